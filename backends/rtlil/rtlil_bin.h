@@ -0,0 +1,75 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  Binary checkpoint format for RTLIL designs, shared by write_rtlil_bin
+ *  and read_rtlil_bin.
+ *
+ *  The file starts with RTLIL_BIN_MAGIC and a version number, followed by
+ *  the value of autoidx and a string table holding every identifier and
+ *  every string constant exactly once. The remainder of the file refers to
+ *  strings by their index in that table.
+ *
+ *  All integers are LEB128 varints; signed values are zigzag encoded. Wires
+ *  are stored as a dense array per module, and SigSpecs are stored as a
+ *  list of chunks that refer to wires by their index in that array.
+ *
+ */
+
+#ifndef RTLIL_BIN_H
+#define RTLIL_BIN_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace RTLIL_BIN {
+	static const char magic[8] = {'Y', 'S', 'R', 'T', 'L', 'B', 'I', 'N'};
+	static const int version = 1;
+
+	// Encoding of a RTLIL::Const
+	enum ConstKind : unsigned char {
+		CONST_BITS01 = 0,   // only 0/1 bits, packed eight per byte
+		CONST_STATES = 1,   // arbitrary bits, one RTLIL::State per byte
+		CONST_STRING = 2    // string backed, stored in the string table
+	};
+
+	// Encoding of a RTLIL::SigChunk
+	enum ChunkKind : unsigned char {
+		CHUNK_WIRE = 0,     // wire index, offset, width
+		CHUNK_CONST = 1     // constant bits as CONST_BITS01/CONST_STATES
+	};
+
+	// Flag bits for RTLIL::Wire
+	enum WireFlags : unsigned char {
+		WIRE_PORT_INPUT = 1,
+		WIRE_PORT_OUTPUT = 2,
+		WIRE_UPTO = 4,
+		WIRE_SIGNED = 8
+	};
+
+	// Encode the given modules as a complete checkpoint and write it to f
+	void write_modules(std::ostream &f, const std::vector<RTLIL::Module*> &modules);
+
+	// Decode a complete checkpoint from memory and add its modules to design
+	void read_modules(RTLIL::Design *design, const std::string &filename, const unsigned char *data, size_t size);
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
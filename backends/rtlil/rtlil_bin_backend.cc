@@ -0,0 +1,329 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  Backend for the binary RTLIL checkpoint format (see rtlil_bin.h).
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "backends/rtlil/rtlil_bin.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+using namespace RTLIL_BIN;
+
+struct RtlilBinWriter
+{
+	std::string buf;
+	idict<std::string> strings;
+	dict<RTLIL::Wire*, int> wire_index;
+	size_t total_size = 0;
+
+	void put_byte(uint8_t v)
+	{
+		buf.push_back(char(v));
+	}
+
+	void put_uint(uint64_t v)
+	{
+		while (v >= 0x80) {
+			buf.push_back(char((v & 0x7f) | 0x80));
+			v >>= 7;
+		}
+		buf.push_back(char(v));
+	}
+
+	void put_sint(int64_t v)
+	{
+		put_uint((uint64_t(v) << 1) ^ uint64_t(v >> 63));
+	}
+
+	void put_string(const std::string &s)
+	{
+		put_uint(strings(s));
+	}
+
+	void put_id(RTLIL::IdString id)
+	{
+		put_string(id.str());
+	}
+
+	void put_bits(const std::vector<RTLIL::State> &bits, int flags, bool with_flags)
+	{
+		bool bits01 = true;
+		for (auto bit : bits)
+			if (bit != RTLIL::State::S0 && bit != RTLIL::State::S1) {
+				bits01 = false;
+				break;
+			}
+
+		put_byte(bits01 ? CONST_BITS01 : CONST_STATES);
+		if (with_flags)
+			put_uint(flags);
+		put_uint(GetSize(bits));
+
+		if (bits01) {
+			for (int i = 0; i < GetSize(bits); i += 8) {
+				uint8_t v = 0;
+				for (int j = 0; j < 8 && i+j < GetSize(bits); j++)
+					if (bits[i+j] == RTLIL::State::S1)
+						v |= 1 << j;
+				put_byte(v);
+			}
+		} else {
+			for (auto bit : bits)
+				put_byte(bit);
+		}
+	}
+
+	void put_const(const RTLIL::Const &value)
+	{
+		if (value.flags & RTLIL::CONST_FLAG_STRING) {
+			std::string str = value.decode_string();
+			if (GetSize(str) * 8 == value.size()) {
+				put_byte(CONST_STRING);
+				put_uint(value.flags);
+				put_string(str);
+				return;
+			}
+		}
+		put_bits(value.to_bits(), value.flags, true);
+	}
+
+	void put_sigspec(const RTLIL::SigSpec &sig)
+	{
+		const std::vector<RTLIL::SigChunk> &chunks = sig.chunks();
+		put_uint(GetSize(chunks));
+		for (auto &chunk : chunks) {
+			if (chunk.wire == nullptr) {
+				put_byte(CHUNK_CONST);
+				put_bits(chunk.data, 0, false);
+			} else {
+				put_byte(CHUNK_WIRE);
+				put_uint(wire_index.at(chunk.wire));
+				put_uint(chunk.offset);
+				put_uint(chunk.width);
+			}
+		}
+	}
+
+	void put_attrs(const dict<RTLIL::IdString, RTLIL::Const> &attrs)
+	{
+		put_uint(GetSize(attrs));
+		for (auto &it : attrs) {
+			put_id(it.first);
+			put_const(it.second);
+		}
+	}
+
+	void put_actions(const std::vector<RTLIL::SigSig> &actions)
+	{
+		put_uint(GetSize(actions));
+		for (auto &it : actions) {
+			put_sigspec(it.first);
+			put_sigspec(it.second);
+		}
+	}
+
+	void put_case(const RTLIL::CaseRule *cs)
+	{
+		put_attrs(cs->attributes);
+		put_uint(GetSize(cs->compare));
+		for (auto &sig : cs->compare)
+			put_sigspec(sig);
+		put_actions(cs->actions);
+		put_uint(GetSize(cs->switches));
+		for (auto sw : cs->switches) {
+			put_attrs(sw->attributes);
+			put_sigspec(sw->signal);
+			put_uint(GetSize(sw->cases));
+			for (auto child : sw->cases)
+				put_case(child);
+		}
+	}
+
+	void put_process(const RTLIL::Process *proc)
+	{
+		put_id(proc->name);
+		put_attrs(proc->attributes);
+		put_case(&proc->root_case);
+		put_uint(GetSize(proc->syncs));
+		for (auto sync : proc->syncs) {
+			put_byte(sync->type);
+			put_sigspec(sync->signal);
+			put_actions(sync->actions);
+			put_uint(GetSize(sync->mem_write_actions));
+			for (auto &act : sync->mem_write_actions) {
+				put_id(act.memid);
+				put_attrs(act.attributes);
+				put_sigspec(act.address);
+				put_sigspec(act.data);
+				put_sigspec(act.enable);
+				put_const(act.priority_mask);
+			}
+		}
+	}
+
+	void put_module(RTLIL::Module *module)
+	{
+		put_id(module->name);
+		put_attrs(module->attributes);
+
+		put_uint(GetSize(module->avail_parameters));
+		for (auto &p : module->avail_parameters) {
+			put_id(p);
+			auto it = module->parameter_default_values.find(p);
+			put_byte(it != module->parameter_default_values.end());
+			if (it != module->parameter_default_values.end())
+				put_const(it->second);
+		}
+
+		wire_index.clear();
+		put_uint(GetSize(module->wires()));
+		for (auto wire : module->wires()) {
+			wire_index[wire] = GetSize(wire_index);
+			put_id(wire->name);
+			put_uint(wire->width);
+			put_sint(wire->start_offset);
+			put_uint(wire->port_id);
+			put_byte((wire->port_input ? WIRE_PORT_INPUT : 0) | (wire->port_output ? WIRE_PORT_OUTPUT : 0) |
+					(wire->upto ? WIRE_UPTO : 0) | (wire->is_signed ? WIRE_SIGNED : 0));
+			put_attrs(wire->attributes);
+		}
+
+		put_uint(GetSize(module->memories));
+		for (auto &it : module->memories) {
+			put_id(it.second->name);
+			put_uint(it.second->width);
+			put_sint(it.second->start_offset);
+			put_uint(it.second->size);
+			put_attrs(it.second->attributes);
+		}
+
+		put_uint(GetSize(module->cells()));
+		for (auto cell : module->cells()) {
+			put_id(cell->name);
+			put_id(cell->type);
+			put_attrs(cell->parameters);
+			put_attrs(cell->attributes);
+			put_uint(GetSize(cell->connections()));
+			for (auto &conn : cell->connections()) {
+				put_id(conn.first);
+				put_sigspec(conn.second);
+			}
+		}
+
+		put_actions(module->connections());
+
+		put_uint(GetSize(module->processes));
+		for (auto &it : module->processes)
+			put_process(it.second);
+	}
+
+	void write(std::ostream &f, const std::vector<RTLIL::Module*> &modules)
+	{
+		put_uint(GetSize(modules));
+		for (auto module : modules)
+			put_module(module);
+
+		// The string table is only complete once the body has been encoded,
+		// but it has to precede the body in the file.
+		std::string body;
+		body.swap(buf);
+
+		buf.append(magic, sizeof(magic));
+		put_uint(version);
+		put_uint(autoidx);
+		put_uint(GetSize(strings));
+		for (auto &s : strings) {
+			put_uint(GetSize(s));
+			buf.append(s);
+		}
+
+		f.write(buf.data(), buf.size());
+		f.write(body.data(), body.size());
+		total_size = buf.size() + body.size();
+	}
+};
+
+struct RtlilBinBackend : public Backend {
+	RtlilBinBackend() : Backend("rtlil_bin", "write design to binary RTLIL checkpoint") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    write_rtlil_bin [options] [filename]\n");
+		log("\n");
+		log("Write the current design to a binary RTLIL checkpoint. The checkpoint holds the\n");
+		log("same information as the output of write_rtlil, but uses a compact encoding\n");
+		log("with a shared string table that is much faster to write and to read back\n");
+		log("with read_rtlil_bin. The format is not meant to be stable across Yosys\n");
+		log("versions; use write_rtlil for long-term storage.\n");
+		log("\n");
+		log("    -selected\n");
+		log("        only write selected modules. (modules are always written as a\n");
+		log("        whole, even if they are only partially selected.)\n");
+		log("\n");
+	}
+	void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool selected = false;
+
+		log_header(design, "Executing binary RTLIL backend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-selected") {
+				selected = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx, true);
+
+		design->sort();
+
+		log("Output filename: %s\n", filename.c_str());
+
+		std::vector<RTLIL::Module*> modules;
+		for (auto module : design->modules())
+			if (!selected || design->selected(module))
+				modules.push_back(module);
+
+		RtlilBinWriter writer;
+		writer.write(*f, modules);
+
+		log("Wrote %zu bytes with %d distinct strings.\n", writer.total_size, GetSize(writer.strings));
+	}
+} RtlilBinBackend;
+
+PRIVATE_NAMESPACE_END
+
+YOSYS_NAMESPACE_BEGIN
+
+void RTLIL_BIN::write_modules(std::ostream &f, const std::vector<RTLIL::Module*> &modules)
+{
+	RtlilBinWriter writer;
+	writer.write(f, modules);
+}
+
+YOSYS_NAMESPACE_END
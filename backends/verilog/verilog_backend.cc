@@ -2380,6 +2380,326 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 	active_initdata.clear();
 }
 
+// Fast path for structural netlists (-fast). It writes exactly what
+// dump_module() writes with -noexpr -noattr, but renders into a large
+// buffer, looks up wire names in a table built once per module and only
+// falls back to the generic dump functions for rare constructs.
+struct FastNetlistWriter
+{
+	static const size_t flush_size = 1 << 20;
+
+	std::ostream &f;
+	std::string buf;
+	dict<RTLIL::Wire*, std::string> wire_names;
+	dict<RTLIL::IdString, std::string> id_names, type_names;
+
+	FastNetlistWriter(std::ostream &f) : f(f)
+	{
+		buf.reserve(flush_size + flush_size / 4);
+	}
+
+	~FastNetlistWriter()
+	{
+		flush();
+	}
+
+	static bool usable()
+	{
+		return noexpr && noattr && !defparam && !siminit && !simple_lhs;
+	}
+
+	static bool usable(RTLIL::Module *module)
+	{
+		if (!module->processes.empty() || !module->memories.empty())
+			return false;
+		for (auto cell : module->cells())
+			if (cell->is_mem_cell())
+				return false;
+		return true;
+	}
+
+	void flush()
+	{
+		f.write(buf.data(), buf.size());
+		buf.clear();
+	}
+
+	void put_uint(uint32_t v)
+	{
+		char tmp[16];
+		int n = 0;
+		do tmp[n++] = '0' + v % 10; while (v /= 10);
+		while (n > 0)
+			buf.push_back(tmp[--n]);
+	}
+
+	void put_int(int v)
+	{
+		if (v < 0) {
+			buf.push_back('-');
+			put_uint(-uint32_t(v));
+		} else
+			put_uint(v);
+	}
+
+	const std::string &id_name(RTLIL::IdString name)
+	{
+		auto it = id_names.find(name);
+		if (it == id_names.end())
+			it = id_names.emplace(name, id(name)).first;
+		return it->second;
+	}
+
+	const std::string &type_name(RTLIL::IdString type)
+	{
+		auto it = type_names.find(type);
+		if (it == type_names.end())
+			it = type_names.emplace(type, id(type, false)).first;
+		return it->second;
+	}
+
+	// Handles fully defined constants in the hex and decimal formats of
+	// dump_const() and hands everything else to dump_const().
+	template<typename T>
+	void put_const(const T &data, int size, int flags, int width, int offset, bool no_decimal)
+	{
+		bool set_signed = (flags & RTLIL::CONST_FLAG_SIGNED) != 0;
+		bool is_string = (flags & RTLIL::CONST_FLAG_STRING) != 0 && width == size;
+		bool fully_def = true;
+
+		for (int i = offset; i < offset+width; i++)
+			if (data[i] != State::S0 && data[i] != State::S1) {
+				fully_def = false;
+				break;
+			}
+
+		if (width == 0 || nohex || !fully_def || (is_string && !nostr)) {
+			std::ostringstream ss;
+			RTLIL::Const value(data);
+			value.flags = flags;
+			dump_const(ss, value, width, offset, no_decimal);
+			buf += ss.str();
+			return;
+		}
+
+		if (width == 32 && !no_decimal && !nodec && !nostr) {
+			int32_t val = 0;
+			for (int i = 0; i < 32; i++)
+				if (data[offset+i] == State::S1)
+					val |= 1 << i;
+			if (decimal) {
+				put_int(val);
+			} else if (set_signed && val < 0) {
+				buf += "-32'sd";
+				put_uint(-uint32_t(val));
+			} else {
+				buf += set_signed ? "32'sd" : "32'd";
+				put_uint(val);
+			}
+			return;
+		}
+
+		put_int(width);
+		buf += set_signed ? "'sh" : "'h";
+		for (int i = (width - 1) & ~3; i >= 0; i -= 4) {
+			int val = 0;
+			for (int j = 0; j < 4 && i+j < width; j++)
+				if (data[offset+i+j] == State::S1)
+					val |= 1 << j;
+			buf.push_back(val < 10 ? '0' + val : 'a' + val - 10);
+		}
+	}
+
+	void put_sigchunk(const RTLIL::SigChunk &chunk, bool no_decimal)
+	{
+		if (chunk.wire == NULL) {
+			put_const(chunk.data, GetSize(chunk.data), 0, chunk.width, chunk.offset, no_decimal);
+			return;
+		}
+
+		const RTLIL::Wire *wire = chunk.wire;
+		buf += wire_names.at(chunk.wire);
+		if (chunk.width == wire->width && chunk.offset == 0)
+			return;
+
+		buf.push_back('[');
+		if (chunk.width == 1) {
+			put_int(wire->upto ? (wire->width - chunk.offset - 1) + wire->start_offset : chunk.offset + wire->start_offset);
+		} else if (wire->upto) {
+			put_int((wire->width - (chunk.offset + chunk.width - 1) - 1) + wire->start_offset);
+			buf.push_back(':');
+			put_int((wire->width - chunk.offset - 1) + wire->start_offset);
+		} else {
+			put_int((chunk.offset + chunk.width - 1) + wire->start_offset);
+			buf.push_back(':');
+			put_int(chunk.offset + wire->start_offset);
+		}
+		buf.push_back(']');
+	}
+
+	void put_sigspec(const RTLIL::SigSpec &sig)
+	{
+		if (GetSize(sig) == 0) {
+			buf += "{0{1'b0}}";
+			return;
+		}
+
+		const std::vector<RTLIL::SigChunk> &chunks = sig.chunks();
+		if (GetSize(chunks) == 1) {
+			put_sigchunk(chunks.front(), false);
+			return;
+		}
+
+		buf += "{ ";
+		for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+			if (it != chunks.rbegin())
+				buf += ", ";
+			put_sigchunk(*it, true);
+		}
+		buf += " }";
+	}
+
+	void put_wire(RTLIL::Wire *wire)
+	{
+		const char *kind = wire->port_input ? (wire->port_output ? "  inout" : "  input") : wire->port_output ? "  output" : nullptr;
+		for (int pass = kind ? 0 : 1; pass < 2; pass++) {
+			buf += pass == 0 ? kind : "  wire";
+			if (wire->width != 1) {
+				buf += " [";
+				put_int(wire->upto ? wire->start_offset : wire->width - 1 + wire->start_offset);
+				buf.push_back(':');
+				put_int(wire->upto ? wire->width - 1 + wire->start_offset : wire->start_offset);
+				buf.push_back(']');
+			}
+			buf.push_back(' ');
+			buf += wire_names.at(wire);
+			buf += ";\n";
+		}
+	}
+
+	void put_cell(RTLIL::Cell *cell)
+	{
+		if (cell->type == ID($scopeinfo))
+			return;
+
+		for (auto &conn : cell->connections())
+			if (conn.first[0] == '$') {
+				// Positional ports are rare enough to not bother.
+				std::ostringstream ss;
+				dump_cell(ss, "  ", cell);
+				buf += ss.str();
+				return;
+			}
+
+		buf += "  ";
+		buf += type_name(cell->type);
+
+		if (!cell->parameters.empty()) {
+			buf += " #(";
+			bool first = true;
+			for (auto &param : cell->parameters) {
+				if (!first)
+					buf.push_back(',');
+				first = false;
+				buf += "\n    .";
+				buf += id_name(param.first);
+				buf.push_back('(');
+				if (param.second.size() > 0)
+					put_const(param.second, param.second.size(), param.second.flags, param.second.size(), 0, false);
+				buf.push_back(')');
+			}
+			buf += "\n  )";
+		}
+
+		std::string name = id(cell->name);
+		buf.push_back(' ');
+		if (!norename && cell->name[0] == '$' && RTLIL::builtin_ff_cell_types().count(cell->type)) {
+			std::string reg_name = cellname(cell);
+			if (reg_name != name) {
+				buf += reg_name;
+				buf += " /* ";
+				buf += name;
+				buf += " */";
+			} else
+				buf += name;
+		} else
+			buf += name;
+		buf += " (";
+
+		bool first = true;
+		for (auto &conn : cell->connections()) {
+			if (!first)
+				buf.push_back(',');
+			first = false;
+			buf += "\n    .";
+			buf += id_name(conn.first);
+			buf.push_back('(');
+			if (conn.second.size() > 0)
+				put_sigspec(conn.second);
+			buf.push_back(')');
+		}
+		buf += "\n  );\n";
+	}
+
+	void dump_module(RTLIL::Module *module)
+	{
+		reg_wires.clear();
+		reset_auto_counter(module);
+		active_module = module;
+
+		wire_names.clear();
+		id_names.clear();
+		wire_names.reserve(GetSize(module->wires_));
+		for (auto wire : module->wires())
+			wire_names.emplace(wire, id(wire->name));
+
+		buf += "\nmodule ";
+		buf += id(module->name, false);
+		buf.push_back('(');
+		int cnt = 0;
+		for (auto port : module->ports) {
+			Wire *wire = module->wire(port);
+			if (wire) {
+				if (port != module->ports[0])
+					buf += ", ";
+				buf += wire_names.at(wire);
+				if (cnt == 20) {
+					buf.push_back('\n');
+					cnt = 0;
+				} else
+					cnt++;
+			}
+		}
+		buf += ");\n";
+
+		for (auto wire : module->wires()) {
+			put_wire(wire);
+			if (buf.size() >= flush_size)
+				flush();
+		}
+
+		for (auto cell : module->cells()) {
+			put_cell(cell);
+			if (buf.size() >= flush_size)
+				flush();
+		}
+
+		for (auto &conn : module->connections()) {
+			buf += "  assign ";
+			put_sigspec(conn.first);
+			buf += " = ";
+			put_sigspec(conn.second);
+			buf += ";\n";
+			if (buf.size() >= flush_size)
+				flush();
+		}
+
+		buf += "endmodule\n";
+		flush();
+		active_module = NULL;
+	}
+};
+
 struct VerilogBackend : public Backend {
 	VerilogBackend() : Backend("verilog", "write design to Verilog file") { }
 	void help() override
@@ -2467,6 +2787,12 @@ struct VerilogBackend : public Backend {
 		log("    -v\n");
 		log("        verbose output (print new names of all renamed wires and cells)\n");
 		log("\n");
+		log("    -fast\n");
+		log("        use a faster writer for modules that only contain wires, cell instances\n");
+		log("        and connections. the output is the same as without this option.\n");
+		log("        requires -noexpr and -noattr, and can't be used with -defparam,\n");
+		log("        -siminit or -simple-lhs.\n");
+		log("\n");
 		log("Note that RTLIL processes can't always be mapped directly to Verilog\n");
 		log("always blocks. This frontend should only be used to export an RTLIL\n");
 		log("netlist, i.e. after the \"proc\" pass has been used to convert all\n");
@@ -2496,6 +2822,7 @@ struct VerilogBackend : public Backend {
 
 		bool blackboxes = false;
 		bool selected = false;
+		bool fast = false;
 
 		auto_name_map.clear();
 		reg_wires.clear();
@@ -2576,9 +2903,15 @@ struct VerilogBackend : public Backend {
 				verbose = true;
 				continue;
 			}
+			if (arg == "-fast") {
+				fast = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
+		if (fast && !FastNetlistWriter::usable())
+			log_cmd_error("Option -fast requires -noexpr and -noattr and can't be used with -defparam, -siminit or -simple-lhs.\n");
 		if (extmem)
 		{
 			if (filename == "<stdout>")
@@ -2607,7 +2940,11 @@ struct VerilogBackend : public Backend {
 				continue;
 			}
 			log("Dumping module `%s'.\n", module->name.c_str());
-			dump_module(*f, "", module);
+			if (fast && FastNetlistWriter::usable(module)) {
+				FastNetlistWriter writer(*f);
+				writer.dump_module(module);
+			} else
+				dump_module(*f, "", module);
 		}
 
 		auto_name_map.clear();
@@ -41,6 +41,7 @@ struct Xaiger2Frontend : public Frontend {
 	Xaiger2Frontend() : Frontend("xaiger2", "(experimental) read XAIGER file")
 	{
 		experimental();
+		bypasses_monitors();
 	}
 
 	void help() override
@@ -29,8 +29,15 @@
 
 #include "kernel/yosys.h"
 #include "libs/sha1/sha1.h"
+#include "backends/rtlil/rtlil_bin.h"
 #include "ast.h"
 
+#if !defined(_WIN32) && !defined(YOSYS_DISABLE_SPAWN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#  define AST_FORK_WORKERS
+#endif
+
 YOSYS_NAMESPACE_BEGIN
 
 using namespace AST;
@@ -1086,6 +1093,21 @@ static bool param_has_no_default(const AstNode *param) {
 		(children.size() == 1 && children[0]->type == AST_RANGE);
 }
 
+static void store_module_flags(AstModule *module)
+{
+	module->nolatches = flag_nolatches;
+	module->nomeminit = flag_nomeminit;
+	module->nomem2reg = flag_nomem2reg;
+	module->mem2reg = flag_mem2reg;
+	module->noblackbox = flag_noblackbox;
+	module->lib = flag_lib;
+	module->nowb = flag_nowb;
+	module->noopt = flag_noopt;
+	module->icells = flag_icells;
+	module->pwires = flag_pwires;
+	module->autowire = flag_autowire;
+}
+
 static RTLIL::Module *process_module(RTLIL::Design *design, AstNode *ast, bool defer, AstNode *original_ast = NULL, bool quiet = false)
 {
 	log_assert(current_scope.empty());
@@ -1285,17 +1307,7 @@ static RTLIL::Module *process_module(RTLIL::Design *design, AstNode *ast, bool d
 	if (ast->type == AST_INTERFACE)
 		module->set_bool_attribute(ID::is_interface);
 	module->ast = ast_before_simplify;
-	module->nolatches = flag_nolatches;
-	module->nomeminit = flag_nomeminit;
-	module->nomem2reg = flag_nomem2reg;
-	module->mem2reg = flag_mem2reg;
-	module->noblackbox = flag_noblackbox;
-	module->lib = flag_lib;
-	module->nowb = flag_nowb;
-	module->noopt = flag_noopt;
-	module->icells = flag_icells;
-	module->pwires = flag_pwires;
-	module->autowire = flag_autowire;
+	store_module_flags(module);
 	module->fixup_ports();
 
 	if (flag_dump_rtlil) {
@@ -1362,9 +1374,221 @@ static void rename_in_package_stmts(AstNode *pkg)
 			rename(item);
 }
 
+static std::string read_binary_file(const std::string &filename)
+{
+	std::ifstream f(filename, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+// wrap a module that has been generated from the given AST elsewhere (by a
+// worker process or by an earlier run) in an AstModule, like process_module()
+static AstModule *adopt_module(const RTLIL::Module *src, AstNode *ast)
+{
+	AstModule *module = new AstModule;
+	module->name = src->name;
+	src->cloneInto(module);
+	module->ast = ast->clone();
+	store_module_flags(module);
+	module->fixup_ports();
+	return module;
+}
+
+#ifdef AST_FORK_WORKERS
+// the log output of a worker is plain text, except for warnings and the final
+// value of autoidx, which are embedded as records starting with '\001' so that
+// the parent can pass them on to log_formatted_warning() and update autoidx
+static FILE *worker_log_file;
+
+static void worker_log_warning(const std::string &prefix, const std::string &message)
+{
+	fprintf(worker_log_file, "\001W %zu %zu\n%s%s", prefix.size(), message.size(), prefix.c_str(), message.c_str());
+}
+
+// body of a worker process forked by process_module_batch(): generate RTLIL for
+// the given modules, each starting with the same autoidx as in the parent,
+// capture the log output and store the result as checkpoint
+[[noreturn]] static void run_module_worker(RTLIL::Design *design, const std::vector<AstNode*> &modules,
+		const std::string &log_filename, const std::string &result_filename)
+{
+	FILE *log_file = fopen(log_filename.c_str(), "w");
+	log_files.clear();
+	log_streams.clear();
+	if (log_file != nullptr)
+		log_files.push_back(log_file);
+	log_errfile = nullptr;
+	log_error_atexit = nullptr;
+	worker_log_file = log_file;
+	log_warning_callback = worker_log_warning;
+
+	bool ok = log_file != nullptr;
+	try {
+		int base_autoidx = autoidx, max_autoidx = autoidx;
+		std::vector<RTLIL::Module*> results;
+		for (auto ast : modules) {
+			autoidx = base_autoidx;
+			results.push_back(process_module(design, ast, false));
+			current_ast_mod = nullptr;
+			max_autoidx = std::max(max_autoidx, autoidx);
+		}
+		if (log_file != nullptr)
+			fprintf(log_file, "\001A %d\n", max_autoidx);
+		std::ofstream f(result_filename, std::ios::binary);
+		RTLIL_BIN::write_modules(f, results);
+		f.close();
+		ok = ok && !f.fail();
+	} catch (...) {
+		ok = false;
+	}
+
+	if (log_file != nullptr)
+		ok = fclose(log_file) == 0 && ok;
+	_exit(ok ? 0 : 1);
+}
+
+// replay the log output of a worker, see worker_log_warning()
+static void replay_worker_log(const std::string &data, int &max_autoidx)
+{
+	size_t pos = 0;
+	while (pos < data.size()) {
+		size_t rec = data.find('\001', pos);
+		if (rec != pos)
+			log("%s", data.substr(pos, rec == std::string::npos ? std::string::npos : rec - pos).c_str());
+		if (rec == std::string::npos)
+			break;
+		size_t eol = data.find('\n', rec);
+		log_assert(eol != std::string::npos);
+		std::string header = data.substr(rec + 1, eol - rec - 1);
+		pos = eol + 1;
+		size_t prefix_len = 0, message_len = 0;
+		int value = 0;
+		if (sscanf(header.c_str(), "W %zu %zu", &prefix_len, &message_len) == 2) {
+			log_assert(pos + prefix_len + message_len <= data.size());
+			log_formatted_warning(data.substr(pos, prefix_len), data.substr(pos + prefix_len, message_len));
+			pos += prefix_len + message_len;
+		} else if (sscanf(header.c_str(), "A %d", &value) == 1) {
+			max_autoidx = std::max(max_autoidx, value);
+		} else
+			log_abort();
+	}
+}
+#endif
+
+// generate RTLIL for a batch of modules in the order given. The AST code keeps
+// its state in globals and the RTLIL kernel is not thread-safe, so modules that
+// do not refer to other modules of the batch are distributed over forked worker
+// processes, which hand back their modules and their log output. Everything else
+// (and everything a worker failed on) is processed here, in the original order.
+// Every module of the batch is generated starting with the same autoidx, so the
+// generated names do not depend on which process handled the module.
+static void process_module_batch(RTLIL::Design *design, const std::vector<AstNode*> &batch, int threads)
+{
+	std::vector<AstModule*> done(batch.size());
+	int base_autoidx = autoidx, max_autoidx = autoidx;
+
+#ifdef AST_FORK_WORKERS
+	pool<std::string> names;
+	for (auto ast : batch)
+		names.insert(ast->str);
+
+	std::vector<int> work;
+	std::vector<int> weight(batch.size());
+	int total_weight = 0;
+	for (int i = 0; i < GetSize(batch); i++) {
+		bool independent = true;
+		std::vector<const AstNode*> queue = {batch[i]};
+		while (!queue.empty()) {
+			const AstNode *node = queue.back();
+			queue.pop_back();
+			weight[i]++;
+			if (node != batch[i]) {
+				std::string name = node->str;
+				if (node->type == AST_INTERFACEPORTTYPE)
+					name = split_modport_from_type(name).first;
+				if (names.count(name))
+					independent = false;
+			}
+			for (auto child : node->children)
+				queue.push_back(child);
+		}
+		if (independent) {
+			work.push_back(i);
+			total_weight += weight[i];
+		}
+	}
+
+	struct worker_t {
+		std::vector<int> modules;
+		std::string log_filename, result_filename;
+		pid_t pid = -1;
+	};
+	std::vector<worker_t> workers;
+
+	// split the independent modules into contiguous ranges of similar size
+	int num_workers = std::min(threads, GetSize(work));
+	if (num_workers > 1) {
+		int acc_weight = 0;
+		workers.resize(num_workers);
+		for (int i : work) {
+			int k = std::min<int>(num_workers - 1, int64_t(acc_weight) * num_workers / total_weight);
+			workers[k].modules.push_back(i);
+			acc_weight += weight[i];
+		}
+	}
+
+	log_flush();
+	for (auto &w : workers) {
+		if (w.modules.empty())
+			continue;
+		std::vector<AstNode*> modules;
+		for (int i : w.modules)
+			modules.push_back(batch[i]);
+		w.log_filename = make_temp_file();
+		w.result_filename = make_temp_file();
+		w.pid = fork();
+		if (w.pid == 0)
+			run_module_worker(design, modules, w.log_filename, w.result_filename);
+	}
+
+	for (auto &w : workers) {
+		if (w.pid < 0)
+			continue;
+		int status = 0;
+		bool ok = waitpid(w.pid, &status, 0) == w.pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		std::string data = ok ? read_binary_file(w.result_filename) : std::string();
+		if (!data.empty()) {
+			replay_worker_log(read_binary_file(w.log_filename), max_autoidx);
+			RTLIL::Design results;
+			RTLIL_BIN::read_modules(&results, w.result_filename, reinterpret_cast<const unsigned char*>(data.data()), data.size());
+			for (int i : w.modules) {
+				RTLIL::Module *result = results.module(batch[i]->str);
+				log_assert(result != nullptr);
+				done[i] = adopt_module(result, batch[i]);
+			}
+		}
+		remove(w.log_filename.c_str());
+		remove(w.result_filename.c_str());
+	}
+#else
+	(void)threads;
+#endif
+
+	for (int i = 0; i < GetSize(batch); i++) {
+		if (done[i] != nullptr) {
+			design->add(done[i]);
+			continue;
+		}
+		autoidx = base_autoidx;
+		process_module(design, batch[i], false);
+		current_ast_mod = nullptr;
+		max_autoidx = std::max(max_autoidx, autoidx);
+	}
+	autoidx = max_autoidx;
+}
+
 // create AstModule instances for all modules in the AST tree and add them to 'design'
 void AST::process(RTLIL::Design *design, AstNode *ast, bool nodisplay, bool dump_ast1, bool dump_ast2, bool no_dump_ptr, bool dump_vlog1, bool dump_vlog2, bool dump_rtlil,
-		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire)
+		bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool noblackbox, bool lib, bool nowb, bool noopt, bool icells, bool pwires, bool nooverwrite, bool overwrite, bool defer, bool autowire,
+		int threads)
 {
 	current_ast = ast;
 	current_ast_mod = nullptr;
@@ -1389,9 +1613,23 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool nodisplay, bool dump
 
 	ast->fixup_hierarchy_flags(true);
 
+	// with -j (threads > 0), consecutive modules are collected and processed as
+	// one batch by process_module_batch() before anything else is processed
+	std::vector<AstNode*> batch;
+	pool<std::string> batch_names;
+	auto flush_batch = [&]() {
+		if (!batch.empty())
+			process_module_batch(design, batch, threads);
+		batch.clear();
+		batch_names.clear();
+	};
+
 	log_assert(current_ast->type == AST_DESIGN);
 	for (AstNode *child : current_ast->children)
 	{
+		if (child->type != AST_MODULE && child->type != AST_INTERFACE)
+			flush_batch();
+
 		if (child->type == AST_MODULE || child->type == AST_INTERFACE)
 		{
 			for (auto n : design->verilog_globals)
@@ -1431,6 +1669,9 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool nodisplay, bool dump
 			if (defer_local)
 				child->str = "$abstract" + child->str;
 
+			if (defer_local || batch_names.count(child->str))
+				flush_batch();
+
 			if (design->has(child->str)) {
 				RTLIL::Module *existing_mod = design->module(child->str);
 				if (!nooverwrite && !overwrite && !existing_mod->get_blackbox_attribute()) {
@@ -1447,6 +1688,12 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool nodisplay, bool dump
 				}
 			}
 
+			if (threads > 0 && !defer_local) {
+				batch.push_back(child);
+				batch_names.insert(child->str);
+				continue;
+			}
+
 			process_module(design, child, defer_local);
 			current_ast_mod = nullptr;
 		}
@@ -1470,6 +1717,8 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool nodisplay, bool dump
 			current_scope.clear();
 		}
 	}
+
+	flush_batch();
 }
 
 // AstModule destructor
@@ -1650,6 +1899,115 @@ void AstModule::expand_interfaces(RTLIL::Design *design, const dict<RTLIL::IdStr
 	new_module->set_bool_attribute(ID::interfaces_replaced_in_module);
 }
 
+// serialize everything about an AST node that can influence the generated RTLIL,
+// collecting the names of the modules it refers to. returns false for ASTs that
+// call system tasks, as their side effects would not be replayed from the cache.
+static bool derive_cache_serialize(std::string &buf, const AstNode *node, pool<std::string> &refs)
+{
+	if (node->type == AST_TCALL && node->str.compare(0, 1, "$") == 0)
+		return false;
+	if (node->type == AST_CELLTYPE)
+		refs.insert(node->str);
+	if (node->type == AST_INTERFACEPORTTYPE)
+		refs.insert(split_modport_from_type(node->str).first);
+
+	buf += stringf("(%d %zu:%s %zu:%s %u.%u-%u.%u", node->type, node->str.size(), node->str.c_str(),
+			node->filename.size(), node->filename.c_str(), node->location.first_line, node->location.first_column,
+			node->location.last_line, node->location.last_column);
+	buf += stringf(" %d%d%d%d%d%d%d%d%d%d%d%d%d%d %d %d %d %u %.17g", node->is_input, node->is_output, node->is_reg,
+			node->is_logic, node->is_signed, node->is_string, node->is_wand, node->is_wor, node->range_valid,
+			node->range_swapped, node->is_unsized, node->is_custom_type, node->is_enum, node->unpacked_dimensions,
+			node->port_id, node->range_left, node->range_right, node->integer, node->realvalue);
+	buf += " ";
+	for (auto bit : node->bits)
+		buf += RTLIL::Const(bit).as_string();
+	for (auto &dim : node->dimensions)
+		buf += stringf(" [%d %d %d]", dim.range_right, dim.range_width, dim.range_swapped);
+	for (auto &attr : node->attributes) {
+		buf += stringf(" %s=", attr.first.c_str());
+		if (!derive_cache_serialize(buf, attr.second, refs))
+			return false;
+	}
+	for (auto child : node->children)
+		if (!derive_cache_serialize(buf, child, refs))
+			return false;
+	buf += ")";
+	return true;
+}
+
+// key for the derive cache: a hash of the AST (with the parameter values already
+// substituted), the frontend flags and the interfaces of the modules it refers
+// to, which simplify() looks up in the design. empty if the AST is not cacheable.
+static std::string derive_cache_key(RTLIL::Design *design, const AstNode *ast)
+{
+	std::string buf = stringf("%s\n%d%d%d%d%d%d%d%d%d%d%d\n", yosys_version_str, flag_nolatches, flag_nomeminit,
+			flag_nomem2reg, flag_mem2reg, flag_noblackbox, flag_lib, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_autowire);
+
+	pool<std::string> refs;
+	if (!derive_cache_serialize(buf, ast, refs))
+		return std::string();
+
+	refs.sort();
+	for (auto &ref : refs) {
+		RTLIL::Module *mod = design->module(ref);
+		if (mod == nullptr)
+			mod = design->module("$abstract" + ref);
+		buf += stringf("\n%s", ref.c_str());
+		if (mod == nullptr)
+			continue;
+		buf += stringf(" %s%s", log_id(mod->name), mod->get_bool_attribute(ID::is_interface) ? " interface" : "");
+		for (auto port : mod->ports) {
+			RTLIL::Wire *wire = mod->wire(port);
+			buf += stringf(" %s:%d:%d%d%d", log_id(port), wire->width, wire->port_input, wire->port_output, wire->is_signed);
+		}
+		for (auto param : mod->avail_parameters)
+			buf += stringf(" %s", log_id(param));
+	}
+
+	return sha1(buf);
+}
+
+// generate RTLIL for a derived module. if the scratchpad variable ast.derive_cache
+// names a directory, modules derived by earlier runs are reused from there.
+static RTLIL::Module *process_derived_module(RTLIL::Design *design, AstNode *ast, bool quiet)
+{
+	std::string cache_dir = design->scratchpad_get_string("ast.derive_cache");
+	std::string key = cache_dir.empty() ? std::string() : derive_cache_key(design, ast);
+	if (key.empty())
+		return process_module(design, ast, false, NULL, quiet);
+
+	std::string filename = cache_dir + "/" + key + ".ybin";
+	if (check_file_exists(filename)) {
+		std::string data = read_binary_file(filename);
+		RTLIL::Design cached;
+		RTLIL_BIN::read_modules(&cached, filename, reinterpret_cast<const unsigned char*>(data.data()), data.size());
+		if (RTLIL::Module *src = cached.module(ast->str)) {
+			if (!quiet)
+				log("Reusing RTLIL representation for module `%s' from derive cache.\n", ast->str.c_str());
+			AstModule *module = adopt_module(src, ast);
+			design->add(module);
+			return module;
+		}
+	}
+
+	RTLIL::Module *module = process_module(design, ast, false, NULL, quiet);
+
+	// write to a temporary file first, so that concurrent runs sharing the
+	// cache never see a partially written entry
+	if (!check_file_exists(cache_dir))
+		create_directory(cache_dir);
+	std::string tmp_filename = make_temp_file(cache_dir + "/derive_XXXXXX");
+	std::ofstream f(tmp_filename, std::ios::binary);
+	RTLIL_BIN::write_modules(f, {module});
+	f.close();
+	if (f.fail() || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+		log("Could not store module `%s' in derive cache %s.\n", ast->str.c_str(), cache_dir.c_str());
+		remove(tmp_filename.c_str());
+	}
+
+	return module;
+}
+
 // create a new parametric module (when needed) and return the name of the generated module - WITH support for interfaces
 // This method is used to explode the interface when the interface is a port of the module (not instantiated inside)
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, const dict<RTLIL::IdString, RTLIL::Const> &parameters, const dict<RTLIL::IdString, RTLIL::Module*> &interfaces, const dict<RTLIL::IdString, RTLIL::IdString> &modports, bool /*mayfail*/)
@@ -1697,7 +2055,7 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, const dict<RTLIL::IdStr
 			explode_interface_port(new_ast, intfmodule, intfname, modport);
 		}
 
-		process_module(design, new_ast, false);
+		process_derived_module(design, new_ast, false);
 		design->module(modname)->check();
 
 		RTLIL::Module* mod = design->module(modname);
@@ -1748,7 +2106,7 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, const dict<RTLIL::IdStr
 
 	if (!design->has(modname) && new_ast) {
 		new_ast->str = modname;
-		process_module(design, new_ast, false, NULL, quiet);
+		process_derived_module(design, new_ast, quiet);
 		design->module(modname)->check();
 	} else if (!quiet) {
 		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
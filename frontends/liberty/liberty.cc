@@ -20,6 +20,7 @@
 #include "passes/techmap/libparse.h"
 #include "kernel/register.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
 
 YOSYS_NAMESPACE_BEGIN
 
@@ -471,6 +472,10 @@ struct LibertyFrontend : public Frontend {
 		log("    -unit_delay\n");
 		log("        import combinational timing arcs under the unit delay model\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        parse the cells of the library on the given number of threads\n");
+		log("        (0 = one per hardware thread)\n");
+		log("\n");
 	}
 	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -483,6 +488,7 @@ struct LibertyFrontend : public Frontend {
 		bool flag_ignore_miss_data_latch = false;
 		bool flag_ignore_buses = false;
 		bool flag_unit_delay = false;
+		int threads = 1;
 		std::vector<std::string> attributes;
 
 		size_t argidx;
@@ -530,6 +536,10 @@ struct LibertyFrontend : public Frontend {
 				flag_unit_delay = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -539,7 +549,7 @@ struct LibertyFrontend : public Frontend {
 
 		log_header(design, "Executing Liberty frontend: %s\n", filename.c_str());
 
-		LibertyParser parser(*f, filename);
+		LibertyParser parser(*f, filename, threads);
 		int cell_count = 0;
 
 		std::map<std::string, std::tuple<int, int, bool>> global_type_map;
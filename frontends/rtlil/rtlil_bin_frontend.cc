@@ -0,0 +1,507 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  Frontend for the binary RTLIL checkpoint format (see rtlil_bin.h).
+ *
+ */
+
+#include "kernel/register.h"
+#include "kernel/log.h"
+#include "backends/rtlil/rtlil_bin.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+using namespace RTLIL_BIN;
+
+struct RtlilBinReader
+{
+	std::string filename;
+	const unsigned char *ptr, *end;
+
+	// String table entries point into the input buffer and are only turned
+	// into IdStrings when they are used as an identifier for the first time.
+	std::vector<std::pair<const char*, size_t>> strings;
+	std::vector<RTLIL::IdString> ids;
+	std::vector<bool> ids_valid;
+	std::vector<RTLIL::Wire*> wires;
+
+	bool flag_nooverwrite = false;
+	bool flag_overwrite = false;
+	bool flag_lib = false;
+
+	RtlilBinReader(const std::string &filename, const unsigned char *data, size_t size) :
+			filename(filename), ptr(data), end(data + size) { }
+
+	[[noreturn]] void corrupt()
+	{
+		log_error("%s: Truncated or corrupt binary RTLIL file.\n", filename.c_str());
+	}
+
+	uint8_t get_byte()
+	{
+		if (ptr == end)
+			corrupt();
+		return *ptr++;
+	}
+
+	uint64_t get_uint()
+	{
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = get_byte();
+			v |= uint64_t(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				return v;
+		}
+		corrupt();
+	}
+
+	int get_int()
+	{
+		uint64_t v = get_uint();
+		if (v > uint64_t(INT_MAX))
+			corrupt();
+		return int(v);
+	}
+
+	int get_sint()
+	{
+		uint64_t v = get_uint();
+		int64_t s = int64_t(v >> 1) ^ -int64_t(v & 1);
+		if (s < INT_MIN || s > INT_MAX)
+			corrupt();
+		return int(s);
+	}
+
+	std::string get_string()
+	{
+		int idx = get_int();
+		if (idx >= GetSize(strings))
+			corrupt();
+		return std::string(strings[idx].first, strings[idx].second);
+	}
+
+	RTLIL::IdString get_id()
+	{
+		int idx = get_int();
+		if (idx >= GetSize(strings))
+			corrupt();
+		if (!ids_valid[idx]) {
+			ids[idx] = RTLIL::IdString(std::string(strings[idx].first, strings[idx].second));
+			ids_valid[idx] = true;
+		}
+		return ids[idx];
+	}
+
+	void get_bits(uint8_t kind, std::vector<RTLIL::State> &bits)
+	{
+		int width = get_int();
+		if (kind == CONST_BITS01) {
+			if (size_t(end - ptr) < size_t(width + 7) / 8)
+				corrupt();
+			bits.resize(width);
+			for (int i = 0; i < width; i++)
+				bits[i] = (ptr[i / 8] >> (i % 8)) & 1 ? RTLIL::State::S1 : RTLIL::State::S0;
+			ptr += (width + 7) / 8;
+		} else if (kind == CONST_STATES) {
+			if (size_t(end - ptr) < size_t(width))
+				corrupt();
+			bits.resize(width);
+			for (int i = 0; i < width; i++) {
+				if (ptr[i] > RTLIL::State::Sm)
+					corrupt();
+				bits[i] = RTLIL::State(ptr[i]);
+			}
+			ptr += width;
+		} else
+			corrupt();
+	}
+
+	RTLIL::Const get_const()
+	{
+		uint8_t kind = get_byte();
+		int flags = get_int();
+		if (kind == CONST_STRING) {
+			RTLIL::Const value(get_string());
+			value.flags = flags;
+			return value;
+		}
+		std::vector<RTLIL::State> bits;
+		get_bits(kind, bits);
+		RTLIL::Const value(std::move(bits));
+		value.flags = flags;
+		return value;
+	}
+
+	RTLIL::SigSpec get_sigspec()
+	{
+		RTLIL::SigSpec sig;
+		int count = get_int();
+		for (int i = 0; i < count; i++) {
+			uint8_t kind = get_byte();
+			if (kind == CHUNK_WIRE) {
+				int idx = get_int();
+				int offset = get_int();
+				int width = get_int();
+				if (idx >= GetSize(wires) || offset + int64_t(width) > wires[idx]->width)
+					corrupt();
+				sig.append(RTLIL::SigSpec(wires[idx], offset, width));
+			} else if (kind == CHUNK_CONST) {
+				std::vector<RTLIL::State> bits;
+				get_bits(get_byte(), bits);
+				sig.append(RTLIL::Const(std::move(bits)));
+			} else
+				corrupt();
+		}
+		return sig;
+	}
+
+	void get_attrs(dict<RTLIL::IdString, RTLIL::Const> &attrs)
+	{
+		int count = get_int();
+		attrs.reserve(count);
+		for (int i = 0; i < count; i++) {
+			RTLIL::IdString name = get_id();
+			attrs[name] = get_const();
+		}
+	}
+
+	void get_actions(std::vector<RTLIL::SigSig> &actions)
+	{
+		int count = get_int();
+		actions.reserve(count);
+		for (int i = 0; i < count; i++) {
+			RTLIL::SigSpec lhs = get_sigspec();
+			RTLIL::SigSpec rhs = get_sigspec();
+			actions.emplace_back(std::move(lhs), std::move(rhs));
+		}
+	}
+
+	void get_case(RTLIL::CaseRule *cs)
+	{
+		get_attrs(cs->attributes);
+		int count = get_int();
+		for (int i = 0; i < count; i++)
+			cs->compare.push_back(get_sigspec());
+		get_actions(cs->actions);
+		count = get_int();
+		for (int i = 0; i < count; i++) {
+			RTLIL::SwitchRule *sw = new RTLIL::SwitchRule;
+			cs->switches.push_back(sw);
+			get_attrs(sw->attributes);
+			sw->signal = get_sigspec();
+			int num_cases = get_int();
+			for (int j = 0; j < num_cases; j++) {
+				RTLIL::CaseRule *child = new RTLIL::CaseRule;
+				sw->cases.push_back(child);
+				get_case(child);
+			}
+		}
+	}
+
+	void get_process(RTLIL::Module *module)
+	{
+		RTLIL::IdString name = get_id();
+		if (module->processes.count(name))
+			corrupt();
+		RTLIL::Process *proc = module->addProcess(name);
+		get_attrs(proc->attributes);
+		get_case(&proc->root_case);
+		int count = get_int();
+		for (int i = 0; i < count; i++) {
+			RTLIL::SyncRule *sync = new RTLIL::SyncRule;
+			proc->syncs.push_back(sync);
+			uint8_t type = get_byte();
+			if (type > RTLIL::STi)
+				corrupt();
+			sync->type = RTLIL::SyncType(type);
+			sync->signal = get_sigspec();
+			get_actions(sync->actions);
+			int num_memwr = get_int();
+			for (int j = 0; j < num_memwr; j++) {
+				RTLIL::MemWriteAction act;
+				act.memid = get_id();
+				get_attrs(act.attributes);
+				act.address = get_sigspec();
+				act.data = get_sigspec();
+				act.enable = get_sigspec();
+				act.priority_mask = get_const();
+				sync->mem_write_actions.push_back(std::move(act));
+			}
+		}
+	}
+
+	void get_module(RTLIL::Design *design)
+	{
+		RTLIL::Module *module = new RTLIL::Module;
+		module->name = get_id();
+		get_attrs(module->attributes);
+
+		bool delete_module = false;
+		if (design->has(module->name)) {
+			RTLIL::Module *existing_mod = design->module(module->name);
+			if (!flag_overwrite && (flag_lib || module->get_bool_attribute(ID::blackbox))) {
+				log("Ignoring blackbox re-definition of module %s.\n", log_id(module->name));
+				delete_module = true;
+			} else if (!flag_nooverwrite && !flag_overwrite && !existing_mod->get_bool_attribute(ID::blackbox)) {
+				log_error("%s: Redefinition of module %s.\n", filename.c_str(), log_id(module->name));
+			} else if (flag_nooverwrite) {
+				log("Ignoring re-definition of module %s.\n", log_id(module->name));
+				delete_module = true;
+			} else {
+				log("Replacing existing%s module %s.\n", existing_mod->get_bool_attribute(ID::blackbox) ? " blackbox" : "", log_id(module->name));
+				design->remove(existing_mod);
+			}
+		}
+		if (!delete_module)
+			design->add(module);
+
+		int count = get_int();
+		for (int i = 0; i < count; i++) {
+			RTLIL::IdString name = get_id();
+			module->avail_parameters(name);
+			if (get_byte())
+				module->parameter_default_values[name] = get_const();
+		}
+
+		count = get_int();
+		wires.clear();
+		wires.reserve(count);
+		module->wires_.reserve(count);
+		for (int i = 0; i < count; i++) {
+			RTLIL::IdString name = get_id();
+			if (module->wire(name) != nullptr)
+				corrupt();
+			RTLIL::Wire *wire = module->addWire(name, get_int());
+			wire->start_offset = get_sint();
+			wire->port_id = get_int();
+			uint8_t flags = get_byte();
+			wire->port_input = (flags & WIRE_PORT_INPUT) != 0;
+			wire->port_output = (flags & WIRE_PORT_OUTPUT) != 0;
+			wire->upto = (flags & WIRE_UPTO) != 0;
+			wire->is_signed = (flags & WIRE_SIGNED) != 0;
+			get_attrs(wire->attributes);
+			wires.push_back(wire);
+		}
+
+		count = get_int();
+		for (int i = 0; i < count; i++) {
+			RTLIL::Memory *memory = new RTLIL::Memory;
+			memory->name = get_id();
+			memory->width = get_int();
+			memory->start_offset = get_sint();
+			memory->size = get_int();
+			get_attrs(memory->attributes);
+			if (module->memories.count(memory->name)) {
+				delete memory;
+				corrupt();
+			}
+			module->memories[memory->name] = memory;
+		}
+
+		count = get_int();
+		module->cells_.reserve(count);
+		for (int i = 0; i < count; i++) {
+			RTLIL::IdString name = get_id();
+			RTLIL::IdString type = get_id();
+			if (module->cell(name) != nullptr)
+				corrupt();
+			RTLIL::Cell *cell = module->addCell(name, type);
+			get_attrs(cell->parameters);
+			get_attrs(cell->attributes);
+			int num_conns = get_int();
+			for (int j = 0; j < num_conns; j++) {
+				RTLIL::IdString port = get_id();
+				cell->setPort(port, get_sigspec());
+			}
+		}
+
+		count = get_int();
+		for (int i = 0; i < count; i++) {
+			RTLIL::SigSpec lhs = get_sigspec();
+			RTLIL::SigSpec rhs = get_sigspec();
+			if (lhs.size() != rhs.size())
+				corrupt();
+			module->connect(lhs, rhs);
+		}
+
+		count = get_int();
+		for (int i = 0; i < count; i++)
+			get_process(module);
+
+		module->fixup_ports();
+		if (delete_module)
+			delete module;
+		else if (flag_lib)
+			module->makeblackbox();
+	}
+
+	void read(RTLIL::Design *design)
+	{
+		if (size_t(end - ptr) < sizeof(magic) || memcmp(ptr, magic, sizeof(magic)))
+			log_error("%s: Not a binary RTLIL file.\n", filename.c_str());
+		ptr += sizeof(magic);
+
+		int file_version = get_int();
+		if (file_version != version)
+			log_error("%s: Unsupported binary RTLIL version %d (expected %d).\n", filename.c_str(), file_version, version);
+
+		autoidx = max(autoidx, get_int());
+
+		int count = get_int();
+		strings.reserve(count);
+		for (int i = 0; i < count; i++) {
+			int len = get_int();
+			if (end - ptr < len)
+				corrupt();
+			strings.emplace_back(reinterpret_cast<const char*>(ptr), len);
+			ptr += len;
+		}
+		ids.resize(count);
+		ids_valid.resize(count);
+
+		count = get_int();
+		for (int i = 0; i < count; i++)
+			get_module(design);
+
+		if (ptr != end)
+			corrupt();
+	}
+};
+
+struct RtlilBinFrontend : public Frontend {
+	RtlilBinFrontend() : Frontend("rtlil_bin", "read modules from binary RTLIL checkpoint") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_rtlil_bin [options] [filename]\n");
+		log("\n");
+		log("Load modules from a binary RTLIL checkpoint written by write_rtlil_bin to the\n");
+		log("current design. Plain files are memory-mapped where the platform supports it.\n");
+		log("\n");
+		log("    -nooverwrite\n");
+		log("        ignore re-definitions of modules. (the default behavior is to\n");
+		log("        create an error message if the existing module is not a blackbox\n");
+		log("        module, and overwrite the existing module if it is a blackbox module.)\n");
+		log("\n");
+		log("    -overwrite\n");
+		log("        overwrite existing modules with the same name\n");
+		log("\n");
+		log("    -lib\n");
+		log("        only create empty blackbox modules\n");
+		log("\n");
+	}
+	void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool flag_nooverwrite = false;
+		bool flag_overwrite = false;
+		bool flag_lib = false;
+
+		log_header(design, "Executing binary RTLIL frontend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-nooverwrite") {
+				flag_nooverwrite = true;
+				flag_overwrite = false;
+				continue;
+			}
+			if (arg == "-overwrite") {
+				flag_nooverwrite = false;
+				flag_overwrite = true;
+				continue;
+			}
+			if (arg == "-lib") {
+				flag_lib = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx, true);
+
+		log("Input filename: %s\n", filename.c_str());
+
+		const unsigned char *data = nullptr;
+		size_t size = 0;
+		std::string buffer;
+
+#ifndef _WIN32
+		// Map the file directly unless it is compressed or not a plain file,
+		// in which case we fall back to reading the (decompressed) stream.
+		void *mapping = MAP_FAILED;
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd >= 0) {
+			struct stat st;
+			if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && size_t(st.st_size) >= sizeof(magic)) {
+				mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapping != MAP_FAILED && memcmp(mapping, magic, sizeof(magic)) != 0) {
+					munmap(mapping, st.st_size);
+					mapping = MAP_FAILED;
+				}
+				if (mapping != MAP_FAILED) {
+					data = static_cast<const unsigned char*>(mapping);
+					size = st.st_size;
+				}
+			}
+			close(fd);
+		}
+#endif
+
+		if (data == nullptr) {
+			buffer.assign(std::istreambuf_iterator<char>(*f), std::istreambuf_iterator<char>());
+			data = reinterpret_cast<const unsigned char*>(buffer.data());
+			size = buffer.size();
+		}
+
+		RtlilBinReader reader(filename, data, size);
+		reader.flag_nooverwrite = flag_nooverwrite;
+		reader.flag_overwrite = flag_overwrite;
+		reader.flag_lib = flag_lib;
+		reader.read(design);
+
+#ifndef _WIN32
+		if (mapping != MAP_FAILED)
+			munmap(mapping, size);
+#endif
+	}
+} RtlilBinFrontend;
+
+PRIVATE_NAMESPACE_END
+
+YOSYS_NAMESPACE_BEGIN
+
+void RTLIL_BIN::read_modules(RTLIL::Design *design, const std::string &filename, const unsigned char *data, size_t size)
+{
+	RtlilBinReader reader(filename, data, size);
+	reader.read(design);
+}
+
+YOSYS_NAMESPACE_END
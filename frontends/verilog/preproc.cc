@@ -35,6 +35,7 @@
 #include "preproc.h"
 #include "verilog_frontend.h"
 #include "kernel/log.h"
+#include "kernel/gzip.h"
 #include <assert.h>
 #include <stack>
 #include <stdarg.h>
@@ -385,6 +386,23 @@ void define_map_t::log() const
 	}
 }
 
+std::string define_map_t::dump() const
+{
+	std::string str;
+	for (auto &it : defines) {
+		const define_body_t &body = *it.second;
+		str += "`define " + it.first;
+		if (body.has_args) {
+			str += "(";
+			for (auto &arg : body.args.args)
+				str += arg.name + (arg.has_default ? "=" + arg.default_value : "") + ",";
+			str += ")";
+		}
+		str += " " + body.body + "\n";
+	}
+	return str;
+}
+
 static void input_file(std::istream &f, std::string filename)
 {
 	char buffer[513];
@@ -912,7 +930,9 @@ frontend_verilog_preproc(std::istream                 &f,
 			if (ff.fail()) {
 				output_code.push_back("`file_notfound " + fn);
 			} else {
-				input_file(ff, fixed_fn);
+				ff.close();
+				std::unique_ptr<std::istream> fi(uncompressed(fixed_fn));
+				input_file(*fi, fixed_fn);
 				yosys_input_files.insert(fixed_fn);
 			}
 			continue;
@@ -60,6 +60,10 @@ struct define_map_t
 	// Print a list of definitions, using the log function
 	void log() const;
 
+	// Return all definitions, including macro arguments, as one string that
+	// can be compared or used as a cache key
+	std::string dump() const;
+
 	std::map<std::string, std::unique_ptr<define_body_t>> defines;
 };
 
@@ -33,6 +33,7 @@
 #include "verilog_frontend.h"
 #include "preproc.h"
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
 #include "libs/sha1/sha1.h"
 #include <stdarg.h>
 
@@ -214,6 +215,14 @@ struct VerilogFrontend : public Frontend {
 		log("    -noautowire\n");
 		log("        make the default of `default_nettype be \"none\" instead of \"wire\".\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        generate RTLIL for modules that do not instantiate each other in\n");
+		log("        parallel, using the given number of worker processes (0 = one per\n");
+		log("        hardware thread). The log output of each worker is replayed once\n");
+		log("        it has finished, and its warnings are counted like any other. The\n");
+		log("        generated RTLIL, including the names of generated objects, does not\n");
+		log("        depend on the number of workers.\n");
+		log("\n");
 		log("    -setattr <attribute_name>\n");
 		log("        set the specified attribute (to the value 1) on all loaded modules\n");
 		log("\n");
@@ -266,6 +275,7 @@ struct VerilogFrontend : public Frontend {
 		bool flag_noblackbox = false;
 		bool flag_nowb = false;
 		bool flag_nosynthesis = false;
+		int threads = -1;
 		define_map_t defines_map;
 
 		std::list<std::string> include_dirs;
@@ -435,6 +445,10 @@ struct VerilogFrontend : public Frontend {
 				default_nettype_wire = false;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (arg == "-setattr" && argidx+1 < args.size()) {
 				attributes.push_back(RTLIL::escape_id(args[++argidx]));
 				continue;
@@ -527,7 +541,8 @@ struct VerilogFrontend : public Frontend {
 			error_on_dpi_function(current_ast);
 
 		AST::process(design, current_ast, flag_nodisplay, flag_dump_ast1, flag_dump_ast2, flag_no_dump_ptr, flag_dump_vlog1, flag_dump_vlog2, flag_dump_rtlil, flag_nolatches,
-				flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, lib_mode, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire);
+				flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_noblackbox, lib_mode, flag_nowb, flag_noopt, flag_icells, flag_pwires, flag_nooverwrite, flag_overwrite, flag_defer, default_nettype_wire,
+				threads);
 
 
 		if (!flag_nopp)
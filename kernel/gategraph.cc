@@ -0,0 +1,91 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/gategraph.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+const std::array<RTLIL::IdString, 5> &GateGraph::input_ports()
+{
+	static const std::array<RTLIL::IdString, 5> ports = {ID::A, ID::B, ID::C, ID::D, ID::S};
+	return ports;
+}
+
+bool GateGraph::is_gate(RTLIL::IdString type)
+{
+	static const pool<RTLIL::IdString> types = {
+		ID($_BUF_), ID($_NOT_), ID($_AND_), ID($_NAND_), ID($_OR_), ID($_NOR_), ID($_XOR_), ID($_XNOR_),
+		ID($_ANDNOT_), ID($_ORNOT_), ID($_MUX_), ID($_NMUX_), ID($_AOI3_), ID($_OAI3_), ID($_AOI4_), ID($_OAI4_)
+	};
+	return types.count(type) != 0;
+}
+
+void GateGraph::build(RTLIL::Module *module)
+{
+	order.clear();
+	drivers.clear();
+
+	std::vector<RTLIL::Cell*> gates;
+	for (auto cell : module->selected_cells()) {
+		if (!is_gate(cell->type) || cell->has_keep_attr())
+			continue;
+		RTLIL::SigBit y = sigmap(cell->getPort(ID::Y));
+		if (y.wire == nullptr || drivers.count(y))
+			continue;
+		drivers[y] = cell;
+		gates.push_back(cell);
+	}
+
+	// Kahn's algorithm; gates on loops never reach a pending count of zero
+	dict<RTLIL::Cell*, int> pending;
+	dict<RTLIL::SigBit, std::vector<RTLIL::Cell*>> readers;
+	for (auto cell : gates) {
+		int count = 0;
+		for (auto port : input_ports()) {
+			if (!cell->hasPort(port))
+				continue;
+			RTLIL::SigBit bit = sigmap(cell->getPort(port));
+			if (drivers.count(bit)) {
+				readers[bit].push_back(cell);
+				count++;
+			}
+		}
+		pending[cell] = count;
+		if (count == 0)
+			order.push_back(cell);
+	}
+
+	for (int i = 0; i < GetSize(order); i++) {
+		auto it = readers.find(sigmap(order[i]->getPort(ID::Y)));
+		if (it == readers.end())
+			continue;
+		for (auto reader : it->second)
+			if (--pending.at(reader) == 0)
+				order.push_back(reader);
+	}
+
+	if (GetSize(order) < GetSize(gates)) {
+		pool<RTLIL::Cell*> ordered(order.begin(), order.end());
+		for (auto cell : gates)
+			if (!ordered.count(cell))
+				drivers.erase(sigmap(cell->getPort(ID::Y)));
+	}
+}
+
+YOSYS_NAMESPACE_END
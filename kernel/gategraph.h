@@ -0,0 +1,57 @@
+/* -*- c++ -*-
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef GATEGRAPH_H
+#define GATEGRAPH_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// The combinational network formed by the simple gate cells ($_AND_, $_MUX_,
+// $_AOI3_ and so on) of a module, as used by the passes that work on gate
+// netlists directly. Gates with a keep attribute, gates driving a constant and
+// all but the first gate driving a signal are left out. So are the gates on
+// combinational loops, and their outputs count as undriven, so that such
+// signals are treated like primary inputs.
+struct GateGraph
+{
+	// the input ports of the gate types, in a fixed order
+	static const std::array<RTLIL::IdString, 5> &input_ports();
+
+	static bool is_gate(RTLIL::IdString type);
+
+	const SigMap &sigmap;
+
+	// the gates in topological order, inputs before readers
+	std::vector<RTLIL::Cell*> order;
+
+	// the gate in 'order' that drives each (sigmapped) signal
+	dict<RTLIL::SigBit, RTLIL::Cell*> drivers;
+
+	GateGraph(const SigMap &sigmap) : sigmap(sigmap) { }
+
+	// Builds the graph from the selected cells of the module.
+	void build(RTLIL::Module *module);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -1,10 +1,12 @@
 #include "kernel/yosys_common.h"
 #include "kernel/log.h"
 #include "kernel/gzip.h"
+#include "kernel/threading.h"
 #include <iostream>
 #include <string>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
 
 #if !defined(WIN32)
 #include <dirent.h>
@@ -13,6 +15,19 @@
 #include <io.h>
 #endif
 
+#ifdef YOSYS_ENABLE_MMAP_INPUT
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(YOSYS_ENABLE_ZLIB) && defined(YOSYS_ENABLE_THREADS)
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
 YOSYS_NAMESPACE_BEGIN
 
 #ifdef YOSYS_ENABLE_ZLIB
@@ -44,7 +59,82 @@ gzip_ostream::obuf::~obuf() {
     }
 }
 
+#ifdef YOSYS_ENABLE_THREADS
+// Decompresses blocks ahead of the reader. At most max_queued blocks are kept
+// around, so memory use stays bounded for large files.
+struct gzip_istream::ibuf::reader_thread {
+	static const int max_queued = 4;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<std::vector<char>> queued, recycled;
+	std::string error;
+	bool done = false, stop = false;
+	std::thread thread;
+
+	reader_thread(gzip_istream::ibuf *owner) {
+		thread = std::thread([this, owner]() {
+			while (1) {
+				std::vector<char> block;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cond.wait(lock, [&]() { return stop || GetSize(queued) < max_queued; });
+					if (stop)
+						return;
+					if (!recycled.empty()) {
+						block.swap(recycled.front());
+						recycled.pop_front();
+					}
+				}
+				std::string block_error;
+				int bytes_read = owner->read_block(block, block_error);
+				std::unique_lock<std::mutex> lock(mutex);
+				if (bytes_read > 0)
+					queued.push_back(std::move(block));
+				else {
+					error = block_error;
+					done = true;
+				}
+				cond.notify_all();
+				if (done)
+					return;
+			}
+		});
+	}
+
+	// Hands out the next block, or returns false at the end of the file.
+	bool next(std::vector<char> &block, std::string &block_error) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!block.empty())
+			recycled.push_back(std::move(block));
+		cond.wait(lock, [&]() { return done || !queued.empty(); });
+		if (queued.empty()) {
+			block_error = error;
+			return false;
+		}
+		block = std::move(queued.front());
+		queued.pop_front();
+		cond.notify_all();
+		return true;
+	}
+
+	~reader_thread() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stop = true;
+			cond.notify_all();
+		}
+		thread.join();
+	}
+};
+#else
+struct gzip_istream::ibuf::reader_thread { };
+#endif
+
+gzip_istream::ibuf::ibuf() : gzf(nullptr) {}
+
 bool gzip_istream::ibuf::open(const std::string& filename) {
+	reader.reset();
 	if (gzf) {
 		Zlib::gzclose(gzf);
 	}
@@ -52,39 +142,68 @@ bool gzip_istream::ibuf::open(const std::string& filename) {
 	if (!gzf) {
 		return false;
 	}
+	Zlib::gzbuffer(gzf, buffer_size);
 	// Empty and point to start
-	setg(buffer, buffer, buffer);
+	buffer.clear();
+	setg(nullptr, nullptr, nullptr);
+#ifdef YOSYS_ENABLE_THREADS
+	if (parallel_thread_count(0) > 1)
+		reader.reset(new reader_thread(this));
+#endif
 	return true;
 }
 
-// Called when the buffer is empty and more input is needed
-std::istream::int_type gzip_istream::ibuf::underflow() {
-	log_assert(gzf && "No gzfile opened\n");
-	int bytes_read = Zlib::gzread(gzf, buffer, buffer_size);
+int gzip_istream::ibuf::read_block(std::vector<char> &block, std::string &error) {
+	block.resize(1 + buffer_size);
+	int bytes_read = Zlib::gzread(gzf, block.data() + 1, buffer_size);
 	if (bytes_read <= 0) {
-		if (Zlib::gzeof(gzf)) {
-			// "On failure, the function ensures that either
-			// gptr() == nullptr or gptr() == egptr."
-			// Let's set gptr to egptr
-			setg(eback(), egptr(), egptr());
-			return traits_type::eof();
-		}
+		if (Zlib::gzeof(gzf))
+			return 0;
 
 		int err;
 		const char* error_msg = Zlib::gzerror(gzf, &err);
 		if (err != Z_OK)
-			log_error("%s", error_msg);
+			error = error_msg;
 		else
-			log_error("Decompression logic failure: "\
-					"read <=0 bytes but neither EOF nor error\n");
+			error = "Decompression logic failure: "\
+					"read <=0 bytes but neither EOF nor error\n";
+		return 0;
+	}
+	block.resize(1 + bytes_read);
+	return bytes_read;
+}
+
+// Called when the buffer is empty and more input is needed
+std::istream::int_type gzip_istream::ibuf::underflow() {
+	log_assert(gzf && "No gzfile opened\n");
+	bool has_last = buffer.size() > 1;
+	char last = has_last ? buffer.back() : 0;
+	std::string error;
+	bool have_block;
+#ifdef YOSYS_ENABLE_THREADS
+	if (reader)
+		have_block = reader->next(buffer, error);
+	else
+#endif
+		have_block = read_block(buffer, error) > 0;
+	if (!have_block) {
+		if (!error.empty())
+			log_error("%s", error.c_str());
+		// "On failure, the function ensures that either
+		// gptr() == nullptr or gptr() == egptr."
+		// Let's set gptr to egptr
+		setg(eback(), egptr(), egptr());
+		return traits_type::eof();
 	}
 
-	// Keep size and point to start
-	setg(buffer, buffer, buffer + bytes_read);
-	return traits_type::to_int_type(buffer[0]);
+	// Keep size and point to start, behind the repeated byte if there is one
+	buffer[0] = last;
+	setg(buffer.data() + (has_last ? 0 : 1), buffer.data() + 1, buffer.data() + buffer.size());
+	return traits_type::to_int_type(buffer[1]);
 }
 
 gzip_istream::ibuf::~ibuf() {
+	reader.reset();
 	if (gzf) {
 		int err = Zlib::gzclose(gzf);
 		if (err != Z_OK) {
@@ -97,9 +216,53 @@ gzip_istream::ibuf::~ibuf() {
 
 #endif // YOSYS_ENABLE_ZLIB
 
+#ifdef YOSYS_ENABLE_MMAP_INPUT
+
+bool mapped_istream::ibuf::open(const std::string& filename) {
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return false;
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+	data = static_cast<char*>(addr);
+	size = st.st_size;
+	setg(data, data, data + size);
+	return true;
+}
+
+std::streambuf::pos_type mapped_istream::ibuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+	if (dir == std::ios_base::cur)
+		off += gptr() - eback();
+	else if (dir == std::ios_base::end)
+		off += size;
+	return seekpos(off, which);
+}
+
+std::streambuf::pos_type mapped_istream::ibuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+	if (!(which & std::ios_base::in) || off_type(pos) < 0 || off_type(pos) > off_type(size))
+		return pos_type(off_type(-1));
+	setg(eback(), eback() + off_type(pos), egptr());
+	return pos;
+}
+
+mapped_istream::ibuf::~ibuf() {
+	if (data)
+		munmap(data, size);
+}
+
+#endif // YOSYS_ENABLE_MMAP_INPUT
 
 // Takes a successfully opened ifstream. If it's gzipped, returns an istream. Otherwise,
-// returns the original ifstream, rewound to the start.
+// returns a stream over a memory mapping of the file where that is supported, and the
+// original ifstream, rewound to the start, otherwise.
 // Never returns nullptr or failed state istream*
 std::istream* uncompressed(const std::string filename, std::ios_base::openmode mode) {
 	if (!check_file_exists(filename))
@@ -133,6 +296,14 @@ std::istream* uncompressed(const std::string filename, std::ios_base::openmode m
 		log_cmd_error("File `%s' is a gzip file, but Yosys is compiled without zlib.\n", filename.c_str());
 #endif // YOSYS_ENABLE_ZLIB
 	} else {
+#ifdef YOSYS_ENABLE_MMAP_INPUT
+		mapped_istream* s = new mapped_istream();
+		if (s->open(filename)) {
+			delete f;
+			return s;
+		}
+		delete s;
+#endif
 		f->clear();
 		f->seekg(0, std::ios::beg);
 		return f;
@@ -1,4 +1,6 @@
 #include <string>
+#include <memory>
+#include <vector>
 #include "kernel/yosys_common.h"
 
 #ifndef YOSYS_GZIP_H
@@ -42,7 +44,9 @@ private:
 
 /*
 An input stream that uses zlib to read gzip-compressed data from a file,
-buffering the decompressed data internally using its own buffer.
+buffering the decompressed data internally in large blocks. When threads
+are available, the blocks are decompressed ahead of the reader by a
+background thread.
 */
 class gzip_istream final : public std::istream {
 public:
@@ -53,7 +57,7 @@ public:
 private:
 	class ibuf final : public std::streambuf {
 	public:
-		ibuf() : gzf(nullptr) {}
+		ibuf();
 		bool open(const std::string& filename);
 		virtual ~ibuf();
 
@@ -61,9 +65,16 @@ private:
 		// Called when the buffer is empty and more input is needed
 		virtual int_type underflow() override;
 	private:
-		static const int buffer_size = 8192;
-		char buffer[buffer_size];
+		static const int buffer_size = 256 * 1024;
+		// Reads the next block into buffer[1..] and returns its size, or 0
+		// at the end of the file. Errors are returned in error.
+		int read_block(std::vector<char> &buffer, std::string &error);
+		// The first byte of each block repeats the last byte of the previous
+		// block so that unget() also works across block boundaries.
+		std::vector<char> buffer;
 		Zlib::gzFile gzf;
+		struct reader_thread;
+		std::unique_ptr<reader_thread> reader;
 	};
 
 	ibuf inbuf;  // The stream buffer instance
@@ -71,6 +82,39 @@ private:
 
 #endif // YOSYS_ENABLE_ZLIB
 
+#if !defined(_WIN32) && !defined(__wasm)
+#define YOSYS_ENABLE_MMAP_INPUT
+
+/*
+An input stream that serves the contents of a regular file directly from a
+read-only memory mapping, without copying it into a stream buffer.
+*/
+class mapped_istream final : public std::istream {
+public:
+	mapped_istream() : std::istream(&inbuf) {}
+	bool open(const std::string& filename) {
+		return inbuf.open(filename);
+	}
+private:
+	class ibuf final : public std::streambuf {
+	public:
+		ibuf() {}
+		bool open(const std::string& filename);
+		virtual ~ibuf();
+
+	protected:
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+	private:
+		char *data = nullptr;
+		size_t size = 0;
+	};
+
+	ibuf inbuf;  // The stream buffer instance
+};
+
+#endif // YOSYS_ENABLE_MMAP_INPUT
+
 std::istream* uncompressed(const std::string filename, std::ios_base::openmode mode = std::ios_base::in);
 
 YOSYS_NAMESPACE_END
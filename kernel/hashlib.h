@@ -1363,6 +1363,18 @@ public:
 		return (*this)[ifind(i)];
 	}
 
+	// Like find(), but without path compression, so that several threads
+	// may call it concurrently as long as nobody modifies the structure.
+	const K &find_shared(const K &a) const
+	{
+		int i = database.at(a, -1);
+		if (i < 0)
+			return a;
+		while (parents[i] != -1)
+			i = parents[i];
+		return (*this)[i];
+	}
+
 	void merge(const K &a, const K &b)
 	{
 		imerge((*this)(a), (*this)(b));
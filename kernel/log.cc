@@ -59,6 +59,7 @@ bool log_quiet_warnings = false;
 int log_verbose_level;
 string log_last_error;
 void (*log_error_atexit)() = NULL;
+void (*log_warning_callback)(const std::string &prefix, const std::string &message) = NULL;
 void (*log_verific_callback)(int msg_type, const char *message_id, const char* file_path, unsigned int left_line, unsigned int left_col, unsigned int right_line, unsigned int right_col, const char *msg) = NULL;
 
 int log_make_debug = 0;
@@ -242,10 +243,13 @@ void logv_header(RTLIL::Design *design, const char *format, va_list ap)
 		log_files.pop_back();
 }
 
-static void logv_warning_with_prefix(const char *prefix,
-                                     const char *format, va_list ap)
+void log_formatted_warning(const std::string &prefix, const std::string &message)
 {
-	std::string message = vstringf(format, ap);
+	if (log_warning_callback) {
+		log_warning_callback(prefix, message);
+		return;
+	}
+
 	bool suppressed = false;
 
 	for (auto &re : log_nowarn_regexes)
@@ -254,7 +258,7 @@ static void logv_warning_with_prefix(const char *prefix,
 
 	if (suppressed)
 	{
-		log("Suppressed %s%s", prefix, message.c_str());
+		log("Suppressed %s%s", prefix.c_str(), message.c_str());
 	}
 	else
 	{
@@ -274,7 +278,7 @@ static void logv_warning_with_prefix(const char *prefix,
 
 		if (log_warnings.count(message))
 		{
-			log("%s%s", prefix, message.c_str());
+			log("%s%s", prefix.c_str(), message.c_str());
 			log_flush();
 		}
 		else
@@ -282,7 +286,7 @@ static void logv_warning_with_prefix(const char *prefix,
 			if (log_errfile != NULL && !log_quiet_warnings)
 				log_files.push_back(log_errfile);
 
-			log("%s%s", prefix, message.c_str());
+			log("%s%s", prefix.c_str(), message.c_str());
 			log_flush();
 
 			if (log_errfile != NULL && !log_quiet_warnings)
@@ -298,6 +302,12 @@ static void logv_warning_with_prefix(const char *prefix,
 	}
 }
 
+static void logv_warning_with_prefix(const char *prefix,
+                                     const char *format, va_list ap)
+{
+	log_formatted_warning(prefix, vstringf(format, ap));
+}
+
 void logv_warning(const char *format, va_list ap)
 {
 	logv_warning_with_prefix("Warning: ", format, ap);
@@ -763,6 +773,16 @@ void log_check_expected()
 #if defined(YOSYS_ENABLE_COVER) && (defined(__linux__) || defined(__FreeBSD__))
 
 dict<std::string, std::pair<std::string, int>> extra_coverage_data;
+thread_local cover_counters_t *cover_thread_counters = nullptr;
+
+void cover_merge_counters(const cover_counters_t &counters)
+{
+	for (auto &it : counters)
+		if (cover_thread_counters == nullptr)
+			it.first->counter += it.second;
+		else
+			(*cover_thread_counters)[it.first] += it.second;
+}
 
 void cover_extra(std::string parent, std::string id, bool increment) {
 	if (extra_coverage_data.count(id) == 0) {
@@ -114,6 +114,9 @@ extern bool log_quiet_warnings;
 extern int log_verbose_level;
 extern string log_last_error;
 extern void (*log_error_atexit)();
+// when set, warnings are handed to this function instead of being logged and
+// counted (e.g. by worker processes that report them to their parent)
+extern void (*log_warning_callback)(const std::string &prefix, const std::string &message);
 
 extern int log_make_debug;
 extern int log_force_debug;
@@ -139,6 +142,7 @@ void log_file_warning(const std::string &filename, int lineno, const char *forma
 void log_file_info(const std::string &filename, int lineno, const char *format, ...) YS_ATTRIBUTE(format(printf, 3, 4));
 
 void log_warning_noprefix(const char *format, ...) YS_ATTRIBUTE(format(printf, 1, 2));
+void log_formatted_warning(const std::string &prefix, const std::string &message);
 [[noreturn]] void log_error(const char *format, ...) YS_ATTRIBUTE(format(printf, 1, 2));
 [[noreturn]] void log_file_error(const string &filename, int lineno, const char *format, ...) YS_ATTRIBUTE(format(printf, 3, 4));
 [[noreturn]] void log_cmd_error(const char *format, ...) YS_ATTRIBUTE(format(printf, 1, 2));
@@ -240,7 +244,7 @@ static inline void log_assert_worker(bool cond, const char *expr, const char *fi
 
 #define cover(_id) do { \
     static CoverData __d __attribute__((section("yosys_cover_list"), aligned(1), used)) = { __FILE__, __FUNCTION__, _id, __LINE__, 0 }; \
-    __d.counter++; \
+    if (cover_thread_counters == nullptr) __d.counter++; else (*cover_thread_counters)[&__d]++; \
 } while (0)
 
 struct CoverData {
@@ -248,6 +252,13 @@ struct CoverData {
 	int line, counter;
 } YS_ATTRIBUTE(packed);
 
+// Worker threads started by parallel_run() count into a thread-local table
+// instead of the shared counters; cover_merge_counters() adds such a table
+// to the counters of the calling thread once the worker has been joined.
+typedef dict<CoverData*, int, hashlib::hash_ptr_ops> cover_counters_t;
+extern thread_local cover_counters_t *cover_thread_counters;
+void cover_merge_counters(const cover_counters_t &counters);
+
 // this two symbols are created by the linker for the "yosys_cover_list" ELF section
 extern "C" struct CoverData __start_yosys_cover_list[];
 extern "C" struct CoverData __stop_yosys_cover_list[];
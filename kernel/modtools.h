@@ -229,6 +229,27 @@ struct ModIndex : public RTLIL::Monitor
 		auto_reload_module = true;
 	}
 
+	void notify_edit(RTLIL::Module *mod, const RTLIL::ModuleEdit &edit) override
+	{
+		log_assert(module == mod);
+
+		if (auto_reload_module)
+			return;
+
+		// a batch touching more bits than the index holds is cheaper to re-index in one go
+		if (edit.connections_replaced || edit.size() > GetSize(database)) {
+			reload_module();
+			return;
+		}
+
+		RTLIL::Monitor::notify_edit(mod, edit);
+
+		// removed wires are only deleted after this, drop their bits now
+		for (auto wire : edit.removed_wires)
+			for (int i = 0; i < GetSize(wire); i++)
+				database.erase(RTLIL::SigBit(wire, i));
+	}
+
 	ModIndex(RTLIL::Module *_m) : sigmap(_m), module(_m)
 	{
 		auto_reload_counter = 0;
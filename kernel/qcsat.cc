@@ -75,6 +75,35 @@ void QuickConeSat::prepare()
 	}
 }
 
+int QuickConeSat::newQuery()
+{
+	return ez->frozen_literal();
+}
+
+void QuickConeSat::assumeQuery(int query, int expr)
+{
+	ez->assume(expr, query);
+}
+
+bool QuickConeSat::solveQuery(int query, std::vector<int> assumptions)
+{
+	prepare();
+	assumptions.push_back(query);
+	std::vector<int> model_exprs;
+	std::vector<bool> model_vals;
+	return ez->solve(model_exprs, model_vals, assumptions);
+}
+
+void QuickConeSat::commitQuery(int query)
+{
+	ez->assume(query);
+}
+
+void QuickConeSat::retractQuery(int query)
+{
+	ez->assume(ez->NOT(query));
+}
+
 int QuickConeSat::cell_complexity(RTLIL::Cell *cell)
 {
 	if (cell->type.in(ID($concat), ID($slice), ID($pos), ID($buf), ID($_BUF_)))
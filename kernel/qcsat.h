@@ -67,6 +67,17 @@ struct QuickConeSat {
 	// the SAT solver.
 	void prepare();
 
+	// Retractable queries, so that many small unrelated queries can share
+	// one solver and the encoding of the cones imported so far. A query is
+	// an activation literal: constraints added with assumeQuery() only hold
+	// in solveQuery() calls for that query, until the query is either made
+	// permanent with commitQuery() or disabled for good with retractQuery().
+	int newQuery();
+	void assumeQuery(int query, int expr);
+	bool solveQuery(int query, std::vector<int> assumptions = {});
+	void commitQuery(int query);
+	void retractQuery(int query);
+
 	// Returns the "complexity level" of a given cell.
 	static int cell_complexity(RTLIL::Cell *cell);
 };
@@ -259,6 +259,9 @@ void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 	auto state = pass_register[args[0]]->pre_execute();
 	pass_register[args[0]]->execute(args, design);
 	pass_register[args[0]]->post_execute(state);
+	if (pass_register[args[0]]->bypasses_monitors_flag)
+		for (auto module : design->modules())
+			module->blackout();
 	while (design->selection_stack.size() > orig_sel_stack_pos)
 		design->pop_selection();
 }
@@ -44,6 +44,15 @@ struct Pass
 		experimental_flag = true;
 	}
 
+	// Set by passes that change modules without reporting it to the monitors,
+	// e.g. by writing to connections_ directly. Pass::call() then calls
+	// Module::blackout() on all modules after the pass.
+	bool bypasses_monitors_flag = false;
+
+	void bypasses_monitors() {
+		bypasses_monitors_flag = true;
+	}
+
 	struct pre_post_exec_state_t {
 		Pass *parent_pass;
 		int64_t begin_ns;
@@ -916,6 +916,11 @@ RTLIL::Design::Design()
 
 RTLIL::Design::~Design()
 {
+	// trackers may hold monitors of the modules, so they go first
+	for (auto &it : trackers) {
+		monitors.erase(it.second);
+		delete it.second;
+	}
 	for (auto &pr : modules_)
 		delete pr.second;
 	for (auto n : bindings_)
@@ -1253,6 +1258,8 @@ RTLIL::Module::Module()
 	design = nullptr;
 	refcount_wires_ = 0;
 	refcount_cells_ = 0;
+	edit_ = nullptr;
+	edit_depth_ = 0;
 
 #ifdef WITH_PYTHON
 	RTLIL::Module::get_all_modules()->insert(std::pair<unsigned int, RTLIL::Module*>(hashidx_, this));
@@ -1261,6 +1268,13 @@ RTLIL::Module::Module()
 
 RTLIL::Module::~Module()
 {
+	if (edit_ != nullptr) {
+		for (auto cell : edit_->removed_cells)
+			delete cell;
+		for (auto wire : edit_->removed_wires)
+			delete wire;
+		delete edit_;
+	}
 	for (auto &pr : wires_)
 		delete pr.second;
 	for (auto &pr : memories)
@@ -2586,6 +2600,9 @@ void RTLIL::Module::add(RTLIL::Cell *cell)
 	log_assert(refcount_cells_ == 0);
 	cells_[cell->name] = cell;
 	cell->module = this;
+
+	if (edit_ != nullptr && edit_->notify)
+		edit_->added_cells.insert(cell);
 }
 
 void RTLIL::Module::add(RTLIL::Process *process)
@@ -2610,6 +2627,7 @@ void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 	{
 		RTLIL::Module *module;
 		const pool<RTLIL::Wire*> *wires_p;
+		bool changed = false;
 
 		void operator()(RTLIL::SigSpec &sig) {
 			sig.pack();
@@ -2617,31 +2635,64 @@ void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 				if (c.wire != NULL && wires_p->count(c.wire)) {
 					c.wire = module->addWire(stringf("$delete_wire$%d", autoidx++), c.width);
 					c.offset = 0;
+					changed = true;
 				}
 		}
 
 		void operator()(RTLIL::SigSpec &lhs, RTLIL::SigSpec &rhs) {
 			// If a deleted wire occurs on the lhs or rhs we just remove that part
 			// of the assignment
+			int width = GetSize(lhs);
 			lhs.remove2(*wires_p, &rhs);
 			rhs.remove2(*wires_p, &lhs);
+			if (GetSize(lhs) != width)
+				changed = true;
 		}
 	};
 
+	// the removed wires are reported to the monitors with notify_edit()
+	// and only deleted after that
+	RTLIL::ModuleEditGuard guard(this);
+
 	DeleteWireWorker delete_wire_worker;
 	delete_wire_worker.module = this;
 	delete_wire_worker.wires_p = &wires;
 	rewrite_sigspecs2(delete_wire_worker);
 
+	// the rewritten references are not reported one by one
+	if (delete_wire_worker.changed)
+		blackout();
+
 	for (auto &it : wires) {
 		log_assert(wires_.count(it->name) != 0);
 		wires_.erase(it->name);
-		delete it;
+		edit_->removed_wires.insert(it);
 	}
 }
 
 void RTLIL::Module::remove(RTLIL::Cell *cell)
 {
+	if (edit_ != nullptr)
+	{
+		log_assert(cells_.count(cell->name) != 0);
+		log_assert(refcount_cells_ == 0);
+
+		if (edit_->notify) {
+			for (auto &conn : cell->connections_)
+				edit_->record_port(cell, conn.first, conn.second, RTLIL::SigSpec());
+			edit_->added_cells.erase(cell);
+		}
+
+		if (yosys_xtrace) {
+			log("#X# Remove %s.%s (deferred)\n", log_id(this), log_id(cell));
+			log_backtrace("-X- ", yosys_xtrace-1);
+		}
+
+		cells_.erase(cell->name);
+		edit_->removed_cells.insert(cell);
+		return;
+	}
+
 	while (!cell->connections_.empty())
 		cell->unsetPort(cell->connections_.begin()->first);
 
@@ -2658,6 +2709,83 @@ void RTLIL::Module::remove(RTLIL::Process *process)
 	delete process;
 }
 
+void RTLIL::Module::begin_edit()
+{
+	if (edit_depth_++ > 0)
+		return;
+
+	log_assert(edit_ == nullptr);
+	edit_ = new RTLIL::ModuleEdit;
+	edit_->notify = !monitors.empty() || (design && !design->monitors.empty());
+}
+
+void RTLIL::Module::commit_edit()
+{
+	log_assert(edit_ != nullptr && edit_depth_ > 0);
+	if (--edit_depth_ > 0)
+		return;
+
+	RTLIL::ModuleEdit *edit = edit_;
+	edit_ = nullptr;
+
+	if (edit->notify)
+	{
+		std::vector<std::pair<RTLIL::Cell*, RTLIL::IdString>> unchanged;
+		for (auto &it : edit->ports)
+			if (it.second.old_sig == it.second.new_sig)
+				unchanged.push_back(it.first);
+		for (auto &key : unchanged)
+			edit->ports.erase(key);
+
+		if (!edit->ports.empty() || !edit->connections.empty() || edit->connections_replaced ||
+				!edit->added_cells.empty() || !edit->removed_cells.empty() || !edit->removed_wires.empty())
+		{
+			for (auto mon : monitors)
+				mon->notify_edit(this, *edit);
+
+			if (design)
+				for (auto mon : design->monitors)
+					mon->notify_edit(this, *edit);
+		}
+	}
+
+	for (auto cell : edit->removed_cells)
+		delete cell;
+	for (auto wire : edit->removed_wires)
+		delete wire;
+	delete edit;
+}
+
+void RTLIL::ModuleEdit::record_port(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec &old_sig, const RTLIL::SigSpec &new_sig)
+{
+	auto r = ports.insert(std::make_pair(cell, port));
+	if (r.second)
+		r.first->second.old_sig = old_sig;
+	r.first->second.new_sig = new_sig;
+}
+
+int RTLIL::ModuleEdit::size() const
+{
+	int count = 0;
+	for (auto &it : ports)
+		count += GetSize(it.second.old_sig) + GetSize(it.second.new_sig);
+	for (auto &conn : connections)
+		count += GetSize(conn.first);
+	return count;
+}
+
+void RTLIL::Monitor::notify_edit(RTLIL::Module *module, const RTLIL::ModuleEdit &edit)
+{
+	for (auto &it : edit.ports)
+		notify_connect(it.first.first, it.first.second, it.second.old_sig, it.second.new_sig);
+
+	if (edit.connections_replaced)
+		notify_connect(module, module->connections());
+	else
+		for (auto &conn : edit.connections)
+			notify_connect(module, conn);
+}
+
 void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
 {
 	log_assert(wires_[wire->name] == wire);
@@ -2665,6 +2793,7 @@ void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
 	wires_.erase(wire->name);
 	wire->name = new_name;
 	add(wire);
+	blackout();
 }
 
 void RTLIL::Module::rename(RTLIL::Cell *cell, RTLIL::IdString new_name)
@@ -2674,6 +2803,7 @@ void RTLIL::Module::rename(RTLIL::Cell *cell, RTLIL::IdString new_name)
 	cells_.erase(cell->name);
 	cell->name = new_name;
 	add(cell);
+	blackout();
 }
 
 void RTLIL::Module::rename(RTLIL::IdString old_name, RTLIL::IdString new_name)
@@ -2700,6 +2830,7 @@ void RTLIL::Module::swap_names(RTLIL::Wire *w1, RTLIL::Wire *w2)
 
 	wires_[w1->name] = w1;
 	wires_[w2->name] = w2;
+	blackout();
 }
 
 void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
@@ -2715,6 +2846,7 @@ void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
 
 	cells_[c1->name] = c1;
 	cells_[c2->name] = c2;
+	blackout();
 }
 
 RTLIL::IdString RTLIL::Module::uniquify(RTLIL::IdString name)
@@ -2753,13 +2885,15 @@ static bool fixup_ports_compare(const RTLIL::Wire *a, const RTLIL::Wire *b)
 
 void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 {
-	for (auto mon : monitors)
-		mon->notify_connect(this, conn);
-
-	if (design)
-		for (auto mon : design->monitors)
+	if (edit_ == nullptr) {
+		for (auto mon : monitors)
 			mon->notify_connect(this, conn);
 
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, conn);
+	}
+
 	// ignore all attempts to assign constants to other constants
 	if (conn.first.has_const()) {
 		RTLIL::SigSig new_conn;
@@ -2780,6 +2914,9 @@ void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 
 	log_assert(GetSize(conn.first) == GetSize(conn.second));
 	connections_.push_back(conn);
+
+	if (edit_ != nullptr && edit_->notify && !edit_->connections_replaced)
+		edit_->connections.push_back(conn);
 }
 
 void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs)
@@ -2789,13 +2926,18 @@ void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs
 
 void RTLIL::Module::new_connections(const std::vector<RTLIL::SigSig> &new_conn)
 {
-	for (auto mon : monitors)
-		mon->notify_connect(this, new_conn);
-
-	if (design)
-		for (auto mon : design->monitors)
+	if (edit_ != nullptr) {
+		edit_->connections_replaced = true;
+		edit_->connections.clear();
+	} else {
+		for (auto mon : monitors)
 			mon->notify_connect(this, new_conn);
 
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, new_conn);
+	}
+
 	if (yosys_xtrace) {
 		log("#X# New connections vector in %s:\n", log_id(this));
 		for (auto &conn: new_conn)
@@ -2811,6 +2953,16 @@ const std::vector<RTLIL::SigSig> &RTLIL::Module::connections() const
 	return connections_;
 }
 
+void RTLIL::Module::blackout()
+{
+	for (auto mon : monitors)
+		mon->notify_blackout(this);
+
+	if (design)
+		for (auto mon : design->monitors)
+			mon->notify_blackout(this);
+}
+
 void RTLIL::Module::fixup_ports()
 {
 	std::vector<RTLIL::Wire*> all_ports;
@@ -2868,6 +3020,22 @@ RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, const RTLIL::Cell *oth
 	cell->connections_ = other->connections_;
 	cell->parameters = other->parameters;
 	cell->attributes = other->attributes;
+
+	// report the copied ports like setPort() would
+	if (edit_ != nullptr) {
+		if (edit_->notify)
+			for (auto &conn : cell->connections_)
+				edit_->record_port(cell, conn.first, RTLIL::SigSpec(), conn.second);
+	} else {
+		for (auto &conn : cell->connections_) {
+			for (auto mon : monitors)
+				mon->notify_connect(cell, conn.first, RTLIL::SigSpec(), conn.second);
+
+			if (design)
+				for (auto mon : design->monitors)
+					mon->notify_connect(cell, conn.first, RTLIL::SigSpec(), conn.second);
+		}
+	}
 	return cell;
 }
 
@@ -3974,13 +4142,18 @@ void RTLIL::Cell::unsetPort(const RTLIL::IdString& portname)
 
 	if (conn_it != connections_.end())
 	{
-		for (auto mon : module->monitors)
-			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
-
-		if (module->design)
-			for (auto mon : module->design->monitors)
+		if (module->edit_ != nullptr) {
+			if (module->edit_->notify)
+				module->edit_->record_port(this, conn_it->first, conn_it->second, signal);
+		} else {
+			for (auto mon : module->monitors)
 				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+			if (module->design)
+				for (auto mon : module->design->monitors)
+					mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+		}
+
 		if (yosys_xtrace) {
 			log("#X# Unconnect %s.%s.%s\n", log_id(this->module), log_id(this), log_id(portname));
 			log_backtrace("-X- ", yosys_xtrace-1);
@@ -4101,13 +4274,18 @@ void RTLIL::Cell::setPort(const RTLIL::IdString& portname, RTLIL::SigSpec signal
 	if (!r.second && conn_it->second == signal)
 		return;
 
-	for (auto mon : module->monitors)
-		mon->notify_connect(this, conn_it->first, conn_it->second, signal);
-
-	if (module->design)
-		for (auto mon : module->design->monitors)
+	if (module->edit_ != nullptr) {
+		if (module->edit_->notify)
+			module->edit_->record_port(this, conn_it->first, conn_it->second, signal);
+	} else {
+		for (auto mon : module->monitors)
 			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+		if (module->design)
+			for (auto mon : module->design->monitors)
+				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+	}
+
 	if (yosys_xtrace) {
 		log("#X# Connect %s.%s.%s = %s (%d)\n", log_id(this->module), log_id(this), log_id(portname), log_signal(signal), GetSize(signal));
 		log_backtrace("-X- ", yosys_xtrace-1);
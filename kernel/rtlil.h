@@ -1254,6 +1254,31 @@ struct RTLIL::Selection
 	static Selection CompleteSelection(RTLIL::Design *design = nullptr) { return Selection(true, true, design); };
 };
 
+// Netlist edits recorded for a module between Module::begin_edit() and
+// Module::commit_edit(). Port changes are coalesced per (cell, port), so
+// each entry holds the signal before the batch and the signal after it.
+// Removed cells and wires are no longer in the module, but stay allocated
+// until all monitors have been notified, as the recorded signals may still
+// refer to them.
+struct RTLIL::ModuleEdit
+{
+	struct PortChange {
+		RTLIL::SigSpec old_sig, new_sig;
+	};
+
+	dict<std::pair<RTLIL::Cell*, RTLIL::IdString>, PortChange> ports;
+	std::vector<RTLIL::SigSig> connections;
+	bool connections_replaced = false;
+	pool<RTLIL::Cell*> added_cells, removed_cells;
+	pool<RTLIL::Wire*> removed_wires;
+
+	// only record port and connection changes when someone is listening
+	bool notify = false;
+
+	void record_port(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec &old_sig, const RTLIL::SigSpec &new_sig);
+	int size() const;
+};
+
 struct RTLIL::Monitor
 {
 	Hasher::hash_t hashidx_;
@@ -1272,6 +1297,9 @@ struct RTLIL::Monitor
 	virtual void notify_connect(RTLIL::Module*, const RTLIL::SigSig&) { }
 	virtual void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) { }
 	virtual void notify_blackout(RTLIL::Module*) { }
+	// called once by Module::commit_edit(); the default replays the batch
+	// through the notify_connect() callbacks above
+	virtual void notify_edit(RTLIL::Module*, const RTLIL::ModuleEdit&);
 };
 
 // Forward declaration; defined in preproc.h.
@@ -1285,6 +1313,10 @@ struct RTLIL::Design
 	pool<RTLIL::Monitor*> monitors;
 	dict<std::string, std::string> scratchpad;
 
+	// Monitors owned by the design, such as the change trackers that passes
+	// keep between runs in incremental mode. See tracker().
+	dict<std::string, RTLIL::Monitor*> trackers;
+
 	bool flagBufferedNormalized = false;
 	void bufNormalize(bool enable=true);
 
@@ -1328,6 +1360,19 @@ struct RTLIL::Design
 	bool scratchpad_get_bool(const std::string &varname, bool default_value = false) const;
 	std::string scratchpad_get_string(const std::string &varname, const std::string &default_value = std::string()) const;
 
+	// Returns the tracker of type T registered under the given name, creating
+	// it and adding it to the design monitors on first use. Trackers are
+	// deleted together with the design.
+	template<typename T> T *tracker(const std::string &name)
+	{
+		RTLIL::Monitor *&mon = trackers[name];
+		if (mon == nullptr) {
+			mon = new T;
+			monitors.insert(mon);
+		}
+		return static_cast<T*>(mon);
+	}
+
 	void sort();
 	void check();
 	void optimize();
@@ -1460,6 +1505,9 @@ public:
 	int refcount_wires_;
 	int refcount_cells_;
 
+	RTLIL::ModuleEdit *edit_;
+	int edit_depth_;
+
 	dict<RTLIL::IdString, RTLIL::Wire*> wires_;
 	dict<RTLIL::IdString, RTLIL::Cell*> cells_;
 
@@ -1493,6 +1541,10 @@ public:
 	void new_connections(const std::vector<RTLIL::SigSig> &new_conn);
 	const std::vector<RTLIL::SigSig> &connections() const;
 
+	// Tells the monitors that the module was changed in ways that were not
+	// reported to them, e.g. by writing to connections_ directly.
+	void blackout();
+
 	std::vector<RTLIL::IdString> ports;
 	void fixup_ports();
 
@@ -1551,6 +1603,17 @@ public:
 	void remove(RTLIL::Cell *cell);
 	void remove(RTLIL::Process *process);
 
+	// Batched netlist edits. Between begin_edit() and commit_edit(), port
+	// changes, connections and cell additions/removals are recorded instead
+	// of being reported to the monitors one by one, and removed cells and
+	// wires are only deleted on commit. Nested batches are merged into the
+	// outermost. Prefer ModuleEditGuard, which also commits on errors.
+	void begin_edit();
+	void commit_edit();
+	bool is_editing() const { return edit_ != nullptr; }
+
+	// Renaming wires and cells calls blackout(), as monitors may index
+	// signals and ports by name.
 	void rename(RTLIL::Wire *wire, RTLIL::IdString new_name);
 	void rename(RTLIL::Cell *cell, RTLIL::IdString new_name);
 	void rename(RTLIL::IdString old_name, RTLIL::IdString new_name);
@@ -1799,6 +1862,20 @@ public:
 #endif
 };
 
+// Scoped Module::begin_edit()/commit_edit() pair. The batch is committed
+// when the guard goes out of scope, including when a pass bails out with
+// an exception, so the module never stays in editing state.
+struct RTLIL::ModuleEditGuard
+{
+	RTLIL::Module *module;
+
+	ModuleEditGuard(RTLIL::Module *module) : module(module) { module->begin_edit(); }
+	~ModuleEditGuard() { module->commit_edit(); }
+
+	ModuleEditGuard(const ModuleEditGuard&) = delete;
+	ModuleEditGuard &operator=(const ModuleEditGuard&) = delete;
+};
+
 namespace RTLIL_BACKEND {
 void dump_wire(std::ostream &f, std::string indent, const RTLIL::Wire *wire);
 }
@@ -320,6 +320,29 @@ struct SigMap
 
 	inline void add(Wire *wire) { return add(RTLIL::SigSpec(wire)); }
 
+	// The map may be read by several threads at once through the *_shared()
+	// methods, provided nothing is added in the meantime and prepare_shared()
+	// was called after the last modification (lookups may otherwise rebuild
+	// the hash table lazily).
+	void prepare_shared() const
+	{
+		database.find(RTLIL::State::S0);
+	}
+
+	RTLIL::SigBit apply_shared(RTLIL::SigBit bit) const
+	{
+		return database.find_shared(bit);
+	}
+
+	RTLIL::SigSpec apply_shared(const RTLIL::SigSpec &sig) const
+	{
+		std::vector<RTLIL::SigBit> bits;
+		bits.reserve(GetSize(sig));
+		for (auto &bit : sig.bits())
+			bits.push_back(database.find_shared(bit));
+		return bits;
+	}
+
 	// Modify bit to its representative
 	void apply(RTLIL::SigBit &bit) const
 	{
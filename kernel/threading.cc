@@ -0,0 +1,122 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/threading.h"
+#include "kernel/log.h"
+
+#ifdef YOSYS_ENABLE_THREADS
+#  include <atomic>
+#  include <exception>
+#  include <mutex>
+#  include <thread>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+int parallel_thread_count(int requested)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	int threads = requested;
+	if (threads <= 0)
+		threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+	const char *max_threads = getenv("YOSYS_MAX_THREADS");
+	if (max_threads != nullptr && atoi(max_threads) > 0)
+		threads = std::min(threads, atoi(max_threads));
+
+	return threads;
+#else
+	(void)requested;
+	return 1;
+#endif
+}
+
+void parallel_run(int threads, const std::function<void(int)> &body)
+{
+#ifdef YOSYS_ENABLE_THREADS
+	if (threads > 1)
+	{
+		std::exception_ptr error;
+		std::mutex error_mutex;
+#if defined(YOSYS_ENABLE_COVER) && (defined(__linux__) || defined(__FreeBSD__))
+		std::vector<cover_counters_t> counters(threads);
+#endif
+
+		auto worker = [&](int thread) {
+#if defined(YOSYS_ENABLE_COVER) && (defined(__linux__) || defined(__FreeBSD__))
+			if (thread > 0)
+				cover_thread_counters = &counters[thread];
+#endif
+			try {
+				body(thread);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (int i = 1; i < threads; i++)
+			workers.emplace_back(worker, i);
+		worker(0);
+		for (auto &it : workers)
+			it.join();
+#if defined(YOSYS_ENABLE_COVER) && (defined(__linux__) || defined(__FreeBSD__))
+		for (int i = 1; i < threads; i++)
+			cover_merge_counters(counters[i]);
+#endif
+
+		if (error)
+			std::rethrow_exception(error);
+		return;
+	}
+#endif
+	for (int i = 0; i < std::max(threads, 1); i++)
+		body(i);
+}
+
+void parallel_for(int threads, int count, const std::function<void(int)> &body, int grain)
+{
+	grain = std::max(grain, 1);
+	threads = std::min(threads, (count + grain - 1) / grain);
+
+#ifdef YOSYS_ENABLE_THREADS
+	if (threads > 1)
+	{
+		std::atomic<int> next(0);
+		parallel_run(threads, [&](int) {
+			while (1) {
+				int begin = next.fetch_add(grain);
+				if (begin >= count)
+					break;
+				int end = std::min(begin + grain, count);
+				for (int i = begin; i < end; i++)
+					body(i);
+			}
+		});
+		return;
+	}
+#endif
+	for (int i = 0; i < count; i++)
+		body(i);
+}
+
+YOSYS_NAMESPACE_END
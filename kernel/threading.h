@@ -0,0 +1,57 @@
+/* -*- c++ -*-
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef THREADING_H
+#define THREADING_H
+
+#include "kernel/yosys_common.h"
+
+#include <functional>
+
+YOSYS_NAMESPACE_BEGIN
+
+// Small helpers for the data-parallel parts of passes.
+//
+// Most of the kernel is not thread safe: creating, copying or destroying an
+// IdString touches the global reference counts, SigSpec and Const convert
+// their representation in const methods, SigMap compresses paths on lookup,
+// and log() writes to shared streams. Worker bodies should therefore only
+// read the netlist objects they own, never log, and store their results in
+// per-index slots that the calling thread applies afterwards.
+
+// Returns the number of threads a pass should use. 'requested' is the value
+// of the pass's -j option; 0 selects one thread per hardware thread. The
+// result is capped by the YOSYS_MAX_THREADS environment variable and is
+// always 1 when Yosys is built without thread support.
+int parallel_thread_count(int requested = 0);
+
+// Calls body(thread) once for every thread in [0, threads), concurrently,
+// with thread 0 running on the calling thread. Returns when all calls have
+// returned; an exception thrown by any call is re-thrown here. Coverage
+// counters hit by cover() on the other threads are kept per thread and added
+// to the shared counters after those threads have been joined.
+void parallel_run(int threads, const std::function<void(int)> &body);
+
+// Calls body(index) for every index in [0, count), handing out blocks of
+// 'grain' consecutive indices to up to 'threads' threads.
+void parallel_for(int threads, int count, const std::function<void(int)> &body, int grain = 1);
+
+YOSYS_NAMESPACE_END
+
+#endif
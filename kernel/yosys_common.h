@@ -196,6 +196,8 @@ namespace RTLIL {
 	struct Module;
 	struct Design;
 	struct Monitor;
+	struct ModuleEdit;
+	struct ModuleEditGuard;
     struct Selection;
 	struct SigChunk;
 	enum State : unsigned char;
@@ -254,7 +254,7 @@ bool abstract_value_mod_port(Module* mod, Wire* wire, std::set<int> offsets, Ena
 			direct_rhs.append(SigBit(to_abstract, port_idx));
 		}
 	}
-	mod->connections_.push_back(SigSig(direct_lhs, direct_rhs));
+	mod->connect(direct_lhs, direct_rhs);
 	emit_mux_anyseq(mod, mux_input, mux_output, enable);
 	return true;
 }
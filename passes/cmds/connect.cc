@@ -33,12 +33,18 @@ static void unset_drivers(RTLIL::Design *design, RTLIL::Module *module, SigMap &
 	RTLIL::Wire *dummy_wire = module->addWire(NEW_ID, sig.size());
 
 	for (auto cell : module->cells())
-	for (auto &port : cell->connections_)
-		if (ct.cell_output(cell->type, port.first))
-			sigmap(port.second).replace(sig, dummy_wire, &port.second);
+	for (auto &port : cell->connections())
+		if (ct.cell_output(cell->type, port.first)) {
+			RTLIL::SigSpec new_sig = port.second;
+			sigmap(port.second).replace(sig, dummy_wire, &new_sig);
+			cell->setPort(port.first, new_sig);
+		}
 
-	for (auto &conn : module->connections_)
+	std::vector<RTLIL::SigSig> new_connections = module->connections();
+	for (auto &conn : new_connections)
 		sigmap(conn.first).replace(sig, dummy_wire, &conn.first);
+	if (new_connections != module->connections())
+		module->new_connections(new_connections);
 }
 
 struct ConnectPass : public Pass {
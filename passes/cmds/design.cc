@@ -26,6 +26,125 @@ YOSYS_NAMESPACE_BEGIN
 std::map<std::string, RTLIL::Design*> saved_designs;
 std::vector<RTLIL::Design*> pushed_designs;
 
+// Snapshots only duplicate modules that actually differ from the copy on the
+// other side. Modules are compared structurally (in iteration order, so that
+// a reused module behaves exactly like a fresh clone) and designs that give
+// up their modules anyway hand them over instead of cloning them.
+
+static bool attrs_identical(const dict<RTLIL::IdString, RTLIL::Const> &a, const dict<RTLIL::IdString, RTLIL::Const> &b)
+{
+	if (GetSize(a) != GetSize(b))
+		return false;
+	for (auto it_a = a.begin(), it_b = b.begin(); it_a != a.end(); ++it_a, ++it_b)
+		if (it_a->first != it_b->first || it_a->second.flags != it_b->second.flags || it_a->second != it_b->second)
+			return false;
+	return true;
+}
+
+static bool sig_identical(const RTLIL::SigSpec &a, const RTLIL::SigSpec &b)
+{
+	if (a.size() != b.size())
+		return false;
+	const std::vector<RTLIL::SigChunk> &chunks_a = a.chunks();
+	const std::vector<RTLIL::SigChunk> &chunks_b = b.chunks();
+	if (GetSize(chunks_a) != GetSize(chunks_b))
+		return false;
+	for (int i = 0; i < GetSize(chunks_a); i++) {
+		auto &ca = chunks_a[i], &cb = chunks_b[i];
+		if ((ca.wire == nullptr) != (cb.wire == nullptr) || ca.width != cb.width)
+			return false;
+		if (ca.wire ? (ca.wire->name != cb.wire->name || ca.offset != cb.offset) : ca.data != cb.data)
+			return false;
+	}
+	return true;
+}
+
+static bool module_identical(const RTLIL::Module *a, const RTLIL::Module *b)
+{
+	// Derived modules (e.g. AST modules) carry state we can not compare.
+	if (typeid(*a) != typeid(RTLIL::Module) || typeid(*b) != typeid(RTLIL::Module))
+		return false;
+	if (!a->processes.empty() || !b->processes.empty() || !a->bindings_.empty() || !b->bindings_.empty())
+		return false;
+
+	if (!attrs_identical(a->attributes, b->attributes) || !attrs_identical(a->parameter_default_values, b->parameter_default_values))
+		return false;
+	if (GetSize(a->avail_parameters) != GetSize(b->avail_parameters))
+		return false;
+	for (int i = 0; i < GetSize(a->avail_parameters); i++)
+		if (a->avail_parameters[i] != b->avail_parameters[i])
+			return false;
+
+	if (GetSize(a->wires_) != GetSize(b->wires_) || GetSize(a->cells_) != GetSize(b->cells_) ||
+			GetSize(a->memories) != GetSize(b->memories) || GetSize(a->connections_) != GetSize(b->connections_))
+		return false;
+
+	for (auto it_a = a->wires_.begin(), it_b = b->wires_.begin(); it_a != a->wires_.end(); ++it_a, ++it_b) {
+		const RTLIL::Wire *wa = it_a->second, *wb = it_b->second;
+		if (wa->name != wb->name || wa->width != wb->width || wa->start_offset != wb->start_offset || wa->port_id != wb->port_id ||
+				wa->port_input != wb->port_input || wa->port_output != wb->port_output || wa->upto != wb->upto ||
+				wa->is_signed != wb->is_signed || !attrs_identical(wa->attributes, wb->attributes))
+			return false;
+	}
+
+	for (auto it_a = a->memories.begin(), it_b = b->memories.begin(); it_a != a->memories.end(); ++it_a, ++it_b) {
+		const RTLIL::Memory *ma = it_a->second, *mb = it_b->second;
+		if (ma->name != mb->name || ma->width != mb->width || ma->start_offset != mb->start_offset ||
+				ma->size != mb->size || !attrs_identical(ma->attributes, mb->attributes))
+			return false;
+	}
+
+	for (auto it_a = a->cells_.begin(), it_b = b->cells_.begin(); it_a != a->cells_.end(); ++it_a, ++it_b) {
+		const RTLIL::Cell *ca = it_a->second, *cb = it_b->second;
+		if (ca->name != cb->name || ca->type != cb->type || GetSize(ca->connections_) != GetSize(cb->connections_) ||
+				!attrs_identical(ca->parameters, cb->parameters) || !attrs_identical(ca->attributes, cb->attributes))
+			return false;
+		for (auto conn_a = ca->connections_.begin(), conn_b = cb->connections_.begin(); conn_a != ca->connections_.end(); ++conn_a, ++conn_b)
+			if (conn_a->first != conn_b->first || !sig_identical(conn_a->second, conn_b->second))
+				return false;
+	}
+
+	for (int i = 0; i < GetSize(a->connections_); i++)
+		if (!sig_identical(a->connections_[i].first, b->connections_[i].first) || !sig_identical(a->connections_[i].second, b->connections_[i].second))
+			return false;
+
+	return true;
+}
+
+// Remove a module from a design without deleting it.
+static void detach_module(RTLIL::Design *design, RTLIL::Module *module)
+{
+	for (auto mon : design->monitors)
+		mon->notify_module_del(module);
+
+	log_assert(design->modules_.at(module->name) == module);
+	log_assert(design->refcount_modules_ == 0);
+	design->modules_.erase(module->name);
+	module->design = nullptr;
+}
+
+// Copy a module into a design, unless the design already holds an identical
+// module under the target name.
+static bool copy_module(RTLIL::Design *copy_to_design, RTLIL::Module *mod, RTLIL::IdString trg_name)
+{
+	RTLIL::Module *existing = copy_to_design->module(trg_name);
+	if (existing != nullptr) {
+		if (module_identical(mod, existing)) {
+			// Re-add to keep the module order of a fresh copy.
+			detach_module(copy_to_design, existing);
+			copy_to_design->add(existing);
+			return false;
+		}
+		copy_to_design->remove(existing);
+	}
+
+	RTLIL::Module *t = mod->clone();
+	t->name = trg_name;
+	t->design = copy_to_design;
+	copy_to_design->add(t);
+	return true;
+}
+
 struct DesignPass : public Pass {
 	DesignPass() : Pass("design", "save, restore and reset current design") { }
 	void on_shutdown() override {
@@ -47,7 +166,9 @@ struct DesignPass : public Pass {
 		log("\n");
 		log("    design -save <name>\n");
 		log("\n");
-		log("Save the current design under the given name.\n");
+		log("Save the current design under the given name. When a design is saved again\n");
+		log("under the same name, or loaded back with -load, modules that are unchanged\n");
+		log("are kept instead of being copied again.\n");
 		log("\n");
 		log("\n");
 		log("    design -stash <name>\n");
@@ -320,26 +441,51 @@ struct DesignPass : public Pass {
 			if (!as_name.empty() && copy_src_modules.size() > 1)
 				log_cmd_error("Only one module can be selected in combination with -as.\n");
 
+			int reused = 0;
 			for (auto mod : copy_src_modules)
 			{
 				std::string trg_name = as_name.empty() ? mod->name.str() : RTLIL::escape_id(as_name);
-
-				if (copy_to_design->module(trg_name) != nullptr)
-					copy_to_design->remove(copy_to_design->module(trg_name));
-
-				RTLIL::Module *t = mod->clone();
-				t->name = trg_name;
-				t->design = copy_to_design;
-				copy_to_design->add(t);
+				if (!copy_module(copy_to_design, mod, trg_name))
+					reused++;
 			}
+
+			if (reused)
+				log("Kept %d identical module%s in the target design.\n", reused, reused == 1 ? "" : "s");
 		}
 
 		if (!save_name.empty() || push_mode || push_copy_mode)
 		{
 			RTLIL::Design *design_copy = new RTLIL::Design;
 
-			for (auto mod : design->modules())
-				design_copy->add(mod->clone());
+			if (push_mode || reset_mode)
+			{
+				// -push and -stash clear the current design, so the modules
+				// can be handed over to the copy as they are.
+				for (auto mod : design->modules().to_vector()) {
+					detach_module(design, mod);
+					design_copy->add(mod);
+				}
+			}
+			else
+			{
+				// Re-saving under an existing name only clones the modules
+				// that changed since the last save.
+				RTLIL::Design *old_copy = saved_designs.count(save_name) ? saved_designs.at(save_name) : nullptr;
+				int reused = 0;
+
+				for (auto mod : design->modules()) {
+					RTLIL::Module *old_mod = old_copy ? old_copy->module(mod->name) : nullptr;
+					if (old_mod != nullptr && module_identical(mod, old_mod)) {
+						detach_module(old_copy, old_mod);
+						design_copy->add(old_mod);
+						reused++;
+					} else
+						design_copy->add(mod->clone());
+				}
+
+				if (reused)
+					log("Kept %d unchanged module%s from the previous save.\n", reused, reused == 1 ? "" : "s");
+			}
 
 			design_copy->selection_stack = design->selection_stack;
 			design_copy->selection_vars = design->selection_vars;
@@ -356,8 +502,14 @@ struct DesignPass : public Pass {
 
 		if (reset_mode || !load_name.empty() || push_mode || pop_mode)
 		{
-			for (auto mod : design->modules().to_vector())
-				design->remove(mod);
+			// Modules identical to the ones about to be loaded are kept.
+			RTLIL::Design *loaded_design = load_name.empty() ? nullptr : saved_designs.at(load_name);
+
+			for (auto mod : design->modules().to_vector()) {
+				RTLIL::Module *loaded_mod = loaded_design ? loaded_design->module(mod->name) : nullptr;
+				if (loaded_mod == nullptr || !module_identical(mod, loaded_mod))
+					design->remove(mod);
+			}
 
 			design->selection_stack.clear();
 			design->selection_vars.clear();
@@ -383,8 +535,25 @@ struct DesignPass : public Pass {
 		{
 			RTLIL::Design *saved_design = pop_mode ? pushed_designs.back() : saved_designs.at(load_name);
 
-			for (auto mod : saved_design->modules())
-				design->add(mod->clone());
+			if (pop_mode) {
+				for (auto mod : saved_design->modules().to_vector()) {
+					detach_module(saved_design, mod);
+					design->add(mod);
+				}
+			} else {
+				int reused = 0;
+				for (auto mod : saved_design->modules()) {
+					RTLIL::Module *kept = design->module(mod->name);
+					if (kept != nullptr) {
+						detach_module(design, kept);
+						design->add(kept);
+						reused++;
+					} else
+						design->add(mod->clone());
+				}
+				if (reused)
+					log("Kept %d unchanged module%s in the current design.\n", reused, reused == 1 ? "" : "s");
+			}
 
 			design->selection_stack = saved_design->selection_stack;
 			design->selection_vars = saved_design->selection_vars;
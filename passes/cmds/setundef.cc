@@ -107,7 +107,9 @@ struct SetundefWorker
 };
 
 struct SetundefPass : public Pass {
-	SetundefPass() : Pass("setundef", "replace undef values with defined constants") { }
+	SetundefPass() : Pass("setundef", "replace undef values with defined constants") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -245,7 +245,9 @@ struct SpliceWorker
 };
 
 struct SplicePass : public Pass {
-	SplicePass() : Pass("splice", "create explicit splicing cells") { }
+	SplicePass() : Pass("splice", "create explicit splicing cells") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
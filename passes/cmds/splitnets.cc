@@ -94,7 +94,9 @@ struct SplitnetsWorker
 };
 
 struct SplitnetsPass : public Pass {
-	SplitnetsPass() : Pass("splitnets", "split up multi-bit nets") { }
+	SplitnetsPass() : Pass("splitnets", "split up multi-bit nets") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
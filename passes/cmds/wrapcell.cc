@@ -125,7 +125,9 @@ std::vector<Chunk> collect_chunks(std::vector<std::pair<IdString, int>> bits)
 }
 
 struct WrapcellPass : Pass {
-	WrapcellPass() : Pass("wrapcell", "wrap individual cells into new modules") {}
+	WrapcellPass() : Pass("wrapcell", "wrap individual cells into new modules") {
+		bypasses_monitors();
+	}
 
 	void help() override
 	{
@@ -19,10 +19,292 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "kernel/threading.h"
+
+#if !defined(_WIN32) && !defined(YOSYS_DISABLE_SPAWN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#  define EQUIV_FORK_WORKERS
+#endif
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// Bit-parallel simulation of the input cones of the $equiv cells, used to
+// settle as many cells as possible before building any SAT problem. Only the
+// $_*_ gates, $lut cells and $equiv cells are simulated, each as a truth table
+// over at most six inputs. A node is "pure" if its cone contains nothing else
+// but free inputs. For a pure cone, a simulation mismatch is a counterexample
+// for the SAT problem of equiv_simple, and exhaustive simulation of a cone with
+// few inputs is a proof.
+struct EquivSimFilter
+{
+	SigMap &sigmap;
+	const dict<SigBit, Cell*> &bit2driver;
+
+	static const int max_exhaustive_inputs = 10;
+	static const int max_exhaustive_nodes = 10000;
+
+	// nodes 0 and 1 are the constants, the inputs of a node precede the node
+	struct node_t {
+		std::vector<int> in;
+		uint64_t table;
+		bool gate, pure;
+	};
+
+	std::vector<node_t> nodes;
+	dict<SigBit, int> bit_to_node;
+	dict<IdString, uint64_t> gate_tables;
+
+	EquivSimFilter(SigMap &sigmap, const dict<SigBit, Cell*> &bit2driver) : sigmap(sigmap), bit2driver(bit2driver)
+	{
+		nodes.push_back({{}, 0, false, true});
+		nodes.push_back({{}, 0, false, true});
+	}
+
+	// truth table of a fine-grained gate, with the inputs A, B, C, D, S as
+	// the bits of the minterm index in that order
+	uint64_t gate_table(IdString type)
+	{
+		auto it = gate_tables.find(type);
+		if (it != gate_tables.end())
+			return it->second;
+
+		uint64_t table = 0;
+		for (int m = 0; m < 16; m++) {
+			bool a = m & 1, b = m & 2, c = m & 4, d = m & 8, y;
+			if (type.in(ID($_BUF_), ID($equiv)))  y = a;
+			else if (type == ID($_NOT_))    y = !a;
+			else if (type == ID($_AND_))    y = a && b;
+			else if (type == ID($_NAND_))   y = !(a && b);
+			else if (type == ID($_OR_))     y = a || b;
+			else if (type == ID($_NOR_))    y = !(a || b);
+			else if (type == ID($_XOR_))    y = a != b;
+			else if (type == ID($_XNOR_))   y = a == b;
+			else if (type == ID($_ANDNOT_)) y = a && !b;
+			else if (type == ID($_ORNOT_))  y = a || !b;
+			else if (type == ID($_MUX_))    y = c ? b : a;
+			else if (type == ID($_NMUX_))   y = !(c ? b : a);
+			else if (type == ID($_AOI3_))   y = !((a && b) || c);
+			else if (type == ID($_OAI3_))   y = !((a || b) && c);
+			else if (type == ID($_AOI4_))   y = !((a && b) || (c && d));
+			else if (type == ID($_OAI4_))   y = !((a || b) && (c || d));
+			else log_abort();
+			if (y)
+				table |= uint64_t(1) << m;
+		}
+		gate_tables[type] = table;
+		return table;
+	}
+
+	// the inputs and truth table of a cell, false for cells that are not simulated
+	bool cell_function(Cell *cell, std::vector<SigBit> &inputs, uint64_t &table)
+	{
+		if (cell->type == ID($lut)) {
+			int width = cell->getParam(ID::WIDTH).as_int();
+			Const lut = cell->getParam(ID::LUT);
+			if (width > 6 || GetSize(lut) < (1 << width))
+				return false;
+			table = 0;
+			for (int m = 0; m < (1 << width); m++) {
+				if (lut[m] == State::S1)
+					table |= uint64_t(1) << m;
+				else if (lut[m] != State::S0)
+					return false;
+			}
+			for (auto bit : sigmap(cell->getPort(ID::A)))
+				inputs.push_back(bit);
+			return true;
+		}
+
+		if (cell->type == ID($equiv)) {
+			table = gate_table(cell->type);
+			inputs.push_back(sigmap(cell->getPort(ID::A)).as_bit());
+			return true;
+		}
+
+		if (!cell->type.in(ID($_BUF_), ID($_NOT_), ID($_AND_), ID($_NAND_), ID($_OR_), ID($_NOR_), ID($_XOR_),
+				ID($_XNOR_), ID($_ANDNOT_), ID($_ORNOT_), ID($_MUX_), ID($_NMUX_), ID($_AOI3_), ID($_OAI3_),
+				ID($_AOI4_), ID($_OAI4_)))
+			return false;
+
+		table = gate_table(cell->type);
+		for (auto port : {ID::A, ID::B, ID::C, ID::D, ID::S})
+			if (cell->hasPort(port))
+				inputs.push_back(sigmap(cell->getPort(port)).as_bit());
+		return true;
+	}
+
+	// the node of a bit, with its input cone added before it
+	int import(SigBit root)
+	{
+		std::vector<std::pair<SigBit, bool>> stack = {{root, false}};
+		pool<SigBit> active;
+		while (!stack.empty())
+		{
+			SigBit bit = stack.back().first;
+			bool expanded = stack.back().second;
+			stack.pop_back();
+
+			if (bit.wire == nullptr || bit_to_node.count(bit))
+				continue;
+
+			// free inputs are pure, outputs of other cells and of
+			// combinational loops are only simulated as inputs
+			auto it = bit2driver.find(bit);
+			std::vector<SigBit> inputs;
+			uint64_t table = 0;
+			if (it == bit2driver.end() || !cell_function(it->second, inputs, table)) {
+				bit_to_node[bit] = GetSize(nodes);
+				nodes.push_back({{}, 0, false, it == bit2driver.end()});
+				continue;
+			}
+
+			if (!expanded) {
+				if (active.count(bit)) {
+					bit_to_node[bit] = GetSize(nodes);
+					nodes.push_back({{}, 0, false, false});
+					continue;
+				}
+				active.insert(bit);
+				stack.push_back({bit, true});
+				for (auto in : inputs)
+					stack.push_back({in, false});
+				continue;
+			}
+
+			active.erase(bit);
+			node_t node = {{}, table, true, true};
+			for (auto in : inputs) {
+				int n = in.wire == nullptr ? (in == State::S1 ? 1 : 0) : bit_to_node.at(in);
+				node.in.push_back(n);
+				node.pure = node.pure && nodes[n].pure;
+			}
+			bit_to_node[bit] = GetSize(nodes);
+			nodes.push_back(node);
+		}
+
+		return root.wire == nullptr ? (root == State::S1 ? 1 : 0) : bit_to_node.at(root);
+	}
+
+	uint64_t eval(const node_t &node, const uint64_t *const *in)
+	{
+		uint64_t y = 0;
+		int k = GetSize(node.in);
+		for (int m = 0; m < (1 << k); m++) {
+			if (((node.table >> m) & 1) == 0)
+				continue;
+			uint64_t term = ~uint64_t(0);
+			for (int i = 0; i < k; i++)
+				term &= ((m >> i) & 1) ? *in[i] : ~*in[i];
+			y |= term;
+		}
+		return y;
+	}
+
+	// simulate the given nodes (in topological order) for the given number of
+	// words, with the values of the constants and inputs already set
+	void simulate(const std::vector<int> &order, std::vector<uint64_t> &vals, const std::vector<int> &pos, int words)
+	{
+		const uint64_t *in[6];
+		for (int n : order) {
+			const node_t &node = nodes[n];
+			if (!node.gate)
+				continue;
+			for (int w = 0; w < words; w++) {
+				for (int i = 0; i < GetSize(node.in); i++)
+					in[i] = &vals[pos[node.in[i]] * words + w];
+				vals[pos[n] * words + w] = eval(node, in);
+			}
+		}
+	}
+
+	// Settle the given cells with the random patterns and, for cones with few
+	// inputs, exhaustive simulation. Returns 1 for a proven cell, -1 for a
+	// refuted cell and 0 for cells that need a SAT proof.
+	std::vector<int> run(const std::vector<Cell*> &cells, int words)
+	{
+		std::vector<std::pair<int, int>> pairs;
+		for (auto cell : cells)
+			pairs.push_back({import(sigmap(cell->getPort(ID::A)).as_bit()), import(sigmap(cell->getPort(ID::B)).as_bit())});
+
+		std::vector<int> order(GetSize(nodes)), pos(GetSize(nodes));
+		for (int n = 0; n < GetSize(nodes); n++)
+			order[n] = pos[n] = n;
+
+		uint64_t rng_state = 1;
+		std::vector<uint64_t> vals(GetSize(nodes) * words);
+		for (int n = 0; n < GetSize(nodes); n++)
+			for (int w = 0; w < words; w++) {
+				if (n == 1)
+					vals[n * words + w] = ~uint64_t(0);
+				else if (n > 1 && !nodes[n].gate) {
+					rng_state ^= rng_state << 13;
+					rng_state ^= rng_state >> 7;
+					rng_state ^= rng_state << 17;
+					vals[n * words + w] = rng_state;
+				}
+			}
+		simulate(order, vals, pos, words);
+
+		std::vector<int> result(GetSize(cells));
+		for (int i = 0; i < GetSize(cells); i++)
+		{
+			int a = pairs[i].first, b = pairs[i].second;
+			if (!nodes[a].pure || !nodes[b].pure)
+				continue;
+			if (!std::equal(&vals[a * words], &vals[a * words] + words, &vals[b * words])) {
+				result[i] = -1;
+				continue;
+			}
+			result[i] = exhaustive(a, b);
+		}
+		return result;
+	}
+
+	int exhaustive(int a, int b)
+	{
+		std::vector<int> cone, inputs;
+		pool<int> seen = {a, b};
+		std::vector<int> stack = {a, b};
+		while (!stack.empty()) {
+			int n = stack.back();
+			stack.pop_back();
+			cone.push_back(n);
+			if (!nodes[n].gate && n > 1)
+				inputs.push_back(n);
+			if (GetSize(inputs) > max_exhaustive_inputs || GetSize(cone) > max_exhaustive_nodes)
+				return 0;
+			for (int in : nodes[n].in)
+				if (seen.insert(in).second)
+					stack.push_back(in);
+		}
+
+		std::sort(cone.begin(), cone.end());
+		std::vector<int> pos(GetSize(nodes));
+		for (int i = 0; i < GetSize(cone); i++)
+			pos[cone[i]] = i;
+
+		// input i selects the i-th bit of the pattern index
+		static const uint64_t masks[6] = {
+			0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+			0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+		};
+		int words = GetSize(inputs) > 6 ? 1 << (GetSize(inputs) - 6) : 1;
+		std::vector<uint64_t> vals(GetSize(cone) * words);
+		for (int i = 0; i < GetSize(cone); i++)
+			for (int w = 0; w < words; w++)
+				if (cone[i] == 1)
+					vals[i * words + w] = ~uint64_t(0);
+		for (int k = 0; k < GetSize(inputs); k++)
+			for (int w = 0; w < words; w++)
+				vals[pos[inputs[k]] * words + w] = k < 6 ? masks[k] : ((w >> (k - 6)) & 1) ? ~uint64_t(0) : 0;
+		simulate(cone, vals, pos, words);
+
+		return std::equal(&vals[pos[a] * words], &vals[pos[a] * words] + words, &vals[pos[b] * words]) ? 1 : -1;
+	}
+};
+
 struct EquivSimpleWorker
 {
 	Module *module;
@@ -275,6 +557,140 @@ struct EquivSimpleWorker
 
 };
 
+struct EquivSimpleContext
+{
+	SigMap &sigmap;
+	dict<SigBit, Cell*> &bit2driver;
+	int max_seq;
+	bool short_cones, verbose, model_undef;
+
+	int run_group(const vector<Cell*> &cells)
+	{
+		EquivSimpleWorker worker(cells, sigmap, bit2driver, max_seq, short_cones, verbose, model_undef);
+		return worker.run();
+	}
+
+#ifdef EQUIV_FORK_WORKERS
+	// runs in a forked worker process, which hands back its log output and the
+	// indices of the cells it has proven (counted over all of its groups)
+	[[noreturn]] void run_worker(const vector<vector<Cell*>> &groups, int begin, int end,
+			const std::string &log_filename, const std::string &result_filename)
+	{
+		FILE *log_file = fopen(log_filename.c_str(), "w");
+		log_files.clear();
+		log_streams.clear();
+		if (log_file != nullptr)
+			log_files.push_back(log_file);
+		log_errfile = nullptr;
+		log_error_atexit = nullptr;
+		log_cmd_error_throw = true;
+
+		bool ok = log_file != nullptr;
+		try {
+			std::ofstream f(result_filename);
+			int index = 0;
+			for (int i = begin; i < end; i++) {
+				run_group(groups[i]);
+				for (auto cell : groups[i]) {
+					if (cell->getPort(ID::A) == cell->getPort(ID::B))
+						f << index << "\n";
+					index++;
+				}
+			}
+			f.close();
+			ok = ok && !f.fail();
+		} catch (...) {
+			ok = false;
+		}
+
+		if (log_file != nullptr)
+			ok = fclose(log_file) == 0 && ok;
+		_exit(ok ? 0 : 1);
+	}
+#endif
+
+	// The groups share no solver state, so with more than one thread they are
+	// split into contiguous ranges that are proven by forked worker processes
+	// (the SAT generator is not thread safe). Groups of a failed worker are
+	// proven here afterwards.
+	int run(const vector<vector<Cell*>> &groups, int threads)
+	{
+		int counter = 0;
+		std::vector<bool> done(GetSize(groups));
+
+#ifdef EQUIV_FORK_WORKERS
+		struct worker_t {
+			int begin, end;
+			std::string log_filename, result_filename;
+			pid_t pid = -1;
+		};
+		std::vector<worker_t> workers;
+
+		int total_cells = 0;
+		for (auto &group : groups)
+			total_cells += GetSize(group);
+
+		int num_workers = std::min(threads, GetSize(groups));
+		if (num_workers > 1) {
+			int acc_cells = 0;
+			for (int i = 0; i < GetSize(groups); i++) {
+				int k = std::min<int>(num_workers - 1, int64_t(acc_cells) * num_workers / total_cells);
+				if (GetSize(workers) <= k) {
+					workers.emplace_back();
+					workers.back().begin = i;
+				}
+				workers.back().end = i + 1;
+				acc_cells += GetSize(groups[i]);
+			}
+		}
+
+		log_flush();
+		for (auto &w : workers) {
+			w.log_filename = make_temp_file();
+			w.result_filename = make_temp_file();
+			w.pid = fork();
+			if (w.pid == 0)
+				run_worker(groups, w.begin, w.end, w.log_filename, w.result_filename);
+		}
+
+		int finished_cells = 0;
+		for (int k = 0; k < GetSize(workers); k++) {
+			worker_t &w = workers[k];
+			int status = 0;
+			if (w.pid > 0 && waitpid(w.pid, &status, 0) == w.pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+				std::ifstream log_f(w.log_filename);
+				std::stringstream buf;
+				buf << log_f.rdbuf();
+				log("%s", buf.str().c_str());
+
+				std::vector<Cell*> cells;
+				for (int i = w.begin; i < w.end; i++) {
+					cells.insert(cells.end(), groups[i].begin(), groups[i].end());
+					done[i] = true;
+				}
+				std::ifstream f(w.result_filename);
+				int proven = 0;
+				for (int index; f >> index; proven++)
+					cells.at(index)->setPort(ID::B, cells.at(index)->getPort(ID::A));
+				counter += proven;
+				finished_cells += GetSize(cells);
+				log("  Worker %d of %d finished, %d of %d $equiv cells done, %d proven so far.\n",
+						k+1, GetSize(workers), finished_cells, total_cells, counter);
+			}
+			remove(w.log_filename.c_str());
+			remove(w.result_filename.c_str());
+		}
+#else
+		(void)threads;
+#endif
+
+		for (int i = 0; i < GetSize(groups); i++)
+			if (!done[i])
+				counter += run_group(groups[i]);
+		return counter;
+	}
+};
+
 struct EquivSimplePass : public Pass {
 	EquivSimplePass() : Pass("equiv_simple", "try proving simple $equiv instances") { }
 	void help() override
@@ -301,12 +717,25 @@ struct EquivSimplePass : public Pass {
 		log("    -seq <N>\n");
 		log("        the max. number of time steps to be considered (default = 1)\n");
 		log("\n");
+		log("    -nosim\n");
+		log("        do not simulate the input cones before building the SAT problems.\n");
+		log("        By default, cells with cones made only of $_*_ gates, $lut and $equiv\n");
+		log("        cells are simulated with random patterns first, which disproves cells\n");
+		log("        with a mismatch and proves cells with few inputs exhaustively. This\n");
+		log("        is always disabled with -undef.\n");
+		log("\n");
+		log("    -j <threads>\n");
+		log("        prove the groups of $equiv cells in the given number of worker\n");
+		log("        processes, each with its own SAT solver (0 = one per hardware thread,\n");
+		log("        default = 1)\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, Design *design) override
 	{
-		bool verbose = false, short_cones = false, model_undef = false, nogroup = false;
+		bool verbose = false, short_cones = false, model_undef = false, nogroup = false, nosim = false;
 		int success_counter = 0;
 		int max_seq = 1;
+		int threads = 1;
 
 		log_header(design, "Executing EQUIV_SIMPLE pass.\n");
 
@@ -332,6 +761,14 @@ struct EquivSimplePass : public Pass {
 				max_seq = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				nosim = true;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -375,6 +812,7 @@ struct EquivSimplePass : public Pass {
 			}
 
 			unproven_equiv_cells.sort();
+			vector<vector<Cell*>> groups;
 			for (auto it : unproven_equiv_cells)
 			{
 				it.second.sort();
@@ -382,10 +820,52 @@ struct EquivSimplePass : public Pass {
 				vector<Cell*> cells;
 				for (auto it2 : it.second)
 					cells.push_back(it2.second);
+				groups.push_back(cells);
+			}
 
-				EquivSimpleWorker worker(cells, sigmap, bit2driver, max_seq, short_cones, verbose, model_undef);
-				success_counter += worker.run();
+			if (!nosim && !model_undef)
+			{
+				vector<Cell*> cells;
+				for (auto &group : groups)
+					cells.insert(cells.end(), group.begin(), group.end());
+
+				EquivSimFilter filter(sigmap, bit2driver);
+				std::vector<int> result = filter.run(cells, 4);
+
+				pool<Cell*> settled;
+				int proven = 0, refuted = 0;
+				for (int i = 0; i < GetSize(cells); i++) {
+					if (result[i] == 0)
+						continue;
+					if (result[i] > 0) {
+						if (verbose)
+							log("  Proved $equiv cell %s by simulation.\n", log_id(cells[i]));
+						cells[i]->setPort(ID::B, cells[i]->getPort(ID::A));
+						proven++;
+					} else {
+						if (verbose)
+							log("  Disproved $equiv cell %s by simulation.\n", log_id(cells[i]));
+						refuted++;
+					}
+					settled.insert(cells[i]);
+				}
+				log("Simulation proved %d and disproved %d of %d $equiv cells.\n", proven, refuted, GetSize(cells));
+				success_counter += proven;
+
+				vector<vector<Cell*>> remaining;
+				for (auto &group : groups) {
+					vector<Cell*> unsettled;
+					for (auto cell : group)
+						if (!settled.count(cell))
+							unsettled.push_back(cell);
+					if (!unsettled.empty())
+						remaining.push_back(unsettled);
+				}
+				groups.swap(remaining);
 			}
+
+			EquivSimpleContext ctx = {sigmap, bit2driver, max_seq, short_cones, verbose, model_undef};
+			success_counter += ctx.run(groups, threads);
 		}
 
 		log("Proved %d previously unproven $equiv cells.\n", success_counter);
@@ -414,7 +414,9 @@ static void extract_fsm(RTLIL::Wire *wire)
 }
 
 struct FsmExtractPass : public Pass {
-	FsmExtractPass() : Pass("fsm_extract", "extracting FSMs in design") { }
+	FsmExtractPass() : Pass("fsm_extract", "extracting FSMs in design") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
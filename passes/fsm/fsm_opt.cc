@@ -323,7 +323,9 @@ void YOSYS_NAMESPACE_PREFIX FsmData::optimize_fsm(RTLIL::Cell *cell, RTLIL::Modu
 PRIVATE_NAMESPACE_BEGIN
 
 struct FsmOptPass : public Pass {
-	FsmOptPass() : Pass("fsm_opt", "optimize finite state machines") { }
+	FsmOptPass() : Pass("fsm_opt", "optimize finite state machines") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -727,7 +727,9 @@ RTLIL::Wire *find_implicit_port_wire(Module *module, Cell *cell, const std::stri
 }
 
 struct HierarchyPass : public Pass {
-	HierarchyPass() : Pass("hierarchy", "check, expand and clean up design hierarchy") { }
+	HierarchyPass() : Pass("hierarchy", "check, expand and clean up design hierarchy") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -761,6 +763,13 @@ struct HierarchyPass : public Pass {
 		log("        for unknown modules and automatically run read_verilog for each\n");
 		log("        unknown module.\n");
 		log("\n");
+		log("    -derive_cache <directory>\n");
+		log("        store modules derived from Verilog ASTs in the specified directory\n");
+		log("        and reuse them when the same module is derived with the same\n");
+		log("        parameters again, e.g. in a later run of the same flow. this sets\n");
+		log("        the scratchpad variable 'ast.derive_cache', so that later calls to\n");
+		log("        hierarchy use the cache as well.\n");
+		log("\n");
 		log("    -keep_positionals\n");
 		log("        per default this pass also converts positional arguments in cells\n");
 		log("        to arguments using port names. This option disables this behavior.\n");
@@ -922,6 +931,10 @@ struct HierarchyPass : public Pass {
 				libdirs.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-derive_cache" && argidx+1 < args.size()) {
+				design->scratchpad_set_string("ast.derive_cache", args[++argidx]);
+				continue;
+			}
 			if (args[argidx] == "-top") {
 				if (++argidx >= args.size())
 					log_cmd_error("Option -top requires an additional argument!\n");
@@ -607,8 +607,9 @@ struct MemoryDffWorker
 	void run()
 	{
 		std::vector<Mem> memories = Mem::get_selected_memories(module);
+		// all memories share one solver, their enable and address cones often overlap
+		QuickConeSat qcsat(modwalker);
 		for (auto &mem : memories) {
-			QuickConeSat qcsat(modwalker);
 			for (int i = 0; i < GetSize(mem.rd_ports); i++) {
 				if (!mem.rd_ports[i].clk_enable)
 					handle_rd_port(mem, qcsat, i);
@@ -25,6 +25,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/mem.h"
 #include "kernel/qcsat.h"
+#include "kernel/threading.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -132,11 +133,13 @@ typedef std::vector<MemConfig> MemConfigs;
 struct MapWorker {
 	Module *module;
 	ModWalker modwalker;
+	// shared by all memories until the module is modified
+	QuickConeSat qcsat;
 	SigMap sigmap;
 	SigMap sigmap_xmux;
 	FfInitVals initvals;
 
-	MapWorker(Module *module) : module(module), modwalker(module->design, module), sigmap(module), sigmap_xmux(module), initvals(&sigmap, module) {
+	MapWorker(Module *module) : module(module), modwalker(module->design, module), qcsat(modwalker), sigmap(module), sigmap_xmux(module), initvals(&sigmap, module) {
 		for (auto cell : module->cells())
 		{
 			if (cell->type == ID($mux))
@@ -168,9 +171,21 @@ struct Swizzle {
 	std::vector<std::vector<SwizzleBit>> bits;
 };
 
+// A SAT query asked while analyzing a memory, and its answer.
+struct SatFact {
+	enum Kind {
+		WrImpliesRd,
+		WrExcludesRd,
+		WrExcludesSrst,
+	} kind;
+	int wpidx;
+	int rpidx;
+	bool result;
+};
+
 struct MemMapping {
 	MapWorker &worker;
-	QuickConeSat qcsat;
+	QuickConeSat &qcsat;
 	Mem &mem;
 	const Library &lib;
 	const PassOptions &opts;
@@ -184,14 +199,35 @@ struct MemMapping {
 	dict<std::pair<int, int>, bool> wr_excludes_rd_cache;
 	dict<std::pair<int, int>, bool> wr_excludes_srst_cache;
 	std::string rejected_cfg_debug_msgs;
+	// SAT queries asked so far, in order.
+	std::vector<SatFact> sat_facts;
+	// Everything the analysis looks at, with signals replaced by the index of
+	// their first occurrence in shape_bits.  Memories with the same key get
+	// the same candidates, provided that their SAT queries agree as well.
+	std::string shape_key;
+	std::vector<SigBit> shape_bits;
+	dict<SigBit, int> shape_ids;
+	// Per write port: number of distinct enable bits, the bit positions
+	// where the enable differs from the previous bit, and the lowest wide
+	// address bit that the enables are not uniform over.
+	std::vector<int> wren_size;
+	std::vector<std::vector<bool>> wren_boundary;
+	std::vector<int> wren_nu_bit;
 
-	MemMapping(MapWorker &worker, Mem &mem, const Library &lib, const PassOptions &opts) : worker(worker), qcsat(worker.modwalker), mem(mem), lib(lib), opts(opts) {
+	MemMapping(MapWorker &worker, Mem &mem, const Library &lib, const PassOptions &opts) : worker(worker), qcsat(worker.qcsat), mem(mem), lib(lib), opts(opts) {
 		determine_style();
 		logic_ok = determine_logic_ok();
 		if (GetSize(mem.wr_ports) == 0)
 			logic_cost = mem.width * mem.size * opts.logic_cost_rom;
 		else
 			logic_cost = mem.width * mem.size * opts.logic_cost_ram;
+		compute_shape();
+	}
+
+	// Collects the mapping candidates.  Together with handle_geom() and
+	// finish_geom(), this fills cfgs unless they are taken from an earlier
+	// memory of the same shape.
+	void analyze() {
 		if (kind == RamKind::Logic)
 			return;
 		for (int i = 0; i < GetSize(lib.rams); i++) {
@@ -224,8 +260,18 @@ struct MemMapping {
 		handle_priority();
 		handle_rd_rst();
 		score_emu_ports();
-		// Now it is just a matter of picking geometry.
-		handle_geom();
+	}
+
+	// Now it is just a matter of picking geometry.
+	void handle_geom() {
+		prepare_geom();
+		for (auto &cfg: cfgs)
+			handle_geom_cfg(cfg);
+	}
+
+	void finish_geom() {
+		if (kind == RamKind::Logic)
+			return;
 		dump_configs(0);
 		prune_post_geom();
 		dump_configs(1);
@@ -262,6 +308,7 @@ struct MemMapping {
 		qcsat.prepare();
 		bool res = !qcsat.ez->solve(wr_en, qcsat.ez->NOT(rd_en));
 		wr_implies_rd_cache.insert({key, res});
+		sat_facts.push_back({SatFact::WrImpliesRd, wpidx, rpidx, res});
 		return res;
 	}
 
@@ -275,6 +322,7 @@ struct MemMapping {
 		qcsat.prepare();
 		bool res = !qcsat.ez->solve(wr_en, rd_en);
 		wr_excludes_rd_cache.insert({key, res});
+		sat_facts.push_back({SatFact::WrExcludesRd, wpidx, rpidx, res});
 		return res;
 	}
 
@@ -292,9 +340,32 @@ struct MemMapping {
 		qcsat.prepare();
 		bool res = !qcsat.ez->solve(wr_en, srst);
 		wr_excludes_srst_cache.insert({key, res});
+		sat_facts.push_back({SatFact::WrExcludesSrst, wpidx, rpidx, res});
 		return res;
 	}
 
+	// Replays the SAT queries an earlier memory of the same shape asked, and
+	// checks that they get the same answers here.
+	bool check_sat_facts(const std::vector<SatFact> &facts) {
+		for (auto &fact: facts) {
+			bool res;
+			switch (fact.kind) {
+				case SatFact::WrImpliesRd:
+					res = get_wr_implies_rd(fact.wpidx, fact.rpidx);
+					break;
+				case SatFact::WrExcludesRd:
+					res = get_wr_excludes_rd(fact.wpidx, fact.rpidx);
+					break;
+				default:
+					res = get_wr_excludes_srst(fact.wpidx, fact.rpidx);
+					break;
+			}
+			if (res != fact.result)
+				return false;
+		}
+		return true;
+	}
+
 	void dump_configs(int stage);
 	void dump_config(MemConfig &cfg);
 	void determine_style();
@@ -308,7 +379,9 @@ struct MemMapping {
 	void handle_priority();
 	void handle_rd_rst();
 	void score_emu_ports();
-	void handle_geom();
+	void compute_shape();
+	void prepare_geom();
+	void handle_geom_cfg(MemConfig &cfg) const;
 	void prune_post_geom();
 	void emit_port(const MemConfig &cfg, std::vector<Cell*> &cells, const PortVariant &pdef, const char *name, int wpidx, int rpidx, const std::vector<int> &hw_addr_swizzle);
 	void emit(const MemConfig &cfg);
@@ -661,6 +734,76 @@ bool MemMapping::check_init(const Ram &ram) {
 	}
 }
 
+// Builds the shape key.  Signals are numbered in order of appearance; the
+// addresses go through sigmap_xmux and are numbered separately, as they are
+// only ever compared to each other.
+void MemMapping::compute_shape() {
+	dict<SigBit, int> xmux_ids;
+	std::string &key = shape_key;
+	auto add_sig = [&](const SigSpec &sig) {
+		for (auto bit: sig) {
+			if (!bit.wire) {
+				key += stringf("%d", bit.data);
+				continue;
+			}
+			int id = shape_ids.emplace(bit, GetSize(shape_bits)).first->second;
+			if (id == GetSize(shape_bits))
+				shape_bits.push_back(bit);
+			key += stringf("#%d", id);
+		}
+		key += ";";
+	};
+	auto add_addr = [&](const SigSpec &addr) {
+		for (auto bit: worker.sigmap_xmux(addr)) {
+			if (!bit.wire) {
+				key += stringf("%d", bit.data);
+				continue;
+			}
+			int id = xmux_ids.emplace(bit, GetSize(xmux_ids)).first->second;
+			key += stringf("@%d", id);
+		}
+		key += ";";
+	};
+	auto add_mask = [&](const std::vector<bool> &mask) {
+		for (bool b: mask)
+			key += b ? "1" : "0";
+		key += ";";
+	};
+
+	bool has_nonx = false;
+	bool has_one = false;
+	for (auto &init: mem.inits) {
+		if (init.data.is_fully_undef())
+			continue;
+		has_nonx = true;
+		for (auto bit: init.data)
+			if (bit == State::S1)
+				has_one = true;
+	}
+	key = stringf("%d:%d:%d:%d:%d:%d:%d:%zu:%s;", mem.width, mem.size, mem.start_offset, int(kind), logic_ok,
+			has_nonx + 2 * has_one, mem.emulate_read_first_ok(), style.size(), style.c_str());
+	for (auto &port: mem.wr_ports) {
+		key += stringf("W%d:%d:%d;", port.wide_log2, port.clk_enable, port.clk_polarity);
+		add_sig(port.clk);
+		add_sig(port.en);
+		add_addr(port.addr);
+		add_mask(port.priority_mask);
+	}
+	for (auto &port: mem.rd_ports) {
+		key += stringf("R%d:%d:%d:%d:%d;", port.wide_log2, port.clk_enable, port.clk_polarity, port.ce_over_srst, GetSize(port.data));
+		add_sig(port.clk);
+		add_sig(port.en);
+		add_sig(port.arst);
+		add_sig(port.srst);
+		add_sig(port.arst_value);
+		add_sig(port.srst_value);
+		add_sig(port.init_value);
+		add_addr(port.addr);
+		add_mask(port.transparency_mask);
+		add_mask(port.collision_x_mask);
+	}
+}
+
 bool apply_clock(MemConfig &cfg, const PortVariant &def, SigBit clk, bool clk_polarity) {
 	if (def.clk_shared == -1)
 		return true;
@@ -1185,288 +1328,300 @@ void MemMapping::score_emu_ports() {
 	}
 }
 
-void MemMapping::handle_geom() {
-	std::vector<int> wren_size;
+// Computes the write enable structure once, so that the configurations
+// can be processed without looking at any SigSpec.
+void MemMapping::prepare_geom() {
+	wren_size.clear();
+	wren_boundary.clear();
+	wren_nu_bit.clear();
 	for (auto &port: mem.wr_ports) {
 		SigSpec en = port.en;
 		en.sort_and_unify();
 		wren_size.push_back(GetSize(en));
+		std::vector<bool> boundary(mem.width, false);
+		for (int sub = 0; sub < (1 << port.wide_log2); sub++) {
+			for (int i = 1; i < mem.width; i++) {
+				int pos = sub * mem.width + i;
+				if (port.en[pos] != port.en[pos-1])
+					boundary[i] = true;
+			}
+		}
+		wren_boundary.push_back(boundary);
+		int nu_bit = port.wide_log2;
+		for (int j = 0; j < port.wide_log2 && nu_bit == port.wide_log2; j++)
+			for (int k = 0; k < (1 << port.wide_log2); k += 2 << j)
+				if (port.en.extract(k * mem.width, mem.width << j) != port.en.extract((k + (1 << j)) * mem.width, mem.width << j))
+					nu_bit = j;
+		wren_nu_bit.push_back(nu_bit);
 	}
-	for (auto &cfg: cfgs) {
-		// First, create a set of "byte boundaries": the bit positions in source memory word
-		// that have write enable different from the previous bit in any write port.
-		// Bit 0 is considered to be a byte boundary as well.
-		// Likewise, create a set of "word boundaries" that are like above, but only for write ports
-		// with the "force uniform" flag set.
-		std::vector<bool> byte_boundary(mem.width, false);
-		std::vector<bool> word_boundary(mem.width, false);
-		byte_boundary[0] = true;
-		for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
-			auto &port = mem.wr_ports[pidx];
-			auto &pcfg = cfg.wr_ports[pidx];
-			if (pcfg.force_uniform)
-				word_boundary[0] = true;
-			for (int sub = 0; sub < (1 << port.wide_log2); sub++) {
-				for (int i = 1; i < mem.width; i++) {
-					int pos = sub * mem.width + i;
-					if (port.en[pos] != port.en[pos-1]) {
-						byte_boundary[i] = true;
-						if (pcfg.force_uniform)
-							word_boundary[i] = true;
-					}
-				}
+}
+
+// Picks the geometry of a single configuration.  Only reads the memory and
+// the results of prepare_geom(), and only writes cfg.
+void MemMapping::handle_geom_cfg(MemConfig &cfg) const {
+	// First, create a set of "byte boundaries": the bit positions in source memory word
+	// that have write enable different from the previous bit in any write port.
+	// Bit 0 is considered to be a byte boundary as well.
+	// Likewise, create a set of "word boundaries" that are like above, but only for write ports
+	// with the "force uniform" flag set.
+	std::vector<bool> byte_boundary(mem.width, false);
+	std::vector<bool> word_boundary(mem.width, false);
+	byte_boundary[0] = true;
+	for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
+		auto &pcfg = cfg.wr_ports[pidx];
+		if (pcfg.force_uniform)
+			word_boundary[0] = true;
+		for (int i = 1; i < mem.width; i++) {
+			if (wren_boundary[pidx][i]) {
+				byte_boundary[i] = true;
+				if (pcfg.force_uniform)
+					word_boundary[i] = true;
 			}
 		}
-		bool got_config = false;
-		int best_cost = 0;
-		int byte_width_log2 = 0;
-		for (int i = 0; i < GetSize(cfg.def->dbits); i++)
-			if (cfg.def->byte >= cfg.def->dbits[i])
-				byte_width_log2 = i;
-		if (cfg.def->byte == 0)
-			byte_width_log2 = GetSize(cfg.def->dbits) - 1;
-		pool<int> no_wide_bits;
-		// Determine which of the source address bits involved in wide ports
-		// are "uniform".  Bits are considered uniform if, when a port is widened through
-		// them, the write enables are the same for both values of the bit.
-		int max_wr_wide_log2 = 0;
-		for (auto &port: mem.wr_ports)
-			if (port.wide_log2 > max_wr_wide_log2)
-				max_wr_wide_log2 = port.wide_log2;
-		int max_wide_log2 = max_wr_wide_log2;
-		for (auto &port: mem.rd_ports)
-			if (port.wide_log2 > max_wide_log2)
-				max_wide_log2 = port.wide_log2;
-		int wide_nu_start = max_wide_log2;
-		int wide_nu_end = max_wr_wide_log2;
-		for (int i = 0; i < GetSize(mem.wr_ports); i++) {
-			auto &port = mem.wr_ports[i];
-			auto &pcfg = cfg.wr_ports[i];
-			for (int j = 0; j < port.wide_log2; j++) {
-				bool uniform = true;
-				// If write enables don't match, mark bit as non-uniform.
-				for (int k = 0; k < (1 << port.wide_log2); k += 2 << j)
-					if (port.en.extract(k * mem.width, mem.width << j) != port.en.extract((k + (1 << j)) * mem.width, mem.width << j))
-						uniform = false;
-				if (!uniform) {
-					if (pcfg.force_uniform) {
-						for (int k = j; k < port.wide_log2; k++)
-							no_wide_bits.insert(k);
-					}
-					if (j < wide_nu_start)
-						wide_nu_start = j;
-					break;
-				}
+	}
+	bool got_config = false;
+	int best_cost = 0;
+	int byte_width_log2 = 0;
+	for (int i = 0; i < GetSize(cfg.def->dbits); i++)
+		if (cfg.def->byte >= cfg.def->dbits[i])
+			byte_width_log2 = i;
+	if (cfg.def->byte == 0)
+		byte_width_log2 = GetSize(cfg.def->dbits) - 1;
+	pool<int> no_wide_bits;
+	// Determine which of the source address bits involved in wide ports
+	// are "uniform".  Bits are considered uniform if, when a port is widened through
+	// them, the write enables are the same for both values of the bit.
+	int max_wr_wide_log2 = 0;
+	for (auto &port: mem.wr_ports)
+		if (port.wide_log2 > max_wr_wide_log2)
+			max_wr_wide_log2 = port.wide_log2;
+	int max_wide_log2 = max_wr_wide_log2;
+	for (auto &port: mem.rd_ports)
+		if (port.wide_log2 > max_wide_log2)
+			max_wide_log2 = port.wide_log2;
+	int wide_nu_start = max_wide_log2;
+	int wide_nu_end = max_wr_wide_log2;
+	for (int i = 0; i < GetSize(mem.wr_ports); i++) {
+		auto &port = mem.wr_ports[i];
+		auto &pcfg = cfg.wr_ports[i];
+		// If write enables don't match, mark bit as non-uniform.
+		int j = wren_nu_bit[i];
+		if (j < port.wide_log2) {
+			if (pcfg.force_uniform) {
+				for (int k = j; k < port.wide_log2; k++)
+					no_wide_bits.insert(k);
 			}
-			if (pcfg.def->width_tied && pcfg.rd_port != -1) {
-				// If:
-				//
-				// - the write port is merged with a read port
-				// - the read port is wider than the write port
-				// - read and write widths are tied
-				//
-				// then we will have to artificially widen the write
-				// port to the width of the read port, and emulate
-				// a narrower write path by use of write enables,
-				// which will definitely be non-uniform over the added
-				// bits.
-				auto &rport = mem.rd_ports[pcfg.rd_port];
-				if (rport.wide_log2 > port.wide_log2) {
-					if (port.wide_log2 < wide_nu_start)
-						wide_nu_start = port.wide_log2;
-					if (rport.wide_log2 > wide_nu_end)
-						wide_nu_end = rport.wide_log2;
-					if (pcfg.force_uniform) {
-						for (int k = port.wide_log2; k < rport.wide_log2; k++)
-							no_wide_bits.insert(k);
-					}
+			if (j < wide_nu_start)
+				wide_nu_start = j;
+		}
+		if (pcfg.def->width_tied && pcfg.rd_port != -1) {
+			// If:
+			//
+			// - the write port is merged with a read port
+			// - the read port is wider than the write port
+			// - read and write widths are tied
+			//
+			// then we will have to artificially widen the write
+			// port to the width of the read port, and emulate
+			// a narrower write path by use of write enables,
+			// which will definitely be non-uniform over the added
+			// bits.
+			auto &rport = mem.rd_ports[pcfg.rd_port];
+			if (rport.wide_log2 > port.wide_log2) {
+				if (port.wide_log2 < wide_nu_start)
+					wide_nu_start = port.wide_log2;
+				if (rport.wide_log2 > wide_nu_end)
+					wide_nu_end = rport.wide_log2;
+				if (pcfg.force_uniform) {
+					for (int k = port.wide_log2; k < rport.wide_log2; k++)
+						no_wide_bits.insert(k);
 				}
 			}
 		}
-		// Iterate over base widths.
-		for (int base_width_log2 = 0; base_width_log2 < GetSize(cfg.def->dbits); base_width_log2++) {
-			// Now, see how many data bits we actually have available.
-			// This is usually dbits[base_width_log2], but could be smaller if we
-			// ran afoul of a max width limitation.  Configurations where this
-			// happens are not useful, unless we need it to satisfy a *minimum*
-			// width limitation.
-			int unit_width_log2 = base_width_log2;
-			for (auto &pcfg: cfg.wr_ports)
-				if (unit_width_log2 > pcfg.def->max_wr_wide_log2)
-					unit_width_log2 = pcfg.def->max_wr_wide_log2;
-			for (auto &pcfg: cfg.rd_ports)
-				if (unit_width_log2 > pcfg.def->max_rd_wide_log2)
-					unit_width_log2 = pcfg.def->max_rd_wide_log2;
-			if (unit_width_log2 != base_width_log2 && got_config)
-				break;
-			int unit_width = cfg.def->dbits[unit_width_log2];
-			// Also determine effective byte width (the granularity of write enables).
-			int effective_byte = cfg.def->byte;
-			if (effective_byte == 0 || effective_byte > unit_width)
-				effective_byte = unit_width;
-			if (mem.wr_ports.empty())
-				effective_byte = 1;
-			log_assert(unit_width % effective_byte == 0);
-			// Create the swizzle pattern.
-			std::vector<int> swizzle;
-			for (int i = 0; i < mem.width; i++) {
-				if (word_boundary[i])
-					while (GetSize(swizzle) % unit_width)
-						swizzle.push_back(-1);
-				else if (byte_boundary[i])
-					while (GetSize(swizzle) % effective_byte)
-						swizzle.push_back(-1);
-				swizzle.push_back(i);
-			}
-			if (word_boundary[0])
+	}
+	// Iterate over base widths.
+	for (int base_width_log2 = 0; base_width_log2 < GetSize(cfg.def->dbits); base_width_log2++) {
+		// Now, see how many data bits we actually have available.
+		// This is usually dbits[base_width_log2], but could be smaller if we
+		// ran afoul of a max width limitation.  Configurations where this
+		// happens are not useful, unless we need it to satisfy a *minimum*
+		// width limitation.
+		int unit_width_log2 = base_width_log2;
+		for (auto &pcfg: cfg.wr_ports)
+			if (unit_width_log2 > pcfg.def->max_wr_wide_log2)
+				unit_width_log2 = pcfg.def->max_wr_wide_log2;
+		for (auto &pcfg: cfg.rd_ports)
+			if (unit_width_log2 > pcfg.def->max_rd_wide_log2)
+				unit_width_log2 = pcfg.def->max_rd_wide_log2;
+		if (unit_width_log2 != base_width_log2 && got_config)
+			break;
+		int unit_width = cfg.def->dbits[unit_width_log2];
+		// Also determine effective byte width (the granularity of write enables).
+		int effective_byte = cfg.def->byte;
+		if (effective_byte == 0 || effective_byte > unit_width)
+			effective_byte = unit_width;
+		if (mem.wr_ports.empty())
+			effective_byte = 1;
+		log_assert(unit_width % effective_byte == 0);
+		// Create the swizzle pattern.
+		std::vector<int> swizzle;
+		for (int i = 0; i < mem.width; i++) {
+			if (word_boundary[i])
 				while (GetSize(swizzle) % unit_width)
 					swizzle.push_back(-1);
-			else
+			else if (byte_boundary[i])
 				while (GetSize(swizzle) % effective_byte)
 					swizzle.push_back(-1);
-			// Now evaluate the configuration, then keep adding more hard wide bits
-			// and evaluating.
-			int hard_wide_mask = 0;
-			int hard_wide_num = 0;
-			bool byte_failed = false;
-			while (1) {
-				// Check if all min width constraints are satisfied.
-				// Only check these constraints for write ports with width below
-				// byte width — for other ports, we can emulate narrow width with
-				// a larger one.
-				bool min_width_ok = true;
-				int min_width_bit = wide_nu_start;
-				for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
-					auto &port = mem.wr_ports[pidx];
-					int w = base_width_log2;
+			swizzle.push_back(i);
+		}
+		if (word_boundary[0])
+			while (GetSize(swizzle) % unit_width)
+				swizzle.push_back(-1);
+		else
+			while (GetSize(swizzle) % effective_byte)
+				swizzle.push_back(-1);
+		// Now evaluate the configuration, then keep adding more hard wide bits
+		// and evaluating.
+		int hard_wide_mask = 0;
+		int hard_wide_num = 0;
+		bool byte_failed = false;
+		while (1) {
+			// Check if all min width constraints are satisfied.
+			// Only check these constraints for write ports with width below
+			// byte width — for other ports, we can emulate narrow width with
+			// a larger one.
+			bool min_width_ok = true;
+			int min_width_bit = wide_nu_start;
+			for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
+				auto &port = mem.wr_ports[pidx];
+				int w = base_width_log2;
+				for (int i = 0; i < port.wide_log2; i++)
+					if (hard_wide_mask & 1 << i)
+						w++;
+				if (w < cfg.wr_ports[pidx].def->min_wr_wide_log2 && w < byte_width_log2) {
+					min_width_ok = false;
+					if (min_width_bit > port.wide_log2)
+						min_width_bit = port.wide_log2;
+				}
+			}
+			if (min_width_ok) {
+				int emu_wide_bits = max_wide_log2 - hard_wide_num;
+				int mult_wide = 1 << emu_wide_bits;
+				int addrs = 1 << (cfg.def->abits - base_width_log2 + emu_wide_bits);
+				int min_addr = mem.start_offset / addrs;
+				int max_addr = (mem.start_offset + mem.size - 1) / addrs;
+				int mult_a = max_addr - min_addr + 1;
+				int bits = mult_a * mult_wide * GetSize(swizzle);
+				int repl = (bits + unit_width - 1) / unit_width;
+				int score_demux = 0;
+				for (int i = 0; i < GetSize(mem.wr_ports); i++) {
+					auto &port = mem.wr_ports[i];
+					int w = emu_wide_bits;
 					for (int i = 0; i < port.wide_log2; i++)
-						if (hard_wide_mask & 1 << i)
-							w++;
-					if (w < cfg.wr_ports[pidx].def->min_wr_wide_log2 && w < byte_width_log2) {
-						min_width_ok = false;
-						if (min_width_bit > port.wide_log2)
-							min_width_bit = port.wide_log2;
-					}
+						if (!(hard_wide_mask & 1 << i))
+							w--;
+					if (w || mult_a != 1)
+						score_demux += (mult_a << w) * wren_size[i];
 				}
-				if (min_width_ok) {
-					int emu_wide_bits = max_wide_log2 - hard_wide_num;
-					int mult_wide = 1 << emu_wide_bits;
-					int addrs = 1 << (cfg.def->abits - base_width_log2 + emu_wide_bits);
-					int min_addr = mem.start_offset / addrs;
-					int max_addr = (mem.start_offset + mem.size - 1) / addrs;
-					int mult_a = max_addr - min_addr + 1;
-					int bits = mult_a * mult_wide * GetSize(swizzle);
-					int repl = (bits + unit_width - 1) / unit_width;
-					int score_demux = 0;
-					for (int i = 0; i < GetSize(mem.wr_ports); i++) {
-						auto &port = mem.wr_ports[i];
-						int w = emu_wide_bits;
-						for (int i = 0; i < port.wide_log2; i++)
-							if (!(hard_wide_mask & 1 << i))
-								w--;
-						if (w || mult_a != 1)
-							score_demux += (mult_a << w) * wren_size[i];
-					}
-					int score_mux = 0;
-					for (auto &port: mem.rd_ports) {
-						int w = emu_wide_bits;
-						for (int i = 0; i < port.wide_log2; i++)
-							if (!(hard_wide_mask & 1 << i))
-								w--;
-						score_mux += ((mult_a << w) - 1) * GetSize(port.data);
-					}
-					double cost = (cfg.def->cost - cfg.def->widthscale) * repl * cfg.repl_port;
-					cost += cfg.def->widthscale * mult_a * mult_wide * mem.width / unit_width * cfg.repl_port;
-					cost += score_mux * FACTOR_MUX;
-					cost += score_demux * FACTOR_DEMUX;
-					cost += cfg.score_emu * FACTOR_EMU;
-					if (!got_config || cost < best_cost) {
-						cfg.base_width_log2 = base_width_log2;
-						cfg.unit_width_log2 = unit_width_log2;
-						cfg.swizzle = swizzle;
-						cfg.hard_wide_mask = hard_wide_mask;
-						cfg.emu_wide_mask = ((1 << max_wide_log2) - 1) & ~hard_wide_mask;
-						cfg.repl_d = repl;
-						cfg.score_demux = score_demux;
-						cfg.score_mux = score_mux;
-						cfg.cost = cost;
-						best_cost = cost;
-						got_config = true;
-					}
+				int score_mux = 0;
+				for (auto &port: mem.rd_ports) {
+					int w = emu_wide_bits;
+					for (int i = 0; i < port.wide_log2; i++)
+						if (!(hard_wide_mask & 1 << i))
+							w--;
+					score_mux += ((mult_a << w) - 1) * GetSize(port.data);
 				}
-				if (cfg.def->width_mode != WidthMode::PerPort)
-					break;
-				// Now, pick the next bit to add to the hard wide mask.
-next_hw:
-				int scan_from;
-				int scan_to;
-				bool retry = false;
-				if (!min_width_ok) {
-					// If we still haven't met the minimum width limits,
-					// add the highest one that will be useful for working
-					// towards all unmet limits.
-					scan_from = min_width_bit;
-					scan_to = 0;
-					// If the relevant write port is not wide, it's impossible.
-				} else if (byte_failed) {
-					// If we already failed with uniformly-written bits only,
-					// go with uniform bits that are only involved in reads.
-					scan_from = max_wide_log2;
-					scan_to = wide_nu_end;
-				} else if (base_width_log2 + hard_wide_num < byte_width_log2) {
-					// If we still need uniform bits, prefer the low ones.
-					scan_from = wide_nu_start;
-					scan_to = 0;
-					retry = true;
-				} else {
-					scan_from = max_wide_log2;
-					scan_to = 0;
+				double cost = (cfg.def->cost - cfg.def->widthscale) * repl * cfg.repl_port;
+				cost += cfg.def->widthscale * mult_a * mult_wide * mem.width / unit_width * cfg.repl_port;
+				cost += score_mux * FACTOR_MUX;
+				cost += score_demux * FACTOR_DEMUX;
+				cost += cfg.score_emu * FACTOR_EMU;
+				if (!got_config || cost < best_cost) {
+					cfg.base_width_log2 = base_width_log2;
+					cfg.unit_width_log2 = unit_width_log2;
+					cfg.swizzle = swizzle;
+					cfg.hard_wide_mask = hard_wide_mask;
+					cfg.emu_wide_mask = ((1 << max_wide_log2) - 1) & ~hard_wide_mask;
+					cfg.repl_d = repl;
+					cfg.score_demux = score_demux;
+					cfg.score_mux = score_mux;
+					cfg.cost = cost;
+					best_cost = cost;
+					got_config = true;
 				}
-				int bit = scan_from - 1;
-				while (1) {
-					if (bit < scan_to) {
+			}
+			if (cfg.def->width_mode != WidthMode::PerPort)
+				break;
+			// Now, pick the next bit to add to the hard wide mask.
+next_hw:
+			int scan_from;
+			int scan_to;
+			bool retry = false;
+			if (!min_width_ok) {
+				// If we still haven't met the minimum width limits,
+				// add the highest one that will be useful for working
+				// towards all unmet limits.
+				scan_from = min_width_bit;
+				scan_to = 0;
+				// If the relevant write port is not wide, it's impossible.
+			} else if (byte_failed) {
+				// If we already failed with uniformly-written bits only,
+				// go with uniform bits that are only involved in reads.
+				scan_from = max_wide_log2;
+				scan_to = wide_nu_end;
+			} else if (base_width_log2 + hard_wide_num < byte_width_log2) {
+				// If we still need uniform bits, prefer the low ones.
+				scan_from = wide_nu_start;
+				scan_to = 0;
+				retry = true;
+			} else {
+				scan_from = max_wide_log2;
+				scan_to = 0;
+			}
+			int bit = scan_from - 1;
+			while (1) {
+				if (bit < scan_to) {
 hw_bit_failed:
-						if (retry) {
-							byte_failed = true;
-							goto next_hw;
-						} else {
-							goto bw_done;
-						}
+					if (retry) {
+						byte_failed = true;
+						goto next_hw;
+					} else {
+						goto bw_done;
 					}
-					if (!(hard_wide_mask & 1 << bit) && !no_wide_bits.count(bit))
-						break;
-					bit--;
 				}
-				int new_hw_mask = hard_wide_mask | 1 << bit;
-				// Check if all max width constraints are satisfied.
-				for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
-					auto &port = mem.wr_ports[pidx];
-					int w = base_width_log2;
-					for (int i = 0; i < port.wide_log2; i++)
-						if (new_hw_mask & 1 << i)
-							w++;
-					if (w > cfg.wr_ports[pidx].def->max_wr_wide_log2) {
-						goto hw_bit_failed;
-					}
+				if (!(hard_wide_mask & 1 << bit) && !no_wide_bits.count(bit))
+					break;
+				bit--;
+			}
+			int new_hw_mask = hard_wide_mask | 1 << bit;
+			// Check if all max width constraints are satisfied.
+			for (int pidx = 0; pidx < GetSize(mem.wr_ports); pidx++) {
+				auto &port = mem.wr_ports[pidx];
+				int w = base_width_log2;
+				for (int i = 0; i < port.wide_log2; i++)
+					if (new_hw_mask & 1 << i)
+						w++;
+				if (w > cfg.wr_ports[pidx].def->max_wr_wide_log2) {
+					goto hw_bit_failed;
 				}
-				for (int pidx = 0; pidx < GetSize(mem.rd_ports); pidx++) {
-					auto &port = mem.rd_ports[pidx];
-					int w = base_width_log2;
-					for (int i = 0; i < port.wide_log2; i++)
-						if (new_hw_mask & 1 << i)
-							w++;
-					if (w > cfg.rd_ports[pidx].def->max_rd_wide_log2) {
-						goto hw_bit_failed;
-					}
+			}
+			for (int pidx = 0; pidx < GetSize(mem.rd_ports); pidx++) {
+				auto &port = mem.rd_ports[pidx];
+				int w = base_width_log2;
+				for (int i = 0; i < port.wide_log2; i++)
+					if (new_hw_mask & 1 << i)
+						w++;
+				if (w > cfg.rd_ports[pidx].def->max_rd_wide_log2) {
+					goto hw_bit_failed;
 				}
-				// Bit ok, commit.
-				hard_wide_mask = new_hw_mask;
-				hard_wide_num++;
 			}
-bw_done:;
+			// Bit ok, commit.
+			hard_wide_mask = new_hw_mask;
+			hard_wide_num++;
 		}
-		log_assert(got_config);
+bw_done:;
 	}
+	log_assert(got_config);
 }
 
 void MemMapping::prune_post_geom() {
@@ -2148,6 +2303,66 @@ void MemMapping::emit(const MemConfig &cfg) {
 	mem.remove();
 }
 
+// Mapping candidates of the memories analyzed so far, so that a memory with
+// the same shape as an earlier one does not have to go through port
+// assignment and geometry selection again.
+struct MappingCache {
+	struct Entry {
+		std::string source;
+		std::vector<SatFact> sat_facts;
+		MemConfigs cfgs;
+		// Per config, the shape_bits index of each shared clock, or -1 if it
+		// is unused or constant.
+		std::vector<std::vector<int>> clk_ids;
+		std::string rejected_cfg_debug_msgs;
+	};
+	dict<std::string, std::vector<std::unique_ptr<Entry>>> entries;
+
+	Entry *find(MemMapping &map) {
+		auto it = entries.find(map.shape_key);
+		if (it == entries.end())
+			return nullptr;
+		for (auto &entry: it->second)
+			if (map.check_sat_facts(entry->sat_facts))
+				return entry.get();
+		return nullptr;
+	}
+
+	// Adds an entry for a memory that has been analyzed.  The candidates are
+	// filled in by set_configs() once the geometry is known.
+	Entry *add(const MemMapping &map) {
+		auto entry = std::make_unique<Entry>();
+		entry->source = stringf("%s.%s", log_id(map.mem.module->name), log_id(map.mem.memid));
+		entry->sat_facts = map.sat_facts;
+		auto &list = entries[map.shape_key];
+		list.push_back(std::move(entry));
+		return list.back().get();
+	}
+
+	void set_configs(Entry *entry, const MemMapping &map) {
+		entry->cfgs = map.cfgs;
+		entry->clk_ids.clear();
+		for (auto &cfg: map.cfgs) {
+			std::vector<int> ids;
+			for (auto &ccfg: cfg.shared_clocks)
+				ids.push_back(ccfg.used && ccfg.clk.wire ? map.shape_ids.at(ccfg.clk) : -1);
+			entry->clk_ids.push_back(ids);
+		}
+		entry->rejected_cfg_debug_msgs = map.rejected_cfg_debug_msgs;
+	}
+
+	void apply(const Entry *entry, MemMapping &map) {
+		log("reusing mapping candidates of memory %s for %s.%s\n", entry->source.c_str(),
+				log_id(map.mem.module->name), log_id(map.mem.memid));
+		map.cfgs = entry->cfgs;
+		for (int i = 0; i < GetSize(map.cfgs); i++)
+			for (int j = 0; j < GetSize(map.cfgs[i].shared_clocks); j++)
+				if (entry->clk_ids[i][j] != -1)
+					map.cfgs[i].shared_clocks[j].clk = map.shape_bits[entry->clk_ids[i][j]];
+		map.rejected_cfg_debug_msgs = entry->rejected_cfg_debug_msgs;
+	}
+};
+
 struct MemoryLibMapPass : public Pass {
 	MemoryLibMapPass() : Pass("memory_libmap", "map memories to cells") { }
 	void help() override
@@ -2179,6 +2394,17 @@ struct MemoryLibMapPass : public Pass {
 		log("    Disables automatic mapping of given kind of RAMs.  Manual mapping\n");
 		log("    (using ram_style or other attributes) is still supported.\n");
 		log("\n");
+		log("  -j <threads>\n");
+		log("    Analyzes all memories of a module before mapping any of them, and picks\n");
+		log("    the geometry of their candidate configs on the given number of threads\n");
+		log("    (0 = one per hardware thread).  The control logic of a memory can then\n");
+		log("    not take the cells emitted for another memory of the module into\n");
+		log("    account.\n");
+		log("\n");
+		log("Memories that have the same shape as an earlier one (same widths, ports,\n");
+		log("clock, enable and address connections up to renaming, and the same answers\n");
+		log("to the enable logic queries) reuse its mapping candidates.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -2190,6 +2416,8 @@ struct MemoryLibMapPass : public Pass {
 		opts.no_auto_huge = false;
 		opts.logic_cost_ram = 1.0;
 		opts.logic_cost_rom = 1.0/16.0;
+		int threads = 1;
+		bool batch = false;
 		log_header(design, "Executing MEMORY_LIBMAP pass (mapping memories to cells).\n");
 
 		size_t argidx;
@@ -2222,41 +2450,43 @@ struct MemoryLibMapPass : public Pass {
 				opts.logic_cost_ram = strtod(args[++argidx].c_str(), nullptr);
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				batch = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
 		Library lib = parse_library(lib_files, defines);
 
+		MappingCache cache;
+
 		for (auto module : design->selected_modules()) {
 			if (module->has_processes_warn())
 				continue;
 
 			auto worker = std::make_unique<MapWorker>(module);
 			auto mems = Mem::get_selected_memories(module);
+			if (batch) {
+				map_batch(*worker, mems, lib, opts, cache, threads);
+				continue;
+			}
 			for (auto &mem : mems)
 			{
 				MemMapping map(*worker, mem, lib, opts);
-				int idx = -1;
-				int best = map.logic_cost;
-				if (!map.logic_ok) {
-					if (map.cfgs.empty()) {
-						log_debug("Rejected candidates for mapping memory %s.%s:\n", log_id(module->name), log_id(mem.memid));
-						log_debug("%s", map.rejected_cfg_debug_msgs.c_str());
-						log_error("no valid mapping found for memory %s.%s\n", log_id(module->name), log_id(mem.memid));
-					}
-					idx = 0;
-					best = map.cfgs[0].cost;
-				}
-				for (int i = 0; i < GetSize(map.cfgs); i++) {
-					if (map.cfgs[i].cost < best) {
-						idx = i;
-						best = map.cfgs[i].cost;
-					}
-				}
-				if (idx == -1) {
-					log("using FF mapping for memory %s.%s\n", log_id(module->name), log_id(mem.memid));
+				auto entry = cache.find(map);
+				if (entry) {
+					cache.apply(entry, map);
 				} else {
+					map.analyze();
+					map.handle_geom();
+					map.finish_geom();
+					cache.set_configs(cache.add(map), map);
+				}
+				int idx = select_config(map);
+				if (idx != -1) {
 					map.emit(map.cfgs[idx]);
 					// Rebuild indices after modifying module
 					worker = std::make_unique<MapWorker>(module);
@@ -2264,6 +2494,84 @@ struct MemoryLibMapPass : public Pass {
 			}
 		}
 	}
+
+	// Returns the index of the cheapest config, or -1 if the memory is
+	// better left to be mapped to FFs.
+	static int select_config(MemMapping &map)
+	{
+		Module *module = map.mem.module;
+		int idx = -1;
+		int best = map.logic_cost;
+		if (!map.logic_ok) {
+			if (map.cfgs.empty()) {
+				log_debug("Rejected candidates for mapping memory %s.%s:\n", log_id(module->name), log_id(map.mem.memid));
+				log_debug("%s", map.rejected_cfg_debug_msgs.c_str());
+				log_error("no valid mapping found for memory %s.%s\n", log_id(module->name), log_id(map.mem.memid));
+			}
+			idx = 0;
+			best = map.cfgs[0].cost;
+		}
+		for (int i = 0; i < GetSize(map.cfgs); i++) {
+			if (map.cfgs[i].cost < best) {
+				idx = i;
+				best = map.cfgs[i].cost;
+			}
+		}
+		if (idx == -1)
+			log("using FF mapping for memory %s.%s\n", log_id(module->name), log_id(map.mem.memid));
+		return idx;
+	}
+
+	// Analyzes all memories of a module against the unmodified module, picks
+	// the geometry of all remaining configs on the given number of threads,
+	// and only then emits the mappings.
+	static void map_batch(MapWorker &worker, std::vector<Mem> &mems, const Library &lib, const PassOptions &opts, MappingCache &cache, int threads)
+	{
+		std::vector<std::unique_ptr<MemMapping>> maps;
+		std::vector<MappingCache::Entry*> entries;
+		std::vector<bool> analyzed;
+		for (auto &mem : mems) {
+			maps.push_back(std::make_unique<MemMapping>(worker, mem, lib, opts));
+			auto &map = *maps.back();
+			// This may also find a memory of this batch whose geometry
+			// has not been picked yet; its candidates are copied below.
+			auto entry = cache.find(map);
+			analyzed.push_back(entry == nullptr);
+			if (!entry) {
+				map.analyze();
+				map.prepare_geom();
+				entry = cache.add(map);
+			}
+			entries.push_back(entry);
+		}
+
+		std::vector<std::pair<int, int>> jobs;
+		for (int i = 0; i < GetSize(maps); i++)
+			if (analyzed[i])
+				for (int j = 0; j < GetSize(maps[i]->cfgs); j++)
+					jobs.push_back({i, j});
+		parallel_for(threads, GetSize(jobs), [&](int k) {
+			auto &map = *maps[jobs[k].first];
+			map.handle_geom_cfg(map.cfgs[jobs[k].second]);
+		});
+
+		for (int i = 0; i < GetSize(maps); i++)
+			if (analyzed[i]) {
+				maps[i]->finish_geom();
+				cache.set_configs(entries[i], *maps[i]);
+			}
+		for (int i = 0; i < GetSize(maps); i++)
+			if (!analyzed[i])
+				cache.apply(entries[i], *maps[i]);
+
+		// The emitters only use sigmap_xmux and initvals, which stay valid
+		// as the module grows, so the worker is not rebuilt here.
+		for (auto &map : maps) {
+			int idx = select_config(*map);
+			if (idx != -1)
+				map->emit(map->cfgs[idx]);
+		}
+	}
 } MemoryLibMapPass;
 
 PRIVATE_NAMESPACE_END
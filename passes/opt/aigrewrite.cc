@@ -0,0 +1,1032 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/gategraph.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// Truth tables of functions with up to four inputs. Bit m of a table holds
+// the value for the input assignment m, with input i in bit i of m.
+static const uint16_t var_tables[4] = {0xaaaa, 0xcccc, 0xf0f0, 0xff00};
+
+static uint16_t cofactor0(uint16_t f, int v)
+{
+	uint16_t lo = f & ~var_tables[v];
+	return lo | (lo << (1 << v));
+}
+
+static uint16_t cofactor1(uint16_t f, int v)
+{
+	uint16_t hi = f & var_tables[v];
+	return hi | (hi >> (1 << v));
+}
+
+static int support(uint16_t f)
+{
+	int mask = 0;
+	for (int v = 0; v < 4; v++)
+		if (cofactor0(f, v) != cofactor1(f, v))
+			mask |= 1 << v;
+	return mask;
+}
+
+// Replacement structures for all 4-input functions, one per NPN class. The
+// structure of a class is derived from its canonical representative by
+// recursive disjoint-support and Shannon decomposition, picking the smallest
+// AIG and then the shallowest one. Both the classification and the
+// structures are computed on first use and kept for the rest of the session.
+struct RewriteLibrary
+{
+	enum dec_kind_t : uint8_t { DEC_NONE, DEC_CONST, DEC_VAR, DEC_AND, DEC_OR, DEC_XOR, DEC_MUX };
+
+	struct dec_t {
+		dec_kind_t kind = DEC_NONE;
+		int var = 0;
+		uint16_t a = 0, b = 0;
+		int cost = 0, depth = 0;
+	};
+
+	// Literals in a recipe are 2*index+complement, with index 0 for constant
+	// false, 1..4 for the inputs and 5+k for the k-th AND step.
+	struct recipe_t {
+		std::vector<std::pair<int, int>> steps;
+		int output = 0;
+	};
+
+	// The canonical table is obtained from f by feeding f's input perm[i]
+	// with input i (inverted when bit i of in_neg is set) and inverting the
+	// output when out_neg is set.
+	struct npn_t {
+		uint16_t canon;
+		int perm[4];
+		int in_neg;
+		bool out_neg;
+	};
+
+	std::vector<dec_t> decs;
+	std::vector<std::array<int, 4>> perms;
+	dict<uint16_t, npn_t> npn_cache;
+	dict<uint16_t, recipe_t> recipes;
+
+	RewriteLibrary() : decs(0x10000)
+	{
+		std::array<int, 4> p = {0, 1, 2, 3};
+		do perms.push_back(p);
+		while (std::next_permutation(p.begin(), p.end()));
+	}
+
+	static RewriteLibrary &instance()
+	{
+		static RewriteLibrary library;
+		return library;
+	}
+
+	const dec_t &decompose(uint16_t f)
+	{
+		if (decs[f].kind != DEC_NONE)
+			return decs[f];
+
+		dec_t best;
+		if (f == 0 || f == 0xffff) {
+			best.kind = DEC_CONST;
+			decs[f] = best;
+			return decs[f];
+		}
+
+		for (int v = 0; v < 4; v++)
+			if (f == var_tables[v] || f == uint16_t(~var_tables[v])) {
+				best.kind = DEC_VAR;
+				best.var = v;
+				decs[f] = best;
+				return decs[f];
+			}
+
+		best.cost = INT_MAX;
+		auto consider = [&](dec_kind_t kind, int var, uint16_t a, uint16_t b, int cost, int depth) {
+			const dec_t &da = decompose(a);
+			const dec_t &db = decompose(b);
+			cost += da.cost + db.cost;
+			depth += std::max(da.depth, db.depth);
+			if (cost < best.cost || (cost == best.cost && depth < best.depth)) {
+				best.kind = kind;
+				best.var = var;
+				best.a = a;
+				best.b = b;
+				best.cost = cost;
+				best.depth = depth;
+			}
+		};
+
+		int sup = support(f);
+		int lowest = sup & -sup;
+
+		// disjoint-support decompositions f = g(A) op h(B)
+		for (int set_a = (sup - 1) & sup; set_a > 0; set_a = (set_a - 1) & sup)
+		{
+			if (!(set_a & lowest))
+				continue;
+			int set_b = sup ^ set_a;
+
+			uint16_t ex_a = f, ex_b = f, all_a = f, all_b = f, zero_a = f, zero_b = f;
+			for (int v = 0; v < 4; v++) {
+				if (set_a & (1 << v)) {
+					ex_a = cofactor0(ex_a, v) | cofactor1(ex_a, v);
+					all_a = cofactor0(all_a, v) & cofactor1(all_a, v);
+					zero_a = cofactor0(zero_a, v);
+				}
+				if (set_b & (1 << v)) {
+					ex_b = cofactor0(ex_b, v) | cofactor1(ex_b, v);
+					all_b = cofactor0(all_b, v) & cofactor1(all_b, v);
+					zero_b = cofactor0(zero_b, v);
+				}
+			}
+
+			if (uint16_t(ex_b & ex_a) == f)
+				consider(DEC_AND, 0, ex_b, ex_a, 1, 1);
+			if (uint16_t(all_b | all_a) == f)
+				consider(DEC_OR, 0, all_b, all_a, 1, 1);
+
+			uint16_t zero_all = zero_a;
+			for (int v = 0; v < 4; v++)
+				if (set_b & (1 << v))
+					zero_all = cofactor0(zero_all, v);
+			uint16_t g = zero_b, h = zero_a ^ zero_all;
+			if (uint16_t(g ^ h) == f)
+				consider(DEC_XOR, 0, g, h, 3, 2);
+		}
+
+		// Shannon expansion f = v ? f1 : f0
+		for (int v = 0; v < 4; v++)
+			if (sup & (1 << v))
+				consider(DEC_MUX, v, cofactor1(f, v), cofactor0(f, v), 3, 2);
+
+		decs[f] = best;
+		return decs[f];
+	}
+
+	recipe_t build_recipe(uint16_t f)
+	{
+		recipe_t recipe;
+		dict<std::pair<int, int>, int> steps;
+		dict<uint16_t, int> emitted;
+
+		auto make_and = [&](int a, int b) -> int {
+			if (a > b)
+				std::swap(a, b);
+			if (a == 0 || (a ^ 1) == b)
+				return 0;
+			if (a == 1)
+				return b;
+			if (a == b)
+				return a;
+			auto key = std::make_pair(a, b);
+			auto it = steps.find(key);
+			if (it != steps.end())
+				return it->second;
+			int lit = 2 * (5 + GetSize(recipe.steps));
+			recipe.steps.push_back(key);
+			steps[key] = lit;
+			return lit;
+		};
+
+		std::function<int(uint16_t)> emit = [&](uint16_t g) -> int {
+			auto it = emitted.find(g);
+			if (it != emitted.end())
+				return it->second;
+			it = emitted.find(uint16_t(~g));
+			if (it != emitted.end())
+				return it->second ^ 1;
+
+			const dec_t &d = decompose(g);
+			int lit = 0;
+			switch (d.kind) {
+			case DEC_CONST:
+				lit = g == 0 ? 0 : 1;
+				break;
+			case DEC_VAR:
+				lit = 2 * (1 + d.var) + (g == var_tables[d.var] ? 0 : 1);
+				break;
+			case DEC_AND:
+				lit = make_and(emit(d.a), emit(d.b));
+				break;
+			case DEC_OR:
+				lit = make_and(emit(d.a) ^ 1, emit(d.b) ^ 1) ^ 1;
+				break;
+			case DEC_XOR: {
+				int a = emit(d.a), b = emit(d.b);
+				lit = make_and(make_and(a, b ^ 1) ^ 1, make_and(a ^ 1, b) ^ 1) ^ 1;
+				break;
+			}
+			case DEC_MUX: {
+				int s = 2 * (1 + d.var), a = emit(d.a), b = emit(d.b);
+				lit = make_and(make_and(s, a) ^ 1, make_and(s ^ 1, b) ^ 1) ^ 1;
+				break;
+			}
+			default:
+				log_abort();
+			}
+			emitted[g] = lit;
+			return lit;
+		};
+
+		recipe.output = emit(f);
+		return recipe;
+	}
+
+	const npn_t &classify(uint16_t f)
+	{
+		auto it = npn_cache.find(f);
+		if (it != npn_cache.end())
+			return it->second;
+
+		npn_t best;
+		best.canon = f;
+		for (int i = 0; i < 4; i++)
+			best.perm[i] = i;
+		best.in_neg = 0;
+		best.out_neg = false;
+
+		for (auto &perm : perms)
+			for (int in_neg = 0; in_neg < 16; in_neg++) {
+				uint16_t g = 0;
+				for (int m = 0; m < 16; m++) {
+					int y = 0;
+					for (int i = 0; i < 4; i++)
+						if (((m >> i) ^ (in_neg >> i)) & 1)
+							y |= 1 << perm[i];
+					if ((f >> y) & 1)
+						g |= 1 << m;
+				}
+				for (int out_neg = 0; out_neg < 2; out_neg++) {
+					uint16_t canon = out_neg ? uint16_t(~g) : g;
+					if (canon < best.canon) {
+						best.canon = canon;
+						for (int i = 0; i < 4; i++)
+							best.perm[i] = perm[i];
+						best.in_neg = in_neg;
+						best.out_neg = out_neg;
+					}
+				}
+			}
+
+		return npn_cache[f] = best;
+	}
+
+	const recipe_t &recipe(uint16_t canon)
+	{
+		auto it = recipes.find(canon);
+		if (it != recipes.end())
+			return it->second;
+		return recipes[canon] = build_recipe(canon);
+	}
+};
+
+struct AigRewriteWorker
+{
+	// Literals are 2*node+complement, node 0 is constant false. All other
+	// nodes are either primary inputs or 2-input ANDs.
+	struct node_t {
+		int fanin0 = 0, fanin1 = 0;
+		bool is_and = false;
+		bool prepared = false;
+		int level = 0;
+		int refs = 0;
+		int repr = -1;
+		RTLIL::SigBit bit;
+	};
+
+	struct cut_t {
+		int size = 0;
+		int leaves[4];
+		uint16_t table = 0;
+	};
+
+	RTLIL::Module *module;
+	SigMap sigmap;
+	bool area_mode;
+	int max_cuts = 8;
+
+	RewriteLibrary &library;
+	std::vector<node_t> nodes;
+	std::vector<std::vector<cut_t>> cuts;
+	dict<std::pair<int, int>, int> strash;
+	std::vector<std::pair<RTLIL::SigBit, int>> outputs;
+	std::vector<RTLIL::Cell*> gates;
+	bool rewriting = false;
+
+	std::vector<int> touched;
+	int rewrites = 0;
+
+	AigRewriteWorker(RTLIL::Module *module, bool area_mode) :
+			module(module), sigmap(module), area_mode(area_mode), library(RewriteLibrary::instance()) { }
+
+	int resolve(int lit)
+	{
+		while (nodes[lit >> 1].repr >= 0)
+			lit = nodes[lit >> 1].repr ^ (lit & 1);
+		return lit;
+	}
+
+	int add_input(RTLIL::SigBit bit)
+	{
+		node_t node;
+		node.bit = bit;
+		node.prepared = true;
+		nodes.push_back(node);
+		cuts.emplace_back();
+		cut_t cut;
+		cut.size = 1;
+		cut.leaves[0] = GetSize(nodes) - 1;
+		cut.table = var_tables[0];
+		cuts.back().push_back(cut);
+		return 2 * (GetSize(nodes) - 1);
+	}
+
+	int make_and(int a, int b)
+	{
+		if (a > b)
+			std::swap(a, b);
+		if (a == 0 || (a ^ 1) == b)
+			return 0;
+		if (a == 1)
+			return b;
+		if (a == b)
+			return a;
+
+		auto key = std::make_pair(a, b);
+		auto it = strash.find(key);
+		if (it != strash.end()) {
+			if (rewriting)
+				prepare(it->second);
+			return 2 * it->second;
+		}
+
+		int idx = GetSize(nodes);
+		node_t node;
+		node.is_and = true;
+		node.fanin0 = a;
+		node.fanin1 = b;
+		nodes.push_back(node);
+		cuts.emplace_back();
+		strash[key] = idx;
+		if (rewriting)
+			prepare(idx);
+		return 2 * idx;
+	}
+
+	int make_or(int a, int b) { return make_and(a ^ 1, b ^ 1) ^ 1; }
+	int make_xor(int a, int b) { return make_or(make_and(a, b ^ 1), make_and(a ^ 1, b)); }
+	int make_mux(int s, int t, int e) { return make_or(make_and(s, t), make_and(s ^ 1, e)); }
+
+	// A node holds references on its fanins only while it is referenced
+	// itself. Nodes that lose their last reference are removed from the
+	// structural hash table.
+	void add_refs(int lit, int count)
+	{
+		int n = lit >> 1;
+		bool revived = nodes[n].refs == 0;
+		nodes[n].refs += count;
+		if (!revived || !nodes[n].is_and)
+			return;
+
+		std::vector<int> stack = {n};
+		while (!stack.empty()) {
+			int m = stack.back();
+			stack.pop_back();
+			for (int fanin : {nodes[m].fanin0, nodes[m].fanin1}) {
+				int k = fanin >> 1;
+				if (nodes[k].refs++ == 0 && nodes[k].is_and)
+					stack.push_back(k);
+			}
+		}
+	}
+
+	void kill(int n)
+	{
+		std::vector<int> stack = {n};
+		while (!stack.empty()) {
+			int m = stack.back();
+			stack.pop_back();
+			auto it = strash.find(std::make_pair(nodes[m].fanin0, nodes[m].fanin1));
+			if (it != strash.end() && it->second == m)
+				strash.erase(it);
+			for (int fanin : {nodes[m].fanin0, nodes[m].fanin1}) {
+				int k = fanin >> 1;
+				if (--nodes[k].refs == 0 && nodes[k].is_and)
+					stack.push_back(k);
+			}
+		}
+	}
+
+	void replace(int n, int lit)
+	{
+		int refs = nodes[n].refs;
+		nodes[n].repr = lit;
+		if (refs == 0) {
+			auto it = strash.find(std::make_pair(nodes[n].fanin0, nodes[n].fanin1));
+			if (it != strash.end() && it->second == n)
+				strash.erase(it);
+			return;
+		}
+		add_refs(lit, refs);
+		nodes[n].refs = 0;
+		kill(n);
+	}
+
+	static uint16_t expand_table(const cut_t &cut, const int *leaves)
+	{
+		int pos[4];
+		for (int j = 0; j < cut.size; j++)
+			for (pos[j] = 0; leaves[pos[j]] != cut.leaves[j]; pos[j]++) { }
+
+		uint16_t table = 0;
+		for (int m = 0; m < 16; m++) {
+			int k = 0;
+			for (int j = 0; j < cut.size; j++)
+				if ((m >> pos[j]) & 1)
+					k |= 1 << j;
+			if ((cut.table >> k) & 1)
+				table |= 1 << m;
+		}
+		return table;
+	}
+
+	static bool merge_leaves(const cut_t &c0, const cut_t &c1, cut_t &cut)
+	{
+		int i = 0, j = 0;
+		cut.size = 0;
+		while (i < c0.size || j < c1.size) {
+			int leaf;
+			if (j == c1.size || (i < c0.size && c0.leaves[i] < c1.leaves[j]))
+				leaf = c0.leaves[i++];
+			else if (i == c0.size || c1.leaves[j] < c0.leaves[i])
+				leaf = c1.leaves[j++];
+			else
+				leaf = c0.leaves[i++], j++;
+			if (cut.size == 4)
+				return false;
+			cut.leaves[cut.size++] = leaf;
+		}
+		return true;
+	}
+
+	static bool subset(const cut_t &small, const cut_t &large)
+	{
+		if (small.size > large.size)
+			return false;
+		int j = 0;
+		for (int i = 0; i < small.size; i++) {
+			while (j < large.size && large.leaves[j] < small.leaves[i])
+				j++;
+			if (j == large.size || large.leaves[j] != small.leaves[i])
+				return false;
+		}
+		return true;
+	}
+
+	void compute_cuts(int n)
+	{
+		std::vector<cut_t> result;
+		int a = nodes[n].fanin0, b = nodes[n].fanin1;
+		uint16_t neg_a = (a & 1) ? 0xffff : 0;
+		uint16_t neg_b = (b & 1) ? 0xffff : 0;
+
+		for (auto &c0 : cuts[a >> 1])
+		for (auto &c1 : cuts[b >> 1])
+		{
+			cut_t cut;
+			if (!merge_leaves(c0, c1, cut))
+				continue;
+
+			bool dominated = false;
+			for (auto &other : result)
+				if (subset(other, cut)) {
+					dominated = true;
+					break;
+				}
+			if (dominated)
+				continue;
+			result.erase(std::remove_if(result.begin(), result.end(),
+					[&](const cut_t &other) { return subset(cut, other); }), result.end());
+
+			cut.table = (expand_table(c0, cut.leaves) ^ neg_a) & (expand_table(c1, cut.leaves) ^ neg_b);
+			result.push_back(cut);
+		}
+
+		// larger cuts leave more room for restructuring
+		std::stable_sort(result.begin(), result.end(),
+				[](const cut_t &x, const cut_t &y) { return x.size > y.size; });
+		if (GetSize(result) > max_cuts)
+			result.resize(max_cuts);
+
+		cut_t trivial;
+		trivial.size = 1;
+		trivial.leaves[0] = n;
+		trivial.table = var_tables[0];
+		result.insert(result.begin(), trivial);
+		cuts[n].swap(result);
+	}
+
+	// Bring a node up to date with the replacements of the nodes in its
+	// input cone, then compute its level and cuts.
+	void prepare(int n)
+	{
+		if (nodes[n].prepared)
+			return;
+		nodes[n].prepared = true;
+
+		int a = resolve(nodes[n].fanin0), b = resolve(nodes[n].fanin1);
+		if (a != nodes[n].fanin0 || b != nodes[n].fanin1)
+		{
+			auto it = strash.find(std::make_pair(nodes[n].fanin0, nodes[n].fanin1));
+			if (it != strash.end() && it->second == n)
+				strash.erase(it);
+
+			if (a > b)
+				std::swap(a, b);
+			nodes[n].fanin0 = a;
+			nodes[n].fanin1 = b;
+
+			int simple = -1;
+			if (a == 0 || (a ^ 1) == b)
+				simple = 0;
+			else if (a == 1 || a == b)
+				simple = b;
+			else {
+				it = strash.find(std::make_pair(a, b));
+				if (it != strash.end()) {
+					prepare(it->second);
+					simple = 2 * it->second;
+				}
+			}
+
+			if (simple >= 0) {
+				replace(n, simple);
+				return;
+			}
+			strash[std::make_pair(a, b)] = n;
+		}
+
+		nodes[n].level = 1 + std::max(nodes[a >> 1].level, nodes[b >> 1].level);
+		compute_cuts(n);
+	}
+
+	// Temporarily dereference the maximum fanout-free cone of n within the
+	// given cut and return its size. Must be followed by restore_mffc().
+	int deref_mffc(int n, const cut_t &cut)
+	{
+		touched.clear();
+		int count = 0;
+		std::vector<int> stack = {n};
+		while (!stack.empty()) {
+			int m = stack.back();
+			stack.pop_back();
+			count++;
+			for (int fanin : {nodes[m].fanin0, nodes[m].fanin1}) {
+				int k = fanin >> 1;
+				touched.push_back(k);
+				if (--nodes[k].refs == 0 && nodes[k].is_and &&
+						std::find(cut.leaves, cut.leaves + cut.size, k) == cut.leaves + cut.size)
+					stack.push_back(k);
+			}
+		}
+		return count;
+	}
+
+	void restore_mffc()
+	{
+		for (int k : touched)
+			nodes[k].refs++;
+	}
+
+	// Map the recipe inputs to the leaves of the cut
+	void recipe_inputs(const RewriteLibrary::npn_t &npn, const cut_t &cut, std::vector<int> &lits)
+	{
+		lits[0] = 0;
+		for (int i = 0; i < 4; i++)
+			lits[1 + i] = npn.perm[i] < cut.size ? 2 * cut.leaves[npn.perm[i]] + ((npn.in_neg >> i) & 1) : 0;
+	}
+
+	// Count the AND nodes that instantiating the recipe would add and the
+	// level of its output, reusing nodes that are already in the graph.
+	void evaluate(const RewriteLibrary::npn_t &npn, const RewriteLibrary::recipe_t &recipe, const cut_t &cut,
+			int &added, int &level)
+	{
+		std::vector<int> lits(5 + GetSize(recipe.steps)), levels(5 + GetSize(recipe.steps));
+		recipe_inputs(npn, cut, lits);
+		for (int i = 0; i < 5; i++)
+			levels[i] = nodes[lits[i] >> 1].level;
+
+		added = 0;
+		for (int k = 0; k < GetSize(recipe.steps); k++)
+		{
+			auto &step = recipe.steps[k];
+			int a = lits[step.first >> 1], b = lits[step.second >> 1];
+			int idx = 5 + k;
+			levels[idx] = 1 + std::max(levels[step.first >> 1], levels[step.second >> 1]);
+			lits[idx] = -1;
+			if (a < 0 || b < 0) {
+				added++;
+				continue;
+			}
+
+			a ^= step.first & 1;
+			b ^= step.second & 1;
+			if (a > b)
+				std::swap(a, b);
+			if (a == 0 || (a ^ 1) == b || a == 1 || a == b) {
+				lits[idx] = a == 0 || (a ^ 1) == b ? 0 : b;
+				levels[idx] = nodes[lits[idx] >> 1].level;
+				continue;
+			}
+
+			auto it = strash.find(std::make_pair(a, b));
+			if (it == strash.end()) {
+				added++;
+				continue;
+			}
+			prepare(it->second);
+			lits[idx] = 2 * it->second;
+			levels[idx] = nodes[it->second].level;
+			if (nodes[it->second].refs == 0)
+				added++;
+		}
+
+		level = levels[recipe.output >> 1];
+	}
+
+	int instantiate(const RewriteLibrary::npn_t &npn, const RewriteLibrary::recipe_t &recipe, const cut_t &cut)
+	{
+		std::vector<int> lits(5 + GetSize(recipe.steps));
+		recipe_inputs(npn, cut, lits);
+		for (int k = 0; k < GetSize(recipe.steps); k++) {
+			auto &step = recipe.steps[k];
+			lits[5 + k] = make_and(lits[step.first >> 1] ^ (step.first & 1), lits[step.second >> 1] ^ (step.second & 1));
+		}
+		return lits[recipe.output >> 1] ^ (recipe.output & 1) ^ (npn.out_neg ? 1 : 0);
+	}
+
+	void rewrite(int n)
+	{
+		int old_level = nodes[n].level;
+		int best_gain = -1, best_level = 0;
+		const cut_t *best_cut = nullptr;
+
+		// the replacement must not be built on top of the node itself
+		auto key = std::make_pair(nodes[n].fanin0, nodes[n].fanin1);
+		strash.erase(key);
+
+		for (auto &cut : cuts[n])
+		{
+			if (cut.size == 1 && cut.leaves[0] == n)
+				continue;
+
+			const auto &npn = library.classify(cut.table);
+			const auto &recipe = library.recipe(npn.canon);
+
+			int mffc = deref_mffc(n, cut);
+			int added, level;
+			evaluate(npn, recipe, cut, added, level);
+			restore_mffc();
+
+			int gain = mffc - added;
+			bool accept;
+			if (area_mode)
+				accept = gain > 0;
+			else
+				accept = level <= old_level && (gain > 0 || (gain == 0 && level < old_level));
+			if (!accept)
+				continue;
+
+			if (best_cut == nullptr || gain > best_gain || (gain == best_gain && level < best_level)) {
+				best_gain = gain;
+				best_level = level;
+				best_cut = &cut;
+			}
+		}
+
+		if (best_cut == nullptr) {
+			strash[key] = n;
+			return;
+		}
+
+		// instantiating may grow the cut lists, so work on a copy
+		cut_t cut = *best_cut;
+		const auto &npn = library.classify(cut.table);
+		int lit = instantiate(npn, library.recipe(npn.canon), cut);
+		replace(n, lit);
+		rewrites++;
+	}
+
+	bool build()
+	{
+		// gates on combinational loops are left alone and their outputs are
+		// treated as inputs
+		GateGraph graph(sigmap);
+		graph.build(module);
+		gates = graph.order;
+
+		if (gates.empty())
+			return false;
+
+		nodes.emplace_back();
+		nodes.back().prepared = true;
+		cuts.emplace_back();
+		cuts.back().emplace_back();
+
+		// x and z constants are 0
+		dict<RTLIL::SigBit, int> bit_lits;
+		auto lookup = [&](RTLIL::SigBit bit) -> int {
+			bit = sigmap(bit);
+			if (bit.wire == nullptr)
+				return bit == RTLIL::State::S1 ? 1 : 0;
+			auto it = bit_lits.find(bit);
+			if (it != bit_lits.end())
+				return it->second;
+			return bit_lits[bit] = add_input(bit);
+		};
+
+		for (auto cell : gates)
+		{
+			int a = cell->hasPort(ID::A) ? lookup(cell->getPort(ID::A)) : 0;
+			int b = cell->hasPort(ID::B) ? lookup(cell->getPort(ID::B)) : 0;
+			int c = cell->hasPort(ID::C) ? lookup(cell->getPort(ID::C)) : 0;
+			int d = cell->hasPort(ID::D) ? lookup(cell->getPort(ID::D)) : 0;
+			int s = cell->hasPort(ID::S) ? lookup(cell->getPort(ID::S)) : 0;
+
+			int y = 0;
+			if (cell->type == ID($_BUF_))    y = a;
+			if (cell->type == ID($_NOT_))    y = a ^ 1;
+			if (cell->type == ID($_AND_))    y = make_and(a, b);
+			if (cell->type == ID($_NAND_))   y = make_and(a, b) ^ 1;
+			if (cell->type == ID($_OR_))     y = make_or(a, b);
+			if (cell->type == ID($_NOR_))    y = make_or(a, b) ^ 1;
+			if (cell->type == ID($_XOR_))    y = make_xor(a, b);
+			if (cell->type == ID($_XNOR_))   y = make_xor(a, b) ^ 1;
+			if (cell->type == ID($_ANDNOT_)) y = make_and(a, b ^ 1);
+			if (cell->type == ID($_ORNOT_))  y = make_or(a, b ^ 1);
+			if (cell->type == ID($_MUX_))    y = make_mux(s, b, a);
+			if (cell->type == ID($_NMUX_))   y = make_mux(s, b, a) ^ 1;
+			if (cell->type == ID($_AOI3_))   y = make_or(make_and(a, b), c) ^ 1;
+			if (cell->type == ID($_OAI3_))   y = make_and(make_or(a, b), c) ^ 1;
+			if (cell->type == ID($_AOI4_))   y = make_or(make_and(a, b), make_and(c, d)) ^ 1;
+			if (cell->type == ID($_OAI4_))   y = make_and(make_or(a, b), make_or(c, d)) ^ 1;
+			bit_lits[sigmap(cell->getPort(ID::Y))] = y;
+		}
+
+		// gate outputs that are visible outside of the gate network
+		pool<RTLIL::Cell*> gate_set(gates.begin(), gates.end());
+		pool<RTLIL::SigBit> used;
+		for (auto cell : module->cells()) {
+			if (gate_set.count(cell))
+				continue;
+			for (auto &conn : cell->connections())
+				if (!cell->output(conn.first) || cell->input(conn.first))
+					for (auto bit : sigmap(conn.second))
+						used.insert(bit);
+		}
+		for (auto wire : module->wires())
+			if (wire->port_output || wire->get_bool_attribute(ID::keep))
+				for (auto bit : sigmap(wire))
+					used.insert(bit);
+
+		for (auto cell : gates) {
+			RTLIL::SigBit y = sigmap(cell->getPort(ID::Y));
+			if (used.count(y))
+				outputs.emplace_back(y, bit_lits.at(y));
+		}
+
+		for (auto &it : outputs)
+			add_refs(it.second, 1);
+		for (int n = 0; n < GetSize(nodes); n++)
+			if (nodes[n].is_and && nodes[n].refs == 0)
+				strash.erase(std::make_pair(nodes[n].fanin0, nodes[n].fanin1));
+
+		return true;
+	}
+
+	// Number of AND nodes and levels in the logic driving the outputs
+	void statistics(int &and_count, int &depth)
+	{
+		std::vector<int> levels(GetSize(nodes), -1);
+		std::vector<int> stack;
+		and_count = 0;
+		depth = 0;
+
+		for (auto &it : outputs) {
+			stack.push_back(resolve(it.second) >> 1);
+			while (!stack.empty()) {
+				int n = stack.back();
+				if (levels[n] >= 0) {
+					stack.pop_back();
+					continue;
+				}
+				if (!nodes[n].is_and) {
+					levels[n] = 0;
+					stack.pop_back();
+					continue;
+				}
+				int a = resolve(nodes[n].fanin0) >> 1, b = resolve(nodes[n].fanin1) >> 1;
+				if (levels[a] < 0 || levels[b] < 0) {
+					if (levels[a] < 0)
+						stack.push_back(a);
+					if (levels[b] < 0)
+						stack.push_back(b);
+					continue;
+				}
+				levels[n] = 1 + std::max(levels[a], levels[b]);
+				and_count++;
+				stack.pop_back();
+			}
+			depth = std::max(depth, levels[resolve(it.second) >> 1]);
+		}
+	}
+
+	void emit()
+	{
+		for (auto cell : gates)
+			module->remove(cell);
+
+		dict<int, RTLIL::SigBit> node_bits, inv_bits;
+		std::vector<int> inv_outputs;
+		std::vector<std::pair<RTLIL::SigBit, int>> connections;
+
+		for (int n = 1; n < GetSize(nodes); n++)
+			if (!nodes[n].is_and)
+				node_bits[n] = nodes[n].bit;
+
+		// drive the output bits directly where possible
+		for (auto &it : outputs) {
+			int lit = resolve(it.second), n = lit >> 1;
+			if (n != 0 && !(lit & 1) && !node_bits.count(n))
+				node_bits[n] = it.first;
+			else if (n != 0 && (lit & 1) && !inv_bits.count(n)) {
+				inv_bits[n] = it.first;
+				inv_outputs.push_back(n);
+			} else
+				connections.emplace_back(it.first, lit);
+		}
+
+		auto get_bit = [&](int lit) -> RTLIL::SigBit {
+			int n = lit >> 1;
+			if (n == 0)
+				return (lit & 1) ? RTLIL::State::S1 : RTLIL::State::S0;
+			if (!(lit & 1))
+				return node_bits.at(n);
+			auto it = inv_bits.find(n);
+			if (it != inv_bits.end())
+				return it->second;
+			return inv_bits[n] = module->NotGate(NEW_ID, node_bits.at(n));
+		};
+
+		std::vector<bool> emitted(GetSize(nodes));
+		std::vector<int> stack;
+		for (auto &it : outputs) {
+			stack.push_back(resolve(it.second) >> 1);
+			while (!stack.empty()) {
+				int n = stack.back();
+				if (emitted[n] || !nodes[n].is_and) {
+					stack.pop_back();
+					continue;
+				}
+				int a = resolve(nodes[n].fanin0), b = resolve(nodes[n].fanin1);
+				bool ready = true;
+				for (int fanin : {a, b})
+					if (!emitted[fanin >> 1] && nodes[fanin >> 1].is_and) {
+						stack.push_back(fanin >> 1);
+						ready = false;
+					}
+				if (!ready)
+					continue;
+				stack.pop_back();
+				emitted[n] = true;
+				if (!node_bits.count(n))
+					node_bits[n] = module->addWire(NEW_ID);
+				module->addAndGate(NEW_ID, get_bit(a), get_bit(b), node_bits.at(n));
+			}
+		}
+
+		for (int n : inv_outputs)
+			module->addNotGate(NEW_ID, node_bits.at(n), inv_bits.at(n));
+		for (auto &it : connections)
+			module->connect(it.first, get_bit(it.second));
+	}
+
+	void run()
+	{
+		if (!build())
+			return;
+
+		int old_ands, old_depth;
+		statistics(old_ands, old_depth);
+
+		rewriting = true;
+		int num_nodes = GetSize(nodes);
+		for (int n = 1; n < num_nodes; n++) {
+			if (!nodes[n].is_and || nodes[n].refs == 0)
+				continue;
+			prepare(n);
+			if (nodes[n].repr < 0)
+				rewrite(n);
+		}
+
+		int new_ands, new_depth;
+		statistics(new_ands, new_depth);
+
+		log("Rewrote %d nodes in module %s: %d -> %d AND nodes, depth %d -> %d.\n",
+				rewrites, log_id(module), old_ands, new_ands, old_depth, new_depth);
+
+		emit();
+	}
+};
+
+struct AigRewritePass : public Pass {
+	AigRewritePass() : Pass("aigrewrite", "cut-based rewriting of fine-grained gate netlists") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    aigrewrite [options] [selection]\n");
+		log("\n");
+		log("This pass converts the selected $_*_ gates to a structurally hashed and-inverter\n");
+		log("graph (AIG) and rewrites it. For every node, the cuts with up to four leaves are\n");
+		log("enumerated and the function of each cut is looked up in a library with one\n");
+		log("precomputed AIG per NPN class of 4-input functions. The cone of the node is\n");
+		log("replaced when the library structure, after sharing the nodes that already\n");
+		log("exist in the graph, needs fewer nodes than it frees.\n");
+		log("\n");
+		log("By default a replacement must not increase the level of the node in the AIG,\n");
+		log("and replacements that keep the node count but reduce the level are accepted\n");
+		log("as well.\n");
+		log("\n");
+		log("The gates are replaced by $_AND_ and $_NOT_ gates, like with 'aigmap'.\n");
+		log("\n");
+		log("    -area\n");
+		log("        accept any replacement that reduces the number of nodes, ignoring the\n");
+		log("        levels\n");
+		log("\n");
+		log("    -n <rounds>\n");
+		log("        number of rewriting rounds (default: 1)\n");
+		log("\n");
+		log("Cells of other types and cells with the keep attribute are treated as inputs.\n");
+		log("The pass is not undef-aware, i.e. x and z constants are treated as 0.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool area_mode = false;
+		int rounds = 1;
+
+		log_header(design, "Executing AIGREWRITE pass (cut-based AIG rewriting).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-area") {
+				area_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				rounds = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		int rewrites = 0;
+		for (auto module : design->selected_modules()) {
+			if (module->has_processes_warn())
+				continue;
+			for (int round = 0; round < rounds; round++) {
+				AigRewriteWorker worker(module, area_mode);
+				worker.run();
+				rewrites += worker.rewrites;
+				if (worker.rewrites == 0)
+					break;
+			}
+		}
+
+		log("Rewrote a total of %d nodes.\n", rewrites);
+	}
+} AigRewritePass;
+
+PRIVATE_NAMESPACE_END
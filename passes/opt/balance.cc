@@ -0,0 +1,522 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/gategraph.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct BalanceWorker
+{
+	enum op_t { OP_AND, OP_OR, OP_XOR, OP_MUX, OP_WIRE, OP_OTHER };
+
+	typedef std::tuple<int, int, int, int> key_t;
+	static const int NONE = INT_MIN;
+
+	RTLIL::Module *module;
+	SigMap sigmap;
+	bool mux_mode;
+
+	// Signals are referred to by their index in `bits`. While planning a
+	// replacement, negative ids refer to the planned gates.
+	idict<RTLIL::SigBit> bits;
+	std::vector<int> arrival;
+	std::vector<int> fanout;
+	dict<int, std::pair<RTLIL::Cell*, RTLIL::IdString>> reader;
+	dict<int, RTLIL::Cell*> driver;
+	dict<RTLIL::Cell*, op_t> ops;
+	std::vector<RTLIL::Cell*> gates;
+	dict<key_t, int> strash;
+	pool<RTLIL::Cell*> removed;
+	pool<int> rebuilt;
+
+	struct planned_t {
+		op_t op;
+		int a, b, s;
+		int arrival;
+	};
+	std::vector<planned_t> plan;
+	dict<key_t, int> plan_strash;
+
+	int balanced_trees = 0, balanced_chains = 0, added_gates = 0, removed_gates = 0;
+
+	BalanceWorker(RTLIL::Module *module, bool mux_mode) : module(module), sigmap(module), mux_mode(mux_mode) { }
+
+	int bit_id(RTLIL::SigBit bit)
+	{
+		int id = bits(sigmap(bit));
+		if (id >= GetSize(arrival)) {
+			arrival.resize(id + 1);
+			fanout.resize(id + 1);
+		}
+		return id;
+	}
+
+	int port_id(RTLIL::Cell *cell, RTLIL::IdString port)
+	{
+		return bit_id(cell->getPort(port));
+	}
+
+	static op_t gate_op(RTLIL::IdString type)
+	{
+		if (type == ID($_AND_)) return OP_AND;
+		if (type == ID($_OR_)) return OP_OR;
+		if (type == ID($_XOR_)) return OP_XOR;
+		if (type == ID($_MUX_)) return OP_MUX;
+		if (type.in(ID($_NOT_), ID($_BUF_))) return OP_WIRE;
+		return OP_OTHER;
+	}
+
+	static key_t make_key(op_t op, int a, int b, int s)
+	{
+		if (op != OP_MUX && a > b)
+			std::swap(a, b);
+		return key_t(op, a, b, s);
+	}
+
+	key_t cell_key(RTLIL::Cell *cell)
+	{
+		op_t op = ops.at(cell);
+		int s = op == OP_MUX ? port_id(cell, ID::S) : NONE;
+		return make_key(op, port_id(cell, ID::A), port_id(cell, ID::B), s);
+	}
+
+	int item_arrival(int id)
+	{
+		return id >= 0 ? arrival[id] : plan[-1 - id].arrival;
+	}
+
+	bool exists(op_t op, int a, int b, int s = NONE)
+	{
+		key_t key = make_key(op, a, b, s);
+		return strash.count(key) || plan_strash.count(key);
+	}
+
+	int make(op_t op, int a, int b, int s = NONE)
+	{
+		key_t key = make_key(op, a, b, s);
+		auto it = strash.find(key);
+		if (it != strash.end())
+			return it->second;
+		it = plan_strash.find(key);
+		if (it != plan_strash.end())
+			return it->second;
+
+		planned_t gate;
+		gate.op = op;
+		gate.a = a;
+		gate.b = b;
+		gate.s = s;
+		gate.arrival = 1 + std::max(item_arrival(a), item_arrival(b));
+		if (s != NONE)
+			gate.arrival = std::max(gate.arrival, 1 + item_arrival(s));
+		plan.push_back(gate);
+		int id = -GetSize(plan);
+		plan_strash[key] = id;
+		return id;
+	}
+
+	bool absorbed(RTLIL::Cell *cell, op_t op, RTLIL::IdString port)
+	{
+		auto it = ops.find(cell);
+		if (it == ops.end() || it->second != op)
+			return false;
+		int y = port_id(cell, ID::Y);
+		auto r = reader.find(y);
+		if (fanout[y] != 1 || r == reader.end())
+			return false;
+		auto r_op = ops.find(r->second.first);
+		return r_op != ops.end() && r_op->second == op && (port == RTLIL::IdString() || r->second.second == port);
+	}
+
+	int gate_arrival(RTLIL::Cell *cell)
+	{
+		int delay = ops.at(cell) == OP_WIRE ? 0 : 1;
+		int t = 0;
+		for (auto port : {ID::A, ID::B, ID::C, ID::D, ID::S})
+			if (cell->hasPort(port))
+				t = std::max(t, arrival[port_id(cell, port)] + delay);
+		return t;
+	}
+
+	// Rebuild the plan for a tree of one associative operator. The two
+	// earliest signals are combined first, preferring pairs that already
+	// exist as a gate so that common sub-trees are shared.
+	int plan_tree(op_t op, std::vector<int> leaves)
+	{
+		if (op == OP_XOR) {
+			// x ^ x cancels out
+			std::sort(leaves.begin(), leaves.end());
+			std::vector<int> odd;
+			for (int i = 0; i < GetSize(leaves); i++)
+				if (i + 1 < GetSize(leaves) && leaves[i] == leaves[i+1])
+					i++;
+				else
+					odd.push_back(leaves[i]);
+			leaves.swap(odd);
+			if (leaves.empty())
+				return bit_id(RTLIL::State::S0);
+		} else {
+			std::sort(leaves.begin(), leaves.end());
+			leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+		}
+
+		auto later = [&](int x, int y) { return item_arrival(x) > item_arrival(y); };
+		std::stable_sort(leaves.begin(), leaves.end(), later);
+
+		while (GetSize(leaves) > 1)
+		{
+			int x = leaves.back();
+			leaves.pop_back();
+
+			int partner = GetSize(leaves) - 1;
+			int t = item_arrival(leaves[partner]);
+			for (int k = partner, n = 0; k >= 0 && n < 16 && item_arrival(leaves[k]) == t; k--, n++)
+				if (exists(op, x, leaves[k])) {
+					partner = k;
+					break;
+				}
+			int y = leaves[partner];
+			leaves.erase(leaves.begin() + partner);
+
+			int z = make(op, x, y);
+			leaves.insert(std::upper_bound(leaves.begin(), leaves.end(), z, later), z);
+		}
+
+		return leaves.front();
+	}
+
+	// A chain of $_MUX_ cells where each one feeds the A input of the next
+	// selects the B input of the first cell with an active select, or the
+	// default value at the end of the chain. With m in the middle of the
+	// chain, this is equivalent to
+	//
+	//   (s[i] | ... | s[m]) ? chain(i..m-1, default b[m]) : chain(m+1..j, default)
+	//
+	// which gives a depth logarithmic in the length of the chain.
+	struct chain_t {
+		std::vector<int> sel, val;
+		dict<std::pair<int, int>, int> or_cache;
+	};
+
+	int plan_or_range(chain_t &chain, int i, int j)
+	{
+		if (i == j)
+			return chain.sel[i];
+		auto key = std::make_pair(i, j);
+		auto it = chain.or_cache.find(key);
+		if (it != chain.or_cache.end())
+			return it->second;
+		// split like plan_chain() splits i..j-1, so the sub-ranges are shared
+		int m = (i + j - 1) / 2;
+		int id = make(OP_OR, plan_or_range(chain, i, m), plan_or_range(chain, m + 1, j));
+		return chain.or_cache[key] = id;
+	}
+
+	int plan_chain(chain_t &chain, int i, int j, int dflt)
+	{
+		if (i > j)
+			return dflt;
+		if (i == j)
+			return make(OP_MUX, dflt, chain.val[i], chain.sel[i]);
+		int m = (i + j) / 2;
+		int sel = plan_or_range(chain, i, m);
+		int then_val = plan_chain(chain, i, m - 1, chain.val[m]);
+		int else_val = plan_chain(chain, m + 1, j, dflt);
+		return make(OP_MUX, else_val, then_val, sel);
+	}
+
+	// Replace the cells with the planned gates, driving the output of the
+	// root cell with the result.
+	void commit(RTLIL::Cell *root, const std::vector<RTLIL::Cell*> &cells, int result)
+	{
+		RTLIL::SigBit y = sigmap(root->getPort(ID::Y));
+		int y_id = bit_id(y);
+
+		for (auto cell : cells) {
+			strash.erase(cell_key(cell));
+			driver.erase(port_id(cell, ID::Y));
+			ops.erase(cell);
+			removed.insert(cell);
+			module->remove(cell);
+		}
+		removed_gates += GetSize(cells);
+
+		std::vector<int> ids(GetSize(plan));
+		auto resolve = [&](int id) { return id >= 0 ? id : ids.at(-1 - id); };
+
+		// A reused gate may be the inner gate of a tree that is visited later,
+		// which must now keep it.
+		auto use = [&](int id) {
+			if (id >= 0)
+				fanout[id]++;
+		};
+
+		for (int k = 0; k < GetSize(plan); k++)
+		{
+			auto &gate = plan[k];
+			use(gate.a);
+			use(gate.b);
+			if (gate.s != NONE)
+				use(gate.s);
+			RTLIL::SigBit out = result == -1 - k ? y : RTLIL::SigBit(module->addWire(NEW_ID));
+			RTLIL::SigBit a = bits[resolve(gate.a)], b = bits[resolve(gate.b)];
+			RTLIL::Cell *cell;
+			if (gate.op == OP_AND)
+				cell = module->addAndGate(NEW_ID, a, b, out);
+			else if (gate.op == OP_OR)
+				cell = module->addOrGate(NEW_ID, a, b, out);
+			else if (gate.op == OP_XOR)
+				cell = module->addXorGate(NEW_ID, a, b, out);
+			else
+				cell = module->addMuxGate(NEW_ID, a, b, bits[resolve(gate.s)], out);
+
+			ids[k] = bit_id(out);
+			arrival[ids[k]] = gate.arrival;
+			ops[cell] = gate.op;
+			strash[cell_key(cell)] = ids[k];
+		}
+		added_gates += GetSize(plan);
+
+		if (result >= 0) {
+			use(result);
+			module->connect(y, bits[result]);
+		}
+		arrival[y_id] = item_arrival(resolve(result));
+		rebuilt.insert(y_id);
+	}
+
+	void balance_tree(RTLIL::Cell *root)
+	{
+		op_t op = ops.at(root);
+		std::vector<RTLIL::Cell*> cells;
+		std::vector<int> leaves;
+		std::vector<RTLIL::Cell*> stack = {root};
+		while (!stack.empty()) {
+			RTLIL::Cell *cell = stack.back();
+			stack.pop_back();
+			cells.push_back(cell);
+			for (auto port : {ID::A, ID::B}) {
+				int id = port_id(cell, port);
+				auto it = driver.find(id);
+				if (it != driver.end() && absorbed(it->second, op, RTLIL::IdString()))
+					stack.push_back(it->second);
+				else
+					leaves.push_back(id);
+			}
+		}
+
+		if (GetSize(leaves) <= 2)
+			return;
+
+		int old_arrival = arrival[port_id(root, ID::Y)];
+		for (auto cell : cells)
+			strash.erase(cell_key(cell));
+
+		plan.clear();
+		plan_strash.clear();
+		int result = plan_tree(op, leaves);
+
+		int new_arrival = item_arrival(result);
+		if (new_arrival < old_arrival || (new_arrival == old_arrival && GetSize(plan) < GetSize(cells))) {
+			commit(root, cells, result);
+			balanced_trees++;
+		} else {
+			for (auto cell : cells)
+				strash[cell_key(cell)] = port_id(cell, ID::Y);
+		}
+	}
+
+	void balance_chain(RTLIL::Cell *root)
+	{
+		std::vector<RTLIL::Cell*> cells;
+		chain_t chain;
+		RTLIL::Cell *cell = root;
+		while (1) {
+			cells.push_back(cell);
+			chain.sel.push_back(port_id(cell, ID::S));
+			chain.val.push_back(port_id(cell, ID::B));
+			int a = port_id(cell, ID::A);
+			auto it = driver.find(a);
+			if (it == driver.end() || !absorbed(it->second, OP_MUX, ID::A))
+				break;
+			cell = it->second;
+		}
+
+		if (GetSize(cells) <= 2)
+			return;
+
+		int old_arrival = arrival[port_id(root, ID::Y)];
+		for (auto c : cells)
+			strash.erase(cell_key(c));
+
+		plan.clear();
+		plan_strash.clear();
+		int result = plan_chain(chain, 0, GetSize(cells) - 1, port_id(cells.back(), ID::A));
+
+		if (item_arrival(result) < old_arrival) {
+			commit(root, cells, result);
+			balanced_chains++;
+		} else {
+			for (auto c : cells)
+				strash[cell_key(c)] = port_id(c, ID::Y);
+		}
+	}
+
+	bool build()
+	{
+		// gates on combinational loops are left alone and their outputs are
+		// treated as inputs
+		GateGraph graph(sigmap);
+		graph.build(module);
+		gates = graph.order;
+
+		if (gates.empty())
+			return false;
+
+		for (auto cell : gates) {
+			driver[port_id(cell, ID::Y)] = cell;
+			ops[cell] = gate_op(cell->type);
+		}
+
+		for (auto cell : module->cells())
+			for (auto &conn : cell->connections()) {
+				if (cell->output(conn.first) && !cell->input(conn.first))
+					continue;
+				for (auto bit : conn.second) {
+					int id = bit_id(bit);
+					fanout[id]++;
+					reader[id] = std::make_pair(cell, conn.first);
+				}
+			}
+
+		// signals visible outside of the module are never absorbed
+		for (auto wire : module->wires())
+			if (wire->port_output || wire->get_bool_attribute(ID::keep))
+				for (auto bit : RTLIL::SigSpec(wire))
+					fanout[bit_id(bit)] += 2;
+
+		for (auto cell : gates) {
+			op_t op = ops.at(cell);
+			if (op == OP_AND || op == OP_OR || op == OP_XOR || op == OP_MUX)
+				strash[cell_key(cell)] = port_id(cell, ID::Y);
+		}
+
+		return true;
+	}
+
+	void run()
+	{
+		if (!build())
+			return;
+
+		int old_depth = 0;
+		for (auto cell : gates) {
+			int y = port_id(cell, ID::Y);
+			arrival[y] = gate_arrival(cell);
+			old_depth = std::max(old_depth, arrival[y]);
+		}
+
+		// in topological order, so the arrival times of the leaves are final
+		// when a tree is rebuilt
+		for (auto cell : gates)
+		{
+			int y = port_id(cell, ID::Y);
+			arrival[y] = gate_arrival(cell);
+
+			op_t op = ops.at(cell);
+			if (op == OP_AND || op == OP_OR || op == OP_XOR) {
+				if (!absorbed(cell, op, RTLIL::IdString()))
+					balance_tree(cell);
+			} else if (op == OP_MUX && mux_mode) {
+				if (!absorbed(cell, OP_MUX, ID::A))
+					balance_chain(cell);
+			}
+		}
+
+		int new_depth = 0;
+		for (auto cell : gates)
+			if (!removed.count(cell))
+				new_depth = std::max(new_depth, arrival[port_id(cell, ID::Y)]);
+		for (int id : rebuilt)
+			new_depth = std::max(new_depth, arrival[id]);
+
+		log("Rebuilt %d trees and %d mux chains in module %s (%d -> %d gates), depth %d -> %d.\n",
+				balanced_trees, balanced_chains, log_id(module), GetSize(gates),
+				GetSize(gates) - removed_gates + added_gates, old_depth, new_depth);
+	}
+};
+
+struct BalancePass : public Pass {
+	BalancePass() : Pass("balance", "reduce the logic depth of fine-grained gate netlists") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    balance [options] [selection]\n");
+		log("\n");
+		log("This pass reduces the depth of a netlist of $_*_ gates. Trees of $_AND_, $_OR_\n");
+		log("and $_XOR_ gates where every inner gate drives only the next gate of the tree\n");
+		log("are collected into one wide operation, which is then rebuilt by combining the\n");
+		log("two inputs that arrive first until one signal is left. Gates that already\n");
+		log("exist in the module are reused where possible, so that common sub-trees are\n");
+		log("shared.\n");
+		log("\n");
+		log("Chains of $_MUX_ gates, where each gate drives only the A input of the next\n");
+		log("one (as created for if/else-if chains and by pmuxtree), are rebuilt with a\n");
+		log("depth that is logarithmic in the length of the chain. This adds $_OR_ gates\n");
+		log("for the combined select signals.\n");
+		log("\n");
+		log("A tree or chain is only replaced when this reduces its depth, counting one\n");
+		log("level per gate and none for $_NOT_ and $_BUF_ gates.\n");
+		log("\n");
+		log("    -nomux\n");
+		log("        do not rebuild $_MUX_ chains\n");
+		log("\n");
+		log("Cells of other types and cells with the keep attribute are treated as inputs.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool mux_mode = true;
+
+		log_header(design, "Executing BALANCE pass (reduce logic depth).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-nomux") {
+				mux_mode = false;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		for (auto module : design->selected_modules()) {
+			if (module->has_processes_warn())
+				continue;
+			BalanceWorker worker(module, mux_mode);
+			worker.run();
+		}
+	}
+} BalancePass;
+
+PRIVATE_NAMESPACE_END
@@ -38,25 +38,28 @@ struct OptPass : public Pass {
 		log("passes in the following order:\n");
 		log("\n");
 		log("    opt_expr [-mux_undef] [-mux_bool] [-undriven] [-noclkinv] [-fine] [-full] [-keepdc]\n");
-		log("    opt_merge [-share_all] -nomux\n");
+		log("             [-worklist] [-j <threads>]\n");
+		log("    opt_merge [-share_all] [-j <threads>] -nomux\n");
 		log("\n");
 		log("    do\n");
 		log("        opt_muxtree\n");
 		log("        opt_reduce [-fine] [-full]\n");
-		log("        opt_merge [-share_all]\n");
+		log("        opt_merge [-share_all] [-j <threads>]\n");
 		log("        opt_share  (-full only)\n");
 		log("        opt_dff [-nodffe] [-nosdff] [-keepdc] [-sat]  (except when called with -noff)\n");
-		log("        opt_clean [-purge]\n");
+		log("        opt_clean [-purge] [-incremental]\n");
 		log("        opt_expr [-mux_undef] [-mux_bool] [-undriven] [-noclkinv] [-fine] [-full] [-keepdc]\n");
+		log("                 [-worklist] [-j <threads>]\n");
 		log("    while <changed design>\n");
 		log("\n");
 		log("When called with -fast the following script is used instead:\n");
 		log("\n");
 		log("    do\n");
 		log("        opt_expr [-mux_undef] [-mux_bool] [-undriven] [-noclkinv] [-fine] [-full] [-keepdc]\n");
-		log("        opt_merge [-share_all]\n");
+		log("                 [-worklist] [-j <threads>]\n");
+		log("        opt_merge [-share_all] [-j <threads>]\n");
 		log("        opt_dff [-nodffe] [-nosdff] [-keepdc] [-sat]  (except when called with -noff)\n");
-		log("        opt_clean [-purge]\n");
+		log("        opt_clean [-purge] [-incremental]\n");
 		log("    while <changed design in opt_dff>\n");
 		log("\n");
 		log("Note: Options in square brackets (such as [-keepdc]) are passed through to\n");
@@ -84,6 +87,10 @@ struct OptPass : public Pass {
 				opt_clean_args += " -purge";
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				opt_clean_args += " -incremental";
+				continue;
+			}
 			if (args[argidx] == "-mux_undef") {
 				opt_expr_args += " -mux_undef";
 				continue;
@@ -129,6 +136,16 @@ struct OptPass : public Pass {
 				opt_dff_args += " -sat";
 				continue;
 			}
+			if (args[argidx] == "-worklist") {
+				opt_expr_args += " -worklist";
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				opt_expr_args += " -j " + args[argidx+1];
+				opt_merge_args += " -j " + args[argidx+1];
+				argidx++;
+				continue;
+			}
 			if (args[argidx] == "-share_all") {
 				opt_merge_args += " -share_all";
 				continue;
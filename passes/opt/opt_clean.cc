@@ -100,9 +100,220 @@ struct keep_cache_t
 	}
 };
 
+// Keeps an index of the cell ports that use each signal bit of the modules
+// that were last cleaned in incremental mode, and the cells and signals that
+// were changed since. The index is updated through the Monitor callbacks, so
+// that a run after a small change only has to look at the change. Changes to
+// the module level connections, and changes that are caught by cheap checks
+// of the cell and wire counts, the ports and the memories, make the next run
+// a full one.
+struct clean_tracker_t : public RTLIL::Monitor
+{
+	struct module_state_t {
+		Hasher::hash_t hashidx;
+		bool purge_mode = false;
+		bool full = false;
+		int memories = 0;
+		std::vector<std::pair<IdString, int>> ports;
+		SigMap sigmap;
+		pool<SigBit> alias_bits, root_bits;
+		dict<SigBit, pool<std::pair<Cell*, IdString>>> users;
+		pool<Cell*> cells;
+		pool<IdString> wires;
+		pool<Cell*> changed_cells;
+		pool<std::pair<IdString, int>> changed_bits;
+	};
+
+	enum status_t { CLEAN, CHANGED, UNKNOWN };
+
+	dict<Module*, module_state_t> modules;
+
+	module_state_t *lookup(Module *module)
+	{
+		auto it = modules.find(module);
+		if (it == modules.end() || it->second.hashidx != module->hashidx_)
+			return nullptr;
+		return &it->second;
+	}
+
+	static int wire_flags(Wire *wire)
+	{
+		return (wire->port_input ? 1 : 0) | (wire->port_output ? 2 : 0) | (wire->get_bool_attribute(ID::keep) ? 4 : 0);
+	}
+
+	// Returns CLEAN if the module is unchanged since the last run, CHANGED if
+	// only the cells and signals returned in 'cells' and 'bits' were changed,
+	// and UNKNOWN if the module has to be cleaned in full.
+	status_t check(Module *module, bool purge_mode, pool<Cell*> &cells, pool<SigBit> &bits)
+	{
+		module_state_t *state = lookup(module);
+		if (state == nullptr || state->full || state->purge_mode != purge_mode ||
+				state->memories != GetSize(module->memories) ||
+				GetSize(state->cells) != GetSize(module->cells_) ||
+				GetSize(state->wires) != GetSize(module->wires_) ||
+				GetSize(state->ports) != GetSize(module->ports))
+			return UNKNOWN;
+		if (GetSize(state->changed_cells) + GetSize(state->changed_bits) > GetSize(module->cells_) + GetSize(module->wires_))
+			return UNKNOWN;
+
+		for (int i = 0; i < GetSize(module->ports); i++) {
+			Wire *wire = module->wire(module->ports[i]);
+			if (wire == nullptr || state->ports[i].first != wire->name || state->ports[i].second != wire_flags(wire))
+				return UNKNOWN;
+		}
+
+		for (auto cell : state->changed_cells)
+			cells.insert(cell);
+		for (auto &it : state->changed_bits) {
+			Wire *wire = module->wire(it.first);
+			if (wire != nullptr && it.second < GetSize(wire))
+				bits.insert(SigBit(wire, it.second));
+		}
+		return cells.empty() && bits.empty() ? CLEAN : CHANGED;
+	}
+
+	// Stops tracking a module, e.g. while it is cleaned in full.
+	void forget(Module *module)
+	{
+		modules.erase(module);
+	}
+
+	// Indexes a module that was just cleaned in full.
+	void mark_clean(Module *module, bool purge_mode)
+	{
+		module_state_t &state = modules[module];
+		state = module_state_t();
+		state.hashidx = module->hashidx_;
+		state.purge_mode = purge_mode;
+		state.memories = GetSize(module->memories);
+		state.sigmap.set(module);
+		for (auto &conn : module->connections())
+			for (auto &sig : {conn.first, conn.second})
+				for (auto bit : sig)
+					if (bit.wire != nullptr)
+						state.alias_bits.insert(bit);
+		for (auto &name : module->ports) {
+			Wire *wire = module->wire(name);
+			state.ports.push_back({name, wire_flags(wire)});
+		}
+		for (auto wire : module->wires())
+			add_wire(&state, wire);
+		for (auto cell : module->cells()) {
+			state.cells.insert(cell);
+			for (auto &conn : cell->connections())
+				update_users(&state, cell, conn.first, conn.second, true);
+		}
+	}
+
+	// Forgets the recorded changes after the module was cleaned locally.
+	void mark_local_clean(Module *module)
+	{
+		module_state_t *state = lookup(module);
+		log_assert(state != nullptr);
+		state->changed_cells.clear();
+		state->changed_bits.clear();
+	}
+
+	void add_wire(module_state_t *state, Wire *wire)
+	{
+		if (!state->wires.insert(wire->name).second)
+			return;
+		if (wire->port_output || wire->get_bool_attribute(ID::keep))
+			for (auto bit : state->sigmap(wire))
+				if (bit.wire != nullptr)
+					state->root_bits.insert(bit);
+	}
+
+	void update_users(module_state_t *state, Cell *cell, IdString port, const SigSpec &sig, bool add)
+	{
+		for (auto bit : sig) {
+			if (bit.wire == nullptr)
+				continue;
+			if (add)
+				add_wire(state, bit.wire);
+			SigBit mapped = state->sigmap(bit);
+			if (add)
+				state->users[mapped].insert({cell, port});
+			else {
+				auto it = state->users.find(mapped);
+				if (it == state->users.end())
+					continue;
+				it->second.erase({cell, port});
+				if (it->second.empty())
+					state->users.erase(it);
+			}
+		}
+	}
+
+	void add_sig(module_state_t *state, const SigSpec &sig)
+	{
+		for (auto &chunk : sig.chunks())
+			if (chunk.wire != nullptr)
+				for (int i = 0; i < chunk.width; i++)
+					state->changed_bits.insert({chunk.wire->name, chunk.offset + i});
+	}
+
+	// new or removed modules change the known cell types of their parents
+	void notify_module_add(Module*) override { modules.clear(); }
+	void notify_module_del(Module*) override { modules.clear(); }
+
+	void notify_connect(Cell *cell, const IdString &port, const SigSpec &old_sig, const SigSpec &sig) override
+	{
+		module_state_t *state = lookup(cell->module);
+		if (state == nullptr)
+			return;
+		update_users(state, cell, port, old_sig, false);
+		update_users(state, cell, port, sig, true);
+		add_sig(state, old_sig);
+		add_sig(state, sig);
+		// Module::remove() unsets the ports one by one before deleting the cell
+		if (sig.empty() && GetSize(cell->connections_) == 1 && cell->connections_.count(port)) {
+			state->cells.erase(cell);
+			state->changed_cells.erase(cell);
+		} else {
+			state->cells.insert(cell);
+			state->changed_cells.insert(cell);
+		}
+	}
+
+	void notify_edit(Module *module, const RTLIL::ModuleEdit &edit) override
+	{
+		RTLIL::Monitor::notify_edit(module, edit);
+		module_state_t *state = lookup(module);
+		if (state == nullptr)
+			return;
+		for (auto cell : edit.removed_cells) {
+			state->cells.erase(cell);
+			state->changed_cells.erase(cell);
+		}
+	}
+
+	// changed aliases are only handled by a full run
+	void notify_connect(Module *module, const SigSig&) override
+	{
+		module_state_t *state = lookup(module);
+		if (state != nullptr)
+			state->full = true;
+	}
+
+	void notify_connect(Module *module, const std::vector<SigSig>&) override
+	{
+		module_state_t *state = lookup(module);
+		if (state != nullptr)
+			state->full = true;
+	}
+
+	void notify_blackout(Module *module) override
+	{
+		module_state_t *state = lookup(module);
+		if (state != nullptr)
+			state->full = true;
+	}
+};
+
 keep_cache_t keep_cache;
 CellTypes ct_reg, ct_all;
-int count_rm_cells, count_rm_wires;
+int count_rm_cells, count_rm_wires, count_skipped_modules, count_local_modules;
 
 void rmunused_module_cells(Module *module, bool verbose)
 {
@@ -202,14 +413,17 @@ void rmunused_module_cells(Module *module, bool verbose)
 
 	unused.sort(RTLIL::sort_by_name_id<RTLIL::Cell>());
 
-	for (auto cell : unused) {
-		if (verbose)
-			log_debug("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
-		module->design->scratchpad_set_bool("opt.did_something", true);
-		if (RTLIL::builtin_ff_cell_types().count(cell->type))
-			ffinit.remove_init(cell->getPort(ID::Q));
-		module->remove(cell);
-		count_rm_cells++;
+	{
+		RTLIL::ModuleEditGuard edit(module);
+		for (auto cell : unused) {
+			if (verbose)
+				log_debug("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
+			module->design->scratchpad_set_bool("opt.did_something", true);
+			if (RTLIL::builtin_ff_cell_types().count(cell->type))
+				ffinit.remove_init(cell->getPort(ID::Q));
+			module->remove(cell);
+			count_rm_cells++;
+		}
 	}
 
 	for (auto it : mem_unused)
@@ -348,8 +562,11 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 		}
 	}
 
-	// we are removing all connections
-	module->connections_.clear();
+	// we are removing all connections, the monitors are told below if they
+	// come back different
+	std::vector<RTLIL::SigSig> old_connections;
+	old_connections.swap(module->connections_);
+	bool rewritten_ports = false;
 
 	// used signals sigmapped
 	SigPool used_signals;
@@ -362,7 +579,11 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 	for (auto &it : module->cells_) {
 		RTLIL::Cell *cell = it.second;
 		for (auto &it2 : cell->connections_) {
-			assign_map.apply(it2.second); // modify the cell connection in place
+			RTLIL::SigSpec sig = assign_map(it2.second);
+			if (sig != it2.second) {
+				it2.second = sig; // modify the cell connection in place
+				rewritten_ports = true;
+			}
 			raw_used_signals.add(it2.second);
 			used_signals.add(it2.second);
 			if (!ct_all.cell_output(cell->type, it2.first))
@@ -501,6 +722,9 @@ bool rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 			del_temp_wires_count++;
 	}
 
+	if (rewritten_ports || module->connections_ != old_connections)
+		module->blackout();
+
 	module->remove(del_wires_queue);
 	count_rm_wires += GetSize(del_wires_queue);
 
@@ -625,6 +849,248 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose, bool
 		while (rmunused_module_signals(module, purge_mode, verbose)) { }
 }
 
+// Incremental counterpart of rmunused_module() for a module where only the
+// given cells and signals were changed since it was last cleaned. A cell can
+// only have become unused if it was changed or drives a changed signal, or if
+// it drives a cell that is removed. For those cells the fanout is followed
+// until an output port, a kept wire or a kept cell is reached, and cells whose
+// fanout never gets there are removed. The changed wires are then handled
+// like rmunused_module_signals() would. Returns false without changing the
+// module when the result could differ from a full run: when aliases, buffer
+// or memory cells are involved or a fanout cone gets too large.
+bool rmunused_module_local(RTLIL::Module *module, clean_tracker_t::module_state_t &state, const pool<Cell*> &changed_cells,
+		const pool<SigBit> &changed_bits, bool verbose)
+{
+	const int max_cone_size = 1000;
+	SigMap &sigmap = state.sigmap;
+
+	auto is_driver = [](Cell *cell, IdString port) {
+		return !ct_all.cell_known(cell->type) || ct_all.cell_output(cell->type, port);
+	};
+	auto is_reader = [](Cell *cell, IdString port) {
+		return !ct_all.cell_known(cell->type) || ct_all.cell_input(cell->type, port);
+	};
+	auto is_special = [](Cell *cell) {
+		if (cell->type.in(ID($memrd), ID($memrd_v2), ID($memwr), ID($memwr_v2), ID($meminit), ID($meminit_v2)))
+			return true;
+		return cell->type.in(ID($pos), ID($_BUF_), ID($buf)) && !cell->has_keep_attr();
+	};
+
+	std::vector<Cell*> queue;
+	for (auto cell : changed_cells) {
+		if (is_special(cell))
+			return false;
+		queue.push_back(cell);
+	}
+	for (auto bit : changed_bits) {
+		if (state.alias_bits.count(bit))
+			return false;
+		auto it = state.users.find(sigmap(bit));
+		if (it != state.users.end())
+			for (auto &user : it->second)
+				if (is_driver(user.first, user.second))
+					queue.push_back(user.first);
+	}
+
+	pool<Cell*> unused, used;
+	while (!queue.empty())
+	{
+		Cell *seed = queue.back();
+		queue.pop_back();
+		if (unused.count(seed) || used.count(seed))
+			continue;
+
+		pool<Cell*> cone;
+		std::vector<Cell*> stack;
+		cone.insert(seed);
+		stack.push_back(seed);
+		bool is_used = false;
+
+		while (!stack.empty() && !is_used)
+		{
+			Cell *cell = stack.back();
+			stack.pop_back();
+			if (is_special(cell))
+				return false;
+			if (keep_cache.query(cell)) {
+				is_used = true;
+				break;
+			}
+			for (auto &conn : cell->connections()) {
+				if (!is_driver(cell, conn.first))
+					continue;
+				for (auto bit : sigmap(conn.second)) {
+					if (bit.wire == nullptr)
+						continue;
+					if (state.root_bits.count(bit)) {
+						is_used = true;
+						break;
+					}
+					auto it = state.users.find(bit);
+					if (it == state.users.end())
+						continue;
+					for (auto &user : it->second) {
+						Cell *reader = user.first;
+						if (!is_reader(reader, user.second) || unused.count(reader) || cone.count(reader))
+							continue;
+						if (used.count(reader)) {
+							is_used = true;
+							break;
+						}
+						if (GetSize(cone) >= max_cone_size)
+							return false;
+						cone.insert(reader);
+						stack.push_back(reader);
+					}
+					if (is_used)
+						break;
+				}
+				if (is_used)
+					break;
+			}
+		}
+
+		if (is_used) {
+			used.insert(seed);
+			continue;
+		}
+
+		// no cell in the cone reaches anything that is used
+		for (auto cell : cone) {
+			unused.insert(cell);
+			for (auto &conn : cell->connections()) {
+				if (!is_reader(cell, conn.first))
+					continue;
+				for (auto bit : sigmap(conn.second)) {
+					auto it = state.users.find(bit);
+					if (it != state.users.end())
+						for (auto &user : it->second)
+							if (is_driver(user.first, user.second) && !cone.count(user.first))
+								queue.push_back(user.first);
+				}
+			}
+		}
+	}
+
+	pool<Wire*> changed_wires;
+	for (auto bit : changed_bits)
+		changed_wires.insert(bit.wire);
+	for (auto cell : unused)
+		for (auto &conn : cell->connections())
+			for (auto &chunk : conn.second.chunks())
+				if (chunk.wire != nullptr)
+					changed_wires.insert(chunk.wire);
+
+	// a full run would also pick new representatives for aliased signals
+	for (auto wire : changed_wires)
+		for (int i = 0; i < GetSize(wire); i++)
+			if (state.alias_bits.count(SigBit(wire, i)))
+				return false;
+
+	if (verbose)
+		log("Finding unused cells or wires near the changes in module %s..\n", module->name.c_str());
+
+	unused.sort(RTLIL::sort_by_name_id<RTLIL::Cell>());
+
+	if (!unused.empty())
+	{
+		RTLIL::ModuleEditGuard edit(module);
+		for (auto cell : unused) {
+			if (verbose)
+				log_debug("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
+			module->design->scratchpad_set_bool("opt.did_something", true);
+			if (RTLIL::builtin_ff_cell_types().count(cell->type))
+				for (auto bit : cell->getPort(ID::Q)) {
+					if (bit.wire == nullptr)
+						continue;
+					auto it = bit.wire->attributes.find(ID::init);
+					if (it != bit.wire->attributes.end() && bit.offset < GetSize(it->second))
+						it->second.bits()[bit.offset] = State::Sx;
+				}
+			module->remove(cell);
+			count_rm_cells++;
+		}
+	}
+
+	// same decisions as rmunused_module_signals() for wires without aliases
+	pool<Wire*> del_wires;
+	for (auto wire : changed_wires)
+	{
+		auto it = wire->attributes.find(ID::init);
+		if (it != wire->attributes.end() && it->second.is_fully_undef())
+			wire->attributes.erase(it);
+
+		std::string unused_bits;
+		bool referenced = false;
+		for (int i = 0; i < GetSize(wire); i++) {
+			bool bit_used = wire->port_output && !wire->port_input;
+			auto it = state.users.find(SigBit(wire, i));
+			if (it != state.users.end()) {
+				referenced = true;
+				for (auto &user : it->second)
+					if (!ct_all.cell_output(user.first->type, user.second))
+						bit_used = true;
+			}
+			if (!bit_used) {
+				if (!unused_bits.empty())
+					unused_bits += " ";
+				unused_bits += stringf("%d", i);
+			}
+		}
+
+		if (!referenced && wire->port_id == 0 && !wire->get_bool_attribute(ID::keep) && !wire->attributes.count(ID::init)) {
+			del_wires.insert(wire);
+			continue;
+		}
+
+		if (unused_bits.empty() || wire->port_id != 0)
+			wire->attributes.erase(ID::unused_bits);
+		else
+			wire->attributes[ID::unused_bits] = RTLIL::Const(unused_bits);
+	}
+
+	if (!del_wires.empty()) {
+		for (auto wire : del_wires) {
+			if (ys_debug() || (check_public_name(wire->name) && verbose))
+				log_debug("  removing unused non-port wire %s.\n", wire->name.c_str());
+			state.wires.erase(wire->name);
+		}
+		module->remove(del_wires);
+		count_rm_wires += GetSize(del_wires);
+		module->design->scratchpad_set_bool("opt.did_something", true);
+	}
+
+	return true;
+}
+
+// Cleans a module, using the tracker of incremental mode if one is given.
+// Returns the status of the module as seen by the tracker.
+clean_tracker_t::status_t clean_module(clean_tracker_t *tracker, RTLIL::Module *module, bool purge_mode, bool verbose)
+{
+	if (tracker == nullptr) {
+		rmunused_module(module, purge_mode, verbose, true);
+		return clean_tracker_t::UNKNOWN;
+	}
+
+	pool<Cell*> changed_cells;
+	pool<SigBit> changed_bits;
+	auto status = tracker->check(module, purge_mode, changed_cells, changed_bits);
+	if (status == clean_tracker_t::CLEAN)
+		return status;
+	if (status == clean_tracker_t::CHANGED) {
+		if (rmunused_module_local(module, tracker->modules.at(module), changed_cells, changed_bits, verbose)) {
+			tracker->mark_local_clean(module);
+			return status;
+		}
+		status = clean_tracker_t::UNKNOWN;
+	}
+
+	tracker->forget(module);
+	rmunused_module(module, purge_mode, verbose, true);
+	tracker->mark_clean(module, purge_mode);
+	return status;
+}
+
 struct OptCleanPass : public Pass {
 	OptCleanPass() : Pass("opt_clean", "remove unused cells and wires") { }
 	void help() override
@@ -643,10 +1109,29 @@ struct OptCleanPass : public Pass {
 		log("    -purge\n");
 		log("        also remove internal nets if they have a public name\n");
 		log("\n");
+		log("    -incremental\n");
+		log("        skip modules that have not been modified since they were last cleaned\n");
+		log("        in incremental mode with the same -purge setting, and in modules where\n");
+		log("        only some cells were changed, only look for unused cells and wires\n");
+		log("        around those. A monitor that is attached to the design on first use\n");
+		log("        keeps an index of the signal users up to date, so such a run does not\n");
+		log("        have to look at the rest of the module. The local cleanup gives the\n");
+		log("        same result as a full run; where it can not guarantee that, e.g. when\n");
+		log("        module level connections (aliases), buffers or memories are involved,\n");
+		log("        the module is cleaned in full. Changed cell, wire and port counts,\n");
+		log("        port flags, renamed objects and passes that are known to bypass the\n");
+		log("        monitors also make the next run a full one. Not detected are other\n");
+		log("        changes that bypass the monitor, e.g. changed cell types or keep\n");
+		log("        attributes; run without this option after passes that do so. This\n");
+		log("        mode is also enabled by setting the scratchpad variable\n");
+		log("        'opt_clean.incremental' to true, which makes it apply to the implicit\n");
+		log("        'clean' calls of ';;' as well.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
 		bool purge_mode = false;
+		bool incremental = design->scratchpad_get_bool("opt_clean.incremental");
 
 		log_header(design, "Executing OPT_CLEAN pass (remove unused cells and wires).\n");
 		log_push();
@@ -657,6 +1142,10 @@ struct OptCleanPass : public Pass {
 				purge_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				incremental = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -671,15 +1160,27 @@ struct OptCleanPass : public Pass {
 
 		count_rm_cells = 0;
 		count_rm_wires = 0;
+		count_skipped_modules = 0;
+		count_local_modules = 0;
+
+		clean_tracker_t *tracker = incremental ? design->tracker<clean_tracker_t>("opt_clean") : nullptr;
 
 		for (auto module : design->selected_whole_modules_warn()) {
 			if (module->has_processes_warn())
 				continue;
-			rmunused_module(module, purge_mode, true, true);
+			auto status = clean_module(tracker, module, purge_mode, true);
+			if (status == clean_tracker_t::CLEAN)
+				count_skipped_modules++;
+			if (status == clean_tracker_t::CHANGED)
+				count_local_modules++;
 		}
 
 		if (count_rm_cells > 0 || count_rm_wires > 0)
 			log("Removed %d unused cells and %d unused wires.\n", count_rm_cells, count_rm_wires);
+		if (count_skipped_modules > 0)
+			log("Skipped %d unchanged modules.\n", count_skipped_modules);
+		if (count_local_modules > 0)
+			log("Cleaned only the changed parts of %d modules.\n", count_local_modules);
 
 		design->optimize();
 		design->sort();
@@ -708,10 +1209,13 @@ struct CleanPass : public Pass {
 		log("When commands are separated using the ';;;' token, this command will be executed\n");
 		log("in -purge mode between the commands.\n");
 		log("\n");
+		log("The -incremental option has the same meaning as for 'opt_clean'.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
 		bool purge_mode = false;
+		bool incremental = design->scratchpad_get_bool("opt_clean.incremental");
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -719,6 +1223,10 @@ struct CleanPass : public Pass {
 				purge_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				incremental = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -733,11 +1241,14 @@ struct CleanPass : public Pass {
 
 		count_rm_cells = 0;
 		count_rm_wires = 0;
+		count_skipped_modules = 0;
+
+		clean_tracker_t *tracker = incremental ? design->tracker<clean_tracker_t>("opt_clean") : nullptr;
 
 		for (auto module : design->selected_unboxed_whole_modules()) {
 			if (module->has_processes())
 				continue;
-			rmunused_module(module, purge_mode, ys_debug(), true);
+			clean_module(tracker, module, purge_mode, ys_debug());
 		}
 
 		log_suppressed();
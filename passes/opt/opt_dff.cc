@@ -739,7 +739,11 @@ struct OptDffWorker
 		QuickConeSat qcsat(modwalker);
 
 		// Run as a separate sub-pass, so that we don't mutate (non-FF) cells under ModWalker.
+		// The queries for a bit assume that it holds its initial value. They are
+		// made permanent when the bit is replaced by that constant, which helps
+		// to prove the bits that depend on it, and are retracted otherwise.
 		bool did_something = false;
+		std::vector<int> queries;
 		for (auto cell : module->selected_cells()) {
 			if (!RTLIL::builtin_ff_cell_types().count(cell->type))
 				continue;
@@ -748,6 +752,10 @@ struct OptDffWorker
 			// Now check if any bit can be replaced by a constant.
 			pool<int> removed_sigbits;
 			for (int i = 0; i < ff.width; i++) {
+				for (int query : queries)
+					qcsat.retractQuery(query);
+				queries.clear();
+
 				State val = ff.val_init[i];
 				if (ff.has_arst)
 					val = combine_const(val, ff.val_arst[i]);
@@ -779,10 +787,11 @@ struct OptDffWorker
 						int q_sat_pi = qcsat.importSigBit(ff.sig_q[i]);
 						int d_sat_pi = qcsat.importSigBit(ff.sig_d[i]);
 
-						qcsat.prepare();
-
 						// Try to find out whether the register bit can change under some circumstances
-						bool counter_example_found = qcsat.ez->solve(qcsat.ez->IFF(q_sat_pi, init_sat_pi), qcsat.ez->NOT(qcsat.ez->IFF(d_sat_pi, init_sat_pi)));
+						int query = qcsat.newQuery();
+						qcsat.assumeQuery(query, qcsat.ez->IFF(q_sat_pi, init_sat_pi));
+						queries.push_back(query);
+						bool counter_example_found = qcsat.solveQuery(query, {qcsat.ez->NOT(qcsat.ez->IFF(d_sat_pi, init_sat_pi))});
 
 						// If the register bit cannot change, we can replace it with a constant
 						if (counter_example_found)
@@ -807,10 +816,11 @@ struct OptDffWorker
 						int q_sat_pi = qcsat.importSigBit(ff.sig_q[i]);
 						int d_sat_pi = qcsat.importSigBit(ff.sig_ad[i]);
 
-						qcsat.prepare();
-
 						// Try to find out whether the register bit can change under some circumstances
-						bool counter_example_found = qcsat.ez->solve(qcsat.ez->IFF(q_sat_pi, init_sat_pi), qcsat.ez->NOT(qcsat.ez->IFF(d_sat_pi, init_sat_pi)));
+						int query = qcsat.newQuery();
+						qcsat.assumeQuery(query, qcsat.ez->IFF(q_sat_pi, init_sat_pi));
+						queries.push_back(query);
+						bool counter_example_found = qcsat.solveQuery(query, {qcsat.ez->NOT(qcsat.ez->IFF(d_sat_pi, init_sat_pi))});
 
 						// If the register bit cannot change, we can replace it with a constant
 						if (counter_example_found)
@@ -820,6 +830,10 @@ struct OptDffWorker
 				log("Setting constant %d-bit at position %d on %s (%s) from module %s.\n", val ? 1 : 0,
 						i, log_id(cell), log_id(cell->type), log_id(module));
 
+				for (int query : queries)
+					qcsat.commitQuery(query);
+				queries.clear();
+
 				initvals.remove_init(ff.sig_q[i]);
 				module->connect(ff.sig_q[i], val);
 				removed_sigbits.insert(i);
@@ -22,6 +22,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/utils.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <algorithm>
@@ -31,6 +32,140 @@ PRIVATE_NAMESPACE_BEGIN
 
 bool did_something;
 
+// Records the changes made to a module while opt_expr -worklist runs on it:
+// cells whose connections were modified and signals that got a new driver or
+// were connected to something else. The next round then only visits these
+// cells and the readers of these signals. There is one set of changes per
+// value of consume_x, as the two kinds of rounds reach their fixed points
+// separately.
+struct expr_tracker_t : public RTLIL::Monitor
+{
+	struct changes_t {
+		bool full = true;
+		pool<RTLIL::IdString> cells;
+		std::vector<RTLIL::SigBit> bits;
+	};
+
+	RTLIL::Module *module;
+	changes_t changes[2];
+	int skipped_cells = 0;
+
+	// state of the cell that replace_const_cells() is looking at
+	RTLIL::IdString cell_name;
+	std::vector<RTLIL::SigSpec> cell_outputs;
+	bool saved_did_something = false;
+
+	expr_tracker_t(RTLIL::Module *module) : module(module)
+	{
+		module->monitors.insert(this);
+	}
+
+	~expr_tracker_t()
+	{
+		module->monitors.erase(this);
+	}
+
+	void add_cell(RTLIL::IdString name)
+	{
+		for (auto &c : changes)
+			c.cells.insert(name);
+	}
+
+	void add_sig(const RTLIL::SigSpec &sig)
+	{
+		for (auto &c : changes)
+			for (auto bit : sig)
+				if (bit.wire != nullptr)
+					c.bits.push_back(bit);
+	}
+
+	void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec &old_sig, const RTLIL::SigSpec &sig) override
+	{
+		add_cell(cell->name);
+		if (!cell->input(port)) {
+			add_sig(old_sig);
+			add_sig(sig);
+		}
+	}
+
+	void notify_connect(RTLIL::Module*, const RTLIL::SigSig &conn) override
+	{
+		add_sig(conn.first);
+		add_sig(conn.second);
+	}
+
+	void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) override
+	{
+		for (auto &c : changes)
+			c.full = true;
+	}
+
+	void notify_blackout(RTLIL::Module*) override
+	{
+		for (auto &c : changes)
+			c.full = true;
+	}
+
+	// Rewrites that change a cell in place (such as its type) are not seen
+	// by the monitor, so every cell that sets did_something is recorded
+	// together with its outputs.
+	void begin_cell(RTLIL::Cell *cell, bool &did_something)
+	{
+		cell_name = cell->name;
+		cell_outputs.clear();
+		for (auto &conn : cell->connections())
+			if (!cell->input(conn.first))
+				cell_outputs.push_back(conn.second);
+		saved_did_something = did_something;
+		did_something = false;
+	}
+
+	void end_cell(bool &did_something)
+	{
+		if (did_something) {
+			add_cell(cell_name);
+			for (auto &sig : cell_outputs)
+				add_sig(sig);
+		}
+		did_something |= saved_did_something;
+	}
+
+	// Collects the cells that a round with the given consume_x setting has
+	// to visit and starts recording the changes for the next such round.
+	// Returns false if all cells have to be visited.
+	bool get_worklist(const SigMap &sigmap, bool consume_x, pool<RTLIL::Cell*> &worklist)
+	{
+		changes_t &c = changes[consume_x];
+		bool partial = !c.full;
+
+		if (partial) {
+			pool<RTLIL::SigBit> dirty_bits;
+			for (auto bit : c.bits)
+				dirty_bits.insert(sigmap(bit));
+
+			auto is_dirty = [&](RTLIL::Cell *cell) {
+				if (c.cells.count(cell->name))
+					return true;
+				for (auto &conn : cell->connections())
+					if (!cell->output(conn.first))
+						for (auto bit : sigmap(conn.second))
+							if (dirty_bits.count(bit))
+								return true;
+				return false;
+			};
+
+			for (auto cell : module->cells())
+				if (is_dirty(cell))
+					worklist.insert(cell);
+			skipped_cells += GetSize(module->cells_) - GetSize(worklist);
+		}
+
+		c = changes_t();
+		c.full = false;
+		return partial;
+	}
+};
+
 void replace_undriven(RTLIL::Module *module, const CellTypes &ct)
 {
 	SigMap sigmap(module);
@@ -393,11 +528,147 @@ int get_highest_hot_index(RTLIL::SigSpec signal)
 	return -1;
 }
 
-void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool consume_x, bool mux_undef, bool mux_bool, bool do_fine, bool keepdc, bool noclkinv)
+// Folds the selected cells that only have constant inputs. The cells are
+// evaluated on worker threads and replaced afterwards on the calling thread,
+// in the order of module->cells(), so that the result does not depend on the
+// number of threads. This covers the cell types of the FOLD_*_CELL rules in
+// replace_const_cells(), which handles everything else.
+void fold_const_cells_parallel(RTLIL::Module *module, int threads)
+{
+	typedef RTLIL::Const (*arith_fn_t)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+	typedef RTLIL::Const (*simple_fn_t)(const RTLIL::Const&, const RTLIL::Const&);
+	typedef RTLIL::Const (*mux_fn_t)(const RTLIL::Const&, const RTLIL::Const&, const RTLIL::Const&);
+
+	static const dict<RTLIL::IdString, arith_fn_t> unary_fns = {
+		{ID($not), RTLIL::const_not}, {ID($pos), RTLIL::const_pos}, {ID($neg), RTLIL::const_neg},
+		{ID($reduce_and), RTLIL::const_reduce_and}, {ID($reduce_or), RTLIL::const_reduce_or},
+		{ID($reduce_xor), RTLIL::const_reduce_xor}, {ID($reduce_xnor), RTLIL::const_reduce_xnor},
+		{ID($reduce_bool), RTLIL::const_reduce_bool}, {ID($logic_not), RTLIL::const_logic_not}
+	};
+	static const dict<RTLIL::IdString, arith_fn_t> binary_fns = {
+		{ID($and), RTLIL::const_and}, {ID($or), RTLIL::const_or}, {ID($xor), RTLIL::const_xor},
+		{ID($xnor), RTLIL::const_xnor}, {ID($logic_and), RTLIL::const_logic_and}, {ID($logic_or), RTLIL::const_logic_or},
+		{ID($shl), RTLIL::const_shl}, {ID($shr), RTLIL::const_shr}, {ID($sshl), RTLIL::const_sshl},
+		{ID($sshr), RTLIL::const_sshr}, {ID($shift), RTLIL::const_shift}, {ID($shiftx), RTLIL::const_shiftx},
+		{ID($lt), RTLIL::const_lt}, {ID($le), RTLIL::const_le}, {ID($eq), RTLIL::const_eq},
+		{ID($ne), RTLIL::const_ne}, {ID($gt), RTLIL::const_gt}, {ID($ge), RTLIL::const_ge},
+		{ID($eqx), RTLIL::const_eqx}, {ID($nex), RTLIL::const_nex},
+		{ID($add), RTLIL::const_add}, {ID($sub), RTLIL::const_sub}, {ID($mul), RTLIL::const_mul},
+		{ID($div), RTLIL::const_div}, {ID($mod), RTLIL::const_mod}, {ID($divfloor), RTLIL::const_divfloor},
+		{ID($modfloor), RTLIL::const_modfloor}, {ID($pow), RTLIL::const_pow}
+	};
+	static const dict<RTLIL::IdString, simple_fn_t> simple_fns = {
+		{ID($bmux), RTLIL::const_bmux}, {ID($demux), RTLIL::const_demux}, {ID($bweqx), RTLIL::const_bweqx}
+	};
+	static const dict<RTLIL::IdString, mux_fn_t> mux_fns = {
+		{ID($mux), RTLIL::const_mux}, {ID($pmux), RTLIL::const_pmux}, {ID($bwmux), RTLIL::const_bwmux}
+	};
+
+	// Everything a worker needs is looked up here, so that the workers do
+	// not touch IdStrings or the parameter dicts.
+	struct fold_task_t {
+		RTLIL::Cell *cell;
+		arith_fn_t arith_fn = nullptr;
+		simple_fn_t simple_fn = nullptr;
+		mux_fn_t mux_fn = nullptr;
+		const RTLIL::SigSpec *a = nullptr, *b = nullptr, *s = nullptr;
+		bool a_signed = false, b_signed = false;
+		int y_width = 0;
+		bool folded = false;
+		RTLIL::Const y;
+	};
+
+	std::vector<fold_task_t> tasks;
+	for (auto cell : module->selected_cells())
+	{
+		fold_task_t task;
+		task.cell = cell;
+		if (unary_fns.count(cell->type) || binary_fns.count(cell->type)) {
+			if (!cell->hasParam(ID::A_SIGNED) || !cell->hasParam(ID::Y_WIDTH))
+				continue;
+			task.a = &cell->getPort(ID::A);
+			task.a_signed = cell->getParam(ID::A_SIGNED).as_bool();
+			task.y_width = cell->getParam(ID::Y_WIDTH).as_int();
+			if (unary_fns.count(cell->type)) {
+				task.arith_fn = unary_fns.at(cell->type);
+			} else {
+				if (!cell->hasParam(ID::B_SIGNED))
+					continue;
+				task.arith_fn = binary_fns.at(cell->type);
+				task.b = &cell->getPort(ID::B);
+				task.b_signed = cell->getParam(ID::B_SIGNED).as_bool();
+			}
+		} else if (simple_fns.count(cell->type)) {
+			task.simple_fn = simple_fns.at(cell->type);
+			task.a = &cell->getPort(ID::A);
+			task.b = &cell->getPort(cell->type == ID($bweqx) ? ID::B : ID::S);
+		} else if (mux_fns.count(cell->type)) {
+			task.mux_fn = mux_fns.at(cell->type);
+			task.a = &cell->getPort(ID::A);
+			task.b = &cell->getPort(ID::B);
+			task.s = &cell->getPort(ID::S);
+		} else
+			continue;
+		tasks.push_back(std::move(task));
+	}
+
+	if (tasks.empty())
+		return;
+
+	SigMap assign_map(module);
+	assign_map.prepare_shared();
+
+	parallel_for(threads, GetSize(tasks), [&](int i) {
+		fold_task_t &task = tasks[i];
+		RTLIL::SigSpec a = assign_map.apply_shared(*task.a);
+		RTLIL::SigSpec b, s;
+		if (!a.is_fully_const())
+			return;
+		if (task.b != nullptr) {
+			b = assign_map.apply_shared(*task.b);
+			if (!b.is_fully_const())
+				return;
+		}
+		if (task.s != nullptr) {
+			s = assign_map.apply_shared(*task.s);
+			if (!s.is_fully_const())
+				return;
+		}
+		if (task.mux_fn != nullptr)
+			task.y = task.mux_fn(a.as_const(), b.as_const(), s.as_const());
+		else if (task.simple_fn != nullptr)
+			task.y = task.simple_fn(a.as_const(), b.as_const());
+		else if (task.b != nullptr)
+			task.y = task.arith_fn(a.as_const(), b.as_const(), task.a_signed, task.b_signed, task.y_width);
+		else
+			task.y = task.arith_fn(a.as_const(), RTLIL::Const(RTLIL::State::S0, 1), task.a_signed, false, task.y_width);
+		task.folded = true;
+	}, 64);
+
+	int folded = 0;
+	for (auto &task : tasks)
+		if (task.folded) {
+			cover("opt.opt_expr.const_parallel");
+			replace_cell(assign_map, module, task.cell, "constant inputs", ID::Y, task.y);
+			folded++;
+		}
+
+	log_debug("  Folded %d of %d cells using %d thread(s).\n", folded, GetSize(tasks), threads);
+}
+
+void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool consume_x, bool mux_undef, bool mux_bool, bool do_fine, bool keepdc, bool noclkinv, expr_tracker_t *tracker = nullptr)
 {
 	SigMap assign_map(module);
 	dict<RTLIL::SigSpec, RTLIL::SigSpec> invert_map;
 
+	// In worklist mode, cells that were not touched since the last round of
+	// the same kind, and whose inputs did not change either, are skipped.
+	pool<RTLIL::Cell*> worklist;
+	bool use_worklist = tracker != nullptr && tracker->get_worklist(assign_map, consume_x, worklist);
+	auto visit_cell = [&](RTLIL::Cell *cell) {
+		return design->selected(module, cell) && (!use_worklist || worklist.count(cell));
+	};
+
 	for (auto cell : module->cells()) {
 		if (design->selected(module, cell) && cell->type[0] == '$') {
 			if (cell->type.in(ID($_NOT_), ID($not), ID($logic_not)) &&
@@ -414,7 +685,7 @@ void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool cons
 
 	if (!noclkinv)
 	for (auto cell : module->cells())
-	if (design->selected(module, cell)) {
+	if (visit_cell(cell)) {
 		if (cell->type.in(ID($dff), ID($dffe), ID($dffsr), ID($dffsre), ID($adff), ID($adffe), ID($aldff), ID($aldffe), ID($sdff), ID($sdffe), ID($sdffce), ID($fsm), ID($memrd), ID($memrd_v2), ID($memwr), ID($memwr_v2)))
 			handle_polarity_inv(cell, ID::CLK, ID::CLK_POLARITY, assign_map, invert_map);
 
@@ -494,7 +765,7 @@ void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool cons
 	dict<RTLIL::SigBit, Cell*> outbit_to_cell;
 
 	for (auto cell : module->cells())
-	if (design->selected(module, cell) && yosys_celltypes.cell_evaluable(cell->type)) {
+	if (visit_cell(cell) && yosys_celltypes.cell_evaluable(cell->type)) {
 		for (auto &conn : cell->connections())
 		if (yosys_celltypes.cell_output(cell->type, conn.first))
 		for (auto bit : assign_map(conn.second))
@@ -503,7 +774,7 @@ void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool cons
 	}
 
 	for (auto cell : module->cells())
-	if (design->selected(module, cell) && yosys_celltypes.cell_evaluable(cell->type)) {
+	if (visit_cell(cell) && yosys_celltypes.cell_evaluable(cell->type)) {
 		const int r_index = cells.node(cell);
 		for (auto &conn : cell->connections())
 		if (yosys_celltypes.cell_input(cell->type, conn.first))
@@ -520,6 +791,9 @@ void replace_const_cells(RTLIL::Design *design, RTLIL::Module *module, bool cons
 
 	for (auto cell : cells.sorted)
 	{
+		if (tracker != nullptr)
+			tracker->begin_cell(cell, did_something);
+
 #define ACTION_DO(_p_, _s_) do { cover("opt.opt_expr.action_" S__LINE__); replace_cell(assign_map, module, cell, input.as_string(), _p_, _s_); goto next_cell; } while (0)
 #define ACTION_DO_Y(_v_) ACTION_DO(ID::Y, RTLIL::SigSpec(RTLIL::State::S ## _v_))
 
@@ -2243,7 +2517,9 @@ skip_alu_split:
 			}
 		}
 
-	next_cell:;
+	next_cell:
+		if (tracker != nullptr)
+			tracker->end_cell(did_something);
 #undef ACTION_DO
 #undef ACTION_DO_Y
 #undef FOLD_1ARG_CELL
@@ -2303,6 +2579,16 @@ struct OptExprPass : public Pass {
 		log("        all result bits to be set to x. this behavior changes when 'a+0' is\n");
 		log("        replaced by 'a'. the -keepdc option disables all such optimizations.\n");
 		log("\n");
+		log("    -worklist\n");
+		log("        after the first pass over a module, only revisit the cells that were\n");
+		log("        changed and the readers of signals that were changed in the previous\n");
+		log("        round, instead of rescanning all cells until nothing changes.\n");
+		log("\n");
+		log("    -j <threads>\n");
+		log("        start with folding all cells that only have constant inputs, evaluating\n");
+		log("        them on the given number of threads (0 = one per hardware thread). The\n");
+		log("        replacements are applied in a fixed order afterwards.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -2312,6 +2598,8 @@ struct OptExprPass : public Pass {
 		bool noclkinv = false;
 		bool do_fine = false;
 		bool keepdc = false;
+		bool worklist = false;
+		int threads = 0;
 
 		log_header(design, "Executing OPT_EXPR pass (perform const folding).\n");
 		log_push();
@@ -2349,6 +2637,14 @@ struct OptExprPass : public Pass {
 				keepdc = true;
 				continue;
 			}
+			if (args[argidx] == "-worklist") {
+				worklist = true;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -2365,15 +2661,26 @@ struct OptExprPass : public Pass {
 					design->scratchpad_set_bool("opt.did_something", true);
 			}
 
+			std::unique_ptr<expr_tracker_t> tracker;
+			if (worklist)
+				tracker.reset(new expr_tracker_t(module));
+
+			if (threads > 0) {
+				did_something = false;
+				fold_const_cells_parallel(module, threads);
+				if (did_something)
+					design->scratchpad_set_bool("opt.did_something", true);
+			}
+
 			do {
 				do {
 					did_something = false;
-					replace_const_cells(design, module, false /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv);
+					replace_const_cells(design, module, false /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv, tracker.get());
 					if (did_something)
 						design->scratchpad_set_bool("opt.did_something", true);
 				} while (did_something);
 				if (!keepdc)
-					replace_const_cells(design, module, true /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv);
+					replace_const_cells(design, module, true /* consume_x */, mux_undef, mux_bool, do_fine, keepdc, noclkinv, tracker.get());
 				if (did_something)
 					design->scratchpad_set_bool("opt.did_something", true);
 			} while (did_something);
@@ -2383,6 +2690,9 @@ struct OptExprPass : public Pass {
 			if (did_something)
 				design->scratchpad_set_bool("opt.did_something", true);
 
+			if (tracker)
+				log("Skipped %d visits of unchanged cells.\n", tracker->skipped_cells);
+
 			log_suppressed();
 		}
 
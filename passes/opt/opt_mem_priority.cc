@@ -49,9 +49,10 @@ struct OptMemPriorityPass : public Pass {
 		int total_count = 0;
 		for (auto module : design->selected_modules()) {
 			modwalker.setup(module);
+			// all memories share one solver, their enable and address cones often overlap
+			QuickConeSat qcsat(modwalker);
 			for (auto &mem : Mem::get_selected_memories(module)) {
 				bool mem_changed = false;
-				QuickConeSat qcsat(modwalker);
 				for (int i = 0; i < GetSize(mem.wr_ports); i++) {
 					auto &wport1 = mem.wr_ports[i];
 					for (int j = 0; j < GetSize(mem.wr_ports); j++) {
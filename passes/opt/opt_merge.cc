@@ -22,6 +22,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/celltypes.h"
+#include "kernel/threading.h"
 #include "libs/sha1/sha1.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -40,10 +41,31 @@ struct OptMergeWorker
 	SigMap assign_map;
 	FfInitVals initvals;
 	bool mode_share_all;
+	bool mode_keepdc;
 
 	CellTypes ct;
 	int total_count;
 
+	enum KeyKind {
+		KEY_GENERIC,
+		KEY_COMMUTATIVE,
+		KEY_REDUCE_SORT,
+		KEY_REDUCE_UNIFY,
+		KEY_PMUX
+	};
+
+	// Everything hash_cell_key() needs to know about a cell. It is filled in
+	// on the main thread, so that the hashing itself can run on worker threads
+	// without copying IdStrings or looking up cell types.
+	struct CellKey {
+		RTLIL::Cell *cell;
+		KeyKind kind;
+		std::vector<const std::pair<RTLIL::IdString, RTLIL::SigSpec>*> inputs;
+		std::vector<const std::pair<RTLIL::IdString, RTLIL::Const>*> params;
+		RTLIL::Const init;
+		Hasher::hash_t hash;
+	};
+
 	static vector<pair<SigBit, SigSpec>> sorted_pmux_in(const dict<RTLIL::IdString, RTLIL::SigSpec> &conn)
 	{
 		SigSpec sig_s = conn.at(ID::S);
@@ -226,8 +248,274 @@ struct OptMergeWorker
 		return !initvals(cell->getPort(ID::Q)).is_fully_def();
 	}
 
-	OptMergeWorker(RTLIL::Design *design, RTLIL::Module *module, bool mode_nomux, bool mode_share_all, bool mode_keepdc) :
-		design(design), module(module), assign_map(module), mode_share_all(mode_share_all)
+	std::vector<RTLIL::Cell*> candidate_cells()
+	{
+		std::vector<RTLIL::Cell*> cells;
+		cells.reserve(module->cells().size());
+		for (auto cell : module->cells()) {
+			if (!design->selected(module, cell))
+				continue;
+			if (cell->type.in(ID($meminit), ID($meminit_v2), ID($mem), ID($mem_v2))) {
+				// Ignore those for performance: meminit can have an excessively large port,
+				// mem can have an excessively large parameter holding the init data
+				continue;
+			}
+			if (mode_keepdc && has_dont_care_initval(cell))
+				continue;
+			if (ct.cell_known(cell->type) || (mode_share_all && cell->known()))
+				cells.push_back(cell);
+		}
+		return cells;
+	}
+
+	// Replace 'cell' by the identical 'other_cell'. The representatives of the
+	// redirected output bits before and after the merge are appended to
+	// 'merged_bits' (if given), so that callers can track which signals changed.
+	void merge_cell(RTLIL::Cell *cell, RTLIL::Cell *other_cell, std::vector<std::array<RTLIL::SigBit, 3>> *merged_bits = nullptr)
+	{
+		log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), other_cell->name.c_str());
+		for (auto &it : cell->connections()) {
+			if (cell->output(it.first)) {
+				RTLIL::SigSpec other_sig = other_cell->getPort(it.first);
+				log_debug("    Redirecting output %s: %s = %s\n", it.first.c_str(),
+						log_signal(it.second), log_signal(other_sig));
+				Const init = initvals(other_sig);
+				initvals.remove_init(it.second);
+				initvals.remove_init(other_sig);
+				module->connect(RTLIL::SigSig(it.second, other_sig));
+				if (merged_bits) {
+					RTLIL::SigSpec old_rep = assign_map(it.second), other_rep = assign_map(other_sig);
+					assign_map.add(it.second, other_sig);
+					RTLIL::SigSpec new_rep = assign_map(it.second);
+					for (int i = 0; i < GetSize(new_rep); i++)
+						merged_bits->push_back({old_rep[i], other_rep[i], new_rep[i]});
+				} else
+					assign_map.add(it.second, other_sig);
+				initvals.set_init(other_sig, init);
+			}
+		}
+		log_debug("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
+		module->remove(cell);
+		total_count++;
+	}
+
+	CellKey make_cell_key(RTLIL::Cell *cell)
+	{
+		CellKey key;
+		key.cell = cell;
+		key.hash = 0;
+
+		if (cell->type.in(ID($and), ID($or), ID($xor), ID($xnor), ID($add), ID($mul),
+				ID($logic_and), ID($logic_or), ID($_AND_), ID($_OR_), ID($_XOR_))) {
+			key.kind = KEY_COMMUTATIVE;
+			key.inputs.push_back(&*cell->connections_.find(ID::A));
+			key.inputs.push_back(&*cell->connections_.find(ID::B));
+		} else if (cell->type.in(ID($reduce_xor), ID($reduce_xnor))) {
+			key.kind = KEY_REDUCE_SORT;
+			key.inputs.push_back(&*cell->connections_.find(ID::A));
+		} else if (cell->type.in(ID($reduce_and), ID($reduce_or), ID($reduce_bool))) {
+			key.kind = KEY_REDUCE_UNIFY;
+			key.inputs.push_back(&*cell->connections_.find(ID::A));
+		} else if (cell->type == ID($pmux)) {
+			key.kind = KEY_PMUX;
+			key.inputs.push_back(&*cell->connections_.find(ID::A));
+			key.inputs.push_back(&*cell->connections_.find(ID::B));
+			key.inputs.push_back(&*cell->connections_.find(ID::S));
+		} else {
+			key.kind = KEY_GENERIC;
+			for (auto &conn : cell->connections_)
+				if (!cell->output(conn.first))
+					key.inputs.push_back(&conn);
+			std::sort(key.inputs.begin(), key.inputs.end(), [](auto a, auto b) { return a->first < b->first; });
+			if (RTLIL::builtin_ff_cell_types().count(cell->type))
+				key.init = initvals(cell->getPort(ID::Q));
+		}
+
+		for (auto &param : cell->parameters)
+			key.params.push_back(&param);
+		std::sort(key.params.begin(), key.params.end(), [](auto a, auto b) { return a->first < b->first; });
+		return key;
+	}
+
+	static Hasher hash_bit_shared(RTLIL::SigBit bit, Hasher h)
+	{
+		if (bit.wire) {
+			h.eat(bit.offset);
+			h.eat(bit.wire->name.index_);
+		} else
+			h.eat(bit.data);
+		return h;
+	}
+
+	// Thread-safe counterpart of hash_cell_function(). Equal cells get equal
+	// hashes, but the values differ from the ones used by the serial mode.
+	Hasher::hash_t hash_cell_key(const CellKey &key) const
+	{
+		Hasher h;
+		h = key.cell->type.hash_into(h);
+
+		switch (key.kind)
+		{
+		case KEY_COMMUTATIVE: {
+			std::array<RTLIL::SigSpec, 2> inputs = {
+				assign_map.apply_shared(key.inputs[0]->second),
+				assign_map.apply_shared(key.inputs[1]->second)
+			};
+			std::sort(inputs.begin(), inputs.end());
+			h = inputs[0].hash_into(h);
+			h = inputs[1].hash_into(h);
+			break;
+		}
+		case KEY_REDUCE_SORT: {
+			RTLIL::SigSpec a = assign_map.apply_shared(key.inputs[0]->second);
+			a.sort();
+			h = a.hash_into(h);
+			break;
+		}
+		case KEY_REDUCE_UNIFY: {
+			RTLIL::SigSpec a = assign_map.apply_shared(key.inputs[0]->second);
+			a.sort_and_unify();
+			h = a.hash_into(h);
+			break;
+		}
+		case KEY_PMUX: {
+			RTLIL::SigSpec sig_a = assign_map.apply_shared(key.inputs[0]->second);
+			RTLIL::SigSpec sig_b = assign_map.apply_shared(key.inputs[1]->second);
+			RTLIL::SigSpec sig_s = assign_map.apply_shared(key.inputs[2]->second);
+			int s_width = GetSize(sig_s);
+			int width = s_width ? GetSize(sig_b) / s_width : 0;
+			vector<pair<SigBit, SigSpec>> sb_pairs;
+			for (int i = 0; i < s_width; i++)
+				sb_pairs.push_back(pair<SigBit, SigSpec>(sig_s[i], sig_b.extract(i*width, width)));
+			std::sort(sb_pairs.begin(), sb_pairs.end());
+			for (auto &it : sb_pairs) {
+				h = hash_bit_shared(it.first, h);
+				h = it.second.hash_into(h);
+			}
+			h = sig_a.hash_into(h);
+			break;
+		}
+		case KEY_GENERIC:
+			for (auto conn : key.inputs) {
+				h = conn->first.hash_into(h);
+				h = assign_map.apply_shared(conn->second).hash_into(h);
+			}
+			h = key.init.hash_into(h);
+			break;
+		}
+
+		for (auto param : key.params) {
+			h = param->first.hash_into(h);
+			h = param->second.hash_into(h);
+		}
+		return h.yield();
+	}
+
+	// Hash all cells on worker threads, then merge identical cells within
+	// each hash bucket on the main thread. Only cells reading signals that
+	// were redirected by a merge are re-hashed and re-checked in later rounds.
+	void run_parallel(int threads)
+	{
+		std::vector<CellKey> keys;
+		for (auto cell : candidate_cells()) {
+			if ((!mode_share_all && !ct.cell_known(cell->type)) || !cell->known())
+				continue;
+			if (cell->type == ID($scopeinfo))
+				continue;
+			keys.push_back(make_cell_key(cell));
+		}
+
+		int count = GetSize(keys);
+		std::vector<bool> alive(count, true);
+		std::vector<int> dirty(count);
+		for (int i = 0; i < count; i++)
+			dirty[i] = i;
+
+		dict<RTLIL::SigBit, std::vector<int>> readers;
+		for (int i = 0; i < count; i++)
+			for (auto conn : keys[i].inputs)
+				for (auto bit : assign_map(conn->second))
+					if (bit.wire != nullptr)
+						readers[bit].push_back(i);
+
+		int rounds = 0;
+		while (!dirty.empty())
+		{
+			rounds++;
+			for (int i : dirty)
+				if (keys[i].kind == KEY_GENERIC && RTLIL::builtin_ff_cell_types().count(keys[i].cell->type))
+					keys[i].init = initvals(keys[i].cell->getPort(ID::Q));
+
+			assign_map.prepare_shared();
+			parallel_for(threads, GetSize(dirty), [&](int k) {
+				keys[dirty[k]].hash = hash_cell_key(keys[dirty[k]]);
+			}, 64);
+
+			// Cells that were not re-hashed are known to be pairwise distinct.
+			std::vector<bool> is_dirty(count, false);
+			for (int i : dirty)
+				is_dirty[i] = true;
+
+			dict<Hasher::hash_t, std::vector<int>> buckets;
+			for (int i = 0; i < count; i++)
+				if (alive[i] && !is_dirty[i])
+					buckets[keys[i].hash].push_back(i);
+
+			std::vector<std::array<RTLIL::SigBit, 3>> merged_bits;
+			{
+				RTLIL::ModuleEditGuard edit(module);
+				for (int i : dirty)
+				{
+					std::vector<int> &bucket = buckets[keys[i].hash];
+					auto other_it = std::find_if(bucket.begin(), bucket.end(), [&](int j) {
+						return compare_cell_parameters_and_connections(keys[j].cell, keys[i].cell);
+					});
+					if (other_it == bucket.end()) {
+						bucket.push_back(i);
+						continue;
+					}
+
+					int keep = *other_it, remove = i;
+					if (keys[remove].cell->has_keep_attr()) {
+						if (keys[keep].cell->has_keep_attr()) {
+							bucket.push_back(i);
+							continue;
+						}
+						std::swap(keep, remove);
+						*other_it = keep;
+					}
+
+					merge_cell(keys[remove].cell, keys[keep].cell, &merged_bits);
+					alive[remove] = false;
+				}
+			}
+
+			pool<int> next_dirty;
+			for (auto &it : merged_bits) {
+				std::vector<int> &new_readers = readers[it[2]];
+				for (int k = 0; k < 2; k++) {
+					if (it[k] == it[2] || it[k].wire == nullptr)
+						continue;
+					auto old_it = readers.find(it[k]);
+					if (old_it == readers.end())
+						continue;
+					new_readers.insert(new_readers.end(), old_it->second.begin(), old_it->second.end());
+					readers.erase(old_it);
+				}
+				for (int j : new_readers)
+					if (alive[j])
+						next_dirty.insert(j);
+			}
+
+			dirty.assign(next_dirty.begin(), next_dirty.end());
+			std::sort(dirty.begin(), dirty.end());
+		}
+
+		log_debug("  Finished after %d round(s) using %d thread(s).\n", rounds, threads);
+	}
+
+	OptMergeWorker(RTLIL::Design *design, RTLIL::Module *module, bool mode_nomux, bool mode_share_all, bool mode_keepdc, int threads) :
+		design(design), module(module), assign_map(module), mode_share_all(mode_share_all), mode_keepdc(mode_keepdc)
 	{
 		total_count = 0;
 		ct.setup_internals();
@@ -252,27 +540,19 @@ struct OptMergeWorker
 
 		initvals.set(&assign_map, module);
 
+		if (threads > 0) {
+			run_parallel(threads);
+			log_suppressed();
+			return;
+		}
+
 		bool did_something = true;
 		// A cell may have to go through a lot of collisions if the hash
 		// function is performing poorly, but it's a symptom of something bad
 		// beyond the user's control.
 		while (did_something)
 		{
-			std::vector<RTLIL::Cell*> cells;
-			cells.reserve(module->cells().size());
-			for (auto cell : module->cells()) {
-				if (!design->selected(module, cell))
-					continue;
-				if (cell->type.in(ID($meminit), ID($meminit_v2), ID($mem), ID($mem_v2))) {
-					// Ignore those for performance: meminit can have an excessively large port,
-					// mem can have an excessively large parameter holding the init data
-					continue;
-				}
-				if (mode_keepdc && has_dont_care_initval(cell))
-					continue;
-				if (ct.cell_known(cell->type) || (mode_share_all && cell->known()))
-					cells.push_back(cell);
-			}
+			std::vector<RTLIL::Cell*> cells = candidate_cells();
 
 			did_something = false;
 
@@ -319,23 +599,7 @@ struct OptMergeWorker
 					}
 
 					did_something = true;
-					log_debug("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), other_cell->name.c_str());
-					for (auto &it : cell->connections()) {
-						if (cell->output(it.first)) {
-							RTLIL::SigSpec other_sig = other_cell->getPort(it.first);
-							log_debug("    Redirecting output %s: %s = %s\n", it.first.c_str(),
-									log_signal(it.second), log_signal(other_sig));
-							Const init = initvals(other_sig);
-							initvals.remove_init(it.second);
-							initvals.remove_init(other_sig);
-							module->connect(RTLIL::SigSig(it.second, other_sig));
-							assign_map.add(it.second, other_sig);
-							initvals.set_init(other_sig, init);
-						}
-					}
-					log_debug("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
-					module->remove(cell);
-					total_count++;
+					merge_cell(cell, other_cell);
 				}
 			}
 		}
@@ -364,6 +628,13 @@ struct OptMergePass : public Pass {
 		log("    -keepdc\n");
 		log("        Do not merge flipflops with don't-care bits in their initial value.\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        Compute the cell hashes on the given number of threads (0 = one per\n");
+		log("        hardware thread) and merge within hash buckets. After the first\n");
+		log("        round, only cells reading signals changed by a merge are hashed and\n");
+		log("        checked again. Produces the same kind of result as the default mode,\n");
+		log("        but may keep a different cell out of each group of identical cells.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -372,6 +643,7 @@ struct OptMergePass : public Pass {
 		bool mode_nomux = false;
 		bool mode_share_all = false;
 		bool mode_keepdc = false;
+		int threads = 0;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -388,13 +660,17 @@ struct OptMergePass : public Pass {
 				mode_keepdc = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
 		int total_count = 0;
 		for (auto module : design->selected_modules()) {
-			OptMergeWorker worker(design, module, mode_nomux, mode_share_all, mode_keepdc);
+			OptMergeWorker worker(design, module, mode_nomux, mode_share_all, mode_keepdc, threads);
 			total_count += worker.total_count;
 		}
 
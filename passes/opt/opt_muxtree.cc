@@ -49,7 +49,11 @@ struct OptMuxtreeWorker
 
 	struct portinfo_t {
 		int ctrl_sig;
-		pool<int> input_sigs;
+		// index of ctrl_sig in the knowledge bitsets, and whether another
+		// port of the same mux has the same control signal
+		int ctrl_idx;
+		bool ctrl_dup;
+		vector<int> input_sigs;
 		pool<int> input_muxes;
 		bool const_activated;
 		bool const_deactivated;
@@ -59,6 +63,8 @@ struct OptMuxtreeWorker
 	struct muxinfo_t {
 		RTLIL::Cell *cell;
 		vector<portinfo_t> ports;
+		// the control signals of all ports, as (word, mask) pairs
+		vector<std::pair<int, uint64_t>> ctrl_words;
 	};
 
 	vector<muxinfo_t> mux2info;
@@ -66,8 +72,15 @@ struct OptMuxtreeWorker
 	vector<bool> root_enable_muxes;
 	pool<int> root_mux_rerun;
 
-	OptMuxtreeWorker(RTLIL::Design *design, RTLIL::Module *module) :
-			design(design), module(module), assign_map(module), removed_count(0)
+	// control signals are numbered in order of first use, so that the
+	// control signals of one mux end up in a few adjacent words
+	vector<int> bit2ctrl;
+	int ctrl_count = 0;
+
+	bool verbose;
+
+	OptMuxtreeWorker(RTLIL::Design *design, RTLIL::Module *module, bool verbose) :
+			design(design), module(module), assign_map(module), removed_count(0), verbose(verbose)
 	{
 		log("Running muxtree optimizer on module %s..\n", module->name.c_str());
 
@@ -101,7 +114,7 @@ struct OptMuxtreeWorker
 					portinfo.ctrl_sig = sig2bits(ctrl_sig, false).front();
 					for (int idx : sig2bits(sig)) {
 						bit2info[idx].mux_users.insert(GetSize(mux2info));
-						portinfo.input_sigs.insert(idx);
+						portinfo.input_sigs.push_back(idx);
 					}
 					portinfo.const_activated = ctrl_sig.is_fully_const() && ctrl_sig.as_bool();
 					portinfo.const_deactivated = ctrl_sig.is_fully_const() && !ctrl_sig.as_bool();
@@ -112,7 +125,7 @@ struct OptMuxtreeWorker
 				portinfo_t portinfo;
 				for (int idx : sig2bits(sig_a)) {
 					bit2info[idx].mux_users.insert(GetSize(mux2info));
-					portinfo.input_sigs.insert(idx);
+					portinfo.input_sigs.push_back(idx);
 				}
 				portinfo.ctrl_sig = -1;
 				portinfo.const_activated = false;
@@ -149,12 +162,34 @@ struct OptMuxtreeWorker
 
 		// Populate mux2info[].ports[]:
 		//	.input_muxes
-		for (int i = 0; i < GetSize(bit2info); i++)
-		for (int j : bit2info[i].mux_users)
-		for (auto &p : mux2info[j].ports) {
-			if (p.input_sigs.count(i))
-				for (int k : bit2info[i].mux_drivers)
-					p.input_muxes.insert(k);
+		//	.ctrl_idx
+		//	.ctrl_dup
+		// Populate mux2info[]:
+		//	.ctrl_words
+		bit2ctrl.resize(GetSize(bit2info), -1);
+		for (auto &mi : mux2info)
+		{
+			dict<int, int> ctrl_uses;
+			dict<int, uint64_t> words;
+			for (auto &p : mi.ports) {
+				std::sort(p.input_sigs.begin(), p.input_sigs.end());
+				p.input_sigs.erase(std::unique(p.input_sigs.begin(), p.input_sigs.end()), p.input_sigs.end());
+				for (int i : p.input_sigs)
+					for (int k : bit2info[i].mux_drivers)
+						p.input_muxes.insert(k);
+				p.ctrl_idx = -1;
+				if (p.ctrl_sig >= 0) {
+					if (bit2ctrl[p.ctrl_sig] < 0)
+						bit2ctrl[p.ctrl_sig] = ctrl_count++;
+					p.ctrl_idx = bit2ctrl[p.ctrl_sig];
+					ctrl_uses[p.ctrl_idx]++;
+					words[p.ctrl_idx / 64] |= uint64_t(1) << (p.ctrl_idx % 64);
+				}
+			}
+			for (auto &p : mi.ports)
+				p.ctrl_dup = p.ctrl_idx >= 0 && ctrl_uses.at(p.ctrl_idx) > 1;
+			for (auto &it : words)
+				mi.ctrl_words.push_back(it);
 		}
 
 		log("  Evaluating internal representation of mux trees.\n");
@@ -288,76 +323,138 @@ struct OptMuxtreeWorker
 
 	struct knowledge_t
 	{
-		// database of known inactive signals
-		// the payload is a reference counter used to manage the
-		// list. when it is non-zero the signal in known to be inactive
-		vector<int> known_inactive;
-
-		// database of known active signals
-		vector<int> known_active;
+		// bitsets of known inactive and known active control signals,
+		// indexed by ctrl_idx
+		vector<uint64_t> known_inactive;
+		vector<uint64_t> known_active;
+
+		// previous values of the words changed by the ports on the
+		// evaluation stack, restored when the port is left
+		struct undo_t {
+			bool active;
+			int word;
+			uint64_t value;
+		};
+		vector<undo_t> undo;
 
 		// this is just used to keep track of visited muxes in order to prohibit
 		// endless recursion in mux loops
 		vector<bool> visited_muxes;
+
+		bool is_inactive(int ctrl_idx) const {
+			return ctrl_idx >= 0 && (known_inactive[ctrl_idx / 64] >> (ctrl_idx % 64) & 1);
+		}
+
+		bool is_active(int ctrl_idx) const {
+			return ctrl_idx >= 0 && (known_active[ctrl_idx / 64] >> (ctrl_idx % 64) & 1);
+		}
+
+		void set_bits(bool active, int word, uint64_t bits) {
+			auto &w = active ? known_active[word] : known_inactive[word];
+			if ((w | bits) == w)
+				return;
+			undo.push_back({active, word, w});
+			w |= bits;
+		}
+
+		void restore(int undo_size) {
+			while (GetSize(undo) > undo_size) {
+				auto &u = undo.back();
+				(u.active ? known_active : known_inactive)[u.word] = u.value;
+				undo.pop_back();
+			}
+		}
 	};
 
-	void eval_mux_port(knowledge_t &knowledge, int mux_idx, int port_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
-	{
-		if (glob_abort_cnt == 0)
-			return;
+	knowledge_t knowledge;
+
+	// An entry on the evaluation stack: either a mux (port_idx < 0) or one of
+	// its ports.  'cursor' is -1 until the entry has been started.
+	struct frame_t {
+		int mux_idx;
+		int port_idx;
+		bool do_replace_known;
+		bool do_enable_ports;
+		int abort_count;
+		int cursor;
+		int parents_begin;
+		int undo_begin;
+	};
 
-		muxinfo_t &muxinfo = mux2info[mux_idx];
+	vector<frame_t> eval_stack;
+	vector<int> parent_stack;
 
-		if (do_enable_ports)
-			muxinfo.ports[port_idx].enabled = true;
+	void push_frame(int mux_idx, int port_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
+	{
+		eval_stack.push_back({mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count, -1, 0, 0});
+	}
 
-		for (int i = 0; i < GetSize(muxinfo.ports); i++) {
-			if (i == port_idx)
-				continue;
-			if (muxinfo.ports[i].ctrl_sig >= 0)
-				knowledge.known_inactive.at(muxinfo.ports[i].ctrl_sig)++;
+	// Entering a port: all other control signals of the mux are known to be
+	// inactive, and the port's own control signal is known to be active.
+	void enter_mux_port(frame_t &f)
+	{
+		muxinfo_t &muxinfo = mux2info[f.mux_idx];
+		portinfo_t &portinfo = muxinfo.ports[f.port_idx];
+
+		if (f.do_enable_ports)
+			portinfo.enabled = true;
+
+		f.undo_begin = GetSize(knowledge.undo);
+		int own_word = portinfo.ctrl_idx >= 0 && !portinfo.ctrl_dup ? portinfo.ctrl_idx / 64 : -1;
+		for (auto &it : muxinfo.ctrl_words) {
+			uint64_t bits = it.second;
+			if (it.first == own_word)
+				bits &= ~(uint64_t(1) << (portinfo.ctrl_idx % 64));
+			knowledge.set_bits(false, it.first, bits);
 		}
 
-		if (port_idx < GetSize(muxinfo.ports)-1 && !muxinfo.ports[port_idx].const_activated)
-			knowledge.known_active.at(muxinfo.ports[port_idx].ctrl_sig)++;
+		if (f.port_idx < GetSize(muxinfo.ports)-1 && !portinfo.const_activated)
+			knowledge.set_bits(true, portinfo.ctrl_idx / 64, uint64_t(1) << (portinfo.ctrl_idx % 64));
 
-		vector<int> parent_muxes;
-		for (int m : muxinfo.ports[port_idx].input_muxes) {
+		f.parents_begin = GetSize(parent_stack);
+		for (int m : portinfo.input_muxes) {
 			if (knowledge.visited_muxes[m])
 				continue;
 			knowledge.visited_muxes[m] = true;
-			parent_muxes.push_back(m);
+			parent_stack.push_back(m);
 		}
-		for (int m : parent_muxes) {
+		f.cursor = f.parents_begin;
+	}
+
+	void leave_mux_port(frame_t &f)
+	{
+		for (int i = f.parents_begin; i < GetSize(parent_stack); i++)
+			knowledge.visited_muxes[parent_stack[i]] = false;
+		parent_stack.resize(f.parents_begin);
+		knowledge.restore(f.undo_begin);
+	}
+
+	// Returns the next parent mux to evaluate for the port, after pushing
+	// its frame, or false when all parents have been handled.
+	bool step_mux_port(frame_t &f)
+	{
+		while (f.cursor < GetSize(parent_stack)) {
+			int m = parent_stack[f.cursor++];
 			if (root_enable_muxes.at(m))
 				continue;
 			else if (root_muxes.at(m)) {
-				if (abort_count == 0) {
+				if (f.abort_count == 0) {
 					root_mux_rerun.insert(m);
 					root_enable_muxes.at(m) = true;
 					log_debug("      Removing pure flag from root mux %s.\n", log_id(mux2info[m].cell));
-				} else
-					eval_mux(knowledge, m, false, do_enable_ports, abort_count - 1);
-			} else
-				eval_mux(knowledge, m, do_replace_known, do_enable_ports, abort_count);
-			if (glob_abort_cnt == 0)
-				return;
-		}
-		for (int m : parent_muxes)
-			knowledge.visited_muxes[m] = false;
-
-		if (port_idx < GetSize(muxinfo.ports)-1 && !muxinfo.ports[port_idx].const_activated)
-			knowledge.known_active.at(muxinfo.ports[port_idx].ctrl_sig)--;
-
-		for (int i = 0; i < GetSize(muxinfo.ports); i++) {
-			if (i == port_idx)
-				continue;
-			if (muxinfo.ports[i].ctrl_sig >= 0)
-				knowledge.known_inactive.at(muxinfo.ports[i].ctrl_sig)--;
+				} else {
+					push_frame(m, -1, false, f.do_enable_ports, f.abort_count - 1);
+					return true;
+				}
+			} else {
+				push_frame(m, -1, f.do_replace_known, f.do_enable_ports, f.abort_count);
+				return true;
+			}
 		}
+		return false;
 	}
 
-	void replace_known(knowledge_t &knowledge, muxinfo_t &muxinfo, IdString portname)
+	void replace_known(muxinfo_t &muxinfo, IdString portname)
 	{
 		SigSpec sig = muxinfo.cell->getPort(portname);
 		bool did_something = false;
@@ -373,11 +470,11 @@ struct OptMuxtreeWorker
 		vector<int> bits = sig2bits(sig, false);
 		for (int i = 0; i < GetSize(bits); i++) {
 			if (bits[i] >= 0) {
-				if (knowledge.known_inactive.at(bits[i])) {
+				if (knowledge.is_inactive(bit2ctrl.at(bits[i]))) {
 					sig[i] = State::S0;
 					did_something = true;
 				} else
-				if (knowledge.known_active.at(bits[i])) {
+				if (knowledge.is_active(bit2ctrl.at(bits[i]))) {
 					sig[i] = State::S1;
 					did_something = true;
 				}
@@ -403,29 +500,24 @@ struct OptMuxtreeWorker
 		}
 	}
 
-	void eval_mux(knowledge_t &knowledge, int mux_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
+	// Entering a mux: returns the only port that can be active, or -1 if
+	// all ports not known to be inactive have to be evaluated.
+	int enter_mux(frame_t &f)
 	{
-		if (glob_abort_cnt == 0)
-			return;
 		glob_abort_cnt--;
 
-		muxinfo_t &muxinfo = mux2info[mux_idx];
+		muxinfo_t &muxinfo = mux2info[f.mux_idx];
 
 		// set input ports to constants if we find known active or inactive signals
-		if (do_replace_known) {
-			replace_known(knowledge, muxinfo, ID::A);
-			replace_known(knowledge, muxinfo, ID::B);
+		if (f.do_replace_known) {
+			replace_known(muxinfo, ID::A);
+			replace_known(muxinfo, ID::B);
 		}
 
 		// if there is a constant activated port we just use it
 		for (int port_idx = 0; port_idx < GetSize(muxinfo.ports); port_idx++)
-		{
-			portinfo_t &portinfo = muxinfo.ports[port_idx];
-			if (portinfo.const_activated) {
-				eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
-				return;
-			}
-		}
+			if (muxinfo.ports[port_idx].const_activated)
+				return port_idx;
 
 		// compare ports with known_active signals. if we find a match, only this
 		// port can be active. do not include the last port (its the default port
@@ -435,38 +527,81 @@ struct OptMuxtreeWorker
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			if (portinfo.const_deactivated)
 				continue;
-			if (knowledge.known_active.at(portinfo.ctrl_sig)) {
-				eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
-				return;
-			}
+			if (knowledge.is_active(portinfo.ctrl_idx))
+				return port_idx;
 		}
 
-		// eval all ports that could be activated (control signal is not in
-		// known_inactive or const_deactivated).
-		for (int port_idx = 0; port_idx < GetSize(muxinfo.ports); port_idx++)
-		{
+		return -1;
+	}
+
+	// Evaluates the next port of a mux that could be activated (control
+	// signal is not known inactive or const_deactivated), after pushing its
+	// frame, or returns false when all ports have been handled.
+	bool step_mux(frame_t &f)
+	{
+		muxinfo_t &muxinfo = mux2info[f.mux_idx];
+		while (f.cursor < GetSize(muxinfo.ports)) {
+			int port_idx = f.cursor++;
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			if (portinfo.const_deactivated)
 				continue;
 			if (port_idx < GetSize(muxinfo.ports)-1)
-				if (knowledge.known_inactive.at(portinfo.ctrl_sig))
+				if (knowledge.is_inactive(portinfo.ctrl_idx))
 					continue;
-			eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
-
-			if (glob_abort_cnt == 0)
-				return;
+			push_frame(f.mux_idx, port_idx, f.do_replace_known, f.do_enable_ports, f.abort_count);
+			return true;
 		}
+		return false;
 	}
 
 	void eval_root_mux(int mux_idx)
 	{
 		log_assert(glob_abort_cnt > 0);
-		knowledge_t knowledge;
-		knowledge.known_inactive.resize(GetSize(bit2info));
-		knowledge.known_active.resize(GetSize(bit2info));
-		knowledge.visited_muxes.resize(GetSize(mux2info));
+		int words = (ctrl_count + 63) / 64;
+		if (knowledge.visited_muxes.empty()) {
+			knowledge.known_inactive.resize(words);
+			knowledge.known_active.resize(words);
+			knowledge.visited_muxes.resize(GetSize(mux2info));
+		}
 		knowledge.visited_muxes[mux_idx] = true;
-		eval_mux(knowledge, mux_idx, true, root_enable_muxes.at(mux_idx), 3);
+
+		int64_t start_time = verbose ? PerformanceTimer::query() : 0;
+		int start_cnt = glob_abort_cnt;
+
+		log_assert(eval_stack.empty() && parent_stack.empty() && knowledge.undo.empty());
+		push_frame(mux_idx, -1, true, root_enable_muxes.at(mux_idx), 3);
+
+		while (!eval_stack.empty() && glob_abort_cnt > 0)
+		{
+			frame_t &f = eval_stack.back();
+			if (f.port_idx < 0) {
+				if (f.cursor < 0) {
+					f.cursor = 0;
+					int port_idx = enter_mux(f);
+					if (port_idx >= 0) {
+						f.cursor = GetSize(mux2info[f.mux_idx].ports);
+						push_frame(f.mux_idx, port_idx, f.do_replace_known, f.do_enable_ports, f.abort_count);
+						continue;
+					}
+				}
+				if (!step_mux(f))
+					eval_stack.pop_back();
+			} else {
+				if (f.cursor < 0)
+					enter_mux_port(f);
+				if (!step_mux_port(f)) {
+					leave_mux_port(f);
+					eval_stack.pop_back();
+				}
+			}
+		}
+
+		knowledge.visited_muxes[mux_idx] = false;
+		eval_stack.clear();
+
+		if (verbose)
+			log("    Evaluated mux tree at %s: %d muxes in %.3f ms.\n", log_id(mux2info[mux_idx].cell),
+					start_cnt - glob_abort_cnt, (PerformanceTimer::query() - start_time) / 1e6);
 	}
 };
 
@@ -476,7 +611,7 @@ struct OptMuxtreePass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    opt_muxtree [selection]\n");
+		log("    opt_muxtree [-v] [selection]\n");
 		log("\n");
 		log("This pass analyzes the control signals for the multiplexer trees in the design\n");
 		log("and identifies inputs that can never be active. It then removes this dead\n");
@@ -484,17 +619,32 @@ struct OptMuxtreePass : public Pass {
 		log("\n");
 		log("This pass only operates on completely selected modules without processes.\n");
 		log("\n");
+		log("    -v\n");
+		log("        Report the number of muxes visited and the time spent for each\n");
+		log("        mux tree.\n");
+		log("\n");
 	}
 	void execute(vector<std::string> args, RTLIL::Design *design) override
 	{
+		bool verbose = false;
+
 		log_header(design, "Executing OPT_MUXTREE pass (detect dead branches in mux trees).\n");
-		extra_args(args, 1, design);
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-v") {
+				verbose = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
 
 		int total_count = 0;
 		for (auto module : design->selected_whole_modules_warn()) {
 			if (module->has_processes_warn())
 				continue;
-			OptMuxtreeWorker worker(design, module);
+			OptMuxtreeWorker worker(design, module, verbose);
 			total_count += worker.removed_count;
 		}
 		if (total_count)
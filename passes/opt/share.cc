@@ -35,6 +35,7 @@ struct ShareWorkerConfig
 {
 	int limit;
 	size_t pattern_limit;
+	double time_budget;
 	bool opt_force;
 	bool opt_aggressive;
 	bool opt_fast;
@@ -394,6 +395,38 @@ struct ShareWorker
 				continue;
 			}
 		}
+
+		for (auto cell : shareable_cells)
+			add_to_bucket(cell);
+	}
+
+	// Shareable cells are bucketed by type (and by memory for read ports).
+	// Where is_shareable_pair() only accepts widths that differ by at most a
+	// factor of two, the bucket also holds the binary order of magnitude of
+	// the output width, so that partners are only searched for in the same
+	// and the two neighbouring width classes. Buckets are only appended to;
+	// cells that left shareable_cells are skipped when searching.
+
+	typedef std::pair<std::string, int> bucket_key_t;
+	dict<bucket_key_t, std::vector<RTLIL::Cell*>> buckets;
+
+	bucket_key_t get_bucket_key(RTLIL::Cell *cell)
+	{
+		if (cell->type.in(ID($memrd), ID($memrd_v2)))
+			return bucket_key_t(stringf("%s %s %d", cell->type.c_str(), cell->parameters.at(ID::MEMID).decode_string().c_str(),
+					cell->parameters.at(ID::WIDTH).as_int()), 0);
+
+		int width_class = 0;
+		if (!config.opt_aggressive && (config.generic_uni_ops.count(cell->type) || config.generic_bin_ops.count(cell->type) ||
+				config.generic_cbin_ops.count(cell->type) || cell->type == ID($alu)))
+			for (int width = cell->parameters.at(ID::Y_WIDTH).as_int(); width > 0; width >>= 1)
+				width_class++;
+		return bucket_key_t(cell->type.str(), width_class);
+	}
+
+	void add_to_bucket(RTLIL::Cell *cell)
+	{
+		buckets[get_bucket_key(cell)].push_back(cell);
 	}
 
 	bool is_shareable_pair(RTLIL::Cell *c1, RTLIL::Cell *c2)
@@ -497,9 +530,36 @@ struct ShareWorker
 	void find_shareable_partners(std::vector<RTLIL::Cell*> &results, RTLIL::Cell *cell)
 	{
 		results.clear();
-		for (auto c : shareable_cells)
-			if (c != cell && is_shareable_pair(c, cell))
-				results.push_back(c);
+		bucket_key_t key = get_bucket_key(cell);
+		for (int offset : {-1, 0, 1}) {
+			if (offset != 0 && key.second == 0)
+				continue;
+			auto it = buckets.find(bucket_key_t(key.first, key.second + offset));
+			if (it == buckets.end())
+				continue;
+			for (auto c : it->second)
+				if (c != cell && shareable_cells.count(c) && is_shareable_pair(c, cell))
+					results.push_back(c);
+		}
+	}
+
+	// Results of the SAT query whether two cells can be active at the same
+	// time, keyed by the two (filtered and optimized) sets of activation
+	// patterns that went into it. The query only depends on these patterns and
+	// on the control logic, which is not changed by merges, so the result is
+	// reused for all later pairs with the same patterns, e.g. for the many
+	// operators in the same branch of a case statement, or for supercells.
+	typedef std::pair<std::vector<ssc_pair_t>, std::vector<ssc_pair_t>> pattern_pair_t;
+	dict<pattern_pair_t, bool> pattern_pair_overlaps;
+
+	static pattern_pair_t pattern_pair(const pool<ssc_pair_t> &p1, const pool<ssc_pair_t> &p2)
+	{
+		pattern_pair_t key(std::vector<ssc_pair_t>(p1.begin(), p1.end()), std::vector<ssc_pair_t>(p2.begin(), p2.end()));
+		std::sort(key.first.begin(), key.first.end());
+		std::sort(key.second.begin(), key.second.end());
+		if (key.second < key.first)
+			std::swap(key.first, key.second);
+		return key;
 	}
 
 
@@ -1242,9 +1302,15 @@ struct ShareWorker
 		topo_bit_drivers.clear();
 		terminal_bits.clear();
 		shareable_cells.clear();
+		buckets.clear();
+		pattern_pair_overlaps.clear();
 		forbidden_controls_cache.clear();
 		activation_patterns_cache.clear();
 
+		int64_t deadline = 0;
+		if (config.time_budget > 0)
+			deadline = PerformanceTimer::query() + int64_t(config.time_budget * 1e9);
+
 		find_terminal_bits();
 		find_shareable_cells();
 
@@ -1256,6 +1322,12 @@ struct ShareWorker
 
 		while (!shareable_cells.empty() && config.limit != 0)
 		{
+			if (deadline != 0 && PerformanceTimer::query() > deadline) {
+				log("  Time budget of %g seconds exhausted, not analyzing the remaining %d cells.\n",
+						config.time_budget, GetSize(shareable_cells));
+				break;
+			}
+
 			RTLIL::Cell *cell = *shareable_cells.begin();
 			shareable_cells.erase(cell);
 
@@ -1292,6 +1364,9 @@ struct ShareWorker
 
 			for (auto other_cell : candidates)
 			{
+				if (deadline != 0 && PerformanceTimer::query() > deadline)
+					break;
+
 				log("    Analyzing resource sharing with %s (%s):\n", log_id(other_cell), log_id(other_cell->type));
 
 				const pool<ssc_pair_t> &other_cell_activation_patterns = find_cell_activation_patterns(other_cell, "      ");
@@ -1358,25 +1433,43 @@ struct ShareWorker
 				int sub2 = qcsat.ez->expression(qcsat.ez->OpOr, other_cell_active);
 
 				bool pattern_only_solve = qcsat.ez->solve(qcsat.ez->AND(sub1, sub2));
-				qcsat.prepare();
 
-				if (!qcsat.ez->solve(sub1)) {
-					log("      According to the SAT solver the cell %s is never active. Sharing is pointless, we simply remove it.\n", log_id(cell));
-					cells_to_remove.insert(cell);
-					break;
+				// a cached result also implies that both cells can be active
+				pattern_pair_t patterns_key;
+				auto cached_overlap = pattern_pair_overlaps.end();
+				if (pattern_only_solve) {
+					patterns_key = pattern_pair(filtered_cell_activation_patterns, filtered_other_cell_activation_patterns);
+					cached_overlap = pattern_pair_overlaps.find(patterns_key);
 				}
 
-				if (!qcsat.ez->solve(sub2)) {
-					log("      According to the SAT solver the cell %s is never active. Sharing is pointless, we simply remove it.\n", log_id(other_cell));
-					cells_to_remove.insert(other_cell);
-					shareable_cells.erase(other_cell);
-					continue;
+				if (cached_overlap == pattern_pair_overlaps.end())
+				{
+					qcsat.prepare();
+
+					if (!qcsat.ez->solve(sub1)) {
+						log("      According to the SAT solver the cell %s is never active. Sharing is pointless, we simply remove it.\n", log_id(cell));
+						cells_to_remove.insert(cell);
+						break;
+					}
+
+					if (!qcsat.ez->solve(sub2)) {
+						log("      According to the SAT solver the cell %s is never active. Sharing is pointless, we simply remove it.\n", log_id(other_cell));
+						cells_to_remove.insert(other_cell);
+						shareable_cells.erase(other_cell);
+						continue;
+					}
 				}
 
 				pool<ssc_pair_t> optimized_cell_activation_patterns = filtered_cell_activation_patterns;
 				pool<ssc_pair_t> optimized_other_cell_activation_patterns = filtered_other_cell_activation_patterns;
 
-				if (pattern_only_solve) {
+				if (pattern_only_solve && cached_overlap != pattern_pair_overlaps.end()) {
+					if (cached_overlap->second) {
+						log("      According to an earlier SAT query with the same activation patterns this pair of cells can not be shared.\n");
+						continue;
+					}
+					log("      According to an earlier SAT query with the same activation patterns this pair of cells can be shared.\n");
+				} else if (pattern_only_solve) {
 					qcsat.ez->non_incremental();
 
 					all_ctrl_signals.sort_and_unify();
@@ -1388,7 +1481,19 @@ struct ShareWorker
 					log("      Size of SAT problem: %zu cells, %d variables, %d clauses\n",
 							qcsat.imported_cells.size(), qcsat.ez->numCnfVariables(), qcsat.ez->numCnfClauses());
 
-					if (qcsat.ez->solve(sat_model, sat_model_values)) {
+					if (deadline != 0)
+						qcsat.ez->setSolverTimeout(std::max(1, int((deadline - PerformanceTimer::query()) / 1000000000)));
+
+					bool sat_result = qcsat.ez->solve(sat_model, sat_model_values);
+
+					if (qcsat.ez->getSolverTimoutStatus()) {
+						log("      SAT solver timed out, assuming that this pair of cells can not be shared.\n");
+						continue;
+					}
+
+					pattern_pair_overlaps[patterns_key] = sat_result;
+
+					if (sat_result) {
 						log("      According to the SAT solver this pair of cells can not be shared.\n");
 						log("      Model from SAT solver: %s = %d'", log_signal(all_ctrl_signals), GetSize(sat_model_values));
 						for (int i = GetSize(sat_model_values)-1; i >= 0; i--)
@@ -1469,6 +1574,7 @@ struct ShareWorker
 				optimize_activation_patterns(supercell_activation_patterns);
 				activation_patterns_cache[supercell] = supercell_activation_patterns;
 				shareable_cells.insert(supercell);
+				add_to_bucket(supercell);
 
 				for (auto bit : topo_sigmap(all_ctrl_signals))
 					for (auto c : topo_bit_drivers[bit])
@@ -1542,6 +1648,19 @@ struct SharePass : public Pass {
 		log("    N is 1000 by default. Higher values may merge more resources at the cost of\n");
 		log("    more runtime and memory consumption.\n");
 		log("\n");
+		log("  -budget <seconds>\n");
+		log("    Stop looking for further sharing opportunities in a module once the given\n");
+		log("    time has been spent on it. SAT queries that would run past the budget are\n");
+		log("    aborted, and the cell pair in question is not shared. Fractions of\n");
+		log("    seconds are allowed; SAT timeouts are rounded up to whole seconds. The\n");
+		log("    default is 300 seconds and can be changed with the scratchpad variable\n");
+		log("    'share.budget'. A budget of 0 removes the limit.\n");
+		log("\n");
+		log("Candidate pairs are only formed between cells of the same type and (unless\n");
+		log("-aggressive is used) of compatible width. The result of the SAT query whether\n");
+		log("two cells can be active at the same time is reused for later pairs of cells\n");
+		log("with the same activation patterns.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -1549,6 +1668,7 @@ struct SharePass : public Pass {
 
 		config.limit = -1;
 		config.pattern_limit = design->scratchpad_get_int("share.pattern_limit", 1000);
+		config.time_budget = atof(design->scratchpad_get_string("share.budget", "300").c_str());
 		config.opt_force = false;
 		config.opt_aggressive = false;
 		config.opt_fast = false;
@@ -1617,6 +1737,10 @@ struct SharePass : public Pass {
 				config.pattern_limit = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-budget" && argidx+1 < args.size()) {
+				config.time_budget = atof(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
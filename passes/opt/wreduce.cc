@@ -48,19 +48,223 @@ struct WreduceConfig
 	}
 };
 
+// Remembers which cells and signals of a module have been changed since
+// wreduce last processed it in incremental mode. Changes are reported through
+// the Monitor callbacks; cells and wires are recorded by name, as they may be
+// deleted before the next run. The signal index of the module is kept between
+// runs as well: it is a monitor of the module itself and only rebuilt after
+// changes it can not follow, i.e. after a blackout (renames, passes that
+// bypass the monitors), replaced module connections or changed ports.
+struct wreduce_tracker_t : public RTLIL::Monitor
+{
+	struct module_state_t {
+		Hasher::hash_t hashidx;
+		std::string config;
+		bool full = true;
+		pool<IdString> cells;
+		pool<std::pair<IdString, int>> bits;
+		std::unique_ptr<ModIndex> index;
+		std::vector<std::pair<IdString, int>> ports;
+		pool<IdString> keep_wires;
+	};
+
+	dict<Module*, module_state_t> modules;
+
+	module_state_t *lookup(Module *module)
+	{
+		auto it = modules.find(module);
+		if (it == modules.end() || it->second.hashidx != module->hashidx_)
+			return nullptr;
+		return &it->second;
+	}
+
+	static int wire_flags(Wire *wire)
+	{
+		return (wire->port_input ? 1 : 0) | (wire->port_output ? 2 : 0);
+	}
+
+	std::vector<std::pair<IdString, int>> port_flags(Module *module)
+	{
+		std::vector<std::pair<IdString, int>> ports;
+		for (auto &name : module->ports) {
+			Wire *wire = module->wire(name);
+			ports.push_back({name, wire ? wire_flags(wire) : 0});
+		}
+		return ports;
+	}
+
+	// Returns the signal index of the module, which is only built anew if
+	// the kept one can not be trusted. A new index makes the run a full one.
+	ModIndex &index(Module *module)
+	{
+		module_state_t *state = lookup(module);
+		if (state == nullptr) {
+			modules.erase(module);
+			state = &modules[module];
+			state->hashidx = module->hashidx_;
+		}
+
+		auto ports = port_flags(module);
+		if (state->index == nullptr || state->index->auto_reload_module || state->ports != ports) {
+			state->index = std::make_unique<ModIndex>(module);
+			state->ports = ports;
+			state->full = true;
+		}
+		return *state->index;
+	}
+
+	void add_sig(module_state_t *state, const SigSpec &sig)
+	{
+		for (auto &chunk : sig.chunks())
+			if (chunk.wire != nullptr)
+				for (int i = 0; i < chunk.width; i++)
+					state->bits.insert({chunk.wire->name, chunk.offset + i});
+	}
+
+	// Fills 'cells' with the selected cells that have to be looked at again:
+	// the changed cells and all cells connected to a changed signal. Returns
+	// false if the module has to be processed in full.
+	bool changed_cells(Module *module, const std::string &config, ModIndex &mi, std::vector<Cell*> &cells)
+	{
+		module_state_t *state = lookup(module);
+		if (state == nullptr || state->full || state->config != config)
+			return false;
+		if (GetSize(state->cells) + GetSize(state->bits) > GetSize(module->cells_))
+			return false;
+
+		pool<Cell*> found;
+		for (auto name : state->cells) {
+			Cell *cell = module->cell(name);
+			if (cell != nullptr)
+				found.insert(cell);
+		}
+		for (auto bit : changed_bits(module))
+			for (auto &port : mi.query_ports(bit))
+				found.insert(port.cell);
+
+		cells.clear();
+		for (auto cell : found)
+			if (module->selected(cell))
+				cells.push_back(cell);
+		std::sort(cells.begin(), cells.end(), IdString::compare_ptr_by_name<Cell>());
+		return true;
+	}
+
+	// The changed bits that still exist in the module.
+	std::vector<SigBit> changed_bits(Module *module)
+	{
+		std::vector<SigBit> bits;
+		module_state_t *state = lookup(module);
+		if (state == nullptr)
+			return bits;
+		for (auto &it : state->bits) {
+			Wire *wire = module->wire(it.first);
+			if (wire != nullptr && it.second < GetSize(wire))
+				bits.push_back(SigBit(wire, it.second));
+		}
+		return bits;
+	}
+
+	// The wires with a keep attribute, as of the last run and among the
+	// changed signals. A keep attribute that is added to an unchanged wire
+	// is not seen.
+	std::vector<Wire*> keep_wires(Module *module)
+	{
+		std::vector<Wire*> wires;
+		module_state_t *state = lookup(module);
+		if (state == nullptr)
+			return wires;
+		pool<IdString> names = state->keep_wires;
+		for (auto &it : state->bits)
+			names.insert(it.first);
+		for (auto name : names) {
+			Wire *wire = module->wire(name);
+			if (wire != nullptr && wire->get_bool_attribute(ID::keep))
+				wires.push_back(wire);
+		}
+		std::sort(wires.begin(), wires.end(), IdString::compare_ptr_by_name<Wire>());
+		return wires;
+	}
+
+	void mark_done(Module *module, const std::string &config, const std::vector<Wire*> &keep_wires)
+	{
+		module_state_t *state = lookup(module);
+		log_assert(state != nullptr);
+		state->config = config;
+		state->full = false;
+		state->cells.clear();
+		state->bits.clear();
+		state->keep_wires.clear();
+		for (auto wire : keep_wires)
+			state->keep_wires.insert(wire->name);
+	}
+
+	void notify_module_del(Module *module) override { modules.erase(module); }
+
+	void notify_connect(Cell *cell, const IdString&, const SigSpec &old_sig, const SigSpec &sig) override
+	{
+		module_state_t *state = lookup(cell->module);
+		if (state == nullptr)
+			return;
+		state->cells.insert(cell->name);
+		add_sig(state, old_sig);
+		add_sig(state, sig);
+	}
+
+	void notify_connect(Module *module, const SigSig &sigsig) override
+	{
+		module_state_t *state = lookup(module);
+		if (state == nullptr)
+			return;
+		add_sig(state, sigsig.first);
+		add_sig(state, sigsig.second);
+	}
+
+	void notify_connect(Module *module, const std::vector<SigSig>&) override
+	{
+		module_state_t *state = lookup(module);
+		if (state != nullptr)
+			state->full = true;
+	}
+
+	void notify_blackout(Module *module) override
+	{
+		module_state_t *state = lookup(module);
+		if (state != nullptr)
+			state->full = true;
+	}
+};
+
 struct WreduceWorker
 {
 	WreduceConfig *config;
 	Module *module;
-	ModIndex mi;
+	std::unique_ptr<ModIndex> own_mi;
+	ModIndex &mi;
 
 	std::set<Cell*, IdString::compare_ptr_by_name<Cell>> work_queue_cells;
 	std::set<SigBit> work_queue_bits;
+	std::vector<Wire*> keep_wires;
 	pool<SigBit> keep_bits;
+	SigMap init_attr_sigmap;
 	FfInitVals initvals;
+	bool initvals_done = false;
+
+	// Uses the given signal index (the one kept by the tracker), or a new one.
+	WreduceWorker(WreduceConfig *config, Module *module, ModIndex *index = nullptr) :
+			config(config), module(module), own_mi(index ? nullptr : new ModIndex(module)),
+			mi(index ? *index : *own_mi) { }
 
-	WreduceWorker(WreduceConfig *config, Module *module) :
-			config(config), module(module), mi(module) { }
+	// Needs all wires, so it is only done once a FF is looked at.
+	void setup_initvals()
+	{
+		if (initvals_done)
+			return;
+		// create a copy as mi.sigmap will be updated as we process the module
+		init_attr_sigmap = mi.sigmap;
+		initvals.set(&init_attr_sigmap, module);
+		initvals_done = true;
+	}
 
 	void run_cell_mux(Cell *cell)
 	{
@@ -144,6 +348,8 @@ struct WreduceWorker
 	{
 		// Reduce size of FF if inputs are just sign/zero extended or output bit is not used
 
+		setup_initvals();
+
 		SigSpec sig_d = mi.sigmap(cell->getPort(ID::D));
 		SigSpec sig_q = mi.sigmap(cell->getPort(ID::Q));
 		bool has_reset = false;
@@ -457,20 +663,31 @@ struct WreduceWorker
 		return count;
 	}
 
-	void run()
+	// With 'cells' given, only these cells (and the cells around any bits
+	// they free up) are processed, and only wires with bits that the tracker
+	// saw change are trimmed.
+	void run(const std::vector<Cell*> *cells = nullptr, wreduce_tracker_t *tracker = nullptr)
 	{
-		// create a copy as mi.sigmap will be updated as we process the module
-		SigMap init_attr_sigmap = mi.sigmap;
-		initvals.set(&init_attr_sigmap, module);
-
-		for (auto w : module->wires()) {
-			if (w->get_bool_attribute(ID::keep))
-				for (auto bit : mi.sigmap(w))
-					keep_bits.insert(bit);
+		if (cells != nullptr) {
+			keep_wires = tracker->keep_wires(module);
+		} else {
+			setup_initvals();
+			for (auto w : module->wires())
+				if (w->get_bool_attribute(ID::keep))
+					keep_wires.push_back(w);
 		}
 
-		for (auto c : module->selected_cells())
-			work_queue_cells.insert(c);
+		for (auto w : keep_wires)
+			for (auto bit : mi.sigmap(w))
+				keep_bits.insert(bit);
+
+		if (cells != nullptr) {
+			for (auto c : *cells)
+				work_queue_cells.insert(c);
+		} else {
+			for (auto c : module->selected_cells())
+				work_queue_cells.insert(c);
+		}
 
 		while (!work_queue_cells.empty())
 		{
@@ -485,11 +702,27 @@ struct WreduceWorker
 					work_queue_cells.insert(port.cell);
 		}
 
+		// only built once a wire can actually be trimmed
 		pool<SigSpec> complete_wires;
-		for (auto w : module->wires())
-			complete_wires.insert(mi.sigmap(w));
+		bool complete_wires_done = false;
+
+		std::vector<Wire*> wires;
+		if (cells != nullptr) {
+			pool<Wire*> changed_wires;
+			for (auto bit : tracker->changed_bits(module))
+				if (module->selected(bit.wire))
+					changed_wires.insert(bit.wire);
+			wires.insert(wires.end(), changed_wires.begin(), changed_wires.end());
+			std::sort(wires.begin(), wires.end(), IdString::compare_ptr_by_name<Wire>());
+		} else {
+			wires = module->selected_wires();
+		}
 
-		for (auto w : module->selected_wires())
+		// renaming makes the monitors drop the signal index, so that is done
+		// once all wires are looked at
+		std::vector<std::pair<Wire*, Wire*>> renames;
+
+		for (auto w : wires)
 		{
 			int unused_top_bits = 0;
 
@@ -507,14 +740,23 @@ struct WreduceWorker
 			if (unused_top_bits == 0 || unused_top_bits == GetSize(w))
 				continue;
 
+			if (!complete_wires_done) {
+				for (auto w2 : module->wires())
+					complete_wires.insert(mi.sigmap(w2));
+				complete_wires_done = true;
+			}
+
 			if (complete_wires[mi.sigmap(w).extract(0, GetSize(w) - unused_top_bits)])
 				continue;
 
 			log("Removed top %d bits (of %d) from wire %s.%s.\n", unused_top_bits, GetSize(w), log_id(module), log_id(w));
 			Wire *nw = module->addWire(NEW_ID, GetSize(w) - unused_top_bits);
 			module->connect(nw, SigSpec(w).extract(0, GetSize(nw)));
-			module->swap_names(w, nw);
+			renames.push_back({w, nw});
 		}
+
+		for (auto &it : renames)
+			module->swap_names(it.first, it.second);
 	}
 };
 
@@ -545,11 +787,28 @@ struct WreducePass : public Pass {
 		log("    -keepdc\n");
 		log("        Do not optimize explicit don't-care values.\n");
 		log("\n");
+		log("    -incremental\n");
+		log("        In modules that were already processed in incremental mode, only look\n");
+		log("        at the cells that were changed since, and at the cells driving or\n");
+		log("        reading a changed signal. Modifications are tracked using a monitor\n");
+		log("        that is attached to the design on first use, and the signal index of\n");
+		log("        the module is kept up to date between runs, so a run after a small\n");
+		log("        change does not have to look at the rest of the module. Only changes\n");
+		log("        to FFs (which need the init attributes of all wires) and trimmed\n");
+		log("        wires take time proportional to the module size. Replaced module\n");
+		log("        connections, renamed wires or cells, changed ports and passes that\n");
+		log("        bypass the monitors make the next run a full one. Not detected are\n");
+		log("        changes of cell types or parameters in place and keep attributes\n");
+		log("        added to unchanged wires, so some reductions may be missed; run\n");
+		log("        without this option to catch those. This mode is also enabled by\n");
+		log("        setting the scratchpad variable 'wreduce.incremental' to true.\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, Design *design) override
 	{
 		WreduceConfig config;
 		bool opt_memx = false;
+		bool incremental = design->scratchpad_get_bool("wreduce.incremental");
 
 		log_header(design, "Executing WREDUCE pass (reducing word size of cells).\n");
 
@@ -567,16 +826,39 @@ struct WreducePass : public Pass {
 				config.mux_undef = true;
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				incremental = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
+		wreduce_tracker_t *tracker = incremental ? design->tracker<wreduce_tracker_t>("wreduce") : nullptr;
+		std::string config_key = stringf("%d%d%d", opt_memx, config.keepdc, config.mux_undef);
+		int count_partial = 0;
+
 		for (auto module : design->selected_modules())
 		{
 			if (module->has_processes_warn())
 				continue;
 
-			for (auto c : module->selected_cells())
+			// In incremental mode the worker uses the index kept by the
+			// tracker, which follows the changes below; otherwise it is
+			// created after them, as before.
+			std::unique_ptr<WreduceWorker> worker;
+			std::vector<Cell*> cells;
+			bool partial = false;
+			if (tracker != nullptr) {
+				worker = std::make_unique<WreduceWorker>(&config, module, &tracker->index(module));
+				partial = tracker->changed_cells(module, config_key, worker->mi, cells);
+			}
+			if (partial)
+				count_partial++;
+			else
+				cells = module->selected_cells();
+
+			for (auto c : cells)
 			{
 				if (c->type.in(ID($reduce_and), ID($reduce_or), ID($reduce_xor), ID($reduce_xnor), ID($reduce_bool),
 						ID($lt), ID($le), ID($eq), ID($ne), ID($eqx), ID($nex), ID($ge), ID($gt),
@@ -643,9 +925,15 @@ struct WreducePass : public Pass {
 				}
 			}
 
-			WreduceWorker worker(&config, module);
-			worker.run();
+			if (worker == nullptr)
+				worker = std::make_unique<WreduceWorker>(&config, module);
+			worker->run(partial ? &cells : nullptr, tracker);
+			if (tracker)
+				tracker->mark_done(module, config_key, worker->keep_wires);
 		}
+
+		if (count_partial > 0)
+			log("Processed only the changed parts of %d modules.\n", count_partial);
 	}
 } WreducePass;
 
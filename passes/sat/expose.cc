@@ -216,7 +216,9 @@ RTLIL::Wire *add_new_wire(RTLIL::Module *module, RTLIL::IdString name, int width
 }
 
 struct ExposePass : public Pass {
-	ExposePass() : Pass("expose", "convert internal signals to module ports") { }
+	ExposePass() : Pass("expose", "convert internal signals to module ports") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
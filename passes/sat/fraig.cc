@@ -0,0 +1,617 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  Shenzhen Pango Microsystems Co., Ltd.
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/satgen.h"
+#include "kernel/gategraph.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct FraigWorker
+{
+	enum node_type_t {
+		NODE_CONST0, NODE_CONST1, NODE_INPUT,
+		NODE_BUF, NODE_NOT, NODE_AND, NODE_NAND, NODE_OR, NODE_NOR, NODE_XOR, NODE_XNOR,
+		NODE_ANDNOT, NODE_ORNOT, NODE_MUX, NODE_NMUX, NODE_AOI3, NODE_OAI3, NODE_AOI4, NODE_OAI4
+	};
+
+	// Nodes are stored in topological order: constants first, then all inputs
+	// (any bit not driven by a gate in the analyzed set), then the gates.
+	struct node_t {
+		node_type_t type;
+		int in[4];
+		RTLIL::SigBit bit;
+		RTLIL::Cell *cell;
+	};
+
+	RTLIL::Design *design;
+	RTLIL::Module *module;
+	SigMap sigmap;
+	int words;
+	bool inv_mode;
+	uint64_t rng_state;
+	int timeout = 0;
+	int recycle_calls = 500;
+
+	std::vector<node_t> nodes;
+	dict<RTLIL::SigBit, int> bit_to_node;
+	std::vector<int> input_nodes;
+
+	// Candidate equivalence classes, refined by simulation and counterexamples.
+	// Members are kept in topological order, so the first one is the representative.
+	std::vector<std::vector<int>> classes;
+	std::vector<int> class_of;
+	std::vector<bool> phase;
+
+	// Proven equivalences: node -> (representative, inverted)
+	dict<int, std::pair<int, bool>> merges;
+
+	// The solver with the literals of the nodes encoded so far, 0 for none
+	ezSatPtr ez;
+	std::vector<int> lits, input_lits;
+	int solver_calls = 0;
+
+	int sat_calls = 0, sat_cex = 0, sat_timeouts = 0, strash_merges = 0;
+
+	FraigWorker(RTLIL::Design *design, RTLIL::Module *module, int words, bool inv_mode, uint64_t seed) :
+			design(design), module(module), sigmap(module), words(words), inv_mode(inv_mode), rng_state(seed) { }
+
+	uint64_t rng()
+	{
+		rng_state ^= rng_state << 13;
+		rng_state ^= rng_state >> 7;
+		rng_state ^= rng_state << 17;
+		return rng_state;
+	}
+
+	static node_type_t gate_node_type(RTLIL::IdString type)
+	{
+		static const dict<RTLIL::IdString, node_type_t> types = {
+			{ID($_BUF_), NODE_BUF}, {ID($_NOT_), NODE_NOT}, {ID($_AND_), NODE_AND}, {ID($_NAND_), NODE_NAND},
+			{ID($_OR_), NODE_OR}, {ID($_NOR_), NODE_NOR}, {ID($_XOR_), NODE_XOR}, {ID($_XNOR_), NODE_XNOR},
+			{ID($_ANDNOT_), NODE_ANDNOT}, {ID($_ORNOT_), NODE_ORNOT}, {ID($_MUX_), NODE_MUX}, {ID($_NMUX_), NODE_NMUX},
+			{ID($_AOI3_), NODE_AOI3}, {ID($_OAI3_), NODE_OAI3}, {ID($_AOI4_), NODE_AOI4}, {ID($_OAI4_), NODE_OAI4}
+		};
+		return types.at(type);
+	}
+
+	int add_node(node_type_t type, RTLIL::SigBit bit, RTLIL::Cell *cell)
+	{
+		node_t node;
+		node.type = type;
+		node.in[0] = node.in[1] = node.in[2] = node.in[3] = -1;
+		node.bit = bit;
+		node.cell = cell;
+		nodes.push_back(node);
+		return GetSize(nodes) - 1;
+	}
+
+	// x and z constants are 0, like in the (not undef-aware) SAT model
+	int lookup_node(RTLIL::SigBit bit)
+	{
+		if (bit.wire == nullptr)
+			return bit == RTLIL::State::S1 ? 1 : 0;
+		return bit_to_node.at(bit);
+	}
+
+	void build()
+	{
+		add_node(NODE_CONST0, RTLIL::State::S0, nullptr);
+		add_node(NODE_CONST1, RTLIL::State::S1, nullptr);
+
+		// gates on combinational loops are left out and their outputs are
+		// treated as inputs
+		GateGraph graph(sigmap);
+		graph.build(module);
+		const std::vector<RTLIL::Cell*> &order = graph.order;
+
+		for (auto cell : order)
+			for (auto port : GateGraph::input_ports()) {
+				if (!cell->hasPort(port))
+					continue;
+				RTLIL::SigBit bit = sigmap(cell->getPort(port));
+				if (bit.wire != nullptr && !graph.drivers.count(bit) && !bit_to_node.count(bit)) {
+					bit_to_node[bit] = add_node(NODE_INPUT, bit, nullptr);
+					input_nodes.push_back(bit_to_node[bit]);
+				}
+			}
+
+		for (auto cell : order) {
+			RTLIL::SigBit y = sigmap(cell->getPort(ID::Y));
+			int idx = add_node(gate_node_type(cell->type), y, cell);
+			bit_to_node[y] = idx;
+			int k = 0;
+			for (auto port : GateGraph::input_ports())
+				if (cell->hasPort(port))
+					nodes[idx].in[k++] = lookup_node(sigmap(cell->getPort(port)));
+		}
+	}
+
+	// Evaluate all gate nodes for `n` words of patterns. The values of the
+	// constant and input nodes must already be set.
+	void simulate(std::vector<uint64_t> &vals, int n)
+	{
+		for (int i = 0; i < GetSize(nodes); i++)
+		{
+			const node_t &node = nodes[i];
+			if (node.type <= NODE_INPUT)
+				continue;
+
+			uint64_t *y = &vals[i * n];
+			const uint64_t *a = node.in[0] >= 0 ? &vals[node.in[0] * n] : nullptr;
+			const uint64_t *b = node.in[1] >= 0 ? &vals[node.in[1] * n] : nullptr;
+			const uint64_t *c = node.in[2] >= 0 ? &vals[node.in[2] * n] : nullptr;
+			const uint64_t *d = node.in[3] >= 0 ? &vals[node.in[3] * n] : nullptr;
+
+			for (int w = 0; w < n; w++)
+				switch (node.type) {
+				case NODE_BUF:    y[w] = a[w]; break;
+				case NODE_NOT:    y[w] = ~a[w]; break;
+				case NODE_AND:    y[w] = a[w] & b[w]; break;
+				case NODE_NAND:   y[w] = ~(a[w] & b[w]); break;
+				case NODE_OR:     y[w] = a[w] | b[w]; break;
+				case NODE_NOR:    y[w] = ~(a[w] | b[w]); break;
+				case NODE_XOR:    y[w] = a[w] ^ b[w]; break;
+				case NODE_XNOR:   y[w] = ~(a[w] ^ b[w]); break;
+				case NODE_ANDNOT: y[w] = a[w] & ~b[w]; break;
+				case NODE_ORNOT:  y[w] = a[w] | ~b[w]; break;
+				// the select input of $_MUX_ comes last, after A and B
+				case NODE_MUX:    y[w] = (a[w] & ~c[w]) | (b[w] & c[w]); break;
+				case NODE_NMUX:   y[w] = ~((a[w] & ~c[w]) | (b[w] & c[w])); break;
+				case NODE_AOI3:   y[w] = ~((a[w] & b[w]) | c[w]); break;
+				case NODE_OAI3:   y[w] = ~((a[w] | b[w]) & c[w]); break;
+				case NODE_AOI4:   y[w] = ~((a[w] & b[w]) | (c[w] & d[w])); break;
+				case NODE_OAI4:   y[w] = ~((a[w] | b[w]) & (c[w] | d[w])); break;
+				default:          log_abort();
+				}
+		}
+	}
+
+	void init_values(std::vector<uint64_t> &vals, int n)
+	{
+		vals.assign(GetSize(nodes) * n, 0);
+		for (int w = 0; w < n; w++)
+			vals[n + w] = ~uint64_t(0);
+	}
+
+	void initial_classes()
+	{
+		std::vector<uint64_t> vals;
+		init_values(vals, words);
+		for (int i : input_nodes)
+			for (int w = 0; w < words; w++)
+				vals[i * words + w] = rng();
+		simulate(vals, words);
+
+		// the first pattern of each node selects its phase, so that with -inv
+		// a node and its complement end up in the same class
+		phase.assign(GetSize(nodes), false);
+		class_of.assign(GetSize(nodes), -1);
+		dict<std::vector<uint64_t>, int> signatures;
+		for (int i = 0; i < GetSize(nodes); i++) {
+			std::vector<uint64_t> sig(vals.begin() + i * words, vals.begin() + (i + 1) * words);
+			if (inv_mode && (sig[0] & 1) != 0) {
+				phase[i] = true;
+				for (auto &w : sig)
+					w = ~w;
+			}
+			auto it = signatures.find(sig);
+			if (it == signatures.end()) {
+				it = signatures.emplace(sig, GetSize(classes)).first;
+				classes.emplace_back();
+			}
+			class_of[i] = it->second;
+			classes[it->second].push_back(i);
+		}
+	}
+
+	// Split the classes according to one word of additional patterns, given
+	// as the values of the input nodes.
+	void refine_classes(const std::vector<uint64_t> &input_vals)
+	{
+		std::vector<uint64_t> vals;
+		init_values(vals, 1);
+		for (int k = 0; k < GetSize(input_nodes); k++)
+			vals[input_nodes[k]] = input_vals[k];
+		simulate(vals, 1);
+
+		int num_classes = GetSize(classes);
+		for (int c = 0; c < num_classes; c++)
+		{
+			if (GetSize(classes[c]) < 2)
+				continue;
+
+			dict<uint64_t, int> splits;
+			std::vector<int> members;
+			members.swap(classes[c]);
+			for (int i : members) {
+				// merged nodes are dropped here instead of when they are merged
+				if (merges.count(i))
+					continue;
+				uint64_t sig = phase[i] ? ~vals[i] : vals[i];
+				auto it = splits.find(sig);
+				if (it == splits.end()) {
+					int new_class = splits.empty() ? c : GetSize(classes);
+					if (new_class != c)
+						classes.emplace_back();
+					it = splits.emplace(sig, new_class).first;
+				}
+				class_of[i] = it->second;
+				classes[it->second].push_back(i);
+			}
+		}
+	}
+
+	// the representative of a node as (node, inverted), after the merges so far
+	std::pair<int, bool> merged_node(int i)
+	{
+		auto it = merges.find(i);
+		if (it == merges.end())
+			return std::make_pair(i, false);
+		return it->second;
+	}
+
+	// The common case of duplicated logic is proven structurally: both gates
+	// compute the same (or the inverse) function of the same merged inputs.
+	bool structurally_equal(int i, int rep, bool inverted)
+	{
+		static const std::pair<node_type_t, bool> base_types[] = {
+			{NODE_CONST0, false}, {NODE_CONST1, false}, {NODE_INPUT, false},
+			{NODE_BUF, false}, {NODE_BUF, true}, {NODE_AND, false}, {NODE_AND, true},
+			{NODE_OR, false}, {NODE_OR, true}, {NODE_XOR, false}, {NODE_XOR, true},
+			{NODE_ANDNOT, false}, {NODE_ORNOT, false}, {NODE_MUX, false}, {NODE_MUX, true},
+			{NODE_AOI3, false}, {NODE_OAI3, false}, {NODE_AOI4, false}, {NODE_OAI4, false}
+		};
+
+		const node_t &a = nodes[i], &b = nodes[rep];
+		auto ta = base_types[a.type], tb = base_types[b.type];
+
+		// a buffer or inverter of the representative itself
+		if (ta.first == NODE_BUF && merged_node(a.in[0]).first == rep)
+			return (ta.second != merged_node(a.in[0]).second) == inverted;
+
+		if (b.type <= NODE_INPUT || ta.first != tb.first || (ta.second != tb.second) != inverted)
+			return false;
+
+		std::pair<int, bool> in_a[4], in_b[4];
+		for (int k = 0; k < 4; k++) {
+			in_a[k] = a.in[k] < 0 ? std::make_pair(-1, false) : merged_node(a.in[k]);
+			in_b[k] = b.in[k] < 0 ? std::make_pair(-1, false) : merged_node(b.in[k]);
+		}
+		if (ta.first == NODE_AND || ta.first == NODE_OR || ta.first == NODE_XOR) {
+			std::sort(in_a, in_a + 2);
+			std::sort(in_b, in_b + 2);
+		}
+		return std::equal(in_a, in_a + 4, in_b);
+	}
+
+	// Start over with an empty solver. The gates are encoded in terms of the
+	// representatives of their inputs, so the proven equivalences carry over.
+	void new_solver()
+	{
+		ez.reset(yosys_satsolver->create());
+		if (timeout > 0)
+			ez->setSolverTimeout(timeout);
+		lits.assign(GetSize(nodes), 0);
+		lits[0] = ez->CONST_FALSE;
+		lits[1] = ez->CONST_TRUE;
+		input_lits.clear();
+		for (int i : input_nodes) {
+			lits[i] = ez->frozen_literal();
+			input_lits.push_back(lits[i]);
+		}
+		solver_calls = 0;
+	}
+
+	int input_lit(const node_t &node, int k)
+	{
+		auto it = merged_node(node.in[k]);
+		return it.second ? ez->NOT(lits[it.first]) : lits[it.first];
+	}
+
+	// The literal of a gate, its input cone is encoded on first use.
+	int node_lit(int i)
+	{
+		std::vector<int> stack = {i};
+		while (!stack.empty())
+		{
+			int n = stack.back();
+			if (lits[n] != 0) {
+				stack.pop_back();
+				continue;
+			}
+
+			const node_t &node = nodes[n];
+			bool ready = true;
+			for (int k = 0; k < 4 && node.in[k] >= 0; k++) {
+				int in = merged_node(node.in[k]).first;
+				if (lits[in] == 0) {
+					stack.push_back(in);
+					ready = false;
+				}
+			}
+			if (!ready)
+				continue;
+			stack.pop_back();
+
+			int a = input_lit(node, 0);
+			int b = node.in[1] >= 0 ? input_lit(node, 1) : 0;
+			int c = node.in[2] >= 0 ? input_lit(node, 2) : 0;
+			int d = node.in[3] >= 0 ? input_lit(node, 3) : 0;
+
+			switch (node.type) {
+			case NODE_BUF:    lits[n] = a; break;
+			case NODE_NOT:    lits[n] = ez->NOT(a); break;
+			case NODE_AND:    lits[n] = ez->AND(a, b); break;
+			case NODE_NAND:   lits[n] = ez->NOT(ez->AND(a, b)); break;
+			case NODE_OR:     lits[n] = ez->OR(a, b); break;
+			case NODE_NOR:    lits[n] = ez->NOT(ez->OR(a, b)); break;
+			case NODE_XOR:    lits[n] = ez->XOR(a, b); break;
+			case NODE_XNOR:   lits[n] = ez->NOT(ez->XOR(a, b)); break;
+			case NODE_ANDNOT: lits[n] = ez->AND(a, ez->NOT(b)); break;
+			case NODE_ORNOT:  lits[n] = ez->OR(a, ez->NOT(b)); break;
+			case NODE_MUX:    lits[n] = ez->ITE(c, b, a); break;
+			case NODE_NMUX:   lits[n] = ez->NOT(ez->ITE(c, b, a)); break;
+			case NODE_AOI3:   lits[n] = ez->NOT(ez->OR(ez->AND(a, b), c)); break;
+			case NODE_OAI3:   lits[n] = ez->NOT(ez->AND(ez->OR(a, b), c)); break;
+			case NODE_AOI4:   lits[n] = ez->NOT(ez->OR(ez->AND(a, b), ez->AND(c, d))); break;
+			case NODE_OAI4:   lits[n] = ez->NOT(ez->AND(ez->OR(a, b), ez->OR(c, d))); break;
+			default:          log_abort();
+			}
+		}
+		return lits[i];
+	}
+
+	void remove_from_class(int i)
+	{
+		auto &members = classes[class_of[i]];
+		members.erase(std::find(members.begin(), members.end(), i));
+		class_of[i] = GetSize(classes);
+		classes.push_back({i});
+	}
+
+	void run()
+	{
+		build();
+
+		int num_gates = GetSize(nodes) - GetSize(input_nodes) - 2;
+		log("Analyzing %d gates with %d inputs in module %s.\n", num_gates, GetSize(input_nodes), log_id(module));
+		if (num_gates == 0)
+			return;
+
+		initial_classes();
+
+		int candidates = 0;
+		for (auto &members : classes)
+			if (GetSize(members) > 1)
+				candidates += GetSize(members) - 1;
+		log("Found %d candidate equivalences in %d simulation patterns.\n", candidates, 64 * words);
+
+		new_solver();
+
+		// counterexamples are collected until they fill one simulation word
+		std::vector<uint64_t> cex_vals(GetSize(input_nodes));
+		std::vector<std::pair<int, int>> disproved;
+		int cex_count = 0;
+
+		auto refine = [&]() {
+			refine_classes(cex_vals);
+			cex_count = 0;
+			// cannot happen with a consistent model, but make sure that
+			// every counterexample makes progress
+			for (auto &it : disproved)
+				if (class_of[it.first] == class_of[it.second])
+					remove_from_class(it.first);
+			disproved.clear();
+		};
+
+		while (true)
+		{
+			for (int i = 0; i < GetSize(nodes); i++)
+			{
+				if (nodes[i].type <= NODE_INPUT || merges.count(i))
+					continue;
+
+				int rep = classes[class_of[i]].front();
+				if (rep == i)
+					continue;
+
+				bool inverted = phase[i] != phase[rep];
+				if (structurally_equal(i, rep, inverted)) {
+					merges[i] = std::make_pair(rep, inverted);
+					strash_merges++;
+					continue;
+				}
+
+				// every satisfiable query assigns all variables of the solver, so
+				// the solver is recycled before it accumulates too many cones
+				if (solver_calls++ == recycle_calls)
+					new_solver();
+
+				int lit_rep = node_lit(rep);
+				int lit_i = node_lit(i);
+				if (inverted)
+					lit_i = ez->NOT(lit_i);
+
+				sat_calls++;
+				std::vector<bool> model;
+				if (!ez->solve(input_lits, model, ez->XOR(lit_rep, lit_i))) {
+					if (ez->getSolverTimoutStatus()) {
+						sat_timeouts++;
+						remove_from_class(i);
+						continue;
+					}
+					// later cones refer to the representative instead of this node
+					merges[i] = std::make_pair(rep, inverted);
+					continue;
+				}
+
+				sat_cex++;
+
+				for (int k = 0; k < GetSize(input_nodes); k++)
+					if (model[k])
+						cex_vals[k] |= uint64_t(1) << cex_count;
+					else
+						cex_vals[k] &= ~(uint64_t(1) << cex_count);
+
+				// until the classes are refined, this node and the representative
+				// cannot be told apart, so wait for the next round
+				disproved.emplace_back(i, rep);
+				if (++cex_count == 64)
+					refine();
+			}
+
+			if (cex_count == 0)
+				break;
+
+			// the unused patterns repeat the last counterexample
+			for (int k = 0; k < GetSize(input_nodes); k++)
+				if ((cex_vals[k] >> (cex_count - 1)) & 1)
+					cex_vals[k] |= ~uint64_t(0) << cex_count;
+				else
+					cex_vals[k] &= ~(~uint64_t(0) << cex_count);
+			refine();
+		}
+
+		log("Proved %d equivalences (%d inverted, %d structurally).\n", GetSize(merges), merged_inv_count(), strash_merges);
+		log("Used %d SAT calls: %d proofs, %d counterexamples, %d timeouts.\n", sat_calls, sat_calls - sat_cex - sat_timeouts, sat_cex, sat_timeouts);
+
+		apply_merges();
+	}
+
+	int merged_inv_count()
+	{
+		int count = 0;
+		for (auto &it : merges)
+			if (it.second.second)
+				count++;
+		return count;
+	}
+
+	void apply_merges()
+	{
+		dict<int, RTLIL::SigBit> inverted_reps;
+		for (auto &it : merges)
+		{
+			const node_t &node = nodes[it.first];
+			int rep = it.second.first;
+
+			RTLIL::SigBit rep_bit = nodes[rep].bit;
+			if (it.second.second) {
+				if (rep <= 1)
+					rep_bit = rep == 0 ? RTLIL::State::S1 : RTLIL::State::S0;
+				else {
+					if (!inverted_reps.count(rep))
+						inverted_reps[rep] = module->NotGate(NEW_ID, rep_bit);
+					rep_bit = inverted_reps.at(rep);
+				}
+			}
+
+			RTLIL::SigSpec y = node.cell->getPort(ID::Y);
+			node.cell->setPort(ID::Y, module->addWire(NEW_ID));
+			module->connect(y, rep_bit);
+		}
+	}
+};
+
+struct FraigPass : public Pass {
+	FraigPass() : Pass("fraig", "functional reduction by SAT sweeping") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    fraig [options] [selection]\n");
+		log("\n");
+		log("This pass merges functionally equivalent nodes in a fine-grained netlist of\n");
+		log("$_*_ gates. Candidate equivalences are found with bit-parallel simulation of\n");
+		log("random patterns and proven with an incremental SAT solver that encodes the\n");
+		log("input cones on demand. Each counterexample found by the solver is used as an\n");
+		log("additional simulation pattern to split the remaining candidates. The cones are\n");
+		log("encoded in terms of the already merged nodes, which keeps later proofs small\n");
+		log("and allows the solver to be restarted periodically as it grows.\n");
+		log("\n");
+		log("The drivers of the merged nodes are disconnected. A subsequent call to 'clean'\n");
+		log("will remove them.\n");
+		log("\n");
+		log("    -inv\n");
+		log("        also merge nodes that are equivalent to the inverse of another node,\n");
+		log("        adding $_NOT_ gates as needed\n");
+		log("\n");
+		log("    -words <n>\n");
+		log("        number of 64-bit words of random patterns to simulate before the\n");
+		log("        first SAT call (default: 4)\n");
+		log("\n");
+		log("    -seed <n>\n");
+		log("        seed for the random patterns (default: 1)\n");
+		log("\n");
+		log("    -timeout <seconds>\n");
+		log("        give up on a candidate equivalence when its SAT call takes longer\n");
+		log("        than the given time\n");
+		log("\n");
+		log("The selected cells cover the circuit that is analyzed. Cells of other types\n");
+		log("and cells with the keep attribute are treated as inputs. The pass is not\n");
+		log("undef-aware, i.e. x and z constants are treated as 0.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		bool inv_mode = false;
+		int words = 4;
+		int timeout = 0;
+		uint64_t seed = 1;
+
+		log_header(design, "Executing FRAIG pass (functional reduction by SAT sweeping).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-inv") {
+				inv_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-words" && argidx+1 < args.size()) {
+				words = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = std::max(1LL, atoll(args[++argidx].c_str()));
+				continue;
+			}
+			if (args[argidx] == "-timeout" && argidx+1 < args.size()) {
+				timeout = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		int merged = 0;
+		for (auto module : design->selected_modules()) {
+			FraigWorker worker(design, module, words, inv_mode, seed);
+			worker.timeout = timeout;
+			worker.run();
+			merged += GetSize(worker.merges);
+		}
+
+		log("Merged a total of %d nodes.\n", merged);
+	}
+} FraigPass;
+
+PRIVATE_NAMESPACE_END
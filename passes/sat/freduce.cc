@@ -760,7 +760,9 @@ struct FreduceWorker
 };
 
 struct FreducePass : public Pass {
-	FreducePass() : Pass("freduce", "perform functional reduction") { }
+	FreducePass() : Pass("freduce", "perform functional reduction") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -125,6 +125,7 @@ struct SimShared
 	bool serious_asserts = false;
 	bool fst_noinit = false;
 	bool initstate = true;
+	bool compiled = false;
 };
 
 void zinit(State &v)
@@ -139,6 +140,52 @@ void zinit(Const &v)
 		zinit(bit);
 }
 
+// Single-bit versions of the functions used by CellTypes::eval(), for the
+// compiled simulation mode. sim_not() passes x and z through like
+// CellTypes::eval_not(), sim_notx() maps them to x like const_not().
+
+static inline State sim_not(State a)
+{
+	if (a == State::S0) return State::S1;
+	if (a == State::S1) return State::S0;
+	return a;
+}
+
+static inline State sim_notx(State a)
+{
+	if (a == State::S0) return State::S1;
+	if (a == State::S1) return State::S0;
+	return State::Sx;
+}
+
+static inline State sim_and(State a, State b)
+{
+	if (a == State::S0 || b == State::S0) return State::S0;
+	if (a != State::S1 || b != State::S1) return State::Sx;
+	return State::S1;
+}
+
+static inline State sim_or(State a, State b)
+{
+	if (a == State::S1 || b == State::S1) return State::S1;
+	if (a != State::S0 || b != State::S0) return State::Sx;
+	return State::S0;
+}
+
+static inline State sim_xor(State a, State b)
+{
+	if (a != State::S0 && a != State::S1) return State::Sx;
+	if (b != State::S0 && b != State::S1) return State::Sx;
+	return a != b ? State::S1 : State::S0;
+}
+
+static inline State sim_mux(State a, State b, State s)
+{
+	if (s == State::S0) return a;
+	if (s == State::S1) return b;
+	return a == b ? a : State::Sx;
+}
+
 struct SimInstance
 {
 	SimShared *shared;
@@ -151,7 +198,8 @@ struct SimInstance
 	dict<Cell*, SimInstance*> children;
 
 	SigMap sigmap;
-	dict<SigBit, State> state_nets;
+	idict<SigBit> net_ids;
+	std::vector<State> net_state;
 	dict<SigBit, pool<Cell*>> upd_cells;
 	dict<SigBit, pool<Wire*>> upd_outports;
 
@@ -163,6 +211,37 @@ struct SimInstance
 	pool<IdString> dirty_memories;
 	pool<SimInstance*> dirty_children;
 
+	// Levelized program for -compiled mode. Combinational cells are
+	// evaluated in topological order on every update_ph1() call that sees a
+	// change on one of the program inputs, writing directly to net_state.
+	enum compiled_opcode_t {
+		OP_BUF, OP_NOT, OP_NOTX, OP_AND, OP_NAND, OP_OR, OP_NOR, OP_XOR, OP_XNOR,
+		OP_ANDNOT, OP_ORNOT, OP_MUX, OP_NMUX, OP_AOI3, OP_OAI3, OP_AOI4, OP_OAI4,
+		OP_LUT, OP_EVAL
+	};
+
+	struct compiled_op_t
+	{
+		compiled_opcode_t opcode;
+		// net_state indices; for OP_LUT `a' is the offset of the inputs in
+		// compiled_args, `b' the number of inputs and `c' the offset of the
+		// truth table in compiled_luts
+		int y, a, b, c, d;
+		Cell *cell;
+	};
+
+	bool compiled = false;
+	bool program_dirty = false;
+	int const_base = 0;
+	std::vector<compiled_op_t> program;
+	std::vector<int> compiled_args;
+	std::vector<State> compiled_luts;
+	pool<Cell*> program_cells;
+	// per net: read by the program but not driven by it
+	std::vector<bool> net_program_input;
+	// per net: read by something other than the program
+	std::vector<bool> net_external;
+
 	struct ff_state_t
 	{
 		Const past_d;
@@ -250,8 +329,8 @@ struct SimInstance
 			SigSpec sig = sigmap(wire);
 
 			for (int i = 0; i < GetSize(sig); i++) {
-				if (state_nets.count(sig[i]) == 0)
-					state_nets[sig[i]] = State::Sx;
+				if (net_ids(sig[i]) == GetSize(net_state))
+					net_state.push_back(State::Sx);
 				if (wire->port_output) {
 					upd_outports[sig[i]].insert(wire);
 					dirty_bits.insert(sig[i]);
@@ -269,7 +348,7 @@ struct SimInstance
 				Const initval = wire->attributes.at(ID::init);
 				for (int i = 0; i < GetSize(sig) && i < GetSize(initval); i++)
 					if (initval[i] == State::S0 || initval[i] == State::S1) {
-						state_nets[sig[i]] = initval[i];
+						net_state[net_ids.at(sig[i])] = initval[i];
 						dirty_bits.insert(sig[i]);
 					}
 			}
@@ -379,6 +458,9 @@ struct SimInstance
 				zinit(mem.data);
 			}
 		}
+
+		if (shared->compiled)
+			compile_program();
 	}
 
 	~SimInstance()
@@ -424,8 +506,8 @@ struct SimInstance
 		for (auto bit : sigmap(sig))
 			if (bit.wire == nullptr)
 				value.bits().push_back(bit.data);
-			else if (state_nets.count(bit))
-				value.bits().push_back(state_nets.at(bit));
+			else if (net_ids.count(bit))
+				value.bits().push_back(net_state[net_ids.at(bit)]);
 			else
 				value.bits().push_back(State::Sz);
 
@@ -441,12 +523,16 @@ struct SimInstance
 		sig = sigmap(sig);
 		log_assert(GetSize(sig) <= GetSize(value));
 
-		for (int i = 0; i < GetSize(sig); i++)
-			if (value[i] != State::Sa && state_nets.at(sig[i]) != value[i]) {
-				state_nets.at(sig[i]) = value[i];
+		for (int i = 0; i < GetSize(sig); i++) {
+			if (value[i] == State::Sa)
+				continue;
+			State &net = net_state[net_ids.at(sig[i])];
+			if (net != value[i]) {
+				net = value[i];
 				dirty_bits.insert(sig[i]);
 				did_something = true;
 			}
+		}
 
 		if (shared->debug)
 			log("[%s] set %s: %s\n", hiername().c_str(), log_signal(sig), log_signal(value));
@@ -587,6 +673,270 @@ struct SimInstance
 		log_error("Unsupported cell type: %s (%s.%s)\n", log_id(cell->type), log_id(module), log_id(cell));
 	}
 
+	int compiled_net(SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == nullptr)
+			return const_base + int(bit.data);
+		return net_ids.at(bit);
+	}
+
+	// Translate a cell into instructions, returns false for cells that are
+	// not evaluated by update_cell().
+	bool compile_cell(Cell *cell, std::vector<compiled_op_t> &ops)
+	{
+		if (ff_database.count(cell) || formal_database.count(cell) || mem_cells.count(cell) || children.count(cell))
+			return false;
+
+		if (!yosys_celltypes.cell_evaluable(cell->type))
+			return false;
+
+		// cells without inputs ($initstate, $anyseq, ..) are never updated
+		bool has_inputs = false;
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first))
+				has_inputs = true;
+		if (!has_inputs)
+			return false;
+
+		auto add_op = [&](compiled_opcode_t opcode, int y, int a, int b = -1, int c = -1, int d = -1) {
+			ops.push_back(compiled_op_t{opcode, y, a, b, c, d, cell});
+		};
+
+		auto port = [&](IdString name) { return compiled_net(cell->getPort(name)); };
+
+		IdString type = cell->type;
+
+		if (type.in(ID($_BUF_), ID($_NOT_))) {
+			add_op(type == ID($_BUF_) ? OP_BUF : OP_NOT, port(ID::Y), port(ID::A));
+			return true;
+		}
+
+		if (type.in(ID($_AND_), ID($_NAND_), ID($_OR_), ID($_NOR_), ID($_XOR_), ID($_XNOR_), ID($_ANDNOT_), ID($_ORNOT_))) {
+			compiled_opcode_t opcode = type == ID($_AND_) ? OP_AND : type == ID($_NAND_) ? OP_NAND :
+					type == ID($_OR_) ? OP_OR : type == ID($_NOR_) ? OP_NOR : type == ID($_XOR_) ? OP_XOR :
+					type == ID($_XNOR_) ? OP_XNOR : type == ID($_ANDNOT_) ? OP_ANDNOT : OP_ORNOT;
+			add_op(opcode, port(ID::Y), port(ID::A), port(ID::B));
+			return true;
+		}
+
+		if (type.in(ID($_MUX_), ID($_NMUX_))) {
+			add_op(type == ID($_MUX_) ? OP_MUX : OP_NMUX, port(ID::Y), port(ID::A), port(ID::B), port(ID::S));
+			return true;
+		}
+
+		if (type.in(ID($_AOI3_), ID($_OAI3_))) {
+			add_op(type == ID($_AOI3_) ? OP_AOI3 : OP_OAI3, port(ID::Y), port(ID::A), port(ID::B), port(ID::C));
+			return true;
+		}
+
+		if (type.in(ID($_AOI4_), ID($_OAI4_))) {
+			add_op(type == ID($_AOI4_) ? OP_AOI4 : OP_OAI4, port(ID::Y), port(ID::A), port(ID::B), port(ID::C), port(ID::D));
+			return true;
+		}
+
+		if (type == ID($lut)) {
+			int width = cell->getParam(ID::WIDTH).as_int();
+			SigSpec sig_a = cell->getPort(ID::A);
+			std::vector<State> table = cell->getParam(ID::LUT).to_bits();
+			table.resize(1 << width, State::S0);
+			add_op(OP_LUT, port(ID::Y), GetSize(compiled_args), width, GetSize(compiled_luts));
+			for (auto bit : sig_a)
+				compiled_args.push_back(compiled_net(bit));
+			compiled_luts.insert(compiled_luts.end(), table.begin(), table.end());
+			return true;
+		}
+
+		if (type.in(ID($not), ID($pos), ID($buf), ID($and), ID($or), ID($xor), ID($xnor)) && GetSize(cell->getPort(ID::A)) > 0 &&
+				(!cell->hasPort(ID::B) || GetSize(cell->getPort(ID::B)) > 0))
+		{
+			SigSpec sig_a = cell->getPort(ID::A);
+			SigSpec sig_b = cell->hasPort(ID::B) ? cell->getPort(ID::B) : SigSpec();
+			SigSpec sig_y = cell->getPort(ID::Y);
+
+			bool signed_a = cell->hasParam(ID::A_SIGNED) && cell->getParam(ID::A_SIGNED).as_bool();
+			bool signed_b = cell->hasParam(ID::B_SIGNED) && cell->getParam(ID::B_SIGNED).as_bool();
+			if (type.in(ID($and), ID($or), ID($xor), ID($xnor)) && (!signed_a || !signed_b))
+				signed_a = false, signed_b = false;
+
+			sig_a.extend_u0(GetSize(sig_y), signed_a);
+			sig_b.extend_u0(GetSize(sig_y), signed_b);
+
+			compiled_opcode_t opcode = type == ID($not) ? OP_NOTX : type.in(ID($pos), ID($buf)) ? OP_BUF :
+					type == ID($and) ? OP_AND : type == ID($or) ? OP_OR : type == ID($xor) ? OP_XOR : OP_XNOR;
+			for (int i = 0; i < GetSize(sig_y); i++)
+				add_op(opcode, compiled_net(sig_y[i]), compiled_net(sig_a[i]), opcode == OP_BUF || opcode == OP_NOTX ? -1 : compiled_net(sig_b[i]));
+			return true;
+		}
+
+		if (type == ID($mux)) {
+			SigSpec sig_a = cell->getPort(ID::A);
+			SigSpec sig_b = cell->getPort(ID::B);
+			SigSpec sig_y = cell->getPort(ID::Y);
+			int s = port(ID::S);
+			for (int i = 0; i < GetSize(sig_y); i++)
+				add_op(OP_MUX, compiled_net(sig_y[i]), compiled_net(sig_a[i]), compiled_net(sig_b[i]), s);
+			return true;
+		}
+
+		add_op(OP_EVAL, -1, -1);
+		return true;
+	}
+
+	void compile_program()
+	{
+		const_base = GetSize(net_state);
+		for (int i = 0; i <= int(State::Sm); i++)
+			net_state.push_back(State(i));
+
+		std::vector<Cell*> cells;
+		std::vector<std::vector<compiled_op_t>> cell_ops;
+		std::vector<std::vector<int>> cell_inputs;
+		dict<int, int> net_driver;
+
+		for (auto cell : module->cells())
+		{
+			std::vector<compiled_op_t> ops;
+			if (!compile_cell(cell, ops))
+				continue;
+
+			std::vector<int> inputs;
+			for (auto &conn : cell->connections())
+				for (auto bit : conn.second) {
+					int id = compiled_net(bit);
+					if (id >= const_base)
+						continue;
+					if (cell->input(conn.first))
+						inputs.push_back(id);
+					if (cell->output(conn.first))
+						net_driver[id] = GetSize(cells);
+				}
+
+			cells.push_back(cell);
+			cell_ops.push_back(std::move(ops));
+			cell_inputs.push_back(std::move(inputs));
+		}
+
+		// levelize
+		int n = GetSize(cells);
+		std::vector<int> indegree(n), order;
+		std::vector<std::vector<int>> fanout(n);
+		for (int i = 0; i < n; i++)
+			for (int id : cell_inputs[i]) {
+				auto it = net_driver.find(id);
+				if (it == net_driver.end())
+					continue;
+				fanout[it->second].push_back(i);
+				indegree[i]++;
+			}
+		for (int i = 0; i < n; i++)
+			if (indegree[i] == 0)
+				order.push_back(i);
+		for (int k = 0; k < GetSize(order); k++)
+			for (int i : fanout[order[k]])
+				if (--indegree[i] == 0)
+					order.push_back(i);
+
+		if (GetSize(order) < n) {
+			log_warning("Found combinational loop in module %s at %s, using event-driven simulation for this instance.\n",
+					log_id(module), hiername().c_str());
+			net_state.resize(const_base);
+			compiled_args.clear();
+			compiled_luts.clear();
+			return;
+		}
+
+		net_program_input.assign(const_base, false);
+		net_external.assign(const_base, false);
+
+		for (int i : order) {
+			program.insert(program.end(), cell_ops[i].begin(), cell_ops[i].end());
+			program_cells.insert(cells[i]);
+			for (int id : cell_inputs[i])
+				if (!net_driver.count(id))
+					net_program_input[id] = true;
+		}
+
+		// the program takes care of its own cells, keep upd_cells for the
+		// ones that still need event-driven updates
+		for (auto cell : program_cells)
+			for (auto &conn : cell->connections())
+				if (cell->input(conn.first))
+					for (auto bit : sigmap(conn.second)) {
+						auto it = upd_cells.find(bit);
+						if (it != upd_cells.end())
+							it->second.erase(cell);
+					}
+
+		for (auto &it : upd_cells)
+			if (!it.second.empty() && it.first.wire != nullptr)
+				net_external[net_ids.at(it.first)] = true;
+		for (auto &it : upd_outports)
+			net_external[net_ids.at(it.first)] = true;
+
+		compiled = true;
+		program_dirty = true;
+
+		if (shared->debug)
+			log("[%s] compiled %d cells into %d instructions\n", hiername().c_str(), n, GetSize(program));
+	}
+
+	State run_lut(const compiled_op_t &op)
+	{
+		int index = 0;
+		for (int i = 0; i < op.b; i++) {
+			State bit = net_state[compiled_args[op.a + i]];
+			if (bit == State::S1)
+				index |= 1 << i;
+			else if (bit != State::S0) {
+				Const sel;
+				for (int j = 0; j < op.b; j++)
+					sel.bits().push_back(net_state[compiled_args[op.a + j]]);
+				Const table(std::vector<State>(compiled_luts.begin() + op.c, compiled_luts.begin() + op.c + (1 << op.b)));
+				return const_bmux(table, sel)[0];
+			}
+		}
+		return compiled_luts[op.c + index];
+	}
+
+	void run_program()
+	{
+		for (auto &op : program)
+		{
+			State value;
+			switch (op.opcode)
+			{
+			case OP_BUF:    value = net_state[op.a]; break;
+			case OP_NOT:    value = sim_not(net_state[op.a]); break;
+			case OP_NOTX:   value = sim_notx(net_state[op.a]); break;
+			case OP_AND:    value = sim_and(net_state[op.a], net_state[op.b]); break;
+			case OP_NAND:   value = sim_not(sim_and(net_state[op.a], net_state[op.b])); break;
+			case OP_OR:     value = sim_or(net_state[op.a], net_state[op.b]); break;
+			case OP_NOR:    value = sim_not(sim_or(net_state[op.a], net_state[op.b])); break;
+			case OP_XOR:    value = sim_xor(net_state[op.a], net_state[op.b]); break;
+			case OP_XNOR:   value = sim_not(sim_xor(net_state[op.a], net_state[op.b])); break;
+			case OP_ANDNOT: value = sim_and(net_state[op.a], sim_not(net_state[op.b])); break;
+			case OP_ORNOT:  value = sim_or(net_state[op.a], sim_not(net_state[op.b])); break;
+			case OP_MUX:    value = sim_mux(net_state[op.a], net_state[op.b], net_state[op.c]); break;
+			case OP_NMUX:   value = sim_not(sim_mux(net_state[op.a], net_state[op.b], net_state[op.c])); break;
+			case OP_AOI3:   value = sim_not(sim_or(sim_and(net_state[op.a], net_state[op.b]), net_state[op.c])); break;
+			case OP_OAI3:   value = sim_not(sim_and(sim_or(net_state[op.a], net_state[op.b]), net_state[op.c])); break;
+			case OP_AOI4:   value = sim_not(sim_or(sim_and(net_state[op.a], net_state[op.b]), sim_and(net_state[op.c], net_state[op.d]))); break;
+			case OP_OAI4:   value = sim_not(sim_and(sim_or(net_state[op.a], net_state[op.b]), sim_or(net_state[op.c], net_state[op.d]))); break;
+			case OP_LUT:    value = run_lut(op); break;
+			case OP_EVAL:   update_cell(op.cell); continue;
+			default:        log_abort();
+			}
+
+			State &y = net_state[op.y];
+			if (y != value) {
+				y = value;
+				if (net_external[op.y])
+					dirty_bits.insert(net_ids[op.y]);
+			}
+		}
+	}
+
 	void update_memory(IdString id) {
 		auto &mdb = mem_database[id];
 		auto &mem = *mdb.mem;
@@ -633,10 +983,19 @@ struct SimInstance
 				if (upd_outports.count(bit) && parent != nullptr)
 					for (auto wire : upd_outports.at(bit))
 						queue_outports.insert(wire);
+
+				if (compiled && net_program_input[net_ids.at(bit)])
+					program_dirty = true;
 			}
 
 			dirty_bits.clear();
 
+			if (program_dirty) {
+				program_dirty = false;
+				run_program();
+				continue;
+			}
+
 			if (!queue_cells.empty())
 			{
 				for (auto cell : queue_cells)
@@ -1282,6 +1641,282 @@ struct SimInstance
 	}
 };
 
+// Bit-parallel simulation of up to 64 independent stimulus streams for
+// "sim -streams". Every net is kept as a pair of words with one bit per
+// stream: `def' is set for streams in which the net is 0 or 1, `val' for
+// streams in which it is 1 (x and z are not distinguished). The
+// combinational logic is evaluated with the levelized program of a compiled
+// SimInstance, flip-flops follow SimInstance::update_ph2().
+struct SimStreams
+{
+	struct word_t
+	{
+		uint64_t val, def;
+	};
+
+	static word_t w_not(word_t a)
+	{
+		return {~a.val & a.def, a.def};
+	}
+
+	static word_t w_and(word_t a, word_t b)
+	{
+		uint64_t val = a.val & b.val;
+		return {val, val | (a.def & ~a.val) | (b.def & ~b.val)};
+	}
+
+	static word_t w_or(word_t a, word_t b)
+	{
+		uint64_t val = a.val | b.val;
+		return {val, val | (a.def & ~a.val & b.def & ~b.val)};
+	}
+
+	static word_t w_xor(word_t a, word_t b)
+	{
+		uint64_t def = a.def & b.def;
+		return {(a.val ^ b.val) & def, def};
+	}
+
+	static word_t w_mux(word_t a, word_t b, word_t s)
+	{
+		uint64_t s0 = s.def & ~s.val, s1 = s.val, eq = ~s.def & a.def & b.def & ~(a.val ^ b.val);
+		return {(s0 & a.val) | (s1 & b.val) | (eq & a.val), (s0 & a.def) | (s1 & b.def) | eq};
+	}
+
+	static word_t w_select(uint64_t sel, word_t a, word_t b)
+	{
+		return {(a.val & sel) | (b.val & ~sel), (a.def & sel) | (b.def & ~sel)};
+	}
+
+	struct ff_t
+	{
+		FfData *data;
+		std::vector<int> d, q;
+		int clk = -1, ce = -1, srst = -1, arst = -1;
+		std::vector<word_t> past_d;
+		word_t past_clk, past_ce, past_srst;
+	};
+
+	SimInstance *inst;
+	int num_streams;
+	uint64_t mask;
+	std::vector<word_t> nets;
+	std::vector<word_t> lut_table;
+	std::vector<ff_t> ffs;
+	std::vector<int> failed_asserts, first_failed_step;
+
+	SimStreams(SimInstance *inst, int num_streams) : inst(inst), num_streams(num_streams)
+	{
+		if (!inst->children.empty())
+			log_error("Simulation with -streams requires a flat design, run 'flatten' first.\n");
+		if (!inst->mem_database.empty())
+			log_error("Memories are not supported with -streams, run 'memory_map' first.\n");
+		if (!inst->compiled)
+			log_error("Module %s could not be compiled for simulation with -streams.\n", log_id(inst->module));
+		for (auto &op : inst->program)
+			if (op.opcode == SimInstance::OP_EVAL)
+				log_error("Cell %s of type %s is not supported with -streams, run 'techmap' first.\n",
+						log_id(op.cell), log_id(op.cell->type));
+
+		mask = num_streams == 64 ? ~uint64_t(0) : (uint64_t(1) << num_streams) - 1;
+
+		for (auto state : inst->net_state)
+			nets.push_back(broadcast(state));
+
+		for (auto &it : inst->ff_database)
+		{
+			SimInstance::ff_state_t &state = it.second;
+			FfData &data = state.data;
+
+			if (data.has_aload || data.has_sr)
+				log_error("Flip-flop %s of type %s is not supported with -streams.\n", log_id(it.first), log_id(it.first->type));
+
+			ff_t ff;
+			ff.data = &data;
+			for (auto bit : data.sig_d)
+				ff.d.push_back(inst->compiled_net(bit));
+			for (auto bit : data.sig_q)
+				ff.q.push_back(inst->compiled_net(bit));
+			if (data.has_clk)
+				ff.clk = inst->compiled_net(data.sig_clk[0]);
+			if (data.has_ce)
+				ff.ce = inst->compiled_net(data.sig_ce[0]);
+			if (data.has_srst)
+				ff.srst = inst->compiled_net(data.sig_srst[0]);
+			if (data.has_arst)
+				ff.arst = inst->compiled_net(data.sig_arst[0]);
+			for (auto bit : state.past_d)
+				ff.past_d.push_back(broadcast(bit));
+			ff.past_clk = broadcast(state.past_clk);
+			ff.past_ce = broadcast(state.past_ce);
+			ff.past_srst = broadcast(state.past_srst);
+			ffs.push_back(ff);
+		}
+
+		failed_asserts.resize(num_streams);
+		first_failed_step.resize(num_streams, -1);
+	}
+
+	word_t broadcast(State state) const
+	{
+		if (state == State::S0)
+			return {0, mask};
+		if (state == State::S1)
+			return {mask, mask};
+		return {0, 0};
+	}
+
+	uint64_t is0(word_t w) const { return w.def & ~w.val; }
+	uint64_t is1(word_t w) const { return w.val; }
+
+	State get_net(int id, int stream) const
+	{
+		uint64_t bit = uint64_t(1) << stream;
+		if (!(nets[id].def & bit))
+			return State::Sx;
+		return nets[id].val & bit ? State::S1 : State::S0;
+	}
+
+	Const get_state(SigSpec sig, int stream)
+	{
+		Const value;
+		for (auto bit : sig)
+			value.bits().push_back(get_net(inst->compiled_net(bit), stream));
+		return value;
+	}
+
+	void set_state(SigSpec sig, word_t value)
+	{
+		for (auto bit : sig) {
+			int id = inst->compiled_net(bit);
+			if (id < inst->const_base)
+				nets[id] = value;
+		}
+	}
+
+	void set_state(SigSpec sig, State value)
+	{
+		set_state(sig, broadcast(value));
+	}
+
+	word_t run_lut(const SimInstance::compiled_op_t &op)
+	{
+		int width = op.b;
+		lut_table.resize(1 << width);
+		for (int i = 0; i < (1 << width); i++)
+			lut_table[i] = broadcast(inst->compiled_luts[op.c + i]);
+		for (int i = 0; i < width; i++) {
+			word_t sel = nets[inst->compiled_args[op.a + i]];
+			for (int j = 0; j < (1 << (width - i - 1)); j++)
+				lut_table[j] = w_mux(lut_table[2*j], lut_table[2*j+1], sel);
+		}
+		return lut_table[0];
+	}
+
+	void run_program()
+	{
+		for (auto &op : inst->program)
+		{
+			word_t value;
+			switch (op.opcode)
+			{
+			case SimInstance::OP_BUF:    value = nets[op.a]; break;
+			case SimInstance::OP_NOT:
+			case SimInstance::OP_NOTX:   value = w_not(nets[op.a]); break;
+			case SimInstance::OP_AND:    value = w_and(nets[op.a], nets[op.b]); break;
+			case SimInstance::OP_NAND:   value = w_not(w_and(nets[op.a], nets[op.b])); break;
+			case SimInstance::OP_OR:     value = w_or(nets[op.a], nets[op.b]); break;
+			case SimInstance::OP_NOR:    value = w_not(w_or(nets[op.a], nets[op.b])); break;
+			case SimInstance::OP_XOR:    value = w_xor(nets[op.a], nets[op.b]); break;
+			case SimInstance::OP_XNOR:   value = w_not(w_xor(nets[op.a], nets[op.b])); break;
+			case SimInstance::OP_ANDNOT: value = w_and(nets[op.a], w_not(nets[op.b])); break;
+			case SimInstance::OP_ORNOT:  value = w_or(nets[op.a], w_not(nets[op.b])); break;
+			case SimInstance::OP_MUX:    value = w_mux(nets[op.a], nets[op.b], nets[op.c]); break;
+			case SimInstance::OP_NMUX:   value = w_not(w_mux(nets[op.a], nets[op.b], nets[op.c])); break;
+			case SimInstance::OP_AOI3:   value = w_not(w_or(w_and(nets[op.a], nets[op.b]), nets[op.c])); break;
+			case SimInstance::OP_OAI3:   value = w_not(w_and(w_or(nets[op.a], nets[op.b]), nets[op.c])); break;
+			case SimInstance::OP_AOI4:   value = w_not(w_or(w_and(nets[op.a], nets[op.b]), w_and(nets[op.c], nets[op.d]))); break;
+			case SimInstance::OP_OAI4:   value = w_not(w_and(w_or(nets[op.a], nets[op.b]), w_or(nets[op.c], nets[op.d]))); break;
+			case SimInstance::OP_LUT:    value = run_lut(op); break;
+			default: log_abort();
+			}
+			nets[op.y] = value;
+		}
+	}
+
+	bool update_ffs(bool gclk)
+	{
+		bool did_something = false;
+
+		for (auto &ff : ffs)
+		{
+			FfData &data = *ff.data;
+			uint64_t load = 0, srst = 0, arst = 0;
+
+			if (data.has_clk) {
+				word_t clk = nets[ff.clk];
+				uint64_t edge = data.pol_clk ? is0(ff.past_clk) & ~is0(clk) : is1(ff.past_clk) & ~is1(clk);
+				uint64_t ce = data.has_ce ? (data.pol_ce ? is1(ff.past_ce) : is0(ff.past_ce)) : 0;
+				load = edge & (data.has_ce ? ce : mask);
+				if (data.has_srst)
+					srst = edge & (data.pol_srst ? is1(ff.past_srst) : is0(ff.past_srst)) & (data.ce_over_srst ? ce : mask);
+			}
+			if (data.has_arst)
+				arst = data.pol_arst ? is1(nets[ff.arst]) : is0(nets[ff.arst]);
+			if (data.has_gclk && gclk)
+				load = mask;
+
+			for (int i = 0; i < GetSize(ff.q); i++) {
+				if (ff.q[i] >= inst->const_base)
+					continue;
+				word_t q = nets[ff.q[i]];
+				q = w_select(load, ff.past_d[i], q);
+				q = w_select(srst, broadcast(data.val_srst[i]), q);
+				q = w_select(arst, broadcast(data.val_arst[i]), q);
+				if (q.val != nets[ff.q[i]].val || q.def != nets[ff.q[i]].def) {
+					nets[ff.q[i]] = q;
+					did_something = true;
+				}
+			}
+		}
+
+		return did_something;
+	}
+
+	void update_past(bool gclk_trigger, int step)
+	{
+		for (auto &ff : ffs) {
+			FfData &data = *ff.data;
+			if (data.has_clk || data.has_gclk)
+				for (int i = 0; i < GetSize(ff.d); i++)
+					ff.past_d[i] = nets[ff.d[i]];
+			if (data.has_clk)
+				ff.past_clk = nets[ff.clk];
+			if (data.has_ce)
+				ff.past_ce = nets[ff.ce];
+			if (data.has_srst)
+				ff.past_srst = nets[ff.srst];
+		}
+
+		if (!gclk_trigger)
+			return;
+
+		for (auto cell : inst->formal_database)
+		{
+			if (cell->type != ID($assert))
+				continue;
+			word_t a = nets[inst->compiled_net(cell->getPort(ID::A)[0])];
+			word_t en = nets[inst->compiled_net(cell->getPort(ID::EN)[0])];
+			uint64_t failed = is1(en) & ~is1(a) & mask;
+			for (int i = 0; i < num_streams; i++)
+				if (failed & (uint64_t(1) << i)) {
+					if (failed_asserts[i]++ == 0)
+						first_failed_step[i] = step;
+				}
+		}
+	}
+};
+
 struct SimWorker : SimShared
 {
 	SimInstance *top = nullptr;
@@ -1292,6 +1927,18 @@ struct SimWorker : SimShared
 	std::string summary_filename;
 	std::string scope;
 
+	struct stream_summary_t {
+		int failed_asserts;
+		int first_failed_step;
+		uint64_t signature;
+	};
+
+	int num_streams = 0;
+	uint64_t stream_seed = 1;
+	bool stream_traces = false;
+	std::vector<std::vector<std::pair<int,std::map<int,Const>>>> stream_output_data;
+	std::vector<stream_summary_t> stream_summaries;
+
 	~SimWorker()
 	{
 		outputfiles.clear();
@@ -1456,6 +2103,144 @@ struct SimWorker : SimShared
 		write_output_files();
 	}
 
+	void run_streams(Module *topmod, int numcycles)
+	{
+		log_assert(top == nullptr);
+		compiled = true;
+		top = new SimInstance(this, scope, topmod);
+		register_signals();
+
+		SimStreams sim(top, num_streams);
+
+		std::vector<Wire*> inputs, outputs;
+		for (auto portname : topmod->ports) {
+			Wire *w = topmod->wire(portname);
+			if (w->port_input && !clock.count(portname) && !clockn.count(portname) && !reset.count(portname) && !resetn.count(portname))
+				inputs.push_back(w);
+			if (w->port_output)
+				outputs.push_back(w);
+		}
+
+		auto set_ports = [&](const pool<IdString> &ports, State value) {
+			for (auto portname : ports) {
+				Wire *w = topmod->wire(portname);
+				if (w == nullptr)
+					log_error("Can't find port %s on module %s.\n", log_id(portname), log_id(topmod));
+				sim.set_state(w, value);
+			}
+		};
+
+		auto set_initstate = [&](State value) {
+			for (auto cell : top->initstate_database)
+				sim.set_state(cell->getPort(ID::Y), value);
+		};
+
+		uint64_t rng = stream_seed ? stream_seed : 1;
+		auto randomize_inputs = [&]() {
+			for (auto wire : inputs)
+				for (auto bit : SigSpec(wire)) {
+					rng ^= rng << 13;
+					rng ^= rng >> 7;
+					rng ^= rng << 17;
+					sim.set_state(bit, SimStreams::word_t{rng & sim.mask, sim.mask});
+				}
+		};
+
+		auto update = [&](bool gclk) {
+			if (gclk)
+				step += 1;
+			do
+				sim.run_program();
+			while (sim.update_ffs(gclk));
+			sim.update_past(gclk, step);
+		};
+
+		// FNV-1a over the values of all output ports at every step
+		std::vector<uint64_t> signatures(num_streams, 0xcbf29ce484222325ull);
+		std::vector<dict<int, Const>> last_values(num_streams);
+		stream_output_data.clear();
+		stream_output_data.resize(num_streams);
+
+		auto record_step = [&](int t) {
+			for (int i = 0; i < num_streams; i++) {
+				for (auto wire : outputs)
+					for (auto bit : sim.get_state(wire, i))
+						signatures[i] = (signatures[i] ^ uint64_t(bit)) * 0x100000001b3ull;
+				if (!stream_traces)
+					continue;
+				std::map<int,Const> data;
+				for (auto &it : top->signal_database) {
+					Const value = sim.get_state(it.first, i);
+					auto last = last_values[i].find(it.second.first);
+					if (last != last_values[i].end() && last->second == value)
+						continue;
+					last_values[i][it.second.first] = value;
+					data.emplace(it.second.first, value);
+				}
+				stream_output_data[i].emplace_back(t, data);
+			}
+		};
+
+		if (verbose)
+			log("Simulating %d streams of random stimulus (seed %llu).\n", num_streams, (unsigned long long)stream_seed);
+
+		set_ports(reset, State::S1);
+		set_ports(resetn, State::S0);
+
+		set_ports(clock, State::Sx);
+		set_ports(clockn, State::Sx);
+
+		set_initstate(initstate ? State::S1 : State::S0);
+		randomize_inputs();
+
+		update(false);
+		record_step(0);
+
+		for (int cycle = 0; cycle < numcycles; cycle++)
+		{
+			set_ports(clock, State::S0);
+			set_ports(clockn, State::S1);
+			randomize_inputs();
+
+			update(true);
+			record_step(10*cycle + 5);
+
+			if (cycle == 0)
+				set_initstate(State::S0);
+
+			set_ports(clock, State::S1);
+			set_ports(clockn, State::S0);
+
+			if (cycle+1 == rstlen) {
+				set_ports(reset, State::S0);
+				set_ports(resetn, State::S1);
+			}
+
+			update(true);
+			record_step(10*cycle + 10);
+		}
+
+		record_step(10*numcycles + 2);
+
+		int failed_streams = 0;
+		for (int i = 0; i < num_streams; i++) {
+			stream_summaries.push_back({sim.failed_asserts[i], sim.first_failed_step[i], signatures[i]});
+			if (sim.failed_asserts[i]) {
+				failed_streams++;
+				log("Stream %2d: %d failed assertions (first at step %d), output signature %016llx.\n", i,
+						sim.failed_asserts[i], sim.first_failed_step[i], (unsigned long long)signatures[i]);
+			} else
+				log("Stream %2d: no failed assertions, output signature %016llx.\n", i, (unsigned long long)signatures[i]);
+		}
+
+		if (failed_streams) {
+			if (serious_asserts)
+				log_error("Assertions failed in %d of %d streams.\n", failed_streams, num_streams);
+			else
+				log_warning("Assertions failed in %d of %d streams.\n", failed_streams, num_streams);
+		}
+	}
+
 	void run_cosim_fst(Module *topmod, int numcycles)
 	{
 		log_assert(top == nullptr);
@@ -2087,6 +2872,21 @@ struct SimWorker : SimShared
 			json.end_object();
 		}
 		json.end_array();
+		if (!stream_summaries.empty()) {
+			json.name("streams");
+			json.begin_array();
+			for (int i = 0; i < GetSize(stream_summaries); i++) {
+				auto &summary = stream_summaries[i];
+				json.begin_object();
+				json.entry("stream", i);
+				json.entry("failed_assertions", summary.failed_asserts);
+				if (summary.first_failed_step >= 0)
+					json.entry("first_failed_step", summary.first_failed_step);
+				json.entry("signature", stringf("%016llx", (unsigned long long)summary.signature));
+				json.end_object();
+			}
+			json.end_array();
+		}
 		json.end_object();
 	}
 
@@ -2675,6 +3475,26 @@ struct SimPass : public Pass {
 		log("        do not initialize latches and memories from an input FST or VCD file\n");
 		log("        (use the initial defined by the design instead)\n");
 		log("\n");
+		log("    -compiled\n");
+		log("        levelize the combinational logic of each module into a flat\n");
+		log("        instruction list that is evaluated without per-cell event handling.\n");
+		log("        Much faster for gate-level netlists, falls back to event-driven\n");
+		log("        simulation for modules with combinational loops.\n");
+		log("\n");
+		log("    -streams <integer>\n");
+		log("        simulate up to 64 independent streams of random stimulus at once, using\n");
+		log("        one bit of a machine word per stream. All top-level inputs except the\n");
+		log("        clock and reset ports get a new random value in every cycle. This\n");
+		log("        requires a flat design without memories that only contains the cell\n");
+		log("        types natively supported by -compiled (run 'techmap' first), and does not\n");
+		log("        distinguish between x and z. A summary with the failed assertions and a\n");
+		log("        signature of the output port values is printed for every stream. -vcd\n");
+		log("        and -fst write one file per stream, with the stream index appended to\n");
+		log("        the file name.\n");
+		log("\n");
+		log("    -seed <integer>\n");
+		log("        seed for the random stimulus of -streams (default: 1)\n");
+		log("\n");
 		log("    -q\n");
 		log("        disable per-cycle/sample log message\n");
 		log("\n");
@@ -2695,27 +3515,17 @@ struct SimPass : public Pass {
 		int numcycles = 20;
 		int append = 0;
 		bool start_set = false, stop_set = false, at_set = false;
+		std::vector<std::pair<std::string, std::string>> output_files;
 
 		log_header(design, "Executing SIM pass (simulate the circuit).\n");
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
-			if (args[argidx] == "-vcd" && argidx+1 < args.size()) {
-				std::string vcd_filename = args[++argidx];
-				rewrite_filename(vcd_filename);
-				worker.outputfiles.emplace_back(std::unique_ptr<VCDWriter>(new VCDWriter(&worker, vcd_filename.c_str())));
-				continue;
-			}
-			if (args[argidx] == "-fst" && argidx+1 < args.size()) {
-				std::string fst_filename = args[++argidx];
-				rewrite_filename(fst_filename);
-				worker.outputfiles.emplace_back(std::unique_ptr<FSTWriter>(new FSTWriter(&worker, fst_filename.c_str())));
-				continue;
-			}
-			if (args[argidx] == "-aiw" && argidx+1 < args.size()) {
-				std::string aiw_filename = args[++argidx];
-				rewrite_filename(aiw_filename);
-				worker.outputfiles.emplace_back(std::unique_ptr<AIWWriter>(new AIWWriter(&worker, aiw_filename.c_str())));
+			if ((args[argidx] == "-vcd" || args[argidx] == "-fst" || args[argidx] == "-aiw") && argidx+1 < args.size()) {
+				std::string kind = args[argidx];
+				std::string filename = args[++argidx];
+				rewrite_filename(filename);
+				output_files.emplace_back(kind, filename);
 				continue;
 			}
 			if (args[argidx] == "-hdlname") {
@@ -2853,9 +3663,54 @@ struct SimPass : public Pass {
 				worker.multiclock = true;
 				continue;
 			}
+			if (args[argidx] == "-compiled") {
+				worker.compiled = true;
+				continue;
+			}
+			if (args[argidx] == "-streams" && argidx+1 < args.size()) {
+				worker.num_streams = atoi(args[++argidx].c_str());
+				if (worker.num_streams < 1 || worker.num_streams > 64)
+					log_cmd_error("The number of streams must be between 1 and 64.\n");
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				worker.stream_seed = strtoull(args[++argidx].c_str(), nullptr, 10);
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
+
+		auto create_writers = [&](int stream) {
+			for (auto &it : output_files) {
+				std::string filename = it.second;
+				if (stream >= 0) {
+					size_t dot = filename.find_last_of('.');
+					size_t slash = filename.find_last_of("/\\");
+					if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+						dot = filename.size();
+					filename.insert(dot, stringf("_%d", stream));
+				}
+				if (it.first == "-vcd")
+					worker.outputfiles.emplace_back(std::unique_ptr<VCDWriter>(new VCDWriter(&worker, filename.c_str())));
+				else if (it.first == "-fst")
+					worker.outputfiles.emplace_back(std::unique_ptr<FSTWriter>(new FSTWriter(&worker, filename.c_str())));
+				else
+					worker.outputfiles.emplace_back(std::unique_ptr<AIWWriter>(new AIWWriter(&worker, filename.c_str())));
+			}
+		};
+
+		if (worker.num_streams > 0) {
+			if (!worker.sim_filename.empty())
+				log_cmd_error("Options -streams and -r are exclusive.\n");
+			if (worker.writeback)
+				log_cmd_error("Options -streams and -w are exclusive.\n");
+			for (auto &it : output_files)
+				if (it.first == "-aiw")
+					log_cmd_error("Option -aiw is not supported with -streams.\n");
+			worker.stream_traces = !output_files.empty();
+		} else
+			create_writers(-1);
 		if (at_set && (start_set || stop_set || worker.cycles_set))
 			log_error("'at' option can only be defined separate of 'start','stop' and 'n'\n");
 		if (stop_set && worker.cycles_set)
@@ -2875,7 +3730,16 @@ struct SimPass : public Pass {
 			top_mod = mods.front();
 		}
 
-		if (worker.sim_filename.empty())
+		if (worker.num_streams > 0) {
+			worker.run_streams(top_mod, numcycles);
+			for (int i = 0; worker.stream_traces && i < worker.num_streams; i++) {
+				worker.output_data.swap(worker.stream_output_data[i]);
+				create_writers(i);
+				worker.write_output_files();
+				worker.outputfiles.clear();
+				worker.output_data.clear();
+			}
+		} else if (worker.sim_filename.empty())
 			worker.run(top_mod, numcycles);
 		else {
 			std::string filename_trim = file_base_name(worker.sim_filename);
@@ -48,6 +48,7 @@
 #include "kernel/ff.h"
 #include "kernel/cost.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -65,9 +66,11 @@
 #include "frontends/blif/blifparse.h"
 
 #ifdef YOSYS_LINK_ABC
-namespace abc {
-	int Abc_RealMain(int argc, char *argv[]);
-}
+#  include "base/abc/abc.h"
+#  include "base/main/main.h"
+#  include "base/cmd/cmd.h"
+#  include "base/io/ioAbc.h"
+#  include "map/mio/mio.h"
 #endif
 
 USING_YOSYS_NAMESPACE
@@ -113,6 +116,7 @@ bool map_mux8;
 bool map_mux16;
 
 bool markgroups;
+bool blif_exchange;
 int map_autoidx;
 SigMap assign_map;
 RTLIL::Module *module;
@@ -129,6 +133,58 @@ dict<int, std::string> pi_map, po_map;
 
 int undef_bits_lost;
 
+// The state of one ABC invocation that has to survive between extracting the
+// netlist, running ABC and re-integrating the results. With -j all jobs are
+// extracted first, the ABC processes run concurrently, and the results are
+// re-integrated in extraction order; the per-job parts of the global state
+// above are parked here in the meantime (see swap_job_state()).
+struct abc_job_t
+{
+	RTLIL::Module *module = nullptr;
+	int map_autoidx = 0;
+	std::vector<gate_t> signal_list;
+	dict<RTLIL::SigBit, int> signal_map;
+	bool had_init = false;
+	bool clk_polarity = true, en_polarity = true, arst_polarity = true, srst_polarity = true;
+	RTLIL::SigSpec clk_sig, en_sig, arst_sig, srst_sig;
+	dict<int, std::string> pi_map, po_map;
+
+	std::string tempdir_name;
+	std::string abc_command;
+	int abc_ret = 0;
+	std::vector<std::string> abc_output;
+
+	// The linked ABC gets the netlist handed over as network and leaves the
+	// mapped netlist in mapped_design instead of output.blif, unless the
+	// BLIF exchange was requested with -blif.
+#ifdef YOSYS_LINK_ABC
+	bool in_memory = false;
+	abc::Abc_Ntk_t *abc_ntk = nullptr;
+	RTLIL::IdString dff_name;
+	bool sop_mode = false;
+#endif
+	RTLIL::Design *mapped_design = nullptr;
+};
+
+void swap_job_state(abc_job_t &job)
+{
+	std::swap(module, job.module);
+	std::swap(map_autoidx, job.map_autoidx);
+	signal_list.swap(job.signal_list);
+	signal_map.swap(job.signal_map);
+	std::swap(had_init, job.had_init);
+	std::swap(clk_polarity, job.clk_polarity);
+	std::swap(en_polarity, job.en_polarity);
+	std::swap(arst_polarity, job.arst_polarity);
+	std::swap(srst_polarity, job.srst_polarity);
+	std::swap(clk_sig, job.clk_sig);
+	std::swap(en_sig, job.en_sig);
+	std::swap(arst_sig, job.arst_sig);
+	std::swap(srst_sig, job.srst_sig);
+	pi_map.swap(job.pi_map);
+	po_map.swap(job.po_map);
+}
+
 int map_signal(RTLIL::SigBit bit, gate_type_t gate_type = G(NONE), int in1 = -1, int in2 = -1, int in3 = -1, int in4 = -1)
 {
 	assign_map.apply(bit);
@@ -703,11 +759,358 @@ struct abc_output_filter
 	}
 };
 
+// Writes the extracted netlist as BLIF file. This is what ABC reads when it
+// runs as a separate process.
+void write_input_blif(const std::string &filename)
+{
+	FILE *f = fopen(filename.c_str(), "wt");
+	if (f == nullptr)
+		log_error("Opening %s for writing failed: %s\n", filename.c_str(), strerror(errno));
+
+	fprintf(f, ".model netlist\n");
+
+	fprintf(f, ".inputs");
+	for (auto &si : signal_list) {
+		if (!si.is_port || si.type != G(NONE))
+			continue;
+		fprintf(f, " ys__n%d", si.id);
+	}
+	if (pi_map.empty())
+		fprintf(f, " dummy_input\n");
+	fprintf(f, "\n");
+
+	fprintf(f, ".outputs");
+	for (auto &si : signal_list) {
+		if (!si.is_port || si.type == G(NONE))
+			continue;
+		fprintf(f, " ys__n%d", si.id);
+	}
+	fprintf(f, "\n");
+
+	for (auto &si : signal_list)
+		fprintf(f, "# ys__n%-5d %s\n", si.id, log_signal(si.bit));
+
+	for (auto &si : signal_list) {
+		if (si.bit.wire == nullptr) {
+			fprintf(f, ".names ys__n%d\n", si.id);
+			if (si.bit == RTLIL::State::S1)
+				fprintf(f, "1\n");
+		}
+	}
+
+	for (auto &si : signal_list) {
+		if (si.type == G(BUF)) {
+			fprintf(f, ".names ys__n%d ys__n%d\n", si.in1, si.id);
+			fprintf(f, "1 1\n");
+		} else if (si.type == G(NOT)) {
+			fprintf(f, ".names ys__n%d ys__n%d\n", si.in1, si.id);
+			fprintf(f, "0 1\n");
+		} else if (si.type == G(AND)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "11 1\n");
+		} else if (si.type == G(NAND)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "0- 1\n");
+			fprintf(f, "-0 1\n");
+		} else if (si.type == G(OR)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "-1 1\n");
+			fprintf(f, "1- 1\n");
+		} else if (si.type == G(NOR)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "00 1\n");
+		} else if (si.type == G(XOR)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "01 1\n");
+			fprintf(f, "10 1\n");
+		} else if (si.type == G(XNOR)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "00 1\n");
+			fprintf(f, "11 1\n");
+		} else if (si.type == G(ANDNOT)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "10 1\n");
+		} else if (si.type == G(ORNOT)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
+			fprintf(f, "1- 1\n");
+			fprintf(f, "-0 1\n");
+		} else if (si.type == G(MUX)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
+			fprintf(f, "1-0 1\n");
+			fprintf(f, "-11 1\n");
+		} else if (si.type == G(NMUX)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
+			fprintf(f, "0-0 1\n");
+			fprintf(f, "-01 1\n");
+		} else if (si.type == G(AOI3)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
+			fprintf(f, "-00 1\n");
+			fprintf(f, "0-0 1\n");
+		} else if (si.type == G(OAI3)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
+			fprintf(f, "00- 1\n");
+			fprintf(f, "--0 1\n");
+		} else if (si.type == G(AOI4)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
+			fprintf(f, "-0-0 1\n");
+			fprintf(f, "-00- 1\n");
+			fprintf(f, "0--0 1\n");
+			fprintf(f, "0-0- 1\n");
+		} else if (si.type == G(OAI4)) {
+			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
+			fprintf(f, "00-- 1\n");
+			fprintf(f, "--00 1\n");
+		} else if (si.type == G(FF)) {
+			fprintf(f, ".latch ys__n%d ys__n%d 2\n", si.in1, si.id);
+		} else if (si.type == G(FF0)) {
+			fprintf(f, ".latch ys__n%d ys__n%d 0\n", si.in1, si.id);
+		} else if (si.type == G(FF1)) {
+			fprintf(f, ".latch ys__n%d ys__n%d 1\n", si.in1, si.id);
+		} else if (si.type != G(NONE))
+			log_abort();
+	}
+
+	fprintf(f, ".end\n");
+	fclose(f);
+}
+
+#ifdef YOSYS_LINK_ABC
+// Builds the network that ABC's read_blif would create from the file written
+// by write_input_blif(), so that the linked ABC can be used without a file.
+abc::Abc_Ntk_t *build_abc_network()
+{
+	using namespace abc;
+
+	Abc_Ntk_t *netlist = Abc_NtkAlloc(ABC_NTK_NETLIST, ABC_FUNC_SOP, 1);
+	netlist->pName = Extra_UtilStrsav("netlist");
+
+	auto net_name = [](int id) { return stringf("ys__n%d", id); };
+
+	int count_input = 0;
+	for (auto &si : signal_list)
+		if (si.is_port && si.type == G(NONE)) {
+			Io_ReadCreatePi(netlist, const_cast<char*>(net_name(si.id).c_str()));
+			count_input++;
+		}
+	if (count_input == 0)
+		Io_ReadCreatePi(netlist, const_cast<char*>("dummy_input"));
+
+	for (auto &si : signal_list)
+		if (si.is_port && si.type != G(NONE))
+			Io_ReadCreatePo(netlist, const_cast<char*>(net_name(si.id).c_str()));
+
+	for (auto &si : signal_list)
+		if (si.bit.wire == nullptr) {
+			std::string name = net_name(si.id);
+			Abc_NtkFindOrCreateNet(netlist, const_cast<char*>(name.c_str()));
+			Io_ReadCreateConst(netlist, const_cast<char*>(name.c_str()), si.bit == RTLIL::State::S1);
+		}
+
+	for (auto &si : signal_list)
+	{
+		const char *sop = nullptr;
+		int nr_inputs = 0;
+
+		switch (si.type) {
+			case G(NONE): continue;
+			case G(FF):
+			case G(FF0):
+			case G(FF1): {
+				Abc_Obj_t *latch = Io_ReadCreateLatch(netlist, const_cast<char*>(net_name(si.in1).c_str()), const_cast<char*>(net_name(si.id).c_str()));
+				if (si.type == G(FF0))
+					Abc_LatchSetInit0(latch);
+				else if (si.type == G(FF1))
+					Abc_LatchSetInit1(latch);
+				else
+					Abc_LatchSetInitDc(latch);
+				continue;
+			}
+			case G(BUF):    sop = "1 1\n", nr_inputs = 1; break;
+			case G(NOT):    sop = "0 1\n", nr_inputs = 1; break;
+			case G(AND):    sop = "11 1\n", nr_inputs = 2; break;
+			case G(NAND):   sop = "0- 1\n-0 1\n", nr_inputs = 2; break;
+			case G(OR):     sop = "-1 1\n1- 1\n", nr_inputs = 2; break;
+			case G(NOR):    sop = "00 1\n", nr_inputs = 2; break;
+			case G(XOR):    sop = "01 1\n10 1\n", nr_inputs = 2; break;
+			case G(XNOR):   sop = "00 1\n11 1\n", nr_inputs = 2; break;
+			case G(ANDNOT): sop = "10 1\n", nr_inputs = 2; break;
+			case G(ORNOT):  sop = "1- 1\n-0 1\n", nr_inputs = 2; break;
+			case G(MUX):    sop = "1-0 1\n-11 1\n", nr_inputs = 3; break;
+			case G(NMUX):   sop = "0-0 1\n-01 1\n", nr_inputs = 3; break;
+			case G(AOI3):   sop = "-00 1\n0-0 1\n", nr_inputs = 3; break;
+			case G(OAI3):   sop = "00- 1\n--0 1\n", nr_inputs = 3; break;
+			case G(AOI4):   sop = "-0-0 1\n-00- 1\n0--0 1\n0-0- 1\n", nr_inputs = 4; break;
+			case G(OAI4):   sop = "00-- 1\n--00 1\n", nr_inputs = 4; break;
+			default: log_abort();
+		}
+
+		std::vector<std::string> input_names;
+		for (int in : {si.in1, si.in2, si.in3, si.in4})
+			if (GetSize(input_names) < nr_inputs)
+				input_names.push_back(net_name(in));
+		std::vector<char*> inputs;
+		for (auto &name : input_names)
+			inputs.push_back(const_cast<char*>(name.c_str()));
+
+		Abc_Obj_t *node = Io_ReadCreateNode(netlist, const_cast<char*>(net_name(si.id).c_str()), inputs.data(), nr_inputs);
+		Abc_ObjSetData(node, Abc_SopRegister((Mem_Flex_t*)netlist->pManFunc, sop));
+	}
+
+	Abc_NtkFinalizeRead(netlist);
+	Abc_Ntk_t *ntk = Abc_NtkToLogic(netlist);
+	Abc_NtkDelete(netlist);
+	return ntk;
+}
+
+// Converts the network left behind by the ABC script into the same design that
+// parse_blif() would create from the output of ABC's write_blif command.
+RTLIL::Design *extract_abc_network(abc::Abc_Ntk_t *ntk, RTLIL::IdString dff_name, bool sop_mode)
+{
+	using namespace abc;
+
+	Abc_Ntk_t *netlist = Abc_NtkToNetlist(ntk);
+	if (netlist == nullptr)
+		return nullptr;
+	if (!Abc_NtkHasSop(netlist) && !Abc_NtkHasMapping(netlist))
+		Abc_NtkToSop(netlist, -1, ABC_INFINITY);
+
+	RTLIL::Design *design = new RTLIL::Design;
+	RTLIL::Module *module = design->addModule(ID(netlist));
+
+	auto net_wire = [&](Abc_Obj_t *net) {
+		RTLIL::IdString name = RTLIL::escape_id(Abc_ObjName(net));
+		RTLIL::Wire *wire = module->wire(name);
+		if (wire == nullptr)
+			wire = module->addWire(name);
+		return wire;
+	};
+
+	Abc_Obj_t *obj;
+	int i;
+
+	Abc_NtkForEachPi(netlist, obj, i)
+		net_wire(Abc_ObjFanout0(obj))->port_input = true;
+	Abc_NtkForEachPo(netlist, obj, i)
+		net_wire(Abc_ObjFanin0(obj))->port_output = true;
+	module->fixup_ports();
+
+	Abc_NtkForEachLatch(netlist, obj, i) {
+		Abc_Obj_t *d = Abc_ObjFanin0(Abc_ObjFanin0(obj));
+		Abc_Obj_t *q = Abc_ObjFanout0(Abc_ObjFanout0(obj));
+		if (Abc_LatchIsInit0(obj) || Abc_LatchIsInit1(obj))
+			net_wire(q)->attributes[ID::init] = RTLIL::Const(Abc_LatchIsInit1(obj) ? 1 : 0, 1);
+		RTLIL::Cell *cell = module->addCell(NEW_ID, dff_name);
+		cell->setPort(ID::D, net_wire(d));
+		cell->setPort(ID::Q, net_wire(q));
+	}
+
+	Abc_NtkForEachNode(netlist, obj, i)
+	{
+		if (Abc_NtkHasMapping(netlist))
+		{
+			if (Abc_ObjIsBarBuf(obj)) {
+				RTLIL::Wire *in = net_wire(Abc_ObjFanin0(obj));
+				module->connect(net_wire(Abc_ObjFanout0(obj)), in);
+				continue;
+			}
+
+			Mio_Gate_t *gate = (Mio_Gate_t*)obj->pData;
+			RTLIL::Cell *cell = module->addCell(NEW_ID, RTLIL::escape_id(Mio_GateReadName(gate)));
+			int k = 0;
+			for (Mio_Pin_t *pin = Mio_GateReadPins(gate); pin != nullptr; pin = Mio_PinReadNext(pin), k++)
+				cell->setPort(RTLIL::escape_id(Mio_PinReadName(pin)), net_wire(Abc_ObjFanin(obj, k)));
+			cell->setPort(RTLIL::escape_id(Mio_GateReadOutName(gate)), net_wire(Abc_ObjFanout0(obj)));
+
+			// Gates with two outputs are represented by two consecutive nodes.
+			if (Mio_GateReadTwin(gate) != nullptr) {
+				Abc_Obj_t *twin = Abc_NtkFetchTwinNode(obj);
+				if (twin != nullptr) {
+					cell->setPort(RTLIL::escape_id(Mio_GateReadOutName((Mio_Gate_t*)twin->pData)), net_wire(Abc_ObjFanout0(twin)));
+					i++;
+				}
+			}
+			continue;
+		}
+
+		char *sop = (char*)Abc_ObjData(obj);
+		int width = Abc_ObjFaninNum(obj);
+
+		RTLIL::SigSpec input_sig;
+		for (int k = 0; k < width; k++)
+			input_sig.append(net_wire(Abc_ObjFanin(obj, k)));
+		RTLIL::SigSpec output_sig = net_wire(Abc_ObjFanout0(obj));
+
+		if (width == 0) {
+			module->connect(output_sig, Abc_SopIsConst1(sop) ? RTLIL::State::S1 : RTLIL::State::S0);
+			continue;
+		}
+
+		// Each cube is the input plane, a space, the output value and a newline.
+		if (sop_mode)
+		{
+			RTLIL::Const table;
+			int depth = 0;
+			for (char *cube = sop; *cube; cube += width + 3, depth++)
+				for (int k = 0; k < width; k++) {
+					table.bits().push_back(cube[k] == '0' ? State::S1 : State::S0);
+					table.bits().push_back(cube[k] == '1' ? State::S1 : State::S0);
+				}
+
+			RTLIL::Cell *cell = module->addCell(NEW_ID, ID($sop));
+			cell->parameters[ID::WIDTH] = RTLIL::Const(width);
+			cell->parameters[ID::DEPTH] = RTLIL::Const(depth);
+			cell->parameters[ID::TABLE] = table;
+			cell->setPort(ID::A, input_sig);
+			cell->setPort(ID::Y, output_sig);
+			if (sop[width + 1] == '0') {
+				SigSpec tempnet = module->addWire(NEW_ID);
+				module->addNotGate(NEW_ID, tempnet, output_sig);
+				cell->setPort(ID::Y, tempnet);
+			}
+			continue;
+		}
+
+		if (width > 12)
+			log_error("ABC: node `%s' has %d inputs, which is too many for a $lut cell.\n", Abc_ObjName(Abc_ObjFanout0(obj)), width);
+
+		RTLIL::Const lut(RTLIL::State::Sx, 1 << width);
+		RTLIL::State default_state = RTLIL::State::Sx;
+		for (char *cube = sop; *cube; cube += width + 3) {
+			RTLIL::State value = cube[width + 1] == '0' ? RTLIL::State::S0 : RTLIL::State::S1;
+			for (int v = 0; v < (1 << width); v++) {
+				bool match = true;
+				for (int k = 0; k < width && match; k++)
+					if (cube[k] != '-' && (cube[k] == '1') != ((v >> k) & 1))
+						match = false;
+				if (match)
+					lut.bits().at(v) = value;
+			}
+			default_state = value == RTLIL::State::S0 ? RTLIL::State::S1 : RTLIL::State::S0;
+		}
+		for (auto &bit : lut.bits())
+			if (bit == RTLIL::State::Sx)
+				bit = default_state;
+
+		RTLIL::Cell *cell = module->addCell(NEW_ID, ID($lut));
+		cell->parameters[ID::WIDTH] = RTLIL::Const(width);
+		cell->parameters[ID::LUT] = lut;
+		cell->setPort(ID::A, input_sig);
+		cell->setPort(ID::Y, output_sig);
+	}
+
+	Abc_NtkDelete(netlist);
+	return design;
+}
+#endif
+
+// Extracts the given cells into the global state and prepares the temp dir for
+// the ABC process of the job; see abc_module_run() and abc_module_import().
 void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::string script_file, std::string exe_file,
 		std::vector<std::string> &liberty_files, std::vector<std::string> &genlib_files, std::string constr_file,
 		bool cleanup, vector<int> lut_costs, bool dff_mode, std::string clk_str, bool keepff, std::string delay_target,
 		std::string sop_inputs, std::string sop_products, std::string lutin_shared, bool fast_mode,
-		const std::vector<RTLIL::Cell*> &cells, bool show_tempdir, bool sop_mode, bool abc_dress, std::vector<std::string> &dont_use_cells)
+		const std::vector<RTLIL::Cell*> &cells, bool show_tempdir, bool sop_mode, bool abc_dress, std::vector<std::string> &dont_use_cells,
+		abc_job_t &job, const pool<RTLIL::SigBit> *extra_ports)
 {
 	module = current_module;
 	map_autoidx = autoidx++;
@@ -794,10 +1197,17 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 		tempdir_name = "_tmp_";
 	tempdir_name += proc_program_prefix() + "yosys-abc-XXXXXX";
 	tempdir_name = make_temp_dir(tempdir_name);
+	job.tempdir_name = tempdir_name;
 	log_header(design, "Extracting gate netlist of module `%s' to `%s/input.blif'..\n",
 			module->name.c_str(), replace_tempdir(tempdir_name, tempdir_name, show_tempdir).c_str());
 
-	std::string abc_script = stringf("read_blif \"%s/input.blif\"; ", tempdir_name.c_str());
+#ifdef YOSYS_LINK_ABC
+	const bool in_memory = !blif_exchange;
+#else
+	const bool in_memory = false;
+#endif
+
+	std::string abc_script = in_memory ? "" : stringf("read_blif \"%s/input.blif\"; ", tempdir_name.c_str());
 
 	if (!liberty_files.empty() || !genlib_files.empty()) {
 		std::string dont_use_args;
@@ -862,19 +1272,25 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 		abc_script = abc_script.substr(0, pos) + lutin_shared + abc_script.substr(pos+3);
 	if (abc_dress)
 		abc_script += stringf("; dress \"%s/input.blif\"", tempdir_name.c_str());
-	abc_script += stringf("; write_blif %s/output.blif", tempdir_name.c_str());
+	if (!in_memory)
+		abc_script += stringf("; write_blif %s/output.blif", tempdir_name.c_str());
 	abc_script = add_echos_to_abc_cmd(abc_script);
+	std::string abc_command = abc_script;
 
 	for (size_t i = 0; i+1 < abc_script.size(); i++)
 		if (abc_script[i] == ';' && abc_script[i+1] == ' ')
 			abc_script[i+1] = '\n';
 
-	std::string buffer = stringf("%s/abc.script", tempdir_name.c_str());
-	FILE *f = fopen(buffer.c_str(), "wt");
-	if (f == nullptr)
-		log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
-	fprintf(f, "%s\n", abc_script.c_str());
-	fclose(f);
+	std::string buffer;
+	FILE *f;
+	if (!in_memory || !cleanup) {
+		buffer = stringf("%s/abc.script", tempdir_name.c_str());
+		f = fopen(buffer.c_str(), "wt");
+		if (f == nullptr)
+			log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
+		fprintf(f, "%s\n", abc_script.c_str());
+		fclose(f);
+	}
 
 	if (dff_mode || !clk_str.empty())
 	{
@@ -922,125 +1338,25 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 	if (srst_sig.size() != 0)
 		mark_port(srst_sig);
 
-	handle_loops();
-
-	buffer = stringf("%s/input.blif", tempdir_name.c_str());
-	f = fopen(buffer.c_str(), "wt");
-	if (f == nullptr)
-		log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
-
-	fprintf(f, ".model netlist\n");
-
-	int count_input = 0;
-	fprintf(f, ".inputs");
-	for (auto &si : signal_list) {
-		if (!si.is_port || si.type != G(NONE))
-			continue;
-		fprintf(f, " ys__n%d", si.id);
-		pi_map[count_input++] = log_signal(si.bit);
-	}
-	if (count_input == 0)
-		fprintf(f, " dummy_input\n");
-	fprintf(f, "\n");
-
-	int count_output = 0;
-	fprintf(f, ".outputs");
-	for (auto &si : signal_list) {
-		if (!si.is_port || si.type == G(NONE))
-			continue;
-		fprintf(f, " ys__n%d", si.id);
-		po_map[count_output++] = log_signal(si.bit);
-	}
-	fprintf(f, "\n");
-
-	for (auto &si : signal_list)
-		fprintf(f, "# ys__n%-5d %s\n", si.id, log_signal(si.bit));
+	if (extra_ports != nullptr)
+		for (auto bit : *extra_ports)
+			if (signal_map.count(bit) > 0)
+				signal_list[signal_map[bit]].is_port = true;
 
-	for (auto &si : signal_list) {
-		if (si.bit.wire == nullptr) {
-			fprintf(f, ".names ys__n%d\n", si.id);
-			if (si.bit == RTLIL::State::S1)
-				fprintf(f, "1\n");
-		}
-	}
+	handle_loops();
 
-	int count_gates = 0;
+	int count_input = 0, count_output = 0, count_gates = 0;
 	for (auto &si : signal_list) {
-		if (si.type == G(BUF)) {
-			fprintf(f, ".names ys__n%d ys__n%d\n", si.in1, si.id);
-			fprintf(f, "1 1\n");
-		} else if (si.type == G(NOT)) {
-			fprintf(f, ".names ys__n%d ys__n%d\n", si.in1, si.id);
-			fprintf(f, "0 1\n");
-		} else if (si.type == G(AND)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "11 1\n");
-		} else if (si.type == G(NAND)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "0- 1\n");
-			fprintf(f, "-0 1\n");
-		} else if (si.type == G(OR)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "-1 1\n");
-			fprintf(f, "1- 1\n");
-		} else if (si.type == G(NOR)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "00 1\n");
-		} else if (si.type == G(XOR)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "01 1\n");
-			fprintf(f, "10 1\n");
-		} else if (si.type == G(XNOR)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "00 1\n");
-			fprintf(f, "11 1\n");
-		} else if (si.type == G(ANDNOT)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "10 1\n");
-		} else if (si.type == G(ORNOT)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "1- 1\n");
-			fprintf(f, "-0 1\n");
-		} else if (si.type == G(MUX)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "1-0 1\n");
-			fprintf(f, "-11 1\n");
-		} else if (si.type == G(NMUX)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "0-0 1\n");
-			fprintf(f, "-01 1\n");
-		} else if (si.type == G(AOI3)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "-00 1\n");
-			fprintf(f, "0-0 1\n");
-		} else if (si.type == G(OAI3)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "00- 1\n");
-			fprintf(f, "--0 1\n");
-		} else if (si.type == G(AOI4)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
-			fprintf(f, "-0-0 1\n");
-			fprintf(f, "-00- 1\n");
-			fprintf(f, "0--0 1\n");
-			fprintf(f, "0-0- 1\n");
-		} else if (si.type == G(OAI4)) {
-			fprintf(f, ".names ys__n%d ys__n%d ys__n%d ys__n%d ys__n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
-			fprintf(f, "00-- 1\n");
-			fprintf(f, "--00 1\n");
-		} else if (si.type == G(FF)) {
-			fprintf(f, ".latch ys__n%d ys__n%d 2\n", si.in1, si.id);
-		} else if (si.type == G(FF0)) {
-			fprintf(f, ".latch ys__n%d ys__n%d 0\n", si.in1, si.id);
-		} else if (si.type == G(FF1)) {
-			fprintf(f, ".latch ys__n%d ys__n%d 1\n", si.in1, si.id);
-		} else if (si.type != G(NONE))
-			log_abort();
+		if (si.is_port && si.type == G(NONE))
+			pi_map[count_input++] = log_signal(si.bit);
+		if (si.is_port && si.type != G(NONE))
+			po_map[count_output++] = log_signal(si.bit);
 		if (si.type != G(NONE))
 			count_gates++;
 	}
 
-	fprintf(f, ".end\n");
-	fclose(f);
+	if (!in_memory || abc_dress || !cleanup)
+		write_input_blif(stringf("%s/input.blif", tempdir_name.c_str()));
 
 	log("Extracted %d gates and %d wires to a netlist network with %d inputs and %d outputs.\n",
 			count_gates, GetSize(signal_list), count_input, count_output);
@@ -1105,70 +1421,139 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 			fclose(f);
 		}
 
+#ifdef YOSYS_LINK_ABC
+		(void)exe_file;
+		job.in_memory = in_memory;
+		if (in_memory)
+			job.abc_ntk = build_abc_network();
+		job.dff_name = liberty_files.empty() && genlib_files.empty() ? ID(DFF) : ID(_dff_);
+		job.sop_mode = sop_mode;
+		job.abc_command = abc_command;
+		if (in_memory)
+			log("Running linked ABC on the extracted network: %s\n", replace_tempdir(abc_command, tempdir_name, show_tempdir).c_str());
+		else
+			log("Running linked ABC command: %s\n", replace_tempdir(abc_command, tempdir_name, show_tempdir).c_str());
+#else
 		buffer = stringf("\"%s\" -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
 		log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
+		job.abc_command = buffer;
+#endif
+	}
+	else
+	{
+		log("Don't call ABC as there is nothing to map.\n");
+	}
+}
+
+// Runs the ABC process of a job that has been extracted by abc_module(). With
+// stream_output the ABC output is logged as it arrives; otherwise it is only
+// collected in the job, so that this can be called on a worker thread.
+void abc_module_run(abc_job_t &job, bool show_tempdir, bool stream_output)
+{
+	std::string tempdir_name = job.tempdir_name;
+	std::string buffer = job.abc_command;
 
 #ifndef YOSYS_LINK_ABC
-		abc_output_filter filt(tempdir_name, show_tempdir);
-		int ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
+	if (!stream_output) {
+		job.abc_ret = run_command(buffer, [&](const std::string &line) { job.abc_output.push_back(line); });
+		return;
+	}
+	abc_output_filter filt(tempdir_name, show_tempdir);
+	int ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
 #else
-		string temp_stdouterr_name = stringf("%s/stdouterr.txt", tempdir_name.c_str());
-		FILE *temp_stdouterr_w = fopen(temp_stdouterr_name.c_str(), "w");
-		if (temp_stdouterr_w == NULL)
-			log_error("ABC: cannot open a temporary file for output redirection");
-		fflush(stdout);
-		fflush(stderr);
-		FILE *old_stdout = fopen(temp_stdouterr_name.c_str(), "r"); // need any fd for renumbering
-		FILE *old_stderr = fopen(temp_stdouterr_name.c_str(), "r"); // need any fd for renumbering
+	string temp_stdouterr_name = stringf("%s/stdouterr.txt", tempdir_name.c_str());
+	FILE *temp_stdouterr_w = fopen(temp_stdouterr_name.c_str(), "w");
+	if (temp_stdouterr_w == NULL)
+		log_error("ABC: cannot open a temporary file for output redirection");
+	fflush(stdout);
+	fflush(stderr);
+	FILE *old_stdout = fopen(temp_stdouterr_name.c_str(), "r"); // need any fd for renumbering
+	FILE *old_stderr = fopen(temp_stdouterr_name.c_str(), "r"); // need any fd for renumbering
 #if defined(__wasm)
 #define fd_renumber(from, to) (void)__wasi_fd_renumber(from, to)
 #else
 #define fd_renumber(from, to) dup2(from, to)
 #endif
-		fd_renumber(fileno(stdout), fileno(old_stdout));
-		fd_renumber(fileno(stderr), fileno(old_stderr));
-		fd_renumber(fileno(temp_stdouterr_w), fileno(stdout));
-		fd_renumber(fileno(temp_stdouterr_w), fileno(stderr));
-		fclose(temp_stdouterr_w);
-		// These needs to be mutable, supposedly due to getopt
-		char *abc_argv[5];
-		string tmp_script_name = stringf("%s/abc.script", tempdir_name.c_str());
-		abc_argv[0] = strdup(exe_file.c_str());
-		abc_argv[1] = strdup("-s");
-		abc_argv[2] = strdup("-f");
-		abc_argv[3] = strdup(tmp_script_name.c_str());
-		abc_argv[4] = 0;
-		int ret = abc::Abc_RealMain(4, abc_argv);
-		free(abc_argv[0]);
-		free(abc_argv[1]);
-		free(abc_argv[2]);
-		free(abc_argv[3]);
-		fflush(stdout);
-		fflush(stderr);
-		fd_renumber(fileno(old_stdout), fileno(stdout));
-		fd_renumber(fileno(old_stderr), fileno(stderr));
-		fclose(old_stdout);
-		fclose(old_stderr);
-		std::ifstream temp_stdouterr_r(temp_stdouterr_name);
-		abc_output_filter filt(tempdir_name, show_tempdir);
-		for (std::string line; std::getline(temp_stdouterr_r, line); )
+	fd_renumber(fileno(stdout), fileno(old_stdout));
+	fd_renumber(fileno(stderr), fileno(old_stderr));
+	fd_renumber(fileno(temp_stdouterr_w), fileno(stdout));
+	fd_renumber(fileno(temp_stdouterr_w), fileno(stderr));
+	fclose(temp_stdouterr_w);
+	abc::Abc_Start();
+	abc::Abc_Frame_t *abc_frame = abc::Abc_FrameGetGlobalFrame();
+	abc::Abc_FrameSetBatchMode(1);
+	if (job.abc_ntk != nullptr)
+		abc::Abc_FrameReplaceCurrentNetwork(abc_frame, job.abc_ntk);
+	job.abc_ntk = nullptr;
+	int ret = abc::Cmd_CommandExecute(abc_frame, job.abc_command.c_str());
+	// A "quit" in the script stops execution with -1.
+	if (ret < 0)
+		ret = 0;
+	fflush(stdout);
+	fflush(stderr);
+	fd_renumber(fileno(old_stdout), fileno(stdout));
+	fd_renumber(fileno(old_stderr), fileno(stderr));
+	fclose(old_stdout);
+	fclose(old_stderr);
+	// The mapped network refers to the gate library of the ABC frame, so it has
+	// to be converted before the frame is stopped. Linked ABC jobs always run
+	// on the main thread (see AbcPass::execute()), so this may use the kernel.
+	if (ret == 0 && job.in_memory) {
+		abc::Abc_Ntk_t *mapped_ntk = abc::Abc_FrameReadNtk(abc_frame);
+		if (mapped_ntk != nullptr)
+			job.mapped_design = extract_abc_network(mapped_ntk, job.dff_name, job.sop_mode);
+		if (job.mapped_design == nullptr)
+			ret = 1;
+	}
+	abc::Abc_Stop();
+	std::ifstream temp_stdouterr_r(temp_stdouterr_name);
+	abc_output_filter filt(tempdir_name, show_tempdir);
+	for (std::string line; std::getline(temp_stdouterr_r, line); )
+		if (stream_output)
 			filt.next_line(line + "\n");
-		temp_stdouterr_r.close();
+		else
+			job.abc_output.push_back(line + "\n");
+	temp_stdouterr_r.close();
 #endif
-		if (ret != 0)
-			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+	job.abc_ret = ret;
+}
+
+// Re-integrates the results of a job. This expects the state of the job in
+// the global variables and closes the log level opened by abc_module().
+void abc_module_import(RTLIL::Design *design, abc_job_t &job, std::vector<std::string> &liberty_files, std::vector<std::string> &genlib_files,
+		bool cleanup, bool show_tempdir, bool sop_mode)
+{
+	std::string tempdir_name = job.tempdir_name;
+	std::string buffer;
 
-		buffer = stringf("%s/%s", tempdir_name.c_str(), "output.blif");
-		std::ifstream ifs;
-		ifs.open(buffer);
-		if (ifs.fail())
-			log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
+	if (!job.abc_command.empty())
+	{
+		if (!job.abc_output.empty()) {
+			abc_output_filter filt(tempdir_name, show_tempdir);
+			for (auto &line : job.abc_output)
+				filt.next_line(line);
+		}
+
+		if (job.abc_ret != 0)
+			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", job.abc_command.c_str(), job.abc_ret);
 
 		bool builtin_lib = liberty_files.empty() && genlib_files.empty();
-		RTLIL::Design *mapped_design = new RTLIL::Design;
-		parse_blif(mapped_design, ifs, builtin_lib ? ID(DFF) : ID(_dff_), false, sop_mode);
+		RTLIL::Design *mapped_design = job.mapped_design;
+		job.mapped_design = nullptr;
 
-		ifs.close();
+		if (mapped_design == nullptr)
+		{
+			buffer = stringf("%s/%s", tempdir_name.c_str(), "output.blif");
+			std::ifstream ifs;
+			ifs.open(buffer);
+			if (ifs.fail())
+				log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
+
+			mapped_design = new RTLIL::Design;
+			parse_blif(mapped_design, ifs, builtin_lib ? ID(DFF) : ID(_dff_), false, sop_mode);
+
+			ifs.close();
+		}
 
 		log_header(design, "Re-integrating ABC results.\n");
 		RTLIL::Module *mapped_mod = mapped_design->module(ID(netlist));
@@ -1437,10 +1822,6 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 
 		delete mapped_design;
 	}
-	else
-	{
-		log("Don't call ABC as there is nothing to map.\n");
-	}
 
 	if (cleanup)
 	{
@@ -1629,11 +2010,24 @@ struct AbcPass : public Pass {
 		log("        this attribute is a unique integer for each ABC process started. This\n");
 		log("        is useful for debugging the partitioning of clock domains.\n");
 		log("\n");
+		log("    -blif\n");
+		log("        when ABC is linked into Yosys, exchange the netlists with it through\n");
+		log("        input.blif and output.blif in the temp dir, like with a separate ABC\n");
+		log("        executable, instead of in memory. This is useful for checking the\n");
+		log("        in-memory exchange. Without a linked ABC this is always done.\n");
+		log("\n");
 		log("    -dress\n");
 		log("        run the 'dress' command after all other ABC commands. This aims to\n");
 		log("        preserve naming by an equivalence check between the original and\n");
 		log("        post-ABC netlists (experimental).\n");
 		log("\n");
+		log("    -j <threads>\n");
+		log("        run up to the given number of ABC processes at the same time (0 = one\n");
+		log("        per hardware thread). The logic of all selected modules (and, with -dff,\n");
+		log("        of all clock domains) is always extracted first and the results are\n");
+		log("        re-integrated in extraction order, so the mapped design, including the\n");
+		log("        names of the created objects, is the same as that of a run without -j.\n");
+		log("\n");
 		log("When no target cell library is specified the Yosys standard cell library is\n");
 		log("loaded into ABC before the ABC script is executed.\n");
 		log("\n");
@@ -1666,8 +2060,10 @@ struct AbcPass : public Pass {
 		bool fast_mode = false, dff_mode = false, keepff = false, cleanup = true;
 		bool show_tempdir = false, sop_mode = false;
 		bool abc_dress = false;
+		int threads = -1;
 		vector<int> lut_costs;
 		markgroups = false;
+		blif_exchange = false;
 
 		map_mux4 = false;
 		map_mux8 = false;
@@ -1800,6 +2196,10 @@ struct AbcPass : public Pass {
 				abc_dress = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (arg == "-g" && argidx+1 < args.size()) {
 				if (g_arg_from_cmd)
 					log_cmd_error("Can only use -g once. Please combine.");
@@ -1837,6 +2237,10 @@ struct AbcPass : public Pass {
 				markgroups = true;
 				continue;
 			}
+			if (arg == "-blif") {
+				blif_exchange = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -2042,6 +2446,24 @@ struct AbcPass : public Pass {
 			// enabled_gates.insert("NMUX");
 		}
 
+#ifdef YOSYS_LINK_ABC
+		// The linked ABC redirects the process-wide stdout and stderr while it runs.
+		if (threads > 1) {
+			log("Running one ABC job at a time as ABC is linked into Yosys.\n");
+			threads = 1;
+		}
+#endif
+
+		// All selected modules are extracted before the first ABC process is
+		// started, with and without -j, so that the names used for the mapped
+		// netlists (map_autoidx and the objects created while reading them) are
+		// handed out in the same order no matter how many processes run at once.
+		std::vector<abc_job_t> jobs;
+		auto finish_job = [&]() {
+			swap_job_state(jobs.back());
+			log_pop();
+		};
+
 		for (auto mod : design->selected_modules())
 		{
 			if (mod->processes.size() > 0) {
@@ -2053,8 +2475,11 @@ struct AbcPass : public Pass {
 			initvals.set(&assign_map, mod);
 
 			if (!dff_mode || !clk_str.empty()) {
+				jobs.emplace_back();
 				abc_module(design, mod, script_file, exe_file, liberty_files, genlib_files, constr_file, cleanup, lut_costs, dff_mode, clk_str, keepff,
-						delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, mod->selected_cells(), show_tempdir, sop_mode, abc_dress, dont_use_cells);
+						delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, mod->selected_cells(), show_tempdir, sop_mode, abc_dress, dont_use_cells,
+						jobs.back(), nullptr);
+				finish_job();
 				continue;
 			}
 
@@ -2206,6 +2631,13 @@ struct AbcPass : public Pass {
 						std::get<4>(it.first) ? "" : "!", log_signal(std::get<5>(it.first)),
 						std::get<6>(it.first) ? "" : "!", log_signal(std::get<7>(it.first)));
 
+			// The cells of the domains extracted before are not replaced by
+			// their mapped netlists yet, so the signals that cross into these
+			// domains have to be kept as ports explicitly. These are the inputs
+			// and outputs of the earlier jobs, i.e. the bits a mapped netlist
+			// would read or drive.
+			pool<RTLIL::SigBit> extracted_ports;
+
 			for (auto &it : assigned_cells) {
 				clk_polarity = std::get<0>(it.first);
 				clk_sig = assign_map(std::get<1>(it.first));
@@ -2215,12 +2647,56 @@ struct AbcPass : public Pass {
 				arst_sig = assign_map(std::get<5>(it.first));
 				srst_polarity = std::get<6>(it.first);
 				srst_sig = assign_map(std::get<7>(it.first));
+				jobs.emplace_back();
 				abc_module(design, mod, script_file, exe_file, liberty_files, genlib_files, constr_file, cleanup, lut_costs, !clk_sig.empty(), "$",
-						keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, it.second, show_tempdir, sop_mode, abc_dress, dont_use_cells);
+						keepff, delay_target, sop_inputs, sop_products, lutin_shared, fast_mode, it.second, show_tempdir, sop_mode, abc_dress, dont_use_cells,
+						jobs.back(), &extracted_ports);
+				finish_job();
+				for (auto &si : jobs.back().signal_list)
+					if (si.is_port && si.bit.wire != nullptr)
+						extracted_ports.insert(si.bit);
 				assign_map.set(mod);
 			}
 		}
 
+		if (!jobs.empty())
+		{
+			int abc_count = 0;
+			for (auto &job : jobs)
+				if (!job.abc_command.empty())
+					abc_count++;
+
+			if (threads < 0) {
+				log_header(design, "Running %d ABC process%s.\n", abc_count, abc_count != 1 ? "es" : "");
+				for (auto &job : jobs)
+					if (!job.abc_command.empty())
+						abc_module_run(job, show_tempdir, true);
+			} else {
+				log_header(design, "Running %d ABC process%s on up to %d thread%s.\n", abc_count, abc_count != 1 ? "es" : "",
+						threads, threads != 1 ? "s" : "");
+				parallel_for(threads, GetSize(jobs), [&](int i) {
+					if (!jobs[i].abc_command.empty())
+						abc_module_run(jobs[i], show_tempdir, false);
+				});
+			}
+
+			RTLIL::Module *current_mod = nullptr;
+			for (int i = 0; i < GetSize(jobs); i++)
+			{
+				abc_job_t &job = jobs[i];
+				if (job.module != current_mod) {
+					current_mod = job.module;
+					assign_map.set(current_mod);
+					initvals.set(&assign_map, current_mod);
+				}
+				log_header(design, "Re-integrating ABC job %d of %d (module `%s').\n", i+1, GetSize(jobs), log_id(current_mod));
+				log_push();
+				swap_job_state(job);
+				abc_module_import(design, job, liberty_files, genlib_files, cleanup, show_tempdir, sop_mode);
+			}
+			jobs.clear();
+		}
+
 		assign_map.clear();
 		signal_list.clear();
 		signal_map.clear();
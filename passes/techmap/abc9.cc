@@ -97,6 +97,10 @@ struct Abc9Pass : public ScriptPass
 		log("ABC tool [1] for technology mapping of the current design to a target FPGA\n");
 		log("architecture. Only fully-selected modules are supported.\n");
 		log("\n");
+		log("The netlist is exchanged with ABC through XAIGER files in a temp dir, also\n");
+		log("when ABC is linked into Yosys (unlike the 'abc' pass, which hands it over in\n");
+		log("memory then).\n");
+		log("\n");
 		log("    -run <from_label>:<to_label>\n");
 		log("        only run the commands between the labels (see below). an empty\n");
 		log("        from label is synonymous to 'begin', and empty to label is\n");
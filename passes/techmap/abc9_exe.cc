@@ -280,6 +280,11 @@ void abc9_module(RTLIL::Design *design, std::string script_file, std::string exe
 	abc9_output_filter filt(tempdir_name, show_tempdir);
 	int ret = run_command(buffer, std::bind(&abc9_output_filter::next_line, filt, std::placeholders::_1));
 #else
+	// Unlike 'abc', this still exchanges the netlist through files: ABC can read
+	// an XAIGER netlist from memory (Gia_AigerReadFromMemory()), but it writes
+	// the mapping, box and timing extensions that read_aiger/read_xaiger2 need
+	// only to files, so an in-memory path has to convert the mapped Gia_Man_t
+	// to RTLIL directly.
 	string temp_stdouterr_name = stringf("%s/stdouterr.txt", tempdir_name.c_str());
 	FILE *temp_stdouterr_w = fopen(temp_stdouterr_name.c_str(), "w");
 	if (temp_stdouterr_w == NULL)
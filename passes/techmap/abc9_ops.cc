@@ -1564,7 +1564,9 @@ clone_lut:
 }
 
 struct Abc9OpsPass : public Pass {
-	Abc9OpsPass() : Pass("abc9_ops", "helper functions for ABC9") { }
+	Abc9OpsPass() : Pass("abc9_ops", "helper functions for ABC9") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
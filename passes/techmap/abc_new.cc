@@ -57,6 +57,10 @@ struct AbcNewPass : public ScriptPass {
 		log("This command uses the ABC tool [1] to optimize the current design and map it to\n");
 		log("the target standard cell library.\n");
 		log("\n");
+		log("The netlist is exchanged with ABC through XAIGER files in a temp dir, also\n");
+		log("when ABC is linked into Yosys (unlike the 'abc' pass, which hands it over in\n");
+		log("memory then).\n");
+		log("\n");
 		log("    -run <from_label>:<to_label>\n");
 		log("        only run the commands between the labels (see below). an empty\n");
 		log("        from label is synonymous to 'begin', and empty to label is\n");
@@ -41,7 +41,9 @@ void constmap_worker(RTLIL::SigSpec &sig)
 }
 
 struct ConstmapPass : public Pass {
-	ConstmapPass() : Pass("constmap", "technology mapping of coarse constant value") { }
+	ConstmapPass() : Pass("constmap", "technology mapping of coarse constant value") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		log("\n");
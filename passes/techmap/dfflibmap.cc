@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
 #include "kernel/gzip.h"
+#include "kernel/threading.h"
 #include "libparse.h"
 #include <string.h>
 #include <errno.h>
@@ -550,7 +551,7 @@ struct DfflibmapPass : public Pass {
 	void help() override
 	{
 		log("\n");
-		log("    dfflibmap [-prepare] [-map-only] [-info] [-dont_use <cell_name>] -liberty <file> [selection]\n");
+		log("    dfflibmap [-prepare] [-map-only] [-info] [-dont_use <cell_name>] [-j <threads>] -liberty <file> [selection]\n");
 		log("\n");
 		log("Map internal flip-flop cells to the flip-flop cells in the technology\n");
 		log("library specified in the given liberty files.\n");
@@ -576,6 +577,10 @@ struct DfflibmapPass : public Pass {
 		log("This argument can be called multiple times with different cell names. This\n");
 		log("argument also supports simple glob patterns in the cell name.\n");
 		log("\n");
+		log("The liberty files are split at their cell groups, and only the flip-flop\n");
+		log("cells are kept. With -j, the cells are parsed on the given number of\n");
+		log("threads (0 = one per hardware thread).\n");
+		log("\n");
 	}
 	void execute(std::vector<std::string> args, RTLIL::Design *design) override
 	{
@@ -585,6 +590,7 @@ struct DfflibmapPass : public Pass {
 		bool prepare_mode = false;
 		bool map_only_mode = false;
 		bool info_mode = false;
+		int threads = 1;
 
 		std::vector<std::string> liberty_files;
 		std::vector<std::string> dont_use_cells;
@@ -615,6 +621,10 @@ struct DfflibmapPass : public Pass {
 				dont_use_cells.push_back(args[++argidx]);
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				threads = parallel_thread_count(atoi(args[++argidx].c_str()));
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -635,7 +645,7 @@ struct DfflibmapPass : public Pass {
 		LibertyMergedCells merged;
 		for (auto path : liberty_files) {
 			std::istream* f = uncompressed(path);
-			LibertyParser p(*f, path);
+			LibertyParser p(*f, path, threads, [](const LibertyAst *cell) { return cell->find("ff") != nullptr; });
 			merged.merge(p);
 			delete f;
 		}
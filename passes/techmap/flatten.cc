@@ -315,7 +315,9 @@ struct FlattenWorker
 };
 
 struct FlattenPass : public Pass {
-	FlattenPass() : Pass("flatten", "flatten design") { }
+	FlattenPass() : Pass("flatten", "flatten design") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -54,7 +54,9 @@ void hilomap_worker(RTLIL::SigSpec &sig)
 }
 
 struct HilomapPass : public Pass {
-	HilomapPass() : Pass("hilomap", "technology mapping of constant hi- and/or lo-drivers") { }
+	HilomapPass() : Pass("hilomap", "technology mapping of constant hi- and/or lo-drivers") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		log("\n");
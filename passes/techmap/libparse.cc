@@ -28,6 +28,8 @@
 
 #ifndef FILTERLIB
 #include "kernel/log.h"
+#include "kernel/threading.h"
+#include <stdexcept>
 #endif
 
 using namespace Yosys;
@@ -45,11 +47,15 @@ std::shared_ptr<const LibertyAst> LibertyAstCache::cached_ast(const std::string
 	return it->second;
 }
 
-void LibertyAstCache::parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast)
+bool LibertyAstCache::should_cache(const std::string &fname) const
 {
 	auto it = cache_path.find(fname);
-	bool should_cache = it == cache_path.end() ? cache_by_default : it->second;
-	if (!should_cache)
+	return it == cache_path.end() ? cache_by_default : it->second;
+}
+
+void LibertyAstCache::parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast)
+{
+	if (!should_cache(fname))
 		return;
 	log("Caching data for liberty file `%s'\n", fname.c_str());
 	cached.emplace(fname, ast);
@@ -70,7 +76,7 @@ bool LibertyInputStream::extend_buffer_once()
 		buf_end -= move_pos;
 	}
 
-	const size_t chunk_size = 4096;
+	const size_t chunk_size = 65536;
 	if (buffer.size() < buf_end + chunk_size) {
 		buffer.resize(buf_end + chunk_size);
 	}
@@ -605,6 +611,8 @@ LibertyAst *LibertyParser::parse(bool top_level)
 
 void LibertyParser::error() const
 {
+	if (chunk_mode)
+		throw std::runtime_error(stringf("Syntax error in liberty file on line %d.\n", line));
 	log_error("Syntax error in liberty file on line %d.\n", line);
 }
 
@@ -613,9 +621,177 @@ void LibertyParser::error(const std::string &str) const
 	std::stringstream ss;
 	ss << "Syntax error in liberty file on line " << line << ".\n";
 	ss << "  " << str << "\n";
+	if (chunk_mode)
+		throw std::runtime_error(ss.str());
 	log_error("%s", ss.str().c_str());
 }
 
+namespace {
+	// Serves a part of the file text to a LibertyParser without copying it.
+	struct LibertyChunkBuf : std::streambuf {
+		LibertyChunkBuf(const char *begin, const char *end) {
+			setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+		}
+	};
+}
+
+LibertyParser::LibertyParser(std::istream &f, const std::string &fname, int threads,
+		const std::function<bool(const LibertyAst*)> &cell_filter) : f(f), line(1)
+{
+	shared_ast = LibertyAstCache::instance.cached_ast(fname);
+	if (!shared_ast) {
+		bool complete = !cell_filter || LibertyAstCache::instance.should_cache(fname);
+		if (threads > 1 || !complete)
+			shared_ast.reset(parse_chunked(f, threads, complete ? nullptr : cell_filter));
+		else
+			shared_ast.reset(parse(true));
+		if (complete)
+			LibertyAstCache::instance.parsed_ast(fname, shared_ast);
+	}
+	ast = shared_ast.get();
+	if (!ast) {
+		log_error("No entries found in liberty file `%s'.\n", fname.c_str());
+	}
+}
+
+// Finds the cell groups directly inside the top-level group with a light
+// scan that only tracks strings, comments, braces and lines. The cells are
+// parsed on worker threads, and the rest of the file is parsed on the calling
+// thread with a "yosys_cell_chunk : <index> ;" statement in place of each
+// cell, followed by as many newlines as the cell spans.
+LibertyAst *LibertyParser::parse_chunked(std::istream &in, int threads, const std::function<bool(const LibertyAst*)> &cell_filter)
+{
+	std::string text;
+	{
+		char buffer[65536];
+		while (1) {
+			std::streamsize n = in.rdbuf()->sgetn(buffer, sizeof(buffer));
+			if (n <= 0)
+				break;
+			text.append(buffer, n);
+		}
+	}
+
+	struct chunk_t {
+		size_t begin, end;
+		int line;
+	};
+	std::vector<chunk_t> chunks;
+
+	auto is_id_char = [](char c) {
+		return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.';
+	};
+
+	size_t n = text.size(), i = 0, chunk_begin = 0;
+	int depth = 0, text_line = 1, chunk_line = 0;
+	bool in_chunk = false, scan_ok = true;
+	while (i < n && scan_ok)
+	{
+		char c = text[i];
+		if (c == '\n') {
+			text_line++;
+			i++;
+		} else if (c == '"') {
+			for (i++; i < n && text[i] != '"'; i++)
+				text_line += text[i] == '\n';
+			i++;
+		} else if (c == '/' && i+1 < n && text[i+1] == '*') {
+			for (i += 2; i+1 < n && !(text[i] == '*' && text[i+1] == '/'); i++)
+				text_line += text[i] == '\n';
+			i += 2;
+		} else if (c == '/' && i+1 < n && text[i+1] == '/') {
+			while (i < n && text[i] != '\n')
+				i++;
+		} else if (c == '{') {
+			depth++;
+			i++;
+		} else if (c == '}') {
+			depth--;
+			i++;
+			if (depth < 0)
+				scan_ok = false;
+			if (in_chunk && depth == 1) {
+				chunks.push_back({chunk_begin, i, chunk_line});
+				in_chunk = false;
+			}
+		} else if (c == ';' && in_chunk && depth == 1) {
+			// a cell statement without a group
+			in_chunk = false;
+			i++;
+		} else if (depth == 1 && !in_chunk && text.compare(i, 4, "cell") == 0 &&
+				(i == 0 || !is_id_char(text[i-1])) && (i+4 == n || !is_id_char(text[i+4]))) {
+			size_t k = i+4;
+			while (k < n && (text[k] == ' ' || text[k] == '\t'))
+				k++;
+			if (k < n && text[k] == '(') {
+				in_chunk = true;
+				chunk_begin = i;
+				chunk_line = text_line;
+			}
+			i += 4;
+		} else
+			i++;
+	}
+
+	if (!scan_ok || in_chunk || depth != 0)
+		chunks.clear();
+
+	std::string skeleton;
+	size_t pos = 0;
+	for (int k = 0; k < GetSize(chunks); k++) {
+		skeleton.append(text, pos, chunks[k].begin - pos);
+		skeleton += stringf("yosys_cell_chunk : %d ;", k);
+		skeleton.append(std::count(text.begin() + chunks[k].begin, text.begin() + chunks[k].end, '\n'), '\n');
+		pos = chunks[k].end;
+	}
+	skeleton.append(text, pos, std::string::npos);
+
+	std::vector<LibertyAst*> cells(GetSize(chunks));
+	try {
+		parallel_for(threads, GetSize(chunks), [&](int k) {
+			LibertyChunkBuf buf(text.data() + chunks[k].begin, text.data() + chunks[k].end);
+			std::istream stream(&buf);
+			LibertyParser parser(stream, chunks[k].line, true);
+			LibertyAst *cell = parser.parse(false);
+			if (cell != nullptr && cell_filter && !cell_filter(cell)) {
+				delete cell;
+				cell = nullptr;
+			}
+			cells[k] = cell;
+		});
+	} catch (const std::runtime_error &e) {
+		for (auto cell : cells)
+			delete cell;
+		log_error("%s", e.what());
+	}
+	text.clear();
+	text.shrink_to_fit();
+
+	std::istringstream skeleton_stream(skeleton);
+	LibertyParser skeleton_parser(skeleton_stream, 1, false);
+	LibertyAst *ast = skeleton_parser.parse(true);
+
+	if (ast != nullptr) {
+		std::vector<LibertyAst*> children;
+		for (auto child : ast->children) {
+			if (child->id != "yosys_cell_chunk") {
+				children.push_back(child);
+				continue;
+			}
+			int k = atoi(child->value.c_str());
+			if (cells[k] != nullptr)
+				children.push_back(cells[k]);
+			cells[k] = nullptr;
+			delete child;
+		}
+		ast->children.swap(children);
+	}
+
+	for (auto cell : cells)
+		delete cell;
+	return ast;
+}
+
 #else
 
 void LibertyParser::error() const
@@ -25,6 +25,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <functional>
 
 namespace Yosys
 {
@@ -143,6 +144,7 @@ namespace Yosys
 		dict<std::string, bool> cache_path;
 
 		std::shared_ptr<const LibertyAst> cached_ast(const std::string &fname);
+		bool should_cache(const std::string &fname) const;
 		void parsed_ast(const std::string &fname, const std::shared_ptr<const LibertyAst> &ast);
 		static LibertyAstCache instance;
 	};
@@ -169,6 +171,15 @@ namespace Yosys
 		void error() const;
 		void error(const std::string &str) const;
 
+#ifndef FILTERLIB
+		// Set when parsing a part of a file on a worker thread, where errors
+		// are thrown as std::runtime_error instead of being logged.
+		bool chunk_mode = false;
+
+		LibertyParser(std::istream &f, int line, bool chunk_mode) : f(f), line(line), chunk_mode(chunk_mode) {}
+		LibertyAst *parse_chunked(std::istream &in, int threads, const std::function<bool(const LibertyAst*)> &cell_filter);
+#endif
+
 	public:
 		std::shared_ptr<const LibertyAst> shared_ast;
 		const LibertyAst *ast = nullptr;
@@ -198,6 +209,13 @@ namespace Yosys
 				log_error("No entries found in liberty file `%s'.\n", fname.c_str());
 			}
 		}
+
+		// Splits the file at the cell groups of the library and parses these
+		// on up to the given number of threads. With a cell_filter, only the
+		// cells it accepts are kept; it is called on the worker threads. A
+		// filtered AST is not cached, and a cached AST is returned unfiltered.
+		LibertyParser(std::istream &f, const std::string &fname, int threads,
+				const std::function<bool(const LibertyAst*)> &cell_filter = nullptr);
 #endif
 	};
 
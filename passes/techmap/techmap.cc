@@ -22,10 +22,12 @@
 #include "kernel/sigtools.h"
 #include "kernel/ffinit.h"
 #include "libs/sha1/sha1.h"
+#include "frontends/verilog/preproc.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "simplemap.h"
 
@@ -978,6 +980,158 @@ struct TechmapWorker
 	}
 };
 
+// Process-wide cache of parsed map files, controlled with the techmapcache
+// command. Each map file is parsed once into its own design, keyed by the
+// frontend command (which includes the -D and -I options), the Verilog
+// defines left by the map files read before it and the file name. An entry
+// is invalidated when the size or the contents (compared by their SHA1 hash)
+// of the file or of one of the files it includes change. Modification times
+// are not used, as they can not tell apart edits within the same second on
+// all file systems.
+struct TechmapMapCache
+{
+	struct file_stamp_t {
+		std::string path;
+		long long size;
+		std::string hash;
+	};
+
+	struct entry_t {
+		std::string path;
+		std::vector<file_stamp_t> files;
+		RTLIL::Design *design;
+	};
+
+	bool cache_by_default = false;
+	dict<std::string, bool> cache_path;
+	dict<std::string, entry_t> cached;
+	std::string disk_dir;
+
+	bool enabled(const std::string &path) const
+	{
+		auto it = cache_path.find(path);
+		return it != cache_path.end() ? it->second : cache_by_default;
+	}
+
+	void purge(const std::string &path)
+	{
+		for (auto it = cached.begin(); it != cached.end();) {
+			if (path.empty() || it->second.path == path) {
+				delete it->second.design;
+				it = cached.erase(it);
+			} else
+				++it;
+		}
+	}
+
+	static file_stamp_t stamp(const std::string &path)
+	{
+		file_stamp_t st{path, -1, std::string()};
+		struct stat buf;
+		if (stat(path.c_str(), &buf) == 0) {
+			st.size = buf.st_size;
+			st.hash = SHA1::from_file(path);
+		}
+		return st;
+	}
+
+	static bool up_to_date(const entry_t &entry)
+	{
+		for (auto &st : entry.files) {
+			struct stat buf;
+			if (stat(st.path.c_str(), &buf) != 0 ? st.size != -1 : buf.st_size != st.size)
+				return false;
+			if (st.size != -1 && SHA1::from_file(st.path) != st.hash)
+				return false;
+		}
+		return true;
+	}
+
+	// Returns the parsed map file. 'defines' holds the Verilog defines of the
+	// map design before the file is read, and is updated to the defines after
+	// reading it, like reading the file into the map design would.
+	RTLIL::Design *lookup(const std::string &path, const std::string &frontend, define_map_t &defines)
+	{
+		std::string key = frontend + "\n" + defines.dump() + path;
+
+		auto it = cached.find(key);
+		if (it != cached.end()) {
+			if (up_to_date(it->second)) {
+				log("Using cached map file `%s'.\n", path.c_str());
+				defines.clear();
+				defines.merge(*it->second.design->verilog_defines);
+				return it->second.design;
+			}
+			delete it->second.design;
+			cached.erase(it);
+		}
+
+		entry_t entry;
+		entry.path = path;
+		entry.design = new RTLIL::Design;
+		entry.design->verilog_defines->clear();
+		entry.design->verilog_defines->merge(defines);
+
+		// Only RTLIL map files are kept on disk. Modules read from Verilog
+		// keep their AST to derive parametric templates, and that can not be
+		// stored in a checkpoint.
+		std::string disk_file;
+		file_stamp_t st = stamp(path);
+		if (!disk_dir.empty() && frontend == "rtlil" && st.size >= 0) {
+			std::string hash = sha1(stringf("%s\n%s\n%s", yosys_maybe_version(), key.c_str(), st.hash.c_str()));
+			disk_file = stringf("%s/%s.rtlilb", disk_dir.c_str(), hash.c_str());
+		}
+
+		// collect the files read by the frontend, including `include files
+		std::set<std::string> input_files;
+		std::swap(input_files, yosys_input_files);
+		if (!disk_file.empty() && check_file_exists(disk_file)) {
+			log("Loading map file `%s' from cache file `%s'.\n", path.c_str(), disk_file.c_str());
+			Frontend::frontend_call(entry.design, nullptr, disk_file, "rtlil_bin");
+		} else {
+			Frontend::frontend_call(entry.design, nullptr, path, frontend);
+			if (!disk_file.empty())
+				Backend::backend_call(entry.design, nullptr, disk_file, "rtlil_bin");
+		}
+		std::swap(input_files, yosys_input_files);
+
+		entry.files.push_back(st);
+		for (auto &fn : input_files) {
+			yosys_input_files.insert(fn);
+			if (fn != path && fn != disk_file)
+				entry.files.push_back(stamp(fn));
+		}
+
+		defines.clear();
+		defines.merge(*entry.design->verilog_defines);
+		RTLIL::Design *design = entry.design;
+		cached[key] = std::move(entry);
+		return design;
+	}
+
+	static TechmapMapCache instance;
+};
+
+TechmapMapCache TechmapMapCache::instance;
+
+void load_map_file(RTLIL::Design *map, const std::string &fn, const std::string &frontend)
+{
+	std::string path = fn;
+	rewrite_filename(path);
+
+	if (!TechmapMapCache::instance.enabled(path)) {
+		Frontend::frontend_call(map, nullptr, fn, frontend);
+		return;
+	}
+
+	// Same semantics as parsing into the map design with -nooverwrite:
+	// the first definition of a module wins.
+	RTLIL::Design *cached = TechmapMapCache::instance.lookup(path, frontend, *map->verilog_defines);
+	for (auto mod : cached->modules())
+		if (!map->module(mod->name))
+			map->add(mod->clone());
+}
+
 struct TechmapPass : public Pass {
 	TechmapPass() : Pass("techmap", "generic technology mapper") { }
 	void help() override
@@ -1214,7 +1368,7 @@ struct TechmapPass : public Pass {
 
 		RTLIL::Design *map = new RTLIL::Design;
 		if (map_files.empty()) {
-			Frontend::frontend_call(map, nullptr, "+/techmap.v", verilog_frontend);
+			load_map_file(map, "+/techmap.v", verilog_frontend);
 		} else {
 			for (auto &fn : map_files)
 				if (fn.compare(0, 1, "%") == 0) {
@@ -1226,7 +1380,7 @@ struct TechmapPass : public Pass {
 						if (!map->module(mod->name))
 							map->add(mod->clone());
 				} else {
-					Frontend::frontend_call(map, nullptr, fn, (fn.size() > 3 && fn.compare(fn.size()-3, std::string::npos, ".il") == 0 ? "rtlil" : verilog_frontend));
+					load_map_file(map, fn, (fn.size() > 3 && fn.compare(fn.size()-3, std::string::npos, ".il") == 0 ? "rtlil" : verilog_frontend));
 				}
 		}
 
@@ -1308,4 +1462,144 @@ struct TechmapPass : public Pass {
 	}
 } TechmapPass;
 
+struct TechmapCachePass : public Pass {
+	TechmapCachePass() : Pass("techmapcache", "control caching of techmap map files") { }
+	void on_shutdown() override
+	{
+		TechmapMapCache::instance.purge("");
+	}
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    techmapcache {-enable|-disable|-purge} { -all | [path]... }\n");
+		log("\n");
+		log("Controls the default and per path caching of map files parsed by techmap.\n");
+		log("A cached map file is only parsed again when the size or contents of the file\n");
+		log("or of one of the files it includes change, or when it is read with\n");
+		log("other frontend options or after map files that leave other Verilog defines.\n");
+		log("\n");
+		log("    -enable    Enable caching.\n");
+		log("    -disable   Disable caching.\n");
+		log("    -purge     Reset cache setting and forget cached data.\n");
+		log("\n");
+		log("This mode takes a list of paths as argument. If no paths are provided, this\n");
+		log("command does nothing. The -all option can be used to change the default cache\n");
+		log("setting for -enable/-disable or to reset and forget about all paths.\n");
+		log("\n");
+		log("By default caching is disabled.\n");
+		log("\n");
+		log("    techmapcache -dir <directory>\n");
+		log("    techmapcache -nodir\n");
+		log("\n");
+		log("Also keep cached RTLIL map files (.il) as binary RTLIL checkpoints in the given\n");
+		log("directory, so that later Yosys runs can load them instead of parsing the map\n");
+		log("file. The checkpoints are named after a hash of the Yosys version, the frontend\n");
+		log("options and the file contents. This only helps RTLIL map files: Verilog map\n");
+		log("files, including the builtin techmap.v and the map files of the technology\n");
+		log("libraries, are never written to disk, because their modules need the AST to\n");
+		log("derive parametric templates. They are only cached within one Yosys process.\n");
+		log("\n");
+		log("    techmapcache -list\n");
+		log("\n");
+		log("Displays the current cache settings and cached paths.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *) override
+	{
+		auto &cache = TechmapMapCache::instance;
+		bool enable = false;
+		bool disable = false;
+		bool purge = false;
+		bool all = false;
+		bool list = false;
+		bool set_dir = false;
+		std::string dir;
+		std::vector<std::string> paths;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-enable") {
+				enable = true;
+				continue;
+			}
+			if (args[argidx] == "-disable") {
+				disable = true;
+				continue;
+			}
+			if (args[argidx] == "-purge") {
+				purge = true;
+				continue;
+			}
+			if (args[argidx] == "-all") {
+				all = true;
+				continue;
+			}
+			if (args[argidx] == "-list") {
+				list = true;
+				continue;
+			}
+			if (args[argidx] == "-dir" && argidx+1 < args.size()) {
+				set_dir = true;
+				dir = args[++argidx];
+				rewrite_filename(dir);
+				continue;
+			}
+			if (args[argidx] == "-nodir") {
+				set_dir = true;
+				dir.clear();
+				continue;
+			}
+			std::string fname = args[argidx];
+			rewrite_filename(fname);
+			paths.push_back(fname);
+		}
+		int modes = enable + disable + purge + list + set_dir;
+		if (modes == 0)
+			log_cmd_error("At least one of -enable, -disable, -purge, -list, -dir or -nodir is required.\n");
+		if (modes > 1)
+			log_cmd_error("Only one of -enable, -disable, -purge, -list, -dir or -nodir may be present.\n");
+
+		if (all && !paths.empty())
+			log_cmd_error("The -all option cannot be combined with a list of paths.\n");
+		if ((list || set_dir) && (all || !paths.empty()))
+			log_cmd_error("The -list, -dir and -nodir modes take no further options.\n");
+		if (!list && !set_dir && !all && paths.empty())
+			log("No paths specified, use -all to %s\n", purge ? "purge all paths" : "change the default setting");
+
+		if (list) {
+			log("Caching is %s by default.\n", cache.cache_by_default ? "enabled" : "disabled");
+			if (!cache.disk_dir.empty())
+				log("Cache files are kept in `%s'.\n", cache.disk_dir.c_str());
+			for (auto const &entry : cache.cache_path)
+				log("Caching is %s for `%s'.\n", entry.second ? "enabled" : "disabled", entry.first.c_str());
+			for (auto const &entry : cache.cached)
+				log("Data for `%s' is currently cached.\n", entry.second.path.c_str());
+		} else if (set_dir) {
+			if (!dir.empty() && !check_directory_exists(dir))
+				log_cmd_error("Cache directory `%s' does not exist.\n", dir.c_str());
+			cache.disk_dir = dir;
+		} else if (enable || disable) {
+			if (all) {
+				cache.cache_by_default = enable;
+			} else {
+				for (auto const &path : paths)
+					cache.cache_path[path] = enable;
+			}
+		} else if (purge) {
+			if (all) {
+				cache.purge("");
+				cache.cache_path.clear();
+			} else {
+				for (auto const &path : paths) {
+					cache.purge(path);
+					cache.cache_path.erase(path);
+				}
+			}
+		} else {
+			log_assert(false);
+		}
+	}
+} TechmapCachePass;
+
 PRIVATE_NAMESPACE_END
@@ -276,7 +276,9 @@ void create_ice40_dsp(ice40_dsp_pm &pm)
 }
 
 struct Ice40DspPass : public Pass {
-	Ice40DspPass() : Pass("ice40_dsp", "iCE40: map multipliers") { }
+	Ice40DspPass() : Pass("ice40_dsp", "iCE40: map multipliers") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
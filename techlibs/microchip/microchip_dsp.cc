@@ -272,7 +272,9 @@ void microchip_dsp_packC(microchip_dsp_CREG_pm &pm)
 }
 
 struct MicrochipDspPass : public Pass {
-	MicrochipDspPass() : Pass("microchip_dsp", "MICROCHIP: pack resources into DSPs") {}
+	MicrochipDspPass() : Pass("microchip_dsp", "MICROCHIP: pack resources into DSPs") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
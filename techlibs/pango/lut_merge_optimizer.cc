@@ -145,29 +145,32 @@ bool LUTMergeOptimizer::optimize(Module *module)
         
         log("Selected %lu merges for execution\n", selected.size());
         
-        // 步骤3：执行合并
+        // 步骤3：执行合并（批量编辑，原始LUT在提交时统一删除）
         int merges_executed = 0;
-        for (const auto &candidate : selected) {
-            if (enable_debug) {
-                printCandidateInfo(candidate);
-            }
-            
-            if (executeSingleMerge(candidate)) {
-                merges_executed++;
-                successful_merges++;
-                merge_type_count[candidate.merge_type]++;
-                
+        {
+            RTLIL::ModuleEditGuard edit(module);
+            for (const auto &candidate : selected) {
                 if (enable_debug) {
-                    log("  Successfully merged %s + %s (type: %s, benefit: %.2f)\n",
-                        candidate.lut1->name.c_str(), candidate.lut2->name.c_str(),
-                        getMergeTypeString(candidate.merge_type).c_str(),
-                        candidate.total_benefit);
+                    printCandidateInfo(candidate);
                 }
-            } else {
-                if (enable_debug) {
-                    log("  Failed to merge %s + %s: %s\n",
-                        candidate.lut1->name.c_str(), candidate.lut2->name.c_str(),
-                        candidate.failure_reason.c_str());
+            
+                if (executeSingleMerge(candidate)) {
+                    merges_executed++;
+                    successful_merges++;
+                    merge_type_count[candidate.merge_type]++;
+                
+                    if (enable_debug) {
+                        log("  Successfully merged %s + %s (type: %s, benefit: %.2f)\n",
+                            candidate.lut1->name.c_str(), candidate.lut2->name.c_str(),
+                            getMergeTypeString(candidate.merge_type).c_str(),
+                            candidate.total_benefit);
+                    }
+                } else {
+                    if (enable_debug) {
+                        log("  Failed to merge %s + %s: %s\n",
+                            candidate.lut1->name.c_str(), candidate.lut2->name.c_str(),
+                            candidate.failure_reason.c_str());
+                    }
                 }
             }
         }
@@ -2675,6 +2675,7 @@ bool ConeToLUTs(Module *module, dict<SigBit, pool<SigBit>> &bit2cut)
 		Cell *lut = addLut(module, cut, out);
 		log_assert(lut);
 	}
+	RTLIL::ModuleEditGuard edit(module);
 	for (auto c : module->cells_) {
 		if (IsCombinationalGate(c.second)) {
 			module->remove(c.second);
@@ -2800,6 +2801,16 @@ struct SynthPangoPass : public ScriptPass {
 		log("    -interation <num>\n");  
 		log("        set iteration number for LUT mapping (default: 3, minimum: 3)\n");
 		log("\n");
+		log("    -balance\n");
+		log("        reduce the depth of the gates with 'balance' before LUT mapping\n");
+		log("\n");
+		log("    -rewrite\n");
+		log("        restructure the gates with 'aigrewrite' before LUT mapping\n");
+		log("\n");
+		log("    -fraig\n");
+		log("        merge functionally equivalent gates with 'fraig -inv' before LUT\n");
+		log("        mapping\n");
+		log("\n");
 		log("    -run <from_stage>:<to_stage>\n");
 		log("        run only the specified stages. Available stages:\n");
 		log("        begin, pango, lut_merge, check, verilog, score\n");
@@ -2829,6 +2840,9 @@ struct SynthPangoPass : public ScriptPass {
 	string input_verilog_file;
 	string output_verilog_file;
 	string top_module_name;
+	bool fraig;
+	bool rewrite;
+	bool balance;
 	
 	// === ✅ 新增: LUT合并配置成员变量 ===
 	bool enable_lut_merge;
@@ -2845,6 +2859,9 @@ struct SynthPangoPass : public ScriptPass {
 		using_internel_lut_type = false;
 		output_verilog_file = "";
 		top_module_name = "";
+		fraig = false;
+		rewrite = false;
+		balance = false;
 		
 		// ❌ 删除原有调用:
 		// clearLUTMergeFlags();  // 已删除：架构重构，功能已内联
@@ -2877,6 +2894,18 @@ struct SynthPangoPass : public ScriptPass {
 				MAX_INTERATIONS = max(atoi(args[++argidx].c_str()), 3);
 				continue;
 			}
+			if (args[argidx] == "-fraig") {
+				fraig = true;
+				continue;
+			}
+			if (args[argidx] == "-balance") {
+				balance = true;
+				continue;
+			}
+			if (args[argidx] == "-rewrite") {
+				rewrite = true;
+				continue;
+			}
 			
 			// ❌ 删除原有调用:
 			// if (parseLUTMergeArgs(args, argidx)) {
@@ -2966,6 +2995,12 @@ struct SynthPangoPass : public ScriptPass {
 
 		if (check_label("pango")) {
 			run(stringf("hierarchy -check -top %s;;", top_module_name.c_str()));
+			if (balance)
+				run("balance; opt_clean");
+			if (rewrite)
+				run("aigrewrite; opt_clean");
+			if (fraig)
+				run("fraig -inv; opt_clean");
 			MapperInit(module);
 			MapperMain(module);  // 这会填充全局bit2depth变量
 			
@@ -3026,7 +3061,7 @@ struct SynthPangoPass : public ScriptPass {
 			run("check -mapped");
 		}
 		if (check_label("verilog")) {
-			run(stringf("write_verilog -noexpr -noattr %s_syn.v", top_module_name.c_str() + 1));
+			run(stringf("write_verilog -noexpr -noattr -fast %s_syn.v", top_module_name.c_str() + 1));
 		}
 		if (check_label("score")) {
 			run(stringf("score -before %s -after %s_syn.v", input_verilog_file.c_str(), top_module_name.c_str() + 1));
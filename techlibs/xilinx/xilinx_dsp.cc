@@ -726,7 +726,9 @@ void xilinx_dsp_packC(xilinx_dsp_CREG_pm &pm)
 }
 
 struct XilinxDspPass : public Pass {
-	XilinxDspPass() : Pass("xilinx_dsp", "Xilinx: pack resources into DSPs") { }
+	XilinxDspPass() : Pass("xilinx_dsp", "Xilinx: pack resources into DSPs") {
+		bypasses_monitors();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
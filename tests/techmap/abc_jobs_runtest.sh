@@ -0,0 +1,51 @@
+set -e
+
+# abc -j has to produce the same netlist, including the names of the
+# generated wires and cells, as a serial abc run
+cat > abc_jobs_diff.v <<EOT
+module top(input clk1, clk2, input [3:0] a, b, output reg [3:0] x, y, output [3:0] z, w);
+	always @(posedge clk1)
+		x <= a + b;
+	always @(posedge clk2)
+		y <= x ^ {b[0], b[3:1]};
+	sub s1(.clk(clk1), .a(a), .b(x), .y(z));
+	sub s2(.clk(clk2), .a(b), .b(y), .y(w));
+endmodule
+
+module sub(input clk, input [3:0] a, b, output reg [3:0] y);
+	always @(posedge clk)
+		y <= a * b;
+endmodule
+EOT
+
+for j in 1 4; do
+	../../yosys -q -p "read_verilog abc_jobs_diff.v; proc; techmap; opt_clean; abc -dff -j $j; write_rtlil abc_jobs_diff_j$j.il"
+done
+../../yosys -q -p "read_verilog abc_jobs_diff.v; proc; techmap; opt_clean; abc -dff; write_rtlil abc_jobs_diff_serial.il"
+
+cmp abc_jobs_diff_serial.il abc_jobs_diff_j1.il
+cmp abc_jobs_diff_serial.il abc_jobs_diff_j4.il
+
+# several clock domains of one module whose logic reads and drives signals of
+# the other domains, in both extraction orders
+cat > abc_jobs_domains.v <<EOT
+module top(input clk1, clk2, clk3, en, input [3:0] a, b, output reg [3:0] p, q, r, output [3:0] s);
+	wire [3:0] t = p & ~q;
+	always @(posedge clk1)
+		p <= a + r;
+	always @(posedge clk2)
+		if (en) q <= t ^ b;
+	always @(negedge clk3)
+		r <= (p | q) - t;
+	assign s = t + r;
+endmodule
+EOT
+
+for j in 1 2 4; do
+	../../yosys -q -p "read_verilog abc_jobs_domains.v; proc; techmap; opt_clean; abc -dff -j $j; write_rtlil abc_jobs_domains_j$j.il"
+done
+../../yosys -q -p "read_verilog abc_jobs_domains.v; proc; techmap; opt_clean; abc -dff; write_rtlil abc_jobs_domains_serial.il"
+
+for j in 1 2 4; do
+	cmp abc_jobs_domains_serial.il abc_jobs_domains_j$j.il
+done
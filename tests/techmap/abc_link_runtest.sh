@@ -0,0 +1,33 @@
+set -e
+
+# With ABC linked into Yosys (make LINK_ABC=1) the abc pass hands the netlist
+# over in memory; the result has to match the BLIF exchange of abc -blif. In
+# other builds both runs use BLIF files and this only checks -blif is accepted.
+cat > abc_link_diff.v <<EOT
+module top(input clk, input [3:0] a, b, input [1:0] s, output reg [3:0] x, output [3:0] y, z);
+	always @(posedge clk)
+		x <= s[0] ? a + b : a - b;
+	assign y = s[1] ? a * b : ~x;
+	sub u(.a(a), .b(x), .y(z));
+endmodule
+
+module sub(input [3:0] a, b, output [3:0] y);
+	assign y = (a & b) | {a[0], a[3:1]};
+endmodule
+EOT
+
+for mode in "" "-dff" "-lut 4" "-sop" "-g AND,NAND,OR,NOR,XOR,XNOR,MUX"; do
+	for exchange in mem blif; do
+		flag=""
+		[ $exchange = blif ] && flag="-blif"
+		../../yosys -q -l abc_link_diff_$exchange.log -p "read_verilog abc_link_diff.v; proc; techmap; opt_clean; abc $mode $flag; write_rtlil abc_link_diff_$exchange.il"
+	done
+	# set by "make test-link-abc" to make sure the in-memory exchange was used
+	if [ "${ABC_LINKED:-0}" = 1 ]; then
+		grep -q "Running linked ABC on the extracted network" abc_link_diff_mem.log
+		if grep -q "Running linked ABC on the extracted network" abc_link_diff_blif.log; then
+			exit 1
+		fi
+	fi
+	cmp abc_link_diff_mem.il abc_link_diff_blif.il
+done
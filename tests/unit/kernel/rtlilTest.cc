@@ -166,6 +166,127 @@ namespace RTLIL {
 			EXPECT_EQ(wire->from_hdl_index(j), INT_MIN);
 	}
 
+	struct EditCountingMonitor : public Monitor {
+		int port_notifications = 0;
+		int edit_notifications = 0;
+		void notify_connect(Cell*, const IdString&, const SigSpec&, const SigSpec&) override { port_notifications++; }
+		void notify_edit(Module *module, const ModuleEdit &edit) override {
+			edit_notifications++;
+			Monitor::notify_edit(module, edit);
+		}
+	};
+
+	TEST_F(KernelRtlilTest, ModuleBatchEdit)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *b = module->addWire(ID(b));
+		Wire *y = module->addWire(ID(y));
+		Cell *and_cell = module->addAndGate(ID(and), a, b, y);
+		Cell *not_cell = module->addNotGate(ID(not), a, b);
+
+		EditCountingMonitor monitor;
+		module->monitors.insert(&monitor);
+
+		module->begin_edit();
+		module->begin_edit();
+		module->remove(and_cell);
+		not_cell->setPort(ID::Y, y);
+		not_cell->setPort(ID::Y, b);
+		Cell *buf_cell = module->addBufGate(ID(buf), a, y);
+		module->commit_edit();
+		EXPECT_EQ(monitor.edit_notifications, 0);
+		EXPECT_TRUE(module->is_editing());
+		module->commit_edit();
+		EXPECT_FALSE(module->is_editing());
+
+		// one batch notification; the \not port change cancels out
+		EXPECT_EQ(monitor.edit_notifications, 1);
+		EXPECT_EQ(monitor.port_notifications, 5);
+		EXPECT_EQ(module->cell(ID(and)), nullptr);
+		EXPECT_EQ(module->cell(ID(buf)), buf_cell);
+		EXPECT_EQ(GetSize(module->cells_), 2);
+
+		module->monitors.erase(&monitor);
+	}
+
+	struct PortRecordingMonitor : public Monitor
+	{
+		std::vector<IdString> old_wires;
+		void notify_connect(Cell*, const IdString&, const SigSpec &old_sig, const SigSpec&) override {
+			old_wires.push_back(old_sig.is_wire() ? old_sig.as_wire()->name : IdString());
+		}
+	};
+
+	TEST_F(KernelRtlilTest, ModuleEditGuardRemoveWire)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *y = module->addWire(ID(y));
+		Cell *not_cell = module->addNotGate(ID(not), a, y);
+
+		PortRecordingMonitor monitor;
+		module->monitors.insert(&monitor);
+
+		try {
+			RTLIL::ModuleEditGuard edit(module);
+			module->remove(not_cell);
+			module->remove(pool<Wire*>{a});
+			EXPECT_EQ(module->wire(ID(a)), nullptr);
+			throw std::runtime_error("abort");
+		} catch (const std::runtime_error &) {
+		}
+		EXPECT_FALSE(module->is_editing());
+
+		// the removed wire is still alive when monitors see the old \A signal
+		ASSERT_EQ(GetSize(monitor.old_wires), 2);
+		EXPECT_TRUE(monitor.old_wires[0] == ID(a) || monitor.old_wires[1] == ID(a));
+		EXPECT_EQ(module->cell(ID(not)), nullptr);
+
+		module->monitors.erase(&monitor);
+	}
+
+	struct BlackoutCountingMonitor : public Monitor
+	{
+		int blackouts = 0;
+		int removed_wires = 0;
+		void notify_blackout(Module*) override { blackouts++; }
+		void notify_edit(Module *module, const ModuleEdit &edit) override {
+			removed_wires += GetSize(edit.removed_wires);
+			Monitor::notify_edit(module, edit);
+		}
+	};
+
+	TEST_F(KernelRtlilTest, ModuleRemoveWireNotify)
+	{
+		Design design;
+		Module *module = design.addModule(ID(top));
+		Wire *a = module->addWire(ID(a));
+		Wire *y = module->addWire(ID(y));
+		Wire *unused = module->addWire(ID(unused));
+		module->addNotGate(ID(not), a, y);
+
+		BlackoutCountingMonitor monitor;
+		module->monitors.insert(&monitor);
+
+		// an unused wire is only reported as removed
+		module->remove(pool<Wire*>{unused});
+		EXPECT_EQ(monitor.removed_wires, 1);
+		EXPECT_EQ(monitor.blackouts, 0);
+
+		// the rewritten references of a used wire are not reported one by one
+		module->remove(pool<Wire*>{a});
+		EXPECT_EQ(monitor.removed_wires, 2);
+		EXPECT_EQ(monitor.blackouts, 1);
+
+		module->rename(y, ID(z));
+		EXPECT_EQ(monitor.blackouts, 2);
+
+		module->monitors.erase(&monitor);
+	}
+
 }
 
 YOSYS_NAMESPACE_END
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+set -e
+
+# the names generated by read_verilog -j do not depend on the number of workers
+cat > parallel_modules_names.v <<EOT
+module n1(input clk, input [3:0] a, b, output reg [3:0] y);
+always @(posedge clk) y <= a + b;
+endmodule
+
+module n2(input [3:0] a, b, output reg [3:0] y);
+always @* if (a[0]) y = a - b; else y = b;
+endmodule
+
+module n3(input [3:0] a, output [3:0] y);
+assign y = a * 3;
+endmodule
+EOT
+
+for j in 1 2 3; do
+	../../yosys -q -p "read_verilog -j $j parallel_modules_names.v; write_rtlil parallel_modules_j$j.il"
+done
+cmp parallel_modules_j1.il parallel_modules_j2.il
+cmp parallel_modules_j1.il parallel_modules_j3.il